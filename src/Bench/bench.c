@@ -0,0 +1,269 @@
+/*
+ * bench.c - microbenchmark harness.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/*
+ * Every benchmark program calls CPBench_Init() with its argv, one
+ * CPBench_Run() per case and CPBench_Finish() at the end.  Options:
+ *
+ *     --json             print one JSON document instead of a table
+ *     --warmup=N         untimed repetitions per case (default 3)
+ *     --repetitions=N    timed repetitions per case (default 15)
+ *     --filter=TEXT      only run cases whose name contains TEXT
+ *
+ * Each timed repetition runs the case `iterations' times; the reported
+ * figures are per iteration.  Hardware counters are summed over all
+ * timed repetitions when the kernel allows it.
+ */
+
+#include "config.h"
+#include "bench.h"
+#include <platform/clock.h>
+#include <platform/perfcounter.h>
+#include <version.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const char *name;
+    size_t iterations;
+    size_t repetitions;
+    size_t bytes;
+    double min_ns;
+    double median_ns;
+    double p90_ns;
+    double p99_ns;
+    double max_ns;
+    int available;
+    double counters[CP_PERF_EVENTS];
+} bench_result_t;
+
+volatile uintptr_t cp_bench_sink;
+
+static const char *suite_name;
+static int json = 0;
+static size_t warmup = 3;
+static size_t repetitions = 15;
+static const char *filter = NULL;
+static bench_result_t *results = NULL;
+static size_t result_count = 0;
+static size_t result_capacity = 0;
+
+static int
+parse_size(const char *arg, const char *option, size_t *value)
+{
+    size_t len = strlen(option);
+    if(strncmp(arg, option, len) != 0 || arg[len] != '=') {
+        return 0;
+    }
+    char *end;
+    unsigned long v = strtoul(arg + len + 1, &end, 10);
+    if(*end != '\0' || v == 0) {
+        fprintf(stderr, "Invalid value for %s\n", option);
+        return -1;
+    }
+    *value = (size_t)v;
+    return 1;
+}
+
+int
+CPBench_Init(int argc, char **argv, const char *suite)
+{
+    suite_name = suite;
+    for(int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        int r;
+        if(strcmp(arg, "--json") == 0) {
+            json = 1;
+        } else if(strncmp(arg, "--filter=", 9) == 0) {
+            filter = arg + 9;
+        } else if((r = parse_size(arg, "--warmup", &warmup)) != 0) {
+            if(r < 0) return -1;
+        } else if((r = parse_size(arg, "--repetitions", &repetitions)) != 0) {
+            if(r < 0) return -1;
+        } else {
+            fprintf(stderr, "Unknown option: %s\n", arg);
+            return -1;
+        }
+    }
+    if(!json) {
+        printf("%-40s %12s %12s %12s %12s %8s %10s\n",
+               suite, "median ns", "p90 ns", "p99 ns", "MB/s", "IPC", "faults/op");
+    }
+    return 0;
+}
+
+static int
+compare_doubles(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double
+percentile(const double *sorted, size_t n, double p)
+{
+    /* Nearest-rank percentile. */
+    size_t rank = (size_t)(p * (double)n + 0.999999);
+    if(rank == 0) rank = 1;
+    if(rank > n) rank = n;
+    return sorted[rank - 1];
+}
+
+static void
+print_row(const bench_result_t *r)
+{
+    char throughput[32] = "-";
+    char ipc[32] = "-";
+    if(r->bytes != 0) {
+        snprintf(throughput, sizeof(throughput), "%.1f",
+                 (double)r->bytes / r->median_ns * 1e9 / (1024.0 * 1024.0));
+    }
+    int both = (1 << CP_PERF_CYCLES) | (1 << CP_PERF_INSTRUCTIONS);
+    if((r->available & both) == both && r->counters[CP_PERF_CYCLES] > 0) {
+        snprintf(ipc, sizeof(ipc), "%.2f",
+                 r->counters[CP_PERF_INSTRUCTIONS] / r->counters[CP_PERF_CYCLES]);
+    }
+    char faults[32] = "-";
+    if(r->available & (1 << CP_PERF_PAGE_FAULTS)) {
+        snprintf(faults, sizeof(faults), "%.1f", r->counters[CP_PERF_PAGE_FAULTS]);
+    }
+    printf("%-40s %12.1f %12.1f %12.1f %12s %8s %10s\n",
+           r->name, r->median_ns, r->p90_ns, r->p99_ns, throughput, ipc, faults);
+}
+
+static void
+run_case(const char *name, CPBenchFunc setup, CPBenchFunc func, void *arg, size_t iterations, size_t bytes)
+{
+    if(filter != NULL && strstr(name, filter) == NULL) {
+        return;
+    }
+    if(result_count == result_capacity) {
+        size_t capacity = result_capacity ? result_capacity * 2 : 16;
+        bench_result_t *grown = realloc(results, capacity * sizeof(bench_result_t));
+        if(grown == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        results = grown;
+        result_capacity = capacity;
+    }
+    double *samples = malloc(repetitions * sizeof(double));
+    if(samples == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    for(size_t i = 0; i < warmup; i++) {
+        if(setup != NULL) {
+            setup(arg, iterations);
+        }
+        func(arg, iterations);
+    }
+    CPPerfCounter counter;
+    uint64_t totals[CP_PERF_EVENTS] = {0};
+    CPPerfCounter_Open(&counter);
+    for(size_t i = 0; i < repetitions; i++) {
+        if(setup != NULL) {
+            setup(arg, iterations);
+        }
+        CPPerfCounter_Start(&counter);
+        func(arg, iterations);
+        CPPerfCounter_Stop(&counter);
+        samples[i] = (double)counter.elapsed_ns / (double)iterations;
+        for(int e = 0; e < CP_PERF_EVENTS; e++) {
+            totals[e] += counter.values[e];
+        }
+    }
+    bench_result_t *r = &results[result_count++];
+    r->name = name;
+    r->iterations = iterations;
+    r->repetitions = repetitions;
+    r->bytes = bytes;
+    r->available = counter.available;
+    for(int e = 0; e < CP_PERF_EVENTS; e++) {
+        r->counters[e] = (double)totals[e] / (double)(iterations * repetitions);
+    }
+    CPPerfCounter_Close(&counter);
+    qsort(samples, repetitions, sizeof(double), compare_doubles);
+    r->min_ns = samples[0];
+    r->median_ns = percentile(samples, repetitions, 0.5);
+    r->p90_ns = percentile(samples, repetitions, 0.9);
+    r->p99_ns = percentile(samples, repetitions, 0.99);
+    r->max_ns = samples[repetitions - 1];
+    free(samples);
+    if(!json) {
+        print_row(r);
+        fflush(stdout);
+    }
+}
+
+void
+CPBench_RunBytes(const char *name, CPBenchFunc func, void *arg, size_t iterations, size_t bytes)
+{
+    run_case(name, NULL, func, arg, iterations, bytes);
+}
+
+void
+CPBench_Run(const char *name, CPBenchFunc func, void *arg, size_t iterations)
+{
+    run_case(name, NULL, func, arg, iterations, 0);
+}
+
+/*
+ * Like CPBench_Run() but call `setup' untimed before every repetition,
+ * for cases that consume their input.
+ */
+void
+CPBench_RunSetup(const char *name, CPBenchFunc setup, CPBenchFunc func, void *arg, size_t iterations)
+{
+    run_case(name, setup, func, arg, iterations, 0);
+}
+
+int
+CPBench_Finish(void)
+{
+    if(json) {
+        printf("{\"suite\":\"%s\",\"version\":\"%s\",\"warmup\":%lu,\"results\":[",
+               suite_name, CP_VERSION_STRING, (unsigned long)warmup);
+        for(size_t i = 0; i < result_count; i++) {
+            const bench_result_t *r = &results[i];
+            printf("%s\n{\"name\":\"%s\",\"iterations\":%lu,\"repetitions\":%lu,"
+                   "\"bytes\":%lu,\"min_ns\":%.3f,\"median_ns\":%.3f,"
+                   "\"p90_ns\":%.3f,\"p99_ns\":%.3f,\"max_ns\":%.3f,\"counters\":{",
+                   i ? "," : "", r->name, (unsigned long)r->iterations,
+                   (unsigned long)r->repetitions, (unsigned long)r->bytes,
+                   r->min_ns, r->median_ns, r->p90_ns, r->p99_ns, r->max_ns);
+            int first = 1;
+            for(int e = 0; e < CP_PERF_EVENTS; e++) {
+                if(r->available & (1 << e)) {
+                    printf("%s\"%s\":%.3f", first ? "" : ",", CPPerfCounter_Name(e), r->counters[e]);
+                    first = 0;
+                }
+            }
+            printf("}}");
+        }
+        printf("\n]}\n");
+    }
+    free(results);
+    results = NULL;
+    result_count = result_capacity = 0;
+    return 0;
+}
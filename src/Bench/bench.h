@@ -0,0 +1,46 @@
+/*
+ * bench.h - microbenchmark harness.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_BENCH_H_
+#define _CP_BENCH_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Run the measured operation `iterations' times. */
+typedef void (*CPBenchFunc)(void *arg, size_t iterations);
+
+/* Feed results here so the compiler cannot drop the measured work. */
+extern volatile uintptr_t cp_bench_sink;
+#define CPBench_Use(x) (cp_bench_sink += (uintptr_t)(x))
+
+int CPBench_Init(int argc, char **argv, const char *suite);
+void CPBench_Run(const char *name, CPBenchFunc func, void *arg, size_t iterations);
+void CPBench_RunBytes(const char *name, CPBenchFunc func, void *arg, size_t iterations, size_t bytes);
+void CPBench_RunSetup(const char *name, CPBenchFunc setup, CPBenchFunc func, void *arg, size_t iterations);
+int CPBench_Finish(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_BENCH_H_ */
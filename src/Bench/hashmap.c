@@ -0,0 +1,292 @@
+/*
+ * hashmap.c - benchmark the hash map against a chained table.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <hashmap.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * The baseline is the textbook table: an array of buckets, each a
+ * malloc'd linked list, doubled at load factor 1.  Both tables use
+ * CPHash_Int so only the layout differs.  Present keys are even and
+ * missing keys odd.  Keys are inserted in order but looked up and
+ * deleted in a scrambled order, or the baseline's nodes would be
+ * visited in allocation order.
+ */
+typedef struct chained_node
+{
+    uintptr_t key;
+    void *value;
+    struct chained_node *next;
+} chained_node_t;
+
+typedef struct
+{
+    chained_node_t **buckets;
+    size_t mask;
+    size_t size;
+} chained_t;
+
+static void
+chained_init(chained_t *t)
+{
+    t->mask = 15;
+    t->size = 0;
+    t->buckets = calloc(t->mask + 1, sizeof(chained_node_t *));
+}
+
+static void
+chained_destroy(chained_t *t)
+{
+    for (size_t i = 0; i <= t->mask; i++) {
+        chained_node_t *node = t->buckets[i];
+        while (node != NULL) {
+            chained_node_t *next = node->next;
+            free(node);
+            node = next;
+        }
+    }
+    free(t->buckets);
+    t->buckets = NULL;
+}
+
+static void
+chained_insert(chained_t *t, uintptr_t key, void *value)
+{
+    chained_node_t **bucket = &t->buckets[CPHash_Int(key) & t->mask];
+    for (chained_node_t *node = *bucket; node != NULL; node = node->next) {
+        if (node->key == key) {
+            node->value = value;
+            return;
+        }
+    }
+    chained_node_t *node = malloc(sizeof(*node));
+    node->key = key;
+    node->value = value;
+    node->next = *bucket;
+    *bucket = node;
+    if (++t->size > t->mask) {
+        size_t mask = t->mask * 2 + 1;
+        chained_node_t **buckets = calloc(mask + 1, sizeof(chained_node_t *));
+        for (size_t i = 0; i <= t->mask; i++) {
+            while (t->buckets[i] != NULL) {
+                chained_node_t *n = t->buckets[i];
+                t->buckets[i] = n->next;
+                n->next = buckets[CPHash_Int(n->key) & mask];
+                buckets[CPHash_Int(n->key) & mask] = n;
+            }
+        }
+        free(t->buckets);
+        t->buckets = buckets;
+        t->mask = mask;
+    }
+}
+
+static void *
+chained_find(const chained_t *t, uintptr_t key)
+{
+    for (chained_node_t *node = t->buckets[CPHash_Int(key) & t->mask]; node != NULL; node = node->next) {
+        if (node->key == key) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static void
+chained_remove(chained_t *t, uintptr_t key)
+{
+    for (chained_node_t **link = &t->buckets[CPHash_Int(key) & t->mask]; *link != NULL; link = &(*link)->next) {
+        if ((*link)->key == key) {
+            chained_node_t *node = *link;
+            *link = node->next;
+            free(node);
+            t->size--;
+            return;
+        }
+    }
+}
+
+typedef struct
+{
+    CPHashMap map;
+    chained_t chained;
+} tables_t;
+
+static tables_t tables;
+static size_t *order;
+
+#define KEY(i) ((uintptr_t)(i) * 2)
+
+static void
+swiss_reset(void *arg, size_t n)
+{
+    (void)arg;
+    (void)n;
+    CPHashMap_Destroy(&tables.map);
+    CPHashMap_Init(&tables.map, CP_HASHMAP_KEY_INTEGER, 0);
+}
+
+static void
+swiss_fill(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPHashMap_Put(&tables.map, (const void *)KEY(i), 0, NULL)->value = (void *)i;
+    }
+}
+
+static void
+swiss_refill(void *arg, size_t n)
+{
+    swiss_reset(arg, n);
+    swiss_fill(arg, n);
+}
+
+static void
+swiss_hit(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPHashMap_Find(&tables.map, (const void *)KEY(order[i]), 0)->value);
+    }
+}
+
+static void
+swiss_miss(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPHashMap_Find(&tables.map, (const void *)(KEY(order[i]) + 1), 0));
+    }
+}
+
+static void
+swiss_delete(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPHashMap_Remove(&tables.map, (const void *)KEY(order[i]), 0);
+    }
+}
+
+static void
+chained_reset(void *arg, size_t n)
+{
+    (void)arg;
+    (void)n;
+    chained_destroy(&tables.chained);
+    chained_init(&tables.chained);
+}
+
+static void
+chained_fill(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        chained_insert(&tables.chained, KEY(i), (void *)i);
+    }
+}
+
+static void
+chained_refill(void *arg, size_t n)
+{
+    chained_reset(arg, n);
+    chained_fill(arg, n);
+}
+
+static void
+chained_hit(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(((chained_node_t *)chained_find(&tables.chained, KEY(order[i])))->value);
+    }
+}
+
+static void
+chained_miss(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(chained_find(&tables.chained, KEY(order[i]) + 1));
+    }
+}
+
+static void
+chained_delete(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        chained_remove(&tables.chained, KEY(order[i]));
+    }
+}
+
+static char names[2 * 3 * 4][48];
+
+static const char *
+name(int index, const char *table, const char *op, const char *size)
+{
+    snprintf(names[index], sizeof(names[index]), "%s/%s/%s", table, op, size);
+    return names[index];
+}
+
+int
+main(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *label;
+        size_t n;
+    } sizes[] = {{"1K", 1000}, {"1M", 1000000}, {"10M", 10000000}};
+    if (CPBench_Init(argc, argv, "hashmap") != 0) {
+        return -1;
+    }
+    CPHashMap_Init(&tables.map, CP_HASHMAP_KEY_INTEGER, 0);
+    chained_init(&tables.chained);
+    int k = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s].n;
+        const char *l = sizes[s].label;
+        /* 1000003 is prime and so coprime to every size here. */
+        order = malloc(n * sizeof(size_t));
+        for (size_t i = 0; i < n; i++) {
+            order[i] = (size_t)((uint64_t)i * 1000003 % n);
+        }
+        CPBench_RunSetup(name(k++, "swiss", "insert", l), swiss_reset, swiss_fill, NULL, n);
+        swiss_refill(NULL, n);
+        CPBench_Run(name(k++, "swiss", "lookup_hit", l), swiss_hit, NULL, n);
+        CPBench_Run(name(k++, "swiss", "lookup_miss", l), swiss_miss, NULL, n);
+        CPBench_RunSetup(name(k++, "swiss", "delete", l), swiss_refill, swiss_delete, NULL, n);
+        swiss_reset(NULL, 0);
+
+        CPBench_RunSetup(name(k++, "chained", "insert", l), chained_reset, chained_fill, NULL, n);
+        chained_refill(NULL, n);
+        CPBench_Run(name(k++, "chained", "lookup_hit", l), chained_hit, NULL, n);
+        CPBench_Run(name(k++, "chained", "lookup_miss", l), chained_miss, NULL, n);
+        CPBench_RunSetup(name(k++, "chained", "delete", l), chained_refill, chained_delete, NULL, n);
+        chained_reset(NULL, 0);
+        free(order);
+    }
+    CPHashMap_Destroy(&tables.map);
+    chained_destroy(&tables.chained);
+    return CPBench_Finish();
+}
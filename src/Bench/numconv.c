@@ -0,0 +1,156 @@
+/*
+ * Bench/numconv.c - benchmark number parsing and formatting.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <numconv.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Each iteration converts one number.  The "decimal" set looks like
+ * CSV columns (prices, measurements); the "random" set is random bit
+ * patterns, which need all 17 digits.
+ */
+#define COUNT 4096
+#define ITERATIONS 1000000
+
+typedef struct
+{
+    double values[COUNT];
+    uint64_t integers[COUNT];
+    char text[COUNT][CP_NUM_BUFFER_SIZE];
+    size_t length[COUNT];
+} numbers_t;
+
+static numbers_t decimal;
+static numbers_t random_bits;
+
+static void
+bench_parse(void *arg, size_t n)
+{
+    numbers_t *set = arg;
+    for (size_t i = 0; i < n; i++) {
+        double value;
+        size_t k = i % COUNT;
+        CPNum_ParseDouble(set->text[k], set->length[k], &value);
+        CPBench_Use(value > 1.0);
+    }
+}
+
+static void
+bench_strtod(void *arg, size_t n)
+{
+    numbers_t *set = arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(strtod(set->text[i % COUNT], NULL) > 1.0);
+    }
+}
+
+static void
+bench_format(void *arg, size_t n)
+{
+    numbers_t *set = arg;
+    char buffer[CP_NUM_BUFFER_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPNum_FormatDouble(set->values[i % COUNT], buffer));
+    }
+}
+
+static void
+bench_snprintf(void *arg, size_t n)
+{
+    numbers_t *set = arg;
+    char buffer[CP_NUM_BUFFER_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(snprintf(buffer, sizeof(buffer), "%.17g", set->values[i % COUNT]));
+    }
+}
+
+static void
+bench_format_u64(void *arg, size_t n)
+{
+    numbers_t *set = arg;
+    char buffer[CP_NUM_BUFFER_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPNum_FormatU64(set->integers[i % COUNT], buffer));
+    }
+}
+
+static void
+bench_snprintf_u64(void *arg, size_t n)
+{
+    numbers_t *set = arg;
+    char buffer[CP_NUM_BUFFER_SIZE];
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(snprintf(buffer, sizeof(buffer), "%" PRIu64, set->integers[i % COUNT]));
+    }
+}
+
+static uint64_t
+random64(void)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 4; i++) {
+        r = (r << 16) ^ (uint64_t)(rand() & 0xFFFF);
+    }
+    return r;
+}
+
+static void
+fill(void)
+{
+    for (size_t i = 0; i < COUNT; i++) {
+        decimal.values[i] = (double)(rand() % 1000000) / 100.0;
+        decimal.integers[i] = (uint64_t)(rand() % 100000);
+        decimal.length[i] = CPNum_FormatDouble(decimal.values[i], decimal.text[i]);
+
+        uint64_t bits;
+        do {
+            bits = random64();
+            memcpy(&random_bits.values[i], &bits, sizeof(bits));
+        } while (random_bits.values[i] - random_bits.values[i] != 0.0);
+        random_bits.integers[i] = bits;
+        random_bits.length[i] = CPNum_FormatDouble(random_bits.values[i], random_bits.text[i]);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    if (CPBench_Init(argc, argv, "numconv") != 0) {
+        return -1;
+    }
+    fill();
+    CPBench_Run("parse/decimal/cp", bench_parse, &decimal, ITERATIONS);
+    CPBench_Run("parse/decimal/strtod", bench_strtod, &decimal, ITERATIONS);
+    CPBench_Run("parse/random/cp", bench_parse, &random_bits, ITERATIONS);
+    CPBench_Run("parse/random/strtod", bench_strtod, &random_bits, ITERATIONS);
+    CPBench_Run("format/decimal/cp", bench_format, &decimal, ITERATIONS);
+    CPBench_Run("format/decimal/snprintf", bench_snprintf, &decimal, ITERATIONS);
+    CPBench_Run("format/random/cp", bench_format, &random_bits, ITERATIONS);
+    CPBench_Run("format/random/snprintf", bench_snprintf, &random_bits, ITERATIONS);
+    CPBench_Run("format_u64/small/cp", bench_format_u64, &decimal, ITERATIONS);
+    CPBench_Run("format_u64/small/snprintf", bench_snprintf_u64, &decimal, ITERATIONS);
+    CPBench_Run("format_u64/large/cp", bench_format_u64, &random_bits, ITERATIONS);
+    CPBench_Run("format_u64/large/snprintf", bench_snprintf_u64, &random_bits, ITERATIONS);
+    return CPBench_Finish();
+}
@@ -0,0 +1,161 @@
+/*
+ * parsearg.c - benchmark command line argument parsing.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <parsearg.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * The parser removes what it matches from cp_argv, so every iteration
+ * restores the argument vector first.  "reset" measures that copy alone.
+ */
+
+typedef struct
+{
+    int argc;
+    char **template;
+    char **argv;
+} argv_case_t;
+
+static inline void
+reset(argv_case_t *c)
+{
+    memcpy(c->argv, c->template, (size_t)c->argc * sizeof(char *));
+    cp_argc = c->argc;
+    cp_argv = c->argv;
+}
+
+static void
+bench_reset(void *arg, size_t n)
+{
+    argv_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        reset(c);
+        CPBench_Use(cp_argv[0]);
+    }
+}
+
+static void
+bench_flag_missing(void *arg, size_t n)
+{
+    argv_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        reset(c);
+        CPBench_Use(CP_ParseFlag("--missing"));
+    }
+}
+
+static void
+bench_flag_last(void *arg, size_t n)
+{
+    argv_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        reset(c);
+        CPBench_Use(CP_ParseFlag("--last"));
+    }
+}
+
+static void
+bench_flag_first(void *arg, size_t n)
+{
+    argv_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        reset(c);
+        CPBench_Use(CP_ParseFlag("--first"));
+    }
+}
+
+static void
+bench_option(void *arg, size_t n)
+{
+    argv_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        reset(c);
+        CPBench_Use(CP_ParseOption("--output"));
+    }
+}
+
+static void
+bench_flag_ex(void *arg, size_t n)
+{
+    static const char * const flags[] = {"--copyright", "--version", "--help", "--last"};
+    argv_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        reset(c);
+        CPBench_Use(CP_ParseFlagEx(4, flags));
+    }
+}
+
+static int
+make_case(argv_case_t *c, int argc)
+{
+    c->argc = argc;
+    c->template = malloc((size_t)argc * sizeof(char *));
+    c->argv = malloc((size_t)argc * sizeof(char *));
+    if (c->template == NULL || c->argv == NULL) {
+        return -1;
+    }
+    c->template[0] = "--first";
+    for (int i = 1; i < argc - 2; i++) {
+        char *s = malloc(32);
+        if (s == NULL) {
+            return -1;
+        }
+        snprintf(s, 32, "source%d.cp", i);
+        c->template[i] = s;
+    }
+    c->template[argc - 2] = "--output=out.cpm";
+    c->template[argc - 1] = "--last";
+    return 0;
+}
+
+int
+main(int argc, char **argv)
+{
+    static const int sizes[] = {16, 1024, 16384};
+    static char names[6 * 3][64];
+    argv_case_t cases[3];
+    if (CPBench_Init(argc, argv, "parsearg") != 0) {
+        return -1;
+    }
+    for (int s = 0; s < 3; s++) {
+        if (make_case(&cases[s], sizes[s]) != 0) {
+            printf("Out of memory\n");
+            return -1;
+        }
+        size_t n = (size_t)(1 << 20) / (size_t)sizes[s];
+        char *name = names[s * 6];
+        snprintf(name, 64, "reset/%d", sizes[s]);
+        CPBench_Run(name, bench_reset, &cases[s], n);
+        snprintf(name += 64, 64, "CP_ParseFlag/missing/%d", sizes[s]);
+        CPBench_Run(name, bench_flag_missing, &cases[s], n);
+        snprintf(name += 64, 64, "CP_ParseFlag/first/%d", sizes[s]);
+        CPBench_Run(name, bench_flag_first, &cases[s], n);
+        snprintf(name += 64, 64, "CP_ParseFlag/last/%d", sizes[s]);
+        CPBench_Run(name, bench_flag_last, &cases[s], n);
+        snprintf(name += 64, 64, "CP_ParseOption/%d", sizes[s]);
+        CPBench_Run(name, bench_option, &cases[s], n);
+        snprintf(name += 64, 64, "CP_ParseFlagEx/%d", sizes[s]);
+        CPBench_Run(name, bench_flag_ex, &cases[s], n);
+    }
+    return CPBench_Finish();
+}
@@ -0,0 +1,93 @@
+/*
+ * path.c - benchmark file path handling.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <path.h>
+
+#include <string.h>
+
+static const char *deep = "/usr/local/share/cp/lib/site-packages/example/module/source.cp";
+
+static void
+bench_join(void *arg, size_t n)
+{
+    (void)arg;
+    char dst[CP_MAX_PATH];
+    for (size_t i = 0; i < n; i++) {
+        CPath_Join(dst, "/usr/local/share/cp/lib/", "example/module/source.cp");
+        CPBench_Use(dst[0]);
+    }
+}
+
+static void
+bench_join_in_place(void *arg, size_t n)
+{
+    (void)arg;
+    char dst[CP_MAX_PATH];
+    for (size_t i = 0; i < n; i++) {
+        memcpy(dst, "/usr/local/share/cp/lib/", sizeof("/usr/local/share/cp/lib/"));
+        CPath_JoinInPlace(dst, "example/module/source.cp");
+        CPBench_Use(dst[0]);
+    }
+}
+
+static void
+bench_filename(void *arg, size_t n)
+{
+    (void)arg;
+    char dst[CP_MAX_PATH];
+    for (size_t i = 0; i < n; i++) {
+        CPath_Filename(dst, deep);
+        CPBench_Use(dst[0]);
+    }
+}
+
+static void
+bench_dirname(void *arg, size_t n)
+{
+    (void)arg;
+    char dst[CP_MAX_PATH];
+    for (size_t i = 0; i < n; i++) {
+        CPath_Dirname(dst, deep);
+        CPBench_Use(dst[0]);
+    }
+}
+
+static void
+bench_is_absolute(void *arg, size_t n)
+{
+    (void)arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPath_IsAbsolute(deep));
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    if (CPBench_Init(argc, argv, "path") != 0) {
+        return -1;
+    }
+    CPBench_Run("CPath_Join", bench_join, NULL, 100000);
+    CPBench_Run("CPath_JoinInPlace", bench_join_in_place, NULL, 100000);
+    CPBench_Run("CPath_Filename", bench_filename, NULL, 100000);
+    CPBench_Run("CPath_Dirname", bench_dirname, NULL, 100000);
+    CPBench_Run("CPath_IsAbsolute", bench_is_absolute, NULL, 1000000);
+    return CPBench_Finish();
+}
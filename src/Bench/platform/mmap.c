@@ -0,0 +1,189 @@
+/*
+ * mmap.c - benchmark memory mapping.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <platform/mmap.h>
+
+#include <stdio.h>
+#include <string.h>
+
+typedef struct
+{
+    size_t size;
+    FILE *file;
+    int flags;
+    int advice;
+} mmap_case_t;
+
+static void
+touch(CPMemoryMapping *map, int write)
+{
+    /* One access per page is enough to fault every page in. */
+    for (size_t off = 0; off < map->size; off += 4096) {
+        if (write) {
+            ((volatile char *)map->addr)[off] = 1;
+        } else {
+            CPBench_Use(((volatile char *)map->addr)[off]);
+        }
+    }
+}
+
+static void
+bench_map_unmap(void *arg, size_t n)
+{
+    mmap_case_t *c = arg;
+    CPMemoryMapping map;
+    for (size_t i = 0; i < n; i++) {
+        if (CPMemoryMapping_Create(&map, NULL, c->size, 0, CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE,
+                                   CP_MMAP_FLAG_PRIVATE) != 0) {
+            return;
+        }
+        CPMemoryMapping_Destroy(&map);
+    }
+}
+
+static void
+bench_anonymous_touch(void *arg, size_t n)
+{
+    mmap_case_t *c = arg;
+    CPMemoryMapping map;
+    for (size_t i = 0; i < n; i++) {
+        if (CPMemoryMapping_Create(&map, NULL, c->size, 0, CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE,
+                                   CP_MMAP_FLAG_PRIVATE | c->flags) != 0) {
+            return;
+        }
+        touch(&map, 1);
+        CPMemoryMapping_Destroy(&map);
+    }
+}
+
+/*
+ * Strided reads over a buffer much larger than the TLB reach: with
+ * 4 KiB pages nearly every access misses the TLB, with 2 MiB pages
+ * the whole buffer fits in a few hundred entries.
+ */
+static void
+bench_tlb_walk(void *arg, size_t n)
+{
+    CPMemoryMapping *map = arg;
+    size_t stride = 4096 + 64;
+    size_t pos = 0;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(((volatile char *)map->addr)[pos]);
+        pos += stride;
+        if (pos >= map->size) {
+            pos -= map->size;
+        }
+    }
+}
+
+static void
+bench_file_read(void *arg, size_t n)
+{
+    mmap_case_t *c = arg;
+    CPMemoryMapping map;
+    for (size_t i = 0; i < n; i++) {
+        if (CPMemoryMapping_Create(&map, c->file, c->size, 0, CP_MMAP_PROT_READ,
+                                   CP_MMAP_FLAG_SHARED | c->flags) != 0) {
+            return;
+        }
+        if (c->advice != CP_MMAP_ADVICE_NORMAL) {
+            CPMemoryMapping_Advise(&map, 0, map.size, c->advice);
+        }
+        touch(&map, 0);
+        CPMemoryMapping_Destroy(&map);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    static const size_t sizes[] = {4096, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024};
+    static char names[4 * 3][64];
+    static char page[4096];
+    if (CPBench_Init(argc, argv, "mmap") != 0) {
+        return -1;
+    }
+    FILE *file = fopen("bench_mmap.dat", "wb+");
+    if (file == NULL) {
+        printf("Failed to open file\n");
+        return -1;
+    }
+    memset(page, 'x', sizeof(page));
+    for (size_t off = 0; off < sizes[3]; off += sizeof(page)) {
+        if (fwrite(page, 1, sizeof(page), file) != sizeof(page)) {
+            printf("Failed to write to file\n");
+            fclose(file);
+            return -1;
+        }
+    }
+    fflush(file);
+    for (int s = 0; s < 4; s++) {
+        mmap_case_t c = {sizes[s], file, 0, CP_MMAP_ADVICE_NORMAL};
+        size_t n = sizes[s] >= 1024 * 1024 ? 20 : 1000;
+        char *name = names[s * 3];
+        snprintf(name, 64, "map_unmap/%zuK", sizes[s] / 1024);
+        CPBench_Run(name, bench_map_unmap, &c, n);
+        snprintf(name += 64, 64, "anonymous_touch/%zuK", sizes[s] / 1024);
+        CPBench_RunBytes(name, bench_anonymous_touch, &c, n, sizes[s]);
+        snprintf(name += 64, 64, "file_read/%zuK", sizes[s] / 1024);
+        CPBench_RunBytes(name, bench_file_read, &c, n, sizes[s]);
+    }
+    /* Page-fault and TLB effects of the access flags and advice. */
+    static const struct
+    {
+        const char *name;
+        int flags;
+        int advice;
+        int anonymous;
+    } modes[] = {
+        {"anonymous_touch/16384K/populate", CP_MMAP_FLAG_POPULATE, CP_MMAP_ADVICE_NORMAL, 1},
+        {"anonymous_touch/16384K/hugepage", CP_MMAP_FLAG_HUGEPAGE, CP_MMAP_ADVICE_NORMAL, 1},
+        {"file_read/16384K/populate", CP_MMAP_FLAG_POPULATE, CP_MMAP_ADVICE_NORMAL, 0},
+        {"file_read/16384K/sequential", 0, CP_MMAP_ADVICE_SEQUENTIAL, 0},
+        {"file_read/16384K/willneed", 0, CP_MMAP_ADVICE_WILLNEED, 0},
+    };
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        mmap_case_t c = {sizes[3], file, modes[m].flags, modes[m].advice};
+        CPBench_RunBytes(modes[m].name, modes[m].anonymous ? bench_anonymous_touch : bench_file_read,
+                         &c, 20, sizes[3]);
+    }
+    static const struct
+    {
+        const char *name;
+        int flags;
+    } walks[] = {
+        {"tlb_walk/256M/4K-pages", CP_MMAP_FLAG_POPULATE},
+        {"tlb_walk/256M/hugepage", CP_MMAP_FLAG_POPULATE | CP_MMAP_FLAG_HUGEPAGE},
+    };
+    for (size_t w = 0; w < sizeof(walks) / sizeof(walks[0]); w++) {
+        CPMemoryMapping map;
+        if (CPMemoryMapping_Create(&map, NULL, 256 * 1024 * 1024, 0, CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE,
+                                   CP_MMAP_FLAG_PRIVATE | walks[w].flags) != 0) {
+            printf("Failed to create memory mapping\n");
+            continue;
+        }
+        touch(&map, 1);
+        CPBench_Run(walks[w].name, bench_tlb_walk, &map, 1000000);
+        CPMemoryMapping_Destroy(&map);
+    }
+    fclose(file);
+    remove("bench_mmap.dat");
+    return CPBench_Finish();
+}
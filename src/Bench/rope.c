@@ -0,0 +1,134 @@
+/*
+ * rope.c - benchmark N-way string concatenation.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <rope.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Build a string from N 16-byte pieces, one `+' at a time, and read
+ * it back once.  rope_concat keeps every intermediate string alive
+ * while building the next; rope_append gives it up, as `s = s + p'
+ * does.  The flat baseline copies the whole result on every
+ * step like an immutable flat string does, so its time per piece
+ * grows with N while the rope's stays flat.  The baseline stops at
+ * 32K pieces; beyond that it takes seconds per repetition.
+ */
+static const char piece[] = "0123456789abcdef";
+
+static CPRope *pieces[1000000];
+
+static void
+bench_rope_concat(void *arg, size_t n)
+{
+    (void)arg;
+    CPRope *p = CPRope_FromBytes(piece, 16);
+    CPRope *s = CPRope_FromBytes("", 0);
+    for (size_t i = 0; i < n; i++) {
+        CPRope *next = CPRope_Concat(s, p);
+        CPRope_Release(s);
+        s = next;
+    }
+    CPBench_Use(CPRope_Flatten(s)[n * 8]);
+    CPRope_Release(s);
+    CPRope_Release(p);
+}
+
+static void
+bench_rope_append(void *arg, size_t n)
+{
+    (void)arg;
+    CPRope *p = CPRope_FromBytes(piece, 16);
+    CPRope *s = CPRope_FromBytes("", 0);
+    for (size_t i = 0; i < n; i++) {
+        s = CPRope_Append(s, p);
+    }
+    CPBench_Use(CPRope_Flatten(s)[n * 8]);
+    CPRope_Release(s);
+    CPRope_Release(p);
+}
+
+static void
+bench_rope_join(void *arg, size_t n)
+{
+    (void)arg;
+    CPRope *s = CPRope_Join(NULL, pieces, n);
+    CPBench_Use(CPRope_Flatten(s)[n * 8]);
+    CPRope_Release(s);
+}
+
+static void
+bench_flat_concat(void *arg, size_t n)
+{
+    (void)arg;
+    char *s = malloc(1);
+    size_t length = 0;
+    for (size_t i = 0; i < n; i++) {
+        char *next = malloc(length + 16 + 1);
+        memcpy(next, s, length);
+        memcpy(next + length, piece, 16);
+        length += 16;
+        next[length] = '\0';
+        free(s);
+        s = next;
+    }
+    CPBench_Use(s[n * 8]);
+    free(s);
+}
+
+static char names[24][48];
+
+static const char *
+name(int index, const char *kind, const char *size)
+{
+    snprintf(names[index], sizeof(names[index]), "%s/%s", kind, size);
+    return names[index];
+}
+
+int
+main(int argc, char **argv)
+{
+    static const struct
+    {
+        const char *label;
+        size_t n;
+    } sizes[] = {{"1K", 1000}, {"8K", 8000}, {"32K", 32000}, {"128K", 128000}, {"1M", 1000000}};
+    if (CPBench_Init(argc, argv, "rope") != 0) {
+        return -1;
+    }
+    CPRope *p = CPRope_FromBytes(piece, 16);
+    for (size_t i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+        pieces[i] = p;
+    }
+    int k = 0;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t n = sizes[s].n;
+        CPBench_RunBytes(name(k++, "rope_concat", sizes[s].label), bench_rope_concat, NULL, n, 16);
+        CPBench_RunBytes(name(k++, "rope_append", sizes[s].label), bench_rope_append, NULL, n, 16);
+        CPBench_RunBytes(name(k++, "rope_join", sizes[s].label), bench_rope_join, NULL, n, 16);
+        if (n <= 32000) {
+            CPBench_RunBytes(name(k++, "flat_concat", sizes[s].label), bench_flat_concat, NULL, n, 16);
+        }
+    }
+    CPRope_Release(p);
+    return CPBench_Finish();
+}
@@ -0,0 +1,98 @@
+/*
+ * safe_string.c - benchmark safe string manipulation functions.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <safe_string.h>
+
+#include <string.h>
+
+typedef struct
+{
+    const char *src;
+    size_t len;
+} string_case_t;
+
+static char buffer[4096];
+
+static void
+bench_strcpy(void *arg, size_t n)
+{
+    string_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        strcpy_safe(buffer, c->src, sizeof(buffer));
+        CPBench_Use(buffer[0]);
+    }
+}
+
+static void
+bench_strncpy(void *arg, size_t n)
+{
+    string_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        strncpy_safe(buffer, c->src, sizeof(buffer), c->len / 2);
+        CPBench_Use(buffer[0]);
+    }
+}
+
+static void
+bench_strcat(void *arg, size_t n)
+{
+    string_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        buffer[0] = 'x';
+        buffer[1] = '\0';
+        strcat_safe(buffer, c->src, sizeof(buffer));
+        CPBench_Use(buffer[1]);
+    }
+}
+
+static void
+bench_strncat(void *arg, size_t n)
+{
+    string_case_t *c = arg;
+    for (size_t i = 0; i < n; i++) {
+        buffer[0] = 'x';
+        buffer[1] = '\0';
+        strncat_safe(buffer, c->src, sizeof(buffer), c->len / 2);
+        CPBench_Use(buffer[1]);
+    }
+}
+
+int
+main(int argc, char **argv)
+{
+    static char long_string[2049];
+    memset(long_string, 'a', sizeof(long_string) - 1);
+    string_case_t cases[] = {
+        {"short-string-16b", 16},
+        {long_string, sizeof(long_string) - 1},
+    };
+    if (CPBench_Init(argc, argv, "safe_string") != 0) {
+        return -1;
+    }
+    CPBench_RunBytes("strcpy_safe/16", bench_strcpy, &cases[0], 100000, 16);
+    CPBench_RunBytes("strcpy_safe/2048", bench_strcpy, &cases[1], 10000, 2048);
+    CPBench_RunBytes("strncpy_safe/16", bench_strncpy, &cases[0], 100000, 8);
+    CPBench_RunBytes("strncpy_safe/2048", bench_strncpy, &cases[1], 10000, 1024);
+    CPBench_RunBytes("strcat_safe/16", bench_strcat, &cases[0], 100000, 16);
+    CPBench_RunBytes("strcat_safe/2048", bench_strcat, &cases[1], 10000, 2048);
+    CPBench_RunBytes("strncat_safe/16", bench_strncat, &cases[0], 100000, 8);
+    CPBench_RunBytes("strncat_safe/2048", bench_strncat, &cases[1], 10000, 1024);
+    return CPBench_Finish();
+}
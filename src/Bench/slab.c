@@ -0,0 +1,129 @@
+/*
+ * Bench/slab.c - benchmark the slab allocator against malloc.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <slab.h>
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * Every thread keeps WINDOW objects alive and replaces one per
+ * operation with an object of another size, like a runtime churning
+ * through strings and frames.  The operations are split across the
+ * threads, so the figure is wall time per operation: flat means the
+ * allocator is the bottleneck, halving per doubling means it scales.
+ */
+#define WINDOW 256
+#define SIZES 4096
+#define ITERATIONS 4000000
+#define MAX_THREADS 32
+
+typedef struct
+{
+    int threads;
+    int use_slab;
+} config_t;
+
+typedef struct
+{
+    int use_slab;
+    size_t operations;
+    unsigned int seed;
+} worker_t;
+
+static void *
+work(void *arg)
+{
+    worker_t *w = arg;
+    void *live[WINDOW] = {0};
+    size_t live_size[WINDOW] = {0};
+    unsigned short sizes[SIZES];
+    for (size_t i = 0; i < SIZES; i++) {
+        w->seed = w->seed * 1103515245 + 12345;
+        sizes[i] = (unsigned short)(16 + (w->seed >> 8) % (CP_SLAB_MAX_SIZE - 15));
+    }
+    for (size_t i = 0; i < w->operations; i++) {
+        size_t slot = i % WINDOW;
+        size_t size = sizes[i % SIZES];
+        if (w->use_slab) {
+            CPSlab_Free(live[slot], live_size[slot]);
+            live[slot] = CPSlab_Alloc(size);
+        } else {
+            free(live[slot]);
+            live[slot] = malloc(size);
+        }
+        *(char *)live[slot] = (char)i;
+        live_size[slot] = size;
+    }
+    for (size_t slot = 0; slot < WINDOW; slot++) {
+        if (w->use_slab) {
+            CPSlab_Free(live[slot], live_size[slot]);
+        } else {
+            free(live[slot]);
+        }
+    }
+    if (w->use_slab) {
+        CPSlab_FlushThread();
+    }
+    return NULL;
+}
+
+static void
+bench_churn(void *arg, size_t n)
+{
+    config_t *config = arg;
+    pthread_t threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    for (int t = 0; t < config->threads; t++) {
+        workers[t].use_slab = config->use_slab;
+        workers[t].operations = n / (size_t)config->threads;
+        workers[t].seed = (unsigned int)t + 1;
+        if (pthread_create(&threads[t], NULL, work, &workers[t]) != 0) {
+            fprintf(stderr, "Cannot create thread\n");
+            exit(1);
+        }
+    }
+    for (int t = 0; t < config->threads; t++) {
+        pthread_join(threads[t], NULL);
+    }
+}
+
+static char names[16][32];
+
+int
+main(int argc, char **argv)
+{
+    if (CPBench_Init(argc, argv, "slab") != 0) {
+        return -1;
+    }
+    static config_t configs[16];
+    int k = 0;
+    for (int threads = 1; threads <= MAX_THREADS; threads *= 2) {
+        for (int use_slab = 1; use_slab >= 0; use_slab--) {
+            configs[k].threads = threads;
+            configs[k].use_slab = use_slab;
+            snprintf(names[k], sizeof(names[k]), "churn/%dt/%s", threads, use_slab ? "slab" : "malloc");
+            CPBench_Run(names[k], bench_churn, &configs[k], ITERATIONS);
+            k++;
+        }
+    }
+    return CPBench_Finish();
+}
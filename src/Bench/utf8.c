@@ -0,0 +1,118 @@
+/*
+ * utf8.c - benchmark UTF-8 validation and transcoding.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <Bench/bench.h>
+#include <utf8.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * 1 MB of ASCII source and 1 MB of mixed text (Latin, CJK, emoji)
+ * through every implementation the CPU supports.
+ */
+#define SIZE (1024 * 1024)
+
+typedef struct
+{
+    const uint8_t *text;
+    size_t length;
+} text_t;
+
+static uint8_t ascii[SIZE];
+static uint8_t mixed[SIZE];
+static uint32_t decoded[SIZE];
+
+static void
+bench_validate(void *arg, size_t n)
+{
+    text_t *t = arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPUtf8_Validate(t->text, t->length, NULL));
+    }
+}
+
+static void
+bench_count(void *arg, size_t n)
+{
+    text_t *t = arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPUtf8_Count(t->text, t->length));
+    }
+}
+
+static void
+bench_to_utf32(void *arg, size_t n)
+{
+    text_t *t = arg;
+    for (size_t i = 0; i < n; i++) {
+        CPBench_Use(CPUtf8_ToUtf32(t->text, t->length, decoded));
+    }
+}
+
+static size_t
+fill_mixed(void)
+{
+    static const char *const words[] = {
+        "print ", "caf\xC3\xA9 ", "\xE4\xBD\xA0\xE5\xA5\xBD ", "stra\xC3\x9F" "e ",
+        "\xF0\x9F\x98\x80 ", "r\xC3\xA9sum\xC3\xA9 ", "\xE6\x97\xA5\xE6\x9C\xAC\xE8\xAA\x9E ",
+    };
+    size_t length = 0;
+    for (size_t i = 0;; i++) {
+        const char *w = words[i % (sizeof(words) / sizeof(words[0]))];
+        size_t n = strlen(w);
+        if (length + n > SIZE) {
+            return length;
+        }
+        memcpy(mixed + length, w, n);
+        length += n;
+    }
+}
+
+static char names[32][48];
+
+int
+main(int argc, char **argv)
+{
+    static const char *const levels[] = {"scalar", "sse4", "avx2"};
+    if (CPBench_Init(argc, argv, "utf8") != 0) {
+        return -1;
+    }
+    for (size_t i = 0; i < SIZE; i++) {
+        ascii[i] = (uint8_t)(i % 61 == 60 ? '\n' : 'a' + i % 26);
+    }
+    text_t texts[2] = {{ascii, SIZE}, {mixed, fill_mixed()}};
+    static const char *const text_names[] = {"ascii", "mixed"};
+    int k = 0;
+    for (int level = CP_UTF8_SCALAR; level <= CP_UTF8_AVX2; level++) {
+        if (CPUtf8_SetLevel(level) != 0) {
+            continue;
+        }
+        for (int t = 0; t < 2; t++) {
+            snprintf(names[k], sizeof(names[k]), "validate/%s/%s", text_names[t], levels[level]);
+            CPBench_RunBytes(names[k++], bench_validate, &texts[t], 1, texts[t].length);
+            snprintf(names[k], sizeof(names[k]), "count/%s/%s", text_names[t], levels[level]);
+            CPBench_RunBytes(names[k++], bench_count, &texts[t], 1, texts[t].length);
+            snprintf(names[k], sizeof(names[k]), "to_utf32/%s/%s", text_names[t], levels[level]);
+            CPBench_RunBytes(names[k++], bench_to_utf32, &texts[t], 1, texts[t].length);
+        }
+    }
+    return CPBench_Finish();
+}
@@ -0,0 +1,131 @@
+/*
+ * Test/build.c - test incremental builds.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <build.h>
+#include <module.h>
+#include <vm.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define DIR "test_build_dir"
+#define OUTPUT "test_build.cpm"
+
+static int
+write_file(const char *path, const char *text)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    size_t n = fwrite(text, 1, strlen(text), file);
+    return fclose(file) != 0 || n != strlen(text) ? -1 : 0;
+}
+
+static int
+build(uint32_t compiled, int64_t expected)
+{
+    CPBuildStats stats;
+    CPModule module;
+    CPVM vm;
+    CPValue result;
+    if (CPBuild_Run(DIR "/main.cp", OUTPUT, &stats) != 0) {
+        printf("Build failed\n");
+        return -1;
+    }
+    if (stats.modules != 2 || stats.compiled != compiled || stats.linked != (compiled != 0)) {
+        printf("Compiled %u modules, expected %u\n", stats.compiled, compiled);
+        return -1;
+    }
+    if (CPModule_Open(&module, OUTPUT) != 0 || CPVM_Init(&vm, &module) != 0) {
+        printf("Cannot load the output\n");
+        return -1;
+    }
+    int rv = CPVM_Call(&vm, module.entry, NULL, 0, &result);
+    CPVM_Destroy(&vm);
+    CPString_Reset();
+    CPModule_Close(&module);
+    if (rv != 0 || result.type != CP_VALUE_INT || result.as.i != expected) {
+        printf("The program did not return %lld\n", (long long)expected);
+        return -1;
+    }
+    return 0;
+}
+
+int
+main()
+{
+    mkdir(DIR, 0777);
+    if (write_file(DIR "/main.cp", "import lib;\nfunc main() { return lib.twice(21); }\n") != 0 ||
+        write_file(DIR "/lib.cp", "func twice(x) { return x * 2; }\n") != 0) {
+        printf("Cannot write the sources\n");
+        return -1;
+    }
+    if (build(2, 42) != 0 || build(0, 42) != 0) {
+        return -1;
+    }
+    /* A new body keeps the interface, so main is not compiled again. */
+    if (write_file(DIR "/lib.cp", "func twice(x) { return x + x + 0; }\n") != 0 || build(1, 42) != 0) {
+        return -1;
+    }
+    /* A new function changes the interface, so main is compiled too. */
+    if (write_file(DIR "/lib.cp", "func twice(x) { return x * 3; }\nfunc half(x) { return x / 2; }\n") != 0 ||
+        build(2, 63) != 0) {
+        return -1;
+    }
+    /* A lost image is compiled again. */
+    remove(DIR "/.cpbuild/lib.cpm");
+    if (build(1, 63) != 0) {
+        return -1;
+    }
+    /* So is everything built by another bytecode version. */
+    FILE *file = fopen(DIR "/.cpbuild/deps.cpdb", "r+b");
+    if (file == NULL || fseek(file, 8, SEEK_SET) != 0 || fputc(0xFF, file) == EOF || fclose(file) != 0) {
+        printf("Cannot change the database version\n");
+        return -1;
+    }
+    if (build(2, 63) != 0) {
+        return -1;
+    }
+    /* A failed link leaves no output, so the next build fails too. */
+    if (write_file(DIR "/lib.cp", "func twice(x, y) { return x * y; }\n") != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 2; i++) {
+        if (CPBuild_Run(DIR "/main.cp", OUTPUT, NULL) == 0 || access(OUTPUT, F_OK) == 0) {
+            printf("A build with an arity error succeeded\n");
+            return -1;
+        }
+    }
+    if (write_file(DIR "/lib.cp", "func twice(x) { return x * 2; }\n") != 0 || build(2, 42) != 0) {
+        return -1;
+    }
+    remove(DIR "/.cpbuild/main.cpm");
+    remove(DIR "/.cpbuild/lib.cpm");
+    remove(DIR "/.cpbuild/deps.cpdb");
+    rmdir(DIR "/.cpbuild");
+    remove(DIR "/main.cp");
+    remove(DIR "/lib.cp");
+    rmdir(DIR);
+    remove(OUTPUT);
+    return 0;
+}
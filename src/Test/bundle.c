@@ -0,0 +1,219 @@
+/*
+ * Test/bundle.c - test bundled executables.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <bundle.h>
+#include <bytecode_writer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#define LAUNCHER "test_bundle_launcher"
+#define IMAGE "test_bundle.cpm"
+#define OUTPUT "test_bundle_out"
+#define REBUNDLED "test_bundle_out2"
+#define SOURCE "test_bundle_app.cp"
+#define APP "test_bundle_app"
+#define SOCKET "test_bundle.sock"
+
+static int
+write_image(const char *text)
+{
+    CPBytecodeWriter writer;
+    if (CPBytecodeWriter_Open(&writer, IMAGE, 1, 0) != 0) {
+        return -1;
+    }
+    char *section = CPBytecodeWriter_AddSection(&writer, 2, strlen(text));
+    if (section == NULL) {
+        return -1;
+    }
+    memcpy(section, text, strlen(text));
+    return CPBytecodeWriter_Close(&writer);
+}
+
+static int
+check(const char *path, const char *text)
+{
+    CPBundle bundle;
+    if (CPBundle_Open(&bundle, path) != 1) {
+        printf("%s is not recognized as a bundle\n", path);
+        return -1;
+    }
+    const unsigned char *image = bundle.image;
+    size_t offset = CP_BYTECODE_HEADER_SIZE + CP_BYTECODE_ENTRY_SIZE;
+    if (bundle.size != CP_BYTECODE_ALIGN(offset + strlen(text)) ||
+        memcmp(image, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE) != 0 ||
+        memcmp(image + offset, text, strlen(text)) != 0) {
+        printf("Wrong image in %s\n", path);
+        return -1;
+    }
+    return CPBundle_Close(&bundle);
+}
+
+static int
+expect_output(const char *command)
+{
+    FILE *pipe = popen(command, "r");
+    char line[32] = "";
+    if (pipe == NULL || fgets(line, sizeof(line), pipe) == NULL) {
+        printf("No output from %s\n", command);
+        return -1;
+    }
+    /* main() returns 3, which must become the exit status. */
+    int status = pclose(pipe);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 3 || strcmp(line, "42\n") != 0) {
+        printf("%s printed '%s', status %d\n", command, line, status);
+        return -1;
+    }
+    return 0;
+}
+
+/* Start `cpc --server' and wait until it accepts connections. */
+static pid_t
+start_server(void)
+{
+    struct sockaddr_un address;
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path, SOCKET);
+    remove(SOCKET);
+    pid_t server = fork();
+    if (server == 0) {
+        execl(CPC, CPC, "--server=" SOCKET, (char *)NULL);
+        _exit(1);
+    }
+    for (int i = 0; i < 500 && server > 0; i++) {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        int connected = fd >= 0 && connect(fd, (struct sockaddr *)&address, sizeof(address)) == 0;
+        if (fd >= 0) {
+            close(fd);
+        }
+        if (connected) {
+            return server;
+        }
+        usleep(10000);
+    }
+    return -1;
+}
+
+/*
+ * Bundle a source program with the real cpc and run the result without
+ * LD_LIBRARY_PATH, so a launcher that still needs libcp.so fails here.
+ * A bundle must also ignore CPC_SERVER: the server would take the
+ * program's arguments for a cpc command.
+ */
+static int
+run_app(void)
+{
+    FILE *file = fopen(SOURCE, "w");
+    if (file == NULL) {
+        printf("Cannot create %s\n", SOURCE);
+        return -1;
+    }
+    fputs("func main() { var i = 6; print i * 7; return 3; }\n", file);
+    fclose(file);
+    if (system(CPC " bundle " SOURCE " -o " APP) != 0) {
+        printf("cpc bundle failed\n");
+        return -1;
+    }
+    unsetenv("LD_LIBRARY_PATH");
+    if (expect_output("./" APP) != 0) {
+        return -1;
+    }
+    pid_t server = start_server();
+    if (server < 0) {
+        printf("Cannot start the server\n");
+        return -1;
+    }
+    int rv = expect_output("CPC_SERVER=" SOCKET " ./" APP);
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    remove(SOCKET);
+    if (rv != 0) {
+        return -1;
+    }
+    remove(".cpbuild/" APP ".cpm");
+    remove(".cpbuild/deps.cpdb");
+    rmdir(".cpbuild");
+    remove(SOURCE);
+    remove(APP);
+    return 0;
+}
+
+int
+main()
+{
+    /* Any file serves as the launcher; an odd size exercises the padding. */
+    FILE *file = fopen(LAUNCHER, "wb");
+    if (file == NULL) {
+        printf("Cannot create %s\n", LAUNCHER);
+        return -1;
+    }
+    for (int i = 0; i < 12345; i++) {
+        fputc(i * 7, file);
+    }
+    fclose(file);
+
+    CPBundle bundle;
+    if (CPBundle_Open(&bundle, LAUNCHER) != 0) {
+        printf("Plain file taken for a bundle\n");
+        return -1;
+    }
+    if (write_image("first image") != 0 || CPBundle_Create(OUTPUT, LAUNCHER, IMAGE) != 0 ||
+        check(OUTPUT, "first image") != 0) {
+        printf("Failed to bundle the first image\n");
+        return -1;
+    }
+    /* Bundling a bundle replaces its image rather than stacking another. */
+    if (write_image("second") != 0 || CPBundle_Create(REBUNDLED, OUTPUT, IMAGE) != 0 ||
+        check(REBUNDLED, "second") != 0) {
+        printf("Failed to rebundle\n");
+        return -1;
+    }
+    file = fopen(REBUNDLED, "rb");
+    unsigned char head[16];
+    if (file == NULL || fread(head, 1, sizeof(head), file) != sizeof(head)) {
+        printf("Cannot read %s\n", REBUNDLED);
+        return -1;
+    }
+    fclose(file);
+    for (int i = 0; i < 16; i++) {
+        if (head[i] != (unsigned char)(i * 7)) {
+            printf("Launcher bytes changed\n");
+            return -1;
+        }
+    }
+    if (CPBundle_Create(OUTPUT, LAUNCHER, LAUNCHER) == 0) {
+        printf("Bundled something that is not an image\n");
+        return -1;
+    }
+    if (run_app() != 0) {
+        return -1;
+    }
+    remove(LAUNCHER);
+    remove(IMAGE);
+    remove(OUTPUT);
+    remove(REBUNDLED);
+    return 0;
+}
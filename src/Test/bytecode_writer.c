@@ -0,0 +1,96 @@
+/*
+ * bytecode_writer.c - test the .cpm writer.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <bytecode_writer.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define PATH "test_bytecode_writer.cpm"
+
+int
+main()
+{
+    CPBytecodeWriter writer;
+    /* A tiny hint forces the writer to grow by remapping. */
+    if (CPBytecodeWriter_Open(&writer, PATH, 3, 16) != 0) {
+        printf("Failed to open writer\n");
+        return -1;
+    }
+    char *a = CPBytecodeWriter_AddSection(&writer, 1, 5);
+    if (a == NULL) {
+        printf("Failed to add section 1\n");
+        return -1;
+    }
+    memcpy(a, "hello", 5);
+    char *b = CPBytecodeWriter_AddSection(&writer, 2, 100000);
+    if (b == NULL) {
+        printf("Failed to add section 2\n");
+        return -1;
+    }
+    memset(b, 'x', 100000);
+    a = CPBytecodeWriter_Section(&writer, 0);
+    if (a == NULL || memcmp(a, "hello", 5) != 0) {
+        printf("Section 1 lost after growing\n");
+        return -1;
+    }
+    if (CPBytecodeWriter_Close(&writer) != 0) {
+        printf("Failed to close writer\n");
+        return -1;
+    }
+
+    static unsigned char image[200000];
+    FILE *file = fopen(PATH, "rb");
+    if (file == NULL) {
+        printf("Failed to reopen %s\n", PATH);
+        return -1;
+    }
+    size_t size = fread(image, 1, sizeof(image), file);
+    fclose(file);
+    remove(PATH);
+    if (memcmp(image, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE) != 0) {
+        printf("Wrong magic number\n");
+        return -1;
+    }
+    if (CPBytecode_GetU32(image + 12) != 2) {
+        printf("Wrong section count: %u\n", (unsigned)CPBytecode_GetU32(image + 12));
+        return -1;
+    }
+    const unsigned char *e = image + CP_BYTECODE_HEADER_SIZE + CP_BYTECODE_ENTRY_SIZE;
+    uint64_t offset = CPBytecode_GetU64(e + 8);
+    uint64_t length = CPBytecode_GetU64(e + 16);
+    if (CPBytecode_GetU32(e) != 2 || length != 100000 || offset % CP_BYTECODE_ALIGNMENT != 0) {
+        printf("Wrong directory entry for section 2\n");
+        return -1;
+    }
+    if (size != CP_BYTECODE_ALIGN(offset + length)) {
+        printf("File not truncated to its contents: %lu\n", (unsigned long)size);
+        return -1;
+    }
+    if (image[offset] != 'x' || image[offset + length - 1] != 'x') {
+        printf("Section 2 contents lost\n");
+        return -1;
+    }
+    e = image + CP_BYTECODE_HEADER_SIZE;
+    if (memcmp(image + CPBytecode_GetU64(e + 8), "hello", 5) != 0) {
+        printf("Section 1 contents lost\n");
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,213 @@
+/*
+ * Test/compiler.c - test the pre-parser and lazy compilation.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <compiler.h>
+#include <vm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define IMAGE "test_compiler.cpm"
+
+static const char program[] =
+    "import lib;\n"
+    "\n"
+    "// Never called, so never parsed past its brackets.\n"
+    "func unused(x) {\n"
+    "    return x + * ;\n"
+    "}\n"
+    "\n"
+    "func square(x) {\n"
+    "    return x * x;\n"
+    "}\n"
+    "\n"
+    "func fib(n) {\n"
+    "    if (n < 2) { return n; }\n"
+    "    return fib(n - 1) + fib(n - 2);\n"
+    "}\n"
+    "\n"
+    "func check(x) {\n"
+    "    if (x < 0) { throw \"negative\"; }\n"
+    "    return x;\n"
+    "}\n"
+    "\n"
+    "// The inner catch rethrows from inside the outer try.\n"
+    "func safe(x) {\n"
+    "    try {\n"
+    "        try {\n"
+    "            return check(x);\n"
+    "        } catch (e) {\n"
+    "            if (x < -5) { throw e; }\n"
+    "            return 0;\n"
+    "        }\n"
+    "    } catch (e) {\n"
+    "        return -1;\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "// Deeper than the frame stack, unless each call reuses the frame.\n"
+    "func count(n, acc) {\n"
+    "    if (n == 0) { return acc; }\n"
+    "    return count(n - 1, acc + 1);\n"
+    "}\n"
+    "\n"
+    "func main() {\n"
+    "    var i = 0;\n"
+    "    var total = 0;\n"
+    "    while (i < 5) {\n"
+    "        total = total + square(i);\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    print total;\n"
+    "    print fib(10);\n"
+    "    print \"a\\tb\";\n"
+    "    print -2.5;\n"
+    "    if (total != 30) { print \"wrong\"; } else if (total >= 30) { print \"ok\"; } else { print \"no\"; }\n"
+    "    counter = 7;\n"
+    "    print counter;\n"
+    "    print safe(3);\n"
+    "    print safe(-1);\n"
+    "    print safe(-9);\n"
+    "    print count(100000, 0);\n"
+    "}\n";
+
+static const char expected[] = "30\n55\na\tb\n-2.5\nok\n7\n3\n0\n-1\n100000\n";
+
+static int
+run(const CPModule *module, CPCompiler *compiler)
+{
+    CPVM vm;
+    CPValue result;
+    char output[256];
+    FILE *out = tmpfile();
+    if (out == NULL || CPVM_Init(&vm, module) != 0) {
+        printf("Cannot create the interpreter\n");
+        return -1;
+    }
+    vm.out = out;
+    vm.compile = compiler != NULL ? CPCompiler_CompileLazily : NULL;
+    vm.context = compiler;
+    int rv = CPVM_Call(&vm, module->entry, NULL, 0, &result);
+    CPVM_Destroy(&vm);
+    size_t n = 0;
+    if (rv == 0) {
+        rewind(out);
+        n = fread(output, 1, sizeof(output) - 1, out);
+    }
+    fclose(out);
+    output[n] = '\0';
+    if (rv != 0 || strcmp(output, expected) != 0) {
+        printf("Wrong output:\n%s", output);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+check_error(const char *source)
+{
+    CPCompiler compiler;
+    if (CPCompiler_Load(&compiler, "error", source, strlen(source)) == 0) {
+        int rv = CPCompiler_CompileAll(&compiler);
+        CPCompiler_Close(&compiler);
+        if (rv == 0) {
+            printf("Compiled: %s\n", source);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int
+main()
+{
+    CPCompiler compiler;
+    if (CPCompiler_Load(&compiler, "test", program, strlen(program)) != 0) {
+        printf("Pre-parse failed\n");
+        return -1;
+    }
+    if (compiler.function_count != 7 || compiler.stats.preparsed != 7 || compiler.import_count != 1 ||
+        CPCompiler_Find(&compiler, "main") != 6 || compiler.module.entry != 6) {
+        printf("Wrong pre-parse\n");
+        return -1;
+    }
+    if (run(&compiler.module, &compiler) != 0) {
+        return -1;
+    }
+    /* All but unused were called; it was never compiled. */
+    if (compiler.stats.lazy != 6 || compiler.stats.eager != 0 || compiler.functions[0].code != NULL) {
+        printf("Wrong lazy compilation: %u lazy\n", compiler.stats.lazy);
+        return -1;
+    }
+    /* Compiling everything reaches the broken body. */
+    if (CPCompiler_CompileAll(&compiler) == 0) {
+        printf("Compiled a broken function\n");
+        return -1;
+    }
+    CPCompiler_Close(&compiler);
+
+    /* The same program without the broken function, compiled to an image. */
+    const char *rest = strstr(program, "func square");
+    if (CPCompiler_Load(&compiler, "test", rest, strlen(rest)) != 0 ||
+        CPCompiler_Write(&compiler, IMAGE) != 0 || compiler.stats.eager != 6) {
+        printf("Cannot write the image\n");
+        return -1;
+    }
+    CPCompiler_Close(&compiler);
+    CPModule module;
+    if (CPModule_Open(&module, IMAGE) != 0) {
+        printf("Cannot load the image\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < module.function_count; i++) {
+        if (CPModule_Verify(&module, i) != 0) {
+            printf("Function %u does not verify\n", i);
+            return -1;
+        }
+    }
+    if (run(&module, NULL) != 0) {
+        return -1;
+    }
+    CPString_Reset();
+    CPModule_Close(&module);
+    remove(IMAGE);
+
+    if (check_error("func f() { ( }") != 0 ||
+        check_error("func f() {} func f() {}") != 0 ||
+        check_error("var x;") != 0 ||
+        check_error("func f() { g(); }") != 0 ||
+        check_error("func f(x) { f(); }") != 0 ||
+        check_error("func f() { var a; var a; }") != 0 ||
+        check_error("func f() { return lib.g(); }") != 0 ||
+        check_error("func f() { return 9223372036854775808; }") != 0 ||
+        check_error("func f() { return \"open; }") != 0 ||
+        check_error("func f() { try { } }") != 0 ||
+        check_error("func f() { throw; }") != 0) {
+        return -1;
+    }
+    /* Deep nesting is an error, not a stack overflow. */
+    static char deep[2000000];
+    memcpy(deep, "func f() { return ", 18);
+    memset(deep + 18, '-', sizeof(deep) - 22);
+    memcpy(deep + sizeof(deep) - 4, "x;}", 4);
+    if (check_error(deep) != 0) {
+        return -1;
+    }
+    return 0;
+}
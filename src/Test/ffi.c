@@ -0,0 +1,181 @@
+/*
+ * Test/ffi.c - test native function calls.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <compiler.h>
+#include <ffi.h>
+#include <vm.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IMAGE "test_ffi.cpm"
+
+/* The C library is part of the program, so "" finds it. */
+static const char program[] =
+    "native \"\" func labs(long) long;\n"
+    "native \"\" func abs(int) int;\n"
+    "native \"\" func atof(string) double;\n"
+    "native \"\" func strlen(string) long;\n"
+    "native \"\" func strncmp(string, string, long) int;\n"
+    "native \"libcp-test-missing.so\" func missing() void;\n"
+    "native \"\" func getenv(string) string;\n"
+    "\n"
+    "func bad() {\n"
+    "    return labs(\"x\");\n"
+    "}\n"
+    "\n"
+    "func lost() {\n"
+    "    missing();\n"
+    "}\n"
+    "\n"
+    "func main() {\n"
+    "    var i = 0;\n"
+    "    var total = 0;\n"
+    "    while (i < 1000) {\n"
+    "        total = total + labs(0 - i);\n"
+    "        i = i + 1;\n"
+    "    }\n"
+    "    print total;\n"
+    "    print abs(-7);\n"
+    "    print atof(\"2.5\") + 1;\n"
+    "    print strlen(\"hello\");\n"
+    "    print strncmp(\"abc\", \"abd\", 2);\n"
+    "    print getenv(\"CP_TEST_FFI\");\n"
+    "    print getenv(\"CP_TEST_FFI\") == \"value\";\n"
+    "}\n";
+
+static const char expected[] = "499500\n7\n3.5\n5\n0\nvalue\n1\n";
+
+static int
+run(const CPModule *module, CPCompiler *compiler)
+{
+    CPVM vm;
+    CPValue result;
+    char output[256];
+    FILE *out = tmpfile();
+    if (out == NULL || CPVM_Init(&vm, module) != 0) {
+        printf("Cannot create the interpreter\n");
+        return -1;
+    }
+    vm.out = out;
+    vm.compile = compiler != NULL ? CPCompiler_CompileLazily : NULL;
+    vm.context = compiler;
+    int rv = CPVM_Call(&vm, module->entry, NULL, 0, &result);
+    size_t n = 0;
+    if (rv == 0) {
+        rewind(out);
+        n = fread(output, 1, sizeof(output) - 1, out);
+    }
+    fclose(out);
+    output[n] = '\0';
+    if (rv != 0 || strcmp(output, expected) != 0) {
+        printf("Wrong output:\n%s", output);
+        CPVM_Destroy(&vm);
+        return -1;
+    }
+    /* Only what main called is bound. */
+    if (vm.native_count != 7 || vm.natives[0].call == NULL || vm.natives[5].call != NULL) {
+        printf("Wrong native slots\n");
+        CPVM_Destroy(&vm);
+        return -1;
+    }
+    /* Returned strings belong to the interpreter, not to the pool. */
+    if (vm.string_count != 2 || !(vm.strings[0]->flags & CP_STRING_UNPOOLED)) {
+        printf("Returned strings were not kept\n");
+        CPVM_Destroy(&vm);
+        return -1;
+    }
+    /* Arguments are checked against the signature, libraries loaded when first called. */
+    if (CPVM_Call(&vm, 0, NULL, 0, &result) == 0 || CPVM_Call(&vm, 1, NULL, 0, &result) == 0 ||
+        vm.natives[5].call != NULL) {
+        printf("Bad native calls succeeded\n");
+        CPVM_Destroy(&vm);
+        return -1;
+    }
+    CPVM_Destroy(&vm);
+    return 0;
+}
+
+static int
+check_error(const char *source)
+{
+    CPCompiler compiler;
+    if (CPCompiler_Load(&compiler, "error", source, strlen(source)) == 0) {
+        int rv = CPCompiler_CompileAll(&compiler);
+        CPCompiler_Close(&compiler);
+        if (rv == 0) {
+            printf("Compiled: %s\n", source);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int
+main()
+{
+    if (CPFFI_Trampoline("d") == NULL || CPFFI_Trampoline("vsss") == NULL || CPFFI_Trampoline("vssss") != NULL ||
+        CPFFI_Trampoline("iv") != NULL || CPFFI_Trampoline("") != NULL) {
+        printf("Wrong trampolines\n");
+        return -1;
+    }
+    setenv("CP_TEST_FFI", "value", 1);
+    CPCompiler compiler;
+    if (CPCompiler_Load(&compiler, "test", program, strlen(program)) != 0) {
+        printf("Pre-parse failed\n");
+        return -1;
+    }
+    if (compiler.module.native_count != 7 || run(&compiler.module, &compiler) != 0) {
+        return -1;
+    }
+    if (CPCompiler_Write(&compiler, IMAGE) != 0) {
+        printf("Cannot write the image\n");
+        return -1;
+    }
+    CPCompiler_Close(&compiler);
+    CPModule module;
+    if (CPModule_Open(&module, IMAGE) != 0) {
+        printf("Cannot load the image\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < module.function_count; i++) {
+        if (CPModule_Verify(&module, i) != 0) {
+            printf("Function %u does not verify\n", i);
+            return -1;
+        }
+    }
+    if (run(&module, NULL) != 0) {
+        return -1;
+    }
+    CPString_Reset();
+    CPModule_Close(&module);
+    remove(IMAGE);
+
+    if (check_error("native \"\" func f(float) int;") != 0 ||
+        check_error("native \"\" func f(int) void2;") != 0 ||
+        check_error("native \"\" func f(void) int;") != 0 ||
+        check_error("native \"\" func f(int, int, int, int) int;") != 0 ||
+        check_error("native func f() int;") != 0 ||
+        check_error("native \"\" func f() int; func f() {}") != 0 ||
+        check_error("native \"\" func f(int) int; func g() { f(); }") != 0) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,142 @@
+/*
+ * hashmap.c - test the open-addressing hash map.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <hashmap.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define KEYS 20000
+
+static int
+test_integers(void)
+{
+    static unsigned char present[KEYS];
+    CPHashMap map;
+    if (CPHashMap_Init(&map, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        printf("Failed to create map\n");
+        return -1;
+    }
+    /* Random inserts and removes against a presence array, so tombstones pile up. */
+    size_t live = 0;
+    srand(1);
+    for (int round = 0; round < 400000; round++) {
+        uintptr_t k = (uintptr_t)(rand() % KEYS);
+        if (rand() % 3 != 0) {
+            int inserted;
+            CPHashMapEntry *e = CPHashMap_Put(&map, (const void *)k, 0, &inserted);
+            if (e == NULL || inserted != !present[k]) {
+                printf("Put(%lu) wrong: inserted=%d\n", (unsigned long)k, inserted);
+                return -1;
+            }
+            e->value = (void *)(k * 3);
+            live += inserted;
+            present[k] = 1;
+        } else {
+            int rv = CPHashMap_Remove(&map, (const void *)k, 0);
+            if ((rv == 0) != present[k]) {
+                printf("Remove(%lu) wrong\n", (unsigned long)k);
+                return -1;
+            }
+            live -= rv == 0;
+            present[k] = 0;
+        }
+    }
+    if (map.size != live) {
+        printf("Wrong size: %lu, expected %lu\n", (unsigned long)map.size, (unsigned long)live);
+        return -1;
+    }
+    for (uintptr_t k = 0; k < KEYS; k++) {
+        CPHashMapEntry *e = CPHashMap_Find(&map, (const void *)k, 0);
+        if ((e != NULL) != present[k] || (e != NULL && e->value != (void *)(k * 3))) {
+            printf("Find(%lu) wrong\n", (unsigned long)k);
+            return -1;
+        }
+    }
+    size_t it = 0;
+    size_t seen = 0;
+    while (CPHashMap_Next(&map, &it) != NULL) {
+        seen++;
+    }
+    if (seen != live) {
+        printf("Iteration saw %lu entries, expected %lu\n", (unsigned long)seen, (unsigned long)live);
+        return -1;
+    }
+    CPHashMap_Destroy(&map);
+    return 0;
+}
+
+static int
+test_bytes(void)
+{
+    static char keys[KEYS][24];
+    CPHashMap map;
+    if (CPHashMap_Init(&map, CP_HASHMAP_KEY_BYTES, KEYS) != 0) {
+        printf("Failed to create map\n");
+        return -1;
+    }
+    size_t capacity = map.capacity;
+    for (int i = 0; i < KEYS; i++) {
+        /* Lengths 0..23 exercise every branch of the hash. */
+        int n = snprintf(keys[i], sizeof(keys[i]), "k%d-%.*s", i, i % 16, "abcdefghijklmnop");
+        CPHashMapEntry *e = CPHashMap_Put(&map, keys[i], (size_t)n, NULL);
+        if (e == NULL) {
+            printf("Put(%s) failed\n", keys[i]);
+            return -1;
+        }
+        e->value = keys[i];
+    }
+    if (map.capacity != capacity) {
+        printf("Map grew although it was sized for %d keys\n", KEYS);
+        return -1;
+    }
+    char probe[24];
+    for (int i = 0; i < KEYS; i++) {
+        /* Look up through a copy so keys compare by content. */
+        strcpy(probe, keys[i]);
+        CPHashMapEntry *e = CPHashMap_Find(&map, probe, strlen(probe));
+        if (e == NULL || e->value != keys[i]) {
+            printf("Find(%s) failed\n", probe);
+            return -1;
+        }
+    }
+    if (CPHashMap_Find(&map, "k0-", 2) != NULL || CPHashMap_Find(&map, "", 0) != NULL) {
+        printf("Found a key that was never added\n");
+        return -1;
+    }
+    if (CPHash_Bytes("abc", 3) == CPHash_Bytes("abd", 3) || CPHash_Int(1) == CPHash_Int(2)) {
+        printf("Trivial hash collision\n");
+        return -1;
+    }
+    CPHashMap_Destroy(&map);
+    return 0;
+}
+
+int
+main()
+{
+    if (test_integers() != 0) {
+        return -1;
+    }
+    if (test_bytes() != 0) {
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,103 @@
+/*
+ * intern.c - test string interning.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <intern.h>
+#include <hashmap.h>
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+static uint64_t table[256];
+
+int
+main()
+{
+    char buffer[16];
+    strcpy(buffer, "print");
+    const CPString *a = CPString_InternCString("print");
+    const CPString *b = CPString_Intern(buffer, 5);
+    const CPString *c = CPString_Intern("printf", 5);
+    if (a == NULL || a != b || a != c) {
+        printf("Equal strings interned to different objects\n");
+        return -1;
+    }
+    if (a->length != 5 || strcmp(a->data, "print") != 0 || a->hash != CPHash_Bytes("print", 5)) {
+        printf("Wrong interned string\n");
+        return -1;
+    }
+    if (CPString_Lookup("print", 5) != a || CPString_Lookup("input", 5) != NULL) {
+        printf("Lookup failed\n");
+        return -1;
+    }
+    if (CPString_Intern("", 0) == NULL || CPString_Intern("", 0)->data[0] != '\0') {
+        printf("Failed to intern the empty string\n");
+        return -1;
+    }
+
+    const CPString *strings[3];
+    strings[0] = a;
+    strings[1] = CPString_InternCString("a string long enough to span several words");
+    strings[2] = CPString_InternCString("x");
+    size_t size = CPString_TableSize(strings, 3);
+    if (size > sizeof(table)) {
+        printf("Table too large: %lu\n", (unsigned long)size);
+        return -1;
+    }
+    CPString_WriteTable(table, strings, 3);
+    if (CPString_TableCount(table) != 3) {
+        printf("Wrong table count\n");
+        return -1;
+    }
+
+    /* In a fresh process the records themselves become the strings. */
+    CPString_Reset();
+    const CPString *x = CPString_InternCString("x");
+    const CPString *loaded[3];
+    if (CPString_LoadTable(table, size, loaded, 3) != 0) {
+        printf("Failed to load table\n");
+        return -1;
+    }
+    if ((const void *)loaded[0] != (const void *)((char *)table + 8)) {
+        printf("First record was copied instead of used in place\n");
+        return -1;
+    }
+    if (loaded[2] != x) {
+        printf("Record not redirected to the existing string\n");
+        return -1;
+    }
+    if (CPString_InternCString("print") != loaded[0] ||
+        strcmp(loaded[1]->data, "a string long enough to span several words") != 0) {
+        printf("Loaded strings are not the unique ones\n");
+        return -1;
+    }
+    if (CPString_LoadTable(table, size - 8, loaded, 3) == 0 || CPString_LoadTable(table, size, loaded, 2) == 0) {
+        printf("Accepted a truncated table\n");
+        return -1;
+    }
+    /* A wrong hash on a new string would intern it a second time. */
+    CPString_Reset();
+    ((unsigned char *)table)[8] ^= 1;
+    if (CPString_LoadTable(table, size, loaded, 3) == 0) {
+        printf("Accepted a wrong hash\n");
+        return -1;
+    }
+    CPString_Reset();
+    return 0;
+}
@@ -0,0 +1,236 @@
+/*
+ * Test/linker.c - test the bytecode linker.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <linker.h>
+#include <module.h>
+#include <opcode.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define MAIN "test_linker_main.cpm"
+#define LIB "test_linker_lib.cpm"
+#define OUTPUT "test_linker_out.cpm"
+
+#define S(s) CPString_InternCString(s)
+
+static int
+add(CPModuleBuilder *b, const char *name, const unsigned char *code, size_t size, uint32_t *index)
+{
+    return CPModuleBuilder_Function(b, S(name), 0, 1, code, size, index);
+}
+
+/*
+ * `params' is the argument count the import of `square' records.
+ *
+ * main:   LOAD_CONST 7; LOAD_STRING "hello"; CALL helper; CALL lib.square; RETURN
+ * helper: LOAD_STRING "hello"; STORE_GLOBAL_SLOT g; LOAD_STRING "hello"; RETURN
+ * unused: CALL lib.unused; RETURN
+ */
+static int
+write_main(const char *square, uint32_t params)
+{
+    CPModuleBuilder b;
+    unsigned char code[64];
+    uint32_t c, s, g, helper, sq, unused_import, index;
+    if (CPModuleBuilder_Init(&b) != 0) {
+        return -1;
+    }
+    int rv = -1;
+    if (CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_INT, 7, &c) != 0 ||
+        CPModuleBuilder_String(&b, S("hello"), &s) != 0 ||
+        CPModuleBuilder_Global(&b, S("g"), &g) != 0 ||
+        CPModuleBuilder_Import(&b, S("test_linker_lib"), S(square), params, &sq) != 0 ||
+        CPModuleBuilder_Import(&b, S("test_linker_lib"), S("unused"), 0, &unused_import) != 0) {
+        goto end;
+    }
+    size_t n = CPOpcode_Emit(code, CP_OP_LOAD_STRING, s);
+    n += CPOpcode_Emit(code + n, CP_OP_STORE_GLOBAL_SLOT, g);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_STRING, s);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (add(&b, "helper", code, n, &helper) != 0) {
+        goto end;
+    }
+    n = CPOpcode_Emit(code, CP_OP_CALL, unused_import);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (add(&b, "unused", code, n, &index) != 0) {
+        goto end;
+    }
+    n = CPOpcode_Emit(code, CP_OP_LOAD_CONST, c);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_STRING, s);
+    n += CPOpcode_Emit(code + n, CP_OP_CALL, helper);
+    n += CPOpcode_Emit(code + n, CP_OP_CALL, sq);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (add(&b, "main", code, n, &b.entry) != 0) {
+        goto end;
+    }
+    rv = CPModuleBuilder_Write(&b, MAIN);
+end:
+    CPModuleBuilder_Destroy(&b);
+    return rv;
+}
+
+/*
+ * unused: RETURN
+ * square: LOAD_CONST 1.0; LOAD_CONST 7; LOAD_LOCAL 0; JUMP_IF_FALSE 20;
+ *         LOAD_GLOBAL_SLOT g; RETURN
+ *
+ * The library's globals are `unused' and then `g'.
+ */
+static int
+write_lib(void)
+{
+    CPModuleBuilder b;
+    unsigned char code[64];
+    uint32_t one, seven, unused, g, index;
+    if (CPModuleBuilder_Init(&b) != 0) {
+        return -1;
+    }
+    int rv = -1;
+    size_t n = CPOpcode_Emit(code, CP_OP_RETURN, 0);
+    if (add(&b, "unused", code, n, &index) != 0 ||
+        CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_FLOAT, 1, &one) != 0 ||
+        CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_INT, 7, &seven) != 0 ||
+        CPModuleBuilder_Global(&b, S("unused"), &unused) != 0 ||
+        CPModuleBuilder_Global(&b, S("g"), &g) != 0) {
+        goto end;
+    }
+    n = CPOpcode_Emit(code, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, seven);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_LOCAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_JUMP_IF_FALSE, 20);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_GLOBAL_SLOT, g);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (add(&b, "square", code, n, &index) != 0) {
+        goto end;
+    }
+    rv = CPModuleBuilder_Write(&b, LIB);
+end:
+    CPModuleBuilder_Destroy(&b);
+    return rv;
+}
+
+static int
+check_output(void)
+{
+    CPModule module;
+    if (CPModule_Open(&module, OUTPUT) != 0) {
+        printf("Cannot load the linked image\n");
+        return -1;
+    }
+    int rv = -1;
+    /* main first, then what it reaches in order; both `unused' are gone. */
+    static const char *names[] = {"main", "helper", "square"};
+    if (module.function_count != 3 || module.entry != 0 || module.import_count != 0) {
+        printf("Wrong functions: %u, entry %u\n", module.function_count, module.entry);
+        goto end;
+    }
+    for (uint32_t i = 0; i < 3; i++) {
+        if (strcmp(module.functions[i].name->data, names[i]) != 0 || CPModule_Verify(&module, i) != 0) {
+            printf("Wrong function %u\n", i);
+            goto end;
+        }
+    }
+    /* The int 7 is shared; the float 1.0 differs from an int 1 by kind only. */
+    if (module.constant_count != 2 ||
+        CPModule_ConstantKind(&module, 0) != CP_BYTECODE_CONSTANT_INT || CPModule_ConstantValue(&module, 0) != 7 ||
+        CPModule_ConstantKind(&module, 1) != CP_BYTECODE_CONSTANT_FLOAT) {
+        printf("Constants not merged\n");
+        goto end;
+    }
+    /* hello, g, main, helper, square */
+    if (module.string_count != 5) {
+        printf("Strings not merged: %u\n", module.string_count);
+        goto end;
+    }
+    const unsigned char *code = module.functions[0].code;
+    if (CPBytecode_GetU32(code + 1) != 0 || CPBytecode_GetU32(code + 11) != 1 ||
+        CPBytecode_GetU32(code + 16) != 2) {
+        printf("Operands not relocated\n");
+        goto end;
+    }
+    code = module.functions[2].code;
+    if (CPBytecode_GetU32(code + 1) != 1 || CPBytecode_GetU32(code + 6) != 0) {
+        printf("Constants of the second module not relocated\n");
+        goto end;
+    }
+    /* Both modules' g share the one slot; the library's unused global is dropped. */
+    if (module.global_count != 1 || CPModule_GlobalName(&module, 0) != S("g") ||
+        CPBytecode_GetU32(module.functions[1].code + 6) != 0 || CPBytecode_GetU32(code + 21) != 0) {
+        printf("Globals not merged\n");
+        goto end;
+    }
+    rv = 0;
+end:
+    CPString_Reset();
+    CPModule_Close(&module);
+    return rv;
+}
+
+int
+main()
+{
+    const char *inputs[] = {MAIN, LIB};
+    CPLinkerStats stats;
+    if (write_main("square", 0) != 0 || write_lib() != 0) {
+        printf("Cannot write the modules\n");
+        return -1;
+    }
+    CPString_Reset();
+    if (CPLinker_Link(OUTPUT, inputs, 2, &stats) != 0) {
+        printf("Link failed\n");
+        return -1;
+    }
+    if (stats.functions_in != 5 || stats.functions_out != 3) {
+        printf("Wrong stats: %u in, %u out\n", stats.functions_in, stats.functions_out);
+        return -1;
+    }
+    if (check_output() != 0) {
+        return -1;
+    }
+    /* A reachable import of something the library does not define. */
+    if (write_main("cube", 0) != 0) {
+        printf("Cannot write the modules\n");
+        return -1;
+    }
+    CPString_Reset();
+    if (CPLinker_Link(OUTPUT, inputs, 2, NULL) == 0) {
+        printf("Linked an undefined function\n");
+        return -1;
+    }
+    /* A call passing more arguments than the function takes. */
+    if (write_main("square", 1) != 0) {
+        printf("Cannot write the modules\n");
+        return -1;
+    }
+    CPString_Reset();
+    if (CPLinker_Link(OUTPUT, inputs, 2, NULL) == 0) {
+        printf("Linked a call with the wrong number of arguments\n");
+        return -1;
+    }
+    /* Without the library, the import cannot be resolved either. */
+    if (CPLinker_Link(OUTPUT, inputs, 1, NULL) == 0) {
+        printf("Linked a missing module\n");
+        return -1;
+    }
+    remove(MAIN);
+    remove(LIB);
+    remove(OUTPUT);
+    return 0;
+}
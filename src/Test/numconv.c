@@ -0,0 +1,245 @@
+/*
+ * Test/numconv.c - test number parsing and formatting.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <numconv.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define ROUNDS 200000
+
+static const struct
+{
+    double value;
+    const char *text;
+} formats[] = {
+    {0.0, "0"},
+    {-0.0, "-0"},
+    {1.0, "1"},
+    {-42.0, "-42"},
+    {0.1, "0.1"},
+    {0.3, "0.3"},
+    {1.5, "1.5"},
+    {123456789.0, "123456789"},
+    {1e16, "10000000000000000"},
+    {1e17, "1e+17"},
+    {1.25e20, "1.25e+20"},
+    {0.00001, "0.00001"},
+    {0.000001, "1e-6"},
+    {1.7976931348623157e308, "1.7976931348623157e+308"},
+    {2.2250738585072014e-308, "2.2250738585072014e-308"},
+    {5e-324, "5e-324"},
+    {9007199254740993.0, "9007199254740992"},
+    {1.0 / 3.0, "0.3333333333333333"},
+};
+
+static const struct
+{
+    const char *text;
+    size_t used;
+} parses[] = {
+    {"0", 1},
+    {"-0.0", 4},
+    {"+1.5e3", 6},
+    {".5", 2},
+    {"5.", 2},
+    {"1e", 1},
+    {"1e+", 1},
+    {"2.5E-3x", 6},
+    {"1e400", 5},
+    {"1e-400", 6},
+    {"2.4703282292062327e-324", 23},
+    {"2.4703282292062328e-324", 23},
+    {"9007199254740993", 16},
+    {"179769313486231580793728971405301e276", 37},
+    {"0.000000000000000000000000000000000000001", 41},
+    {"123456789012345678901234567890", 30},
+    {"7.2057594037927933e16", 21},
+    /* Halfway points, exactly and just either side of them. */
+    {"1.00000000000000011102230246251565404236316680908203125", 55},
+    {"1.00000000000000011102230246251565404236316680908203124", 55},
+    {"1.000000000000000111022302462515654042363166809082031250000000001", 65},
+    {"9007199254740993.000000000000000000", 35},
+    {"9007199254740995.000000000000000000", 35},
+    {"179769313486231580793728971405303415079934132710037826936173778980444968292764750946649017977587207096330286416692887910946555547851940402630657488671505820681908902000708383676273854845817711531764475730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904174497791", 309},
+    {"179769313486231580793728971405303415079934132710037826936173778980444968292764750946649017977587207096330286416692887910946555547851940402630657488671505820681908902000708383676273854845817711531764475730270069855571366959622842914819860834936475292719074168444365510704342711559699508093042880177904174497792", 309},
+    {"0.0000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000024703282292062327208828439643411068618252990130716238221279284125033775363510437593264991818081799618989828234772285886546332835517796989819938739800539093906315035659515570226392290858392449105184435931802849936536152500319370457678249219365623669863658480757001585769269903706311928279558551332927834338409351978015531246597263579574622766465272827220056374006485499977096599470454020828166226237857393450736339007967761930577506740176324673600968951340535537458516661134223766678604162159680461914467291840300530057530849048765391711386591646239524912623653881879636239373280423891018672348497668235089863388587925628302755995657524455507255189313690836254779186948667994968324049705821028513185451396213837722826145437693412532098591327667236328125", 1077},
+    {"0.00000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000000247032822920623272088284396434110686182529901307162382212792841250337753635104375932649918180817996189898282347722858865463328355177969898199387398005390939063150356595155702263922908583924491051844359318028499365361525003193704576782492193656236698636584807570015857692699037063119282795585513329278343384093519780155312465972635795746227664652728272200563740064854999770965994704540208281662262378573934507363390079677619305775067401763246736009689513405355374585166611342237666786041621596804619144672918403005300575308490487653917113865916462395249126236538818796362393732804238910186723484976682350898633885879256283027559956575244555072551893136908362547791869486679949683240497058210285131854513962138377228261454376934125320985913276672363281251", 1078},
+    {"", 0},
+    {"-", 0},
+    {".", 0},
+    {"e5", 0},
+};
+
+static uint64_t
+random64(void)
+{
+    uint64_t r = 0;
+    for (int i = 0; i < 4; i++) {
+        r = (r << 16) ^ (uint64_t)(rand() & 0xFFFF);
+    }
+    return r;
+}
+
+static int
+check_parse(const char *text, size_t used)
+{
+    double expected = strtod(text, NULL);
+    double value = 0.0;
+    if (CPNum_ParseDouble(text, strlen(text), &value) != used) {
+        printf("Parsing '%s' used the wrong length\n", text);
+        return -1;
+    }
+    if (used != 0 && memcmp(&value, &expected, sizeof(value)) != 0) {
+        printf("Parsing '%s' gave %.17g, expected %.17g\n", text, value, expected);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+check_integers(uint64_t u)
+{
+    char buffer[CP_NUM_BUFFER_SIZE];
+    char expected[CP_NUM_BUFFER_SIZE];
+    size_t length = CPNum_FormatU64(u, buffer);
+    snprintf(expected, sizeof(expected), "%" PRIu64, u);
+    uint64_t parsed = 0;
+    if (strcmp(buffer, expected) != 0 || length != strlen(expected) ||
+        CPNum_ParseU64(buffer, length, &parsed) != length || parsed != u) {
+        printf("Unsigned %s formatted as %s\n", expected, buffer);
+        return -1;
+    }
+    int64_t i = (int64_t)u;
+    length = CPNum_FormatI64(i, buffer);
+    snprintf(expected, sizeof(expected), "%" PRId64, i);
+    int64_t parsed_signed = 0;
+    if (strcmp(buffer, expected) != 0 || length != strlen(expected) ||
+        CPNum_ParseI64(buffer, length, &parsed_signed) != length || parsed_signed != i) {
+        printf("Signed %s formatted as %s\n", expected, buffer);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+check_double(double value)
+{
+    char buffer[CP_NUM_BUFFER_SIZE];
+    size_t length = CPNum_FormatDouble(value, buffer);
+    if (length != strlen(buffer)) {
+        printf("Formatting %.17g returned the wrong length\n", value);
+        return -1;
+    }
+    double back = strtod(buffer, NULL);
+    if (memcmp(&back, &value, sizeof(value)) != 0) {
+        printf("%.17g formatted as %s, which reads back as %.17g\n", value, buffer, back);
+        return -1;
+    }
+
+    /* One significant digit fewer must not round-trip. */
+    const char *first = buffer + strcspn(buffer, "123456789");
+    const char *last = buffer + strcspn(buffer, "e");
+    while (last > first && (last[-1] == '0' || last[-1] == '.')) {
+        last--;
+    }
+    int digits = 0;
+    for (const char *p = first; p < last; p++) {
+        digits += *p != '.';
+    }
+    if (digits > 1) {
+        char shorter[64];
+        snprintf(shorter, sizeof(shorter), "%.*e", digits - 2, value);
+        back = strtod(shorter, NULL);
+        if (memcmp(&back, &value, sizeof(value)) == 0) {
+            printf("%s is not the shortest form of %.17g; %s is\n", buffer, value, shorter);
+            return -1;
+        }
+    }
+
+    /* What %.17g prints must parse back to the same bits. */
+    char text[64];
+    snprintf(text, sizeof(text), "%.17g", value);
+    return check_parse(text, strlen(text));
+}
+
+int
+main()
+{
+    char buffer[CP_NUM_BUFFER_SIZE];
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        size_t length = CPNum_FormatDouble(formats[i].value, buffer);
+        if (strcmp(buffer, formats[i].text) != 0 || length != strlen(buffer)) {
+            printf("Formatted %.17g as '%s', expected '%s'\n", formats[i].value, buffer, formats[i].text);
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < sizeof(parses) / sizeof(parses[0]); i++) {
+        if (check_parse(parses[i].text, parses[i].used) != 0) {
+            return -1;
+        }
+    }
+
+    uint64_t u;
+    int64_t s;
+    if (CPNum_ParseU64("18446744073709551615", 20, &u) != 20 || u != UINT64_MAX ||
+        CPNum_ParseU64("18446744073709551616", 20, &u) != 0 ||
+        CPNum_ParseI64("-9223372036854775808", 20, &s) != 20 || s != INT64_MIN ||
+        CPNum_ParseI64("9223372036854775808", 19, &s) != 0 ||
+        CPNum_ParseU64("12ab", 4, &u) != 2 || u != 12 ||
+        CPNum_ParseU64("-1", 2, &u) != 0) {
+        printf("Integer parsing limits are wrong\n");
+        return -1;
+    }
+    for (int shift = 0; shift < 64; shift++) {
+        if (check_integers(1ULL << shift) != 0 || check_integers((1ULL << shift) - 1) != 0) {
+            return -1;
+        }
+    }
+
+    for (int round = 0; round < ROUNDS; round++) {
+        uint64_t bits = random64();
+        if (check_integers(bits >> (rand() % 64)) != 0) {
+            return -1;
+        }
+        double value;
+        memcpy(&value, &bits, sizeof(value));
+        if (value != value || value - value != 0.0) {
+            continue;
+        }
+        if (check_double(value) != 0) {
+            return -1;
+        }
+
+        /* Short decimals with a random exponent, as a lexer would see them. */
+        char text[64];
+        snprintf(text, sizeof(text), "%" PRIu64 "e%d", bits >> (rand() % 64), rand() % 700 - 350);
+        if (check_parse(text, strlen(text)) != 0) {
+            return -1;
+        }
+        /* And long ones, which the first 19 digits do not settle. */
+        snprintf(text, sizeof(text), "%.*e", 19 + rand() % 30, value);
+        if (check_parse(text, strlen(text)) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
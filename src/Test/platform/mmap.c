@@ -20,6 +20,7 @@
 #include <platform/mmap.h>
 
 #include <stdio.h>
+#include <stdint.h>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -82,6 +83,75 @@ main()
         printf("Failed to destroy memory mapping 2: %d\n", err);
         return -1;
     }
+    CPMemoryMapping map3;
+    ret = CPMemoryMapping_Create(&map3, file, -1, 0, CP_MMAP_PROT_READ, CP_MMAP_FLAG_SHARED | CP_MMAP_FLAG_POPULATE);
+    if (ret != 0) {
+        printf("Failed to create populated memory mapping 3: %d\n", err);
+        return -1;
+    }
+    static const int advice[] = {
+        CP_MMAP_ADVICE_SEQUENTIAL,
+        CP_MMAP_ADVICE_RANDOM,
+        CP_MMAP_ADVICE_WILLNEED,
+        CP_MMAP_ADVICE_DONTNEED,
+        CP_MMAP_ADVICE_NORMAL,
+    };
+    for (size_t i = 0; i < sizeof(advice) / sizeof(advice[0]); i++) {
+        ret = CPMemoryMapping_Advise(&map3, 0, -1, advice[i]);
+        if (ret != 0) {
+            printf("Failed to advise memory mapping 3 (%d): %d\n", advice[i], err);
+            return -1;
+        }
+    }
+    /* Shared file pages are simply read back in after DONTNEED. */
+    if (((char *)map3.addr)[0] != 'T') {
+        printf("Unexpected content in memory mapping 3\n");
+        return -1;
+    }
+    if (CPMemoryMapping_Advise(&map3, 0, map3.size + 1, CP_MMAP_ADVICE_NORMAL) == 0) {
+        printf("Advice beyond the end of memory mapping 3 was accepted\n");
+        return -1;
+    }
+    ret = CPMemoryMapping_Destroy(&map3);
+    if (ret != 0) {
+        printf("Failed to destroy memory mapping 3: %d\n", err);
+        return -1;
+    }
     fclose(file);
+    size_t page = CPMemoryMapping_PageSize();
+    if (page == 0 || (page & (page - 1)) != 0) {
+        printf("Invalid page size: %lu\n", (unsigned long)page);
+        return -1;
+    }
+    CPMemoryMapping map4;
+    ret = CPMemoryMapping_Create(&map4, NULL, 3 * page, 0, CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE,
+                                 CP_MMAP_FLAG_PRIVATE | CP_MMAP_FLAG_HUGEPAGE | CP_MMAP_FLAG_POPULATE);
+    if (ret != 0) {
+        printf("Failed to create huge page memory mapping 4: %d\n", err);
+        return -1;
+    }
+#ifndef _WIN32
+    if (map4.size % CP_MMAP_HUGEPAGE_SIZE != 0 || (uintptr_t)map4.addr % CP_MMAP_HUGEPAGE_SIZE != 0) {
+        printf("Huge page memory mapping 4 is not 2 MB aligned\n");
+        return -1;
+    }
+#endif
+    ((char *)map4.addr)[map4.size - 1] = 'G';
+    ret = CPMemoryMapping_Advise(&map4, page, page, CP_MMAP_ADVICE_HUGEPAGE);
+    if (ret != 0) {
+        /* Kernels without transparent huge pages refuse this; it is only a hint. */
+        printf("Note: huge page advice refused: %d\n", err);
+    }
+    ((char *)map4.addr)[1] = 'H';
+    ret = CPMemoryMapping_Advise(&map4, 1, 1, CP_MMAP_ADVICE_DONTNEED);
+    if (ret != 0) {
+        printf("Failed to release memory mapping 4: %d\n", err);
+        return -1;
+    }
+    ret = CPMemoryMapping_Destroy(&map4);
+    if (ret != 0) {
+        printf("Failed to destroy memory mapping 4: %d\n", err);
+        return -1;
+    }
     return 0;
 }
@@ -0,0 +1,143 @@
+/*
+ * mmapview.c - test sliding-window views of large files.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <platform/mmapview.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define err (int)GetLastError()
+#else
+#include <errno.h>
+#define err errno
+#endif
+
+/* Byte i of the test file; not periodic in any power of two. */
+#define BYTE_AT(i) ((unsigned char)(((i) * 7 + (i) / 251) & 0xff))
+
+static int
+check(CPMemoryView *view, size_t offset, size_t length)
+{
+    void *ptr;
+    if (CPMemoryView_Get(view, offset, length, &ptr) != 0) {
+        printf("Failed to get view of [%lu, +%lu): %d\n", (unsigned long)offset, (unsigned long)length, err);
+        return -1;
+    }
+    for (size_t i = 0; i < length; i++) {
+        if (((unsigned char *)ptr)[i] != BYTE_AT(offset + i)) {
+            printf("Wrong byte at %lu\n", (unsigned long)(offset + i));
+            return -1;
+        }
+    }
+    int mapped = 0;
+    for (int i = 0; i < CP_MMAP_VIEW_WINDOWS; i++) {
+        mapped += view->windows[i].mapped;
+    }
+    if (mapped > CP_MMAP_VIEW_WINDOWS) {
+        printf("Too many windows mapped\n");
+        return -1;
+    }
+    return 0;
+}
+
+int
+main()
+{
+    size_t granularity = CPMemoryMapping_Granularity();
+    size_t file_size = 40 * granularity + 123;
+    FILE *file = fopen("test_mmapview.txt", "wb+");
+    if (file == NULL) {
+        printf("Failed to open file: %d\n", err);
+        return -1;
+    }
+    for (size_t i = 0; i < file_size; i++) {
+        if (fputc(BYTE_AT(i), file) == EOF) {
+            printf("Failed to write to file: %d\n", err);
+            fclose(file);
+            return -1;
+        }
+    }
+    fflush(file);
+    CPMemoryView view;
+    if (CPMemoryView_Open(&view, file, 4 * granularity, CP_MMAP_PROT_READ, CP_MMAP_FLAG_SHARED) != 0) {
+        printf("Failed to open view: %d\n", err);
+        return -1;
+    }
+    if (view.file_size != file_size) {
+        printf("Wrong file size: %lu\n", (unsigned long)view.file_size);
+        return -1;
+    }
+    size_t max = CPMemoryView_MaxLength(&view);
+    /* Stream through the file in unaligned steps. */
+    for (size_t off = 0; off + 1000 <= file_size; off += 997) {
+        if (check(&view, off, 1000) != 0) {
+            return -1;
+        }
+    }
+    /* Longest ranges at the worst offsets, and the tail of the file. */
+    if (check(&view, granularity - 1, max) != 0 ||
+        check(&view, 7 * granularity + 1, max) != 0 ||
+        check(&view, file_size - 10, 10) != 0 ||
+        check(&view, 3, 5) != 0) {
+        return -1;
+    }
+    void *ptr;
+    if (CPMemoryView_Get(&view, 0, max + 1, &ptr) == 0) {
+        printf("Range longer than the window was accepted\n");
+        return -1;
+    }
+    if (CPMemoryView_Get(&view, file_size - 10, 11, &ptr) == 0) {
+        printf("Range past the end of the file was accepted\n");
+        return -1;
+    }
+    if (CPMemoryView_Close(&view) != 0) {
+        printf("Failed to close view: %d\n", err);
+        return -1;
+    }
+    /* With every window in use, an empty range at an aligned end evicts none. */
+    if (CPMemoryView_Open(&view, file, 4 * granularity, CP_MMAP_PROT_READ, CP_MMAP_FLAG_SHARED) != 0) {
+        printf("Failed to open view: %d\n", err);
+        return -1;
+    }
+    for (int i = 0; i < CP_MMAP_VIEW_WINDOWS; i++) {
+        if (check(&view, (size_t)i * 8 * granularity, 10) != 0) {
+            return -1;
+        }
+    }
+    view.file_size = 40 * granularity;
+    if (CPMemoryView_Get(&view, view.file_size, 0, &ptr) != 0 || ptr != NULL) {
+        printf("Empty range at the end failed\n");
+        return -1;
+    }
+    for (int i = 0; i < CP_MMAP_VIEW_WINDOWS; i++) {
+        if (!view.windows[i].mapped) {
+            printf("Empty range evicted a window\n");
+            return -1;
+        }
+    }
+    if (CPMemoryView_Close(&view) != 0) {
+        printf("Failed to close view: %d\n", err);
+        return -1;
+    }
+    fclose(file);
+    remove("test_mmapview.txt");
+    return 0;
+}
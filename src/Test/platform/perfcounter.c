@@ -0,0 +1,90 @@
+/*
+ * perfcounter.c - test hardware performance counters.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <platform/perfcounter.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static volatile unsigned long sink;
+
+static int
+measure(int fallback)
+{
+    CPPerfCounter counter;
+    if (CPPerfCounter_Open(&counter) != 0) {
+        printf("Failed to open performance counters\n");
+        return -1;
+    }
+    /* Only time and the getrusage() page faults are left. */
+    if (fallback && counter.available != (1 << CP_PERF_PAGE_FAULTS)) {
+        printf("Fallback still measures 0x%x\n", (unsigned)counter.available);
+        return -1;
+    }
+    if (CPPerfCounter_Start(&counter) != 0) {
+        printf("Failed to start performance counters\n");
+        return -1;
+    }
+    for (unsigned long i = 0; i < 1000000; i++) {
+        sink += i;
+    }
+    if (CPPerfCounter_Stop(&counter) != 0) {
+        printf("Failed to stop performance counters\n");
+        return -1;
+    }
+    if (counter.elapsed_ns == 0) {
+        printf("Elapsed time was not measured\n");
+        return -1;
+    }
+    /* The loop above retires at least a million instructions. */
+    if ((counter.available & (1 << CP_PERF_INSTRUCTIONS)) &&
+        counter.values[CP_PERF_INSTRUCTIONS] < 1000000) {
+        printf("Implausible instruction count: %llu\n",
+               (unsigned long long)counter.values[CP_PERF_INSTRUCTIONS]);
+        return -1;
+    }
+    for (int i = 0; i < CP_PERF_EVENTS; i++) {
+        if (counter.available & (1 << i)) {
+            printf("%s: %llu\n", CPPerfCounter_Name(i), (unsigned long long)counter.values[i]);
+        } else {
+            printf("%s: not available\n", CPPerfCounter_Name(i));
+        }
+    }
+    printf("elapsed: %llu ns\n", (unsigned long long)counter.elapsed_ns);
+    if (CPPerfCounter_Close(&counter) != 0) {
+        printf("Failed to close performance counters\n");
+        return -1;
+    }
+    return 0;
+}
+
+int
+main()
+{
+    /* Whatever this host allows, then the fallback. */
+    if (measure(0) != 0) {
+        return -1;
+    }
+#ifndef _WIN32
+    if (setenv(CP_PERF_DISABLE_ENV, "1", 1) != 0 || measure(1) != 0) {
+        return -1;
+    }
+#endif
+    return 0;
+}
@@ -0,0 +1,121 @@
+/*
+ * rope.c - test rope strings.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <rope.h>
+#include <hashmap.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PIECES 100000
+
+static char expected[PIECES * 8];
+
+int
+main()
+{
+    /* Append and prepend pieces of varying length, mirroring into a flat buffer. */
+    CPRope *rope = CPRope_FromBytes("", 0);
+    size_t length = 0;
+    size_t start = PIECES * 4;
+    srand(1);
+    for (int i = 0; i < PIECES; i++) {
+        char piece[8];
+        int n = rand() % 8;
+        for (int j = 0; j < n; j++) {
+            piece[j] = (char)('a' + (i + j) % 26);
+        }
+        CPRope *p = CPRope_FromBytes(piece, (size_t)n);
+        int r = rand() % 4;
+        if (r == 0) {
+            CPRope *next = CPRope_Concat(p, rope);
+            CPRope_Release(rope);
+            rope = next;
+            start -= (size_t)n;
+            memcpy(expected + start, piece, (size_t)n);
+        } else {
+            if (r == 1) {
+                CPRope *next = CPRope_Concat(rope, p);
+                CPRope_Release(rope);
+                rope = next;
+            } else {
+                rope = CPRope_Append(rope, p);
+            }
+            memcpy(expected + start + length, piece, (size_t)n);
+        }
+        length += (size_t)n;
+        CPRope_Release(p);
+        if (rope == NULL) {
+            printf("Concat failed\n");
+            return -1;
+        }
+    }
+    if (CPRope_Length(rope) != length) {
+        printf("Wrong length: %lu, expected %lu\n", (unsigned long)CPRope_Length(rope), (unsigned long)length);
+        return -1;
+    }
+    /* Balanced: about log2(PIECES * 7 / CP_ROPE_SHORT_LENGTH) * 1.45. */
+    if (rope->depth > 30) {
+        printf("Rope is not balanced: depth %d\n", rope->depth);
+        return -1;
+    }
+    static char copy[PIECES * 8];
+    CPRope_CopyTo(rope, copy);
+    if (memcmp(copy, expected + start, length) != 0) {
+        printf("CopyTo produced wrong contents\n");
+        return -1;
+    }
+
+    /* Share the rope in a bigger one, then flatten the shared part. */
+    CPRope *twice = CPRope_Concat(rope, rope);
+    if (CPRope_CharAt(rope, length / 2) != (unsigned char)expected[start + length / 2] || !CPRope_IsFlat(rope)) {
+        printf("CharAt failed to flatten\n");
+        return -1;
+    }
+    if (CPRope_Hash(rope) != CPHash_Bytes(expected + start, length) || CPRope_CharAt(rope, length) != -1) {
+        printf("Wrong hash or bounds\n");
+        return -1;
+    }
+    const char *flat = CPRope_Flatten(twice);
+    if (CPRope_Length(twice) != 2 * length || memcmp(flat, expected + start, length) != 0 ||
+        memcmp(flat + length, expected + start, length) != 0 || flat[2 * length] != '\0') {
+        printf("Shared rope has wrong contents\n");
+        return -1;
+    }
+    CPRope_Release(twice);
+    CPRope_Release(rope);
+
+    CPRope *pieces[3];
+    pieces[0] = CPRope_FromCString("a");
+    pieces[1] = CPRope_FromCString("b");
+    pieces[2] = CPRope_FromCString("c");
+    CPRope *comma = CPRope_FromCString(", ");
+    CPRope *joined = CPRope_Join(comma, pieces, 3);
+    if (strcmp(CPRope_Flatten(joined), "a, b, c") != 0) {
+        printf("Join produced '%s'\n", CPRope_Flatten(joined));
+        return -1;
+    }
+    CPRope_Release(joined);
+    CPRope_Release(comma);
+    for (int i = 0; i < 3; i++) {
+        CPRope_Release(pieces[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+/*
+ * Test/server.c - test forwarding commands to a server.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <server.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+
+#define SOCKET "test_server.sock"
+#define OUTPUT "test_server.txt"
+
+/* Echo what arrived and exit with the argument count. */
+static int
+handler(int argc, char **argv)
+{
+    char cwd[4096];
+    const char *home = getenv("CPLOCALHOME");
+    printf("%s %s %s\n", argv[0], argv[argc - 1], home != NULL ? home : "-");
+    fflush(stdout);
+    fprintf(stderr, "%s\n", getcwd(cwd, sizeof(cwd)) != NULL ? cwd : "-");
+    return argc;
+}
+
+static int
+forward(char **argv, int argc, int *status)
+{
+    /* The server writes to our stdout and stderr; point them at a file. */
+    int saved_out = dup(1), saved_err = dup(2);
+    FILE *file = fopen(OUTPUT, "w");
+    if (file == NULL) {
+        return -1;
+    }
+    dup2(fileno(file), 1);
+    dup2(fileno(file), 2);
+    int rv = CPServer_Forward(SOCKET, argc, argv, status);
+    dup2(saved_out, 1);
+    dup2(saved_err, 2);
+    close(saved_out);
+    close(saved_err);
+    fclose(file);
+    return rv;
+}
+
+int
+main()
+{
+    char *argv[] = {"run", "--eager", "main.cp"};
+    char expected[4200], output[4200], cwd[4096];
+    int status;
+    remove(SOCKET);
+    if (CPServer_Forward(SOCKET, 3, argv, &status) == 0) {
+        printf("Forwarded without a server\n");
+        return -1;
+    }
+    pid_t server = fork();
+    if (server == 0) {
+        _exit(CPServer_Run(SOCKET, handler) == 0 ? 0 : 1);
+    }
+    /* Wait for it to listen. */
+    setenv("CPLOCALHOME", "/opt/cp", 1);
+    int rv = -1;
+    for (int i = 0; i < 500 && rv != 0; i++) {
+        usleep(10000);
+        rv = forward(argv, 3, &status);
+    }
+    struct stat st;
+    if (rv == 0 && (stat(SOCKET, &st) != 0 || (st.st_mode & 0777) != 0600)) {
+        printf("The socket is not private to its user\n");
+        rv = -1;
+    }
+    kill(server, SIGTERM);
+    waitpid(server, NULL, 0);
+    remove(SOCKET);
+    if (rv != 0 || status != 3) {
+        printf("Forwarding failed: %d, status %d\n", rv, status);
+        return -1;
+    }
+    FILE *file = fopen(OUTPUT, "r");
+    size_t n = file != NULL ? fread(output, 1, sizeof(output) - 1, file) : 0;
+    if (file != NULL) {
+        fclose(file);
+    }
+    output[n] = '\0';
+    remove(OUTPUT);
+    if (getcwd(cwd, sizeof(cwd)) == NULL) {
+        return -1;
+    }
+    snprintf(expected, sizeof(expected), "run main.cp /opt/cp\n%s\n", cwd);
+    if (strcmp(output, expected) != 0) {
+        printf("Wrong output:\n%s", output);
+        return -1;
+    }
+    return 0;
+}
+
+#else
+
+int
+main()
+{
+    return 0;
+}
+
+#endif
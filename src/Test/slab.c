@@ -0,0 +1,106 @@
+/*
+ * Test/slab.c - test the slab allocator.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <slab.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LIVE 20000
+#define ROUNDS 200000
+
+static unsigned char *objects[LIVE];
+static size_t sizes[LIVE];
+
+static int
+check(size_t i)
+{
+    for (size_t k = 0; k < sizes[i]; k++) {
+        if (objects[i][k] != (unsigned char)(i * 31 + k)) {
+            printf("Object %lu of %lu bytes was overwritten\n", (unsigned long)i, (unsigned long)sizes[i]);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+allocate(size_t i)
+{
+    /* Mostly small objects, sometimes one for malloc(). */
+    sizes[i] = rand() % 50 == 0 ? 513 + (size_t)rand() % 2000 : (size_t)rand() % (CP_SLAB_MAX_SIZE + 1);
+    objects[i] = CPSlab_Alloc(sizes[i]);
+    if (objects[i] == NULL || (uintptr_t)objects[i] % 16 != 0) {
+        printf("Bad allocation of %lu bytes\n", (unsigned long)sizes[i]);
+        return -1;
+    }
+    for (size_t k = 0; k < sizes[i]; k++) {
+        objects[i][k] = (unsigned char)(i * 31 + k);
+    }
+    return 0;
+}
+
+int
+main()
+{
+    for (size_t i = 0; i < LIVE; i++) {
+        if (allocate(i) != 0) {
+            return -1;
+        }
+    }
+    /* Random frees and reallocations; any overlap corrupts a pattern. */
+    for (int round = 0; round < ROUNDS; round++) {
+        size_t i = (size_t)rand() % LIVE;
+        if (check(i) != 0) {
+            return -1;
+        }
+        CPSlab_Free(objects[i], sizes[i]);
+        if (allocate(i) != 0) {
+            return -1;
+        }
+    }
+    for (size_t i = 0; i < LIVE; i++) {
+        if (check(i) != 0) {
+            return -1;
+        }
+        CPSlab_Free(objects[i], sizes[i]);
+    }
+
+    /* A flushed cache is refilled from the depot with the same memory. */
+    void *p = CPSlab_Alloc(40);
+    CPSlab_Free(p, 40);
+    CPSlab_FlushThread();
+    int found = 0;
+    void *again[256];
+    for (int i = 0; i < 256; i++) {
+        again[i] = CPSlab_Alloc(48);
+        found |= again[i] == p;
+    }
+    for (int i = 0; i < 256; i++) {
+        CPSlab_Free(again[i], 48);
+    }
+    if (!found) {
+        printf("Flushed object was not reused\n");
+        return -1;
+    }
+    CPSlab_Free(NULL, 16);
+    return 0;
+}
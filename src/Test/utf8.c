@@ -0,0 +1,138 @@
+/*
+ * utf8.c - test UTF-8 validation and transcoding.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <utf8.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_CODE_POINTS 300
+
+static const struct
+{
+    const char *bytes;
+    int valid;
+} cases[] = {
+    {"plain ascii", 1},
+    {"\xC3\xA9t\xC3\xA9", 1},
+    {"\xE2\x82\xAC", 1},
+    {"\xF0\x9F\x98\x80", 1},
+    {"\xF4\x8F\xBF\xBF", 1},
+    {"\xC0\x80", 0},         // overlong NUL
+    {"\xE0\x80\xAF", 0},     // overlong 3-byte
+    {"\xF0\x80\x80\xAF", 0}, // overlong 4-byte
+    {"\xED\xA0\x80", 0},     // surrogate
+    {"\xF4\x90\x80\x80", 0}, // above U+10FFFF
+    {"\xF8\x88\x80\x80\x80", 0},
+    {"\x80", 0},
+    {"a\xE2\x82", 0},
+    {"\xE2\x82" "a", 0},
+};
+
+static size_t
+random_text(uint8_t *dst, uint32_t *code_points, size_t *count)
+{
+    /* Mostly ASCII with some 2-, 3- and 4-byte characters; sometimes long ASCII runs. */
+    size_t n = (size_t)(rand() % MAX_CODE_POINTS);
+    int spread = rand() % 2 ? 8 : 100;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t c;
+        switch (rand() % spread) {
+        case 0: c = 0x80 + (uint32_t)rand() % 0x780; break;
+        case 1: c = 0x800 + (uint32_t)rand() % 0xF800; break;
+        case 2: c = 0x10000 + (uint32_t)rand() % 0x100000; break;
+        default: c = (uint32_t)rand() % 0x80; break;
+        }
+        if (c >= 0xD800 && c <= 0xDFFF) {
+            c = 'x';
+        }
+        code_points[i] = c;
+    }
+    *count = n;
+    return CPUtf8_FromUtf32(code_points, n, dst);
+}
+
+int
+main()
+{
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (int level = CP_UTF8_SCALAR; level <= CP_UTF8_AVX2; level++) {
+            if (CPUtf8_SetLevel(level) != 0) {
+                continue;
+            }
+            if ((CPUtf8_Validate(cases[i].bytes, strlen(cases[i].bytes), NULL) == 0) != cases[i].valid) {
+                printf("Case %lu misjudged at level %d\n", (unsigned long)i, level);
+                return -1;
+            }
+        }
+    }
+
+    static uint8_t text[MAX_CODE_POINTS * 4];
+    static uint32_t code_points[MAX_CODE_POINTS];
+    static uint32_t decoded[MAX_CODE_POINTS * 4];
+    srand(1);
+    for (int round = 0; round < 20000; round++) {
+        size_t count;
+        size_t length = random_text(text, code_points, &count);
+        /* Every other round, break a random byte. */
+        int mutated = round % 2 && length > 0;
+        if (mutated) {
+            text[rand() % length] = (uint8_t)rand();
+        }
+        CPUtf8_SetLevel(CP_UTF8_SCALAR);
+        size_t expected_offset = 0;
+        int expected = CPUtf8_Validate(text, length, &expected_offset);
+        if (!mutated && expected != 0) {
+            printf("Generated text rejected at offset %lu\n", (unsigned long)expected_offset);
+            return -1;
+        }
+        for (int level = CP_UTF8_SCALAR; level <= CP_UTF8_AVX2; level++) {
+            if (CPUtf8_SetLevel(level) != 0) {
+                continue;
+            }
+            size_t offset = 0;
+            int rv = CPUtf8_Validate(text, length, &offset);
+            if (rv != expected || (rv != 0 && offset != expected_offset)) {
+                printf("Level %d disagrees with scalar on round %d: %d at %lu vs %d at %lu\n",
+                       level, round, rv, (unsigned long)offset, expected, (unsigned long)expected_offset);
+                return -1;
+            }
+            if (mutated) {
+                continue;
+            }
+            if (CPUtf8_Count(text, length) != count) {
+                printf("Level %d miscounted round %d\n", level, round);
+                return -1;
+            }
+            if (CPUtf8_ToUtf32(text, length, decoded) != count ||
+                memcmp(decoded, code_points, count * sizeof(uint32_t)) != 0) {
+                printf("Level %d mis-decoded round %d\n", level, round);
+                return -1;
+            }
+            size_t index = count ? (size_t)rand() % count : 0;
+            size_t at = CPUtf8_Offset(text, length, index);
+            if (CPUtf8_Count(text, at) != index || CPUtf8_Offset(text, length, count) != length) {
+                printf("Level %d misplaced code point %lu on round %d\n", level, (unsigned long)index, round);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
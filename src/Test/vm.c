@@ -0,0 +1,278 @@
+/*
+ * Test/vm.c - test the bytecode interpreter.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <module.h>
+#include <opcode.h>
+#include <profile.h>
+#include <vm.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define IMAGE "test_vm.cpm"
+#define BAD_IMAGE "test_vm_bad.cpm"
+
+#define S(s) CPString_InternCString(s)
+
+enum
+{
+    FACT,
+    DIVIDE,
+    GLOBALS,
+    FOREVER,
+    MIXED,
+};
+
+static int
+write_image(void)
+{
+    CPModuleBuilder b;
+    unsigned char code[64];
+    uint32_t one, two, half, g, g_slot, h_slot, index;
+    size_t n;
+    if (CPModuleBuilder_Init(&b) != 0 ||
+        CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_INT, 1, &one) != 0 ||
+        CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_INT, 2, &two) != 0 ||
+        CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_FLOAT, 0x3FE0000000000000ull, &half) != 0 ||
+        CPModuleBuilder_String(&b, S("g"), &g) != 0 ||
+        CPModuleBuilder_Global(&b, S("g"), &g_slot) != 0 ||
+        CPModuleBuilder_Global(&b, S("h"), &h_slot) != 0) {
+        return -1;
+    }
+
+    /* fact(n): if (n < 2) return 1; return n * fact(n - 1); */
+    n = CPOpcode_Emit(code, CP_OP_LOAD_LOCAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, two);
+    n += CPOpcode_Emit(code + n, CP_OP_LESS, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_JUMP_IF_FALSE, 22);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_LOCAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_LOCAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_SUB, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_CALL, FACT);
+    n += CPOpcode_Emit(code + n, CP_OP_MUL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("fact"), 1, 1, code, n, &index) != 0) {
+        return -1;
+    }
+
+    /* divide(a, b): return a / b; */
+    n = CPOpcode_Emit(code, CP_OP_LOAD_LOCAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_LOCAL, 1);
+    n += CPOpcode_Emit(code + n, CP_OP_DIV, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("divide"), 2, 2, code, n, &index) != 0) {
+        return -1;
+    }
+
+    /*
+     * globals(): g = 2; h = g; return h + g; with g stored by name, so
+     * the slot of g must notice the new name.
+     */
+    n = CPOpcode_Emit(code, CP_OP_LOAD_CONST, two);
+    n += CPOpcode_Emit(code + n, CP_OP_STORE_GLOBAL, g);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_GLOBAL_SLOT, g_slot);
+    n += CPOpcode_Emit(code + n, CP_OP_STORE_GLOBAL_SLOT, h_slot);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_GLOBAL_SLOT, h_slot);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_GLOBAL, g);
+    n += CPOpcode_Emit(code + n, CP_OP_ADD, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("globals"), 0, 0, code, n, &index) != 0) {
+        return -1;
+    }
+
+    /* forever(): return forever(); */
+    n = CPOpcode_Emit(code, CP_OP_CALL, FOREVER);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("forever"), 0, 0, code, n, &index) != 0) {
+        return -1;
+    }
+
+    /* mixed(): return 1 + 0.5 > 1; as !(1 + 0.5 <= 1) */
+    n = CPOpcode_Emit(code, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, half);
+    n += CPOpcode_Emit(code + n, CP_OP_ADD, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_LESS_EQUAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_NOT, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("mixed"), 0, 0, code, n, &index) != 0) {
+        return -1;
+    }
+
+    int rv = CPModuleBuilder_Write(&b, IMAGE);
+    CPModuleBuilder_Destroy(&b);
+    return rv;
+}
+
+/* Functions whose operands are all in range but that must not verify. */
+static int
+write_bad_image(void)
+{
+    CPModuleBuilder b;
+    unsigned char code[64], handler[CP_BYTECODE_HANDLER_SIZE];
+    uint32_t one, index;
+    size_t n;
+    if (CPModuleBuilder_Init(&b) != 0 ||
+        CPModuleBuilder_Constant(&b, CP_BYTECODE_CONSTANT_INT, 1, &one) != 0) {
+        return -1;
+    }
+    int rv = -1;
+
+    /* RETURN with nothing to return. */
+    n = CPOpcode_Emit(code, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("empty"), 0, 0, code, n, &index) != 0) {
+        goto end;
+    }
+
+    /* Runs off the end. */
+    n = CPOpcode_Emit(code, CP_OP_NOP, 0);
+    if (CPModuleBuilder_Function(&b, S("nop"), 0, 0, code, n, &index) != 0) {
+        goto end;
+    }
+
+    /* Jumps into its own operand. */
+    n = CPOpcode_Emit(code, CP_OP_JUMP, 1);
+    if (CPModuleBuilder_Function(&b, S("middle"), 0, 0, code, n, &index) != 0) {
+        goto end;
+    }
+
+    /* if (x) { push 1 } then push 1 and return: two depths meet at 15. */
+    n = CPOpcode_Emit(code, CP_OP_LOAD_LOCAL, 0);
+    n += CPOpcode_Emit(code + n, CP_OP_JUMP_IF_FALSE, 15);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    if (CPModuleBuilder_Function(&b, S("merge"), 1, 1, code, n, &index) != 0) {
+        goto end;
+    }
+
+    /* A handler inside an instruction. */
+    n = CPOpcode_Emit(code, CP_OP_LOAD_CONST, one);
+    n += CPOpcode_Emit(code + n, CP_OP_RETURN, 0);
+    CPBytecode_PutU32(handler + 4, 0);
+    CPBytecode_PutU32(handler + 8, 5);
+    CPBytecode_PutU32(handler + 12, 1);
+    if (CPModuleBuilder_Function(&b, S("handler"), 0, 0, code, n, &index) != 0 ||
+        CPModuleBuilder_Handlers(&b, index, handler, 1) != 0) {
+        goto end;
+    }
+    rv = CPModuleBuilder_Write(&b, BAD_IMAGE);
+end:
+    CPModuleBuilder_Destroy(&b);
+    return rv;
+}
+
+static int
+expect_int(CPVM *vm, uint32_t function, const CPValue *args, uint32_t argc, int64_t expected)
+{
+    CPValue result;
+    if (CPVM_Call(vm, function, args, argc, &result) != 0 ||
+        result.type != CP_VALUE_INT || result.as.i != expected) {
+        printf("Function %u did not return %lld\n", function, (long long)expected);
+        return -1;
+    }
+    if (vm->sp != 0 || vm->frame_count != 0) {
+        printf("Function %u left the stack unbalanced\n", function);
+        return -1;
+    }
+    return 0;
+}
+
+int
+main()
+{
+    CPModule module;
+    CPVM vm;
+    CPValue args[2];
+    CPValue result;
+    if (write_image() != 0 || CPModule_Open(&module, IMAGE) != 0) {
+        printf("Cannot build the image\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < module.function_count; i++) {
+        if (CPModule_Verify(&module, i) != 0) {
+            printf("Function %u does not verify\n", i);
+            return -1;
+        }
+    }
+    CPModule bad;
+    if (write_bad_image() != 0 || CPModule_Open(&bad, BAD_IMAGE) != 0 || bad.function_count != 5) {
+        printf("Cannot build the invalid image\n");
+        return -1;
+    }
+    for (uint32_t i = 0; i < bad.function_count; i++) {
+        if (CPModule_Verify(&bad, i) == 0) {
+            printf("Function '%s' verifies\n", bad.functions[i].name->data);
+            return -1;
+        }
+    }
+    CPModule_Close(&bad);
+    remove(BAD_IMAGE);
+    if (CPVM_Init(&vm, &module) != 0) {
+        printf("Cannot create the interpreter\n");
+        return -1;
+    }
+    args[0].type = CP_VALUE_INT;
+    args[0].as.i = 10;
+    if (expect_int(&vm, FACT, args, 1, 3628800) != 0) {
+        return -1;
+    }
+    args[0].as.i = INT64_MIN;
+    args[1].type = CP_VALUE_INT;
+    args[1].as.i = -1;
+    if (expect_int(&vm, DIVIDE, args, 2, INT64_MIN) != 0) {
+        return -1;
+    }
+    args[1].as.i = 0;
+    if (CPVM_Call(&vm, DIVIDE, args, 2, &result) == 0) {
+        printf("Divided by zero\n");
+        return -1;
+    }
+    args[0].type = CP_VALUE_FLOAT;
+    args[0].as.f = 1.0;
+    if (CPVM_Call(&vm, DIVIDE, args, 2, &result) != 0 || result.type != CP_VALUE_FLOAT) {
+        printf("Float division by zero failed\n");
+        return -1;
+    }
+    if (CPVM_Call(&vm, DIVIDE, args, 1, &result) == 0) {
+        printf("Called with the wrong number of arguments\n");
+        return -1;
+    }
+    if (expect_int(&vm, GLOBALS, NULL, 0, 4) != 0 || expect_int(&vm, MIXED, NULL, 0, 1) != 0) {
+        return -1;
+    }
+    /* The profiler's shadow stack is unwound with the frames. */
+    if (CPVM_Call(&vm, FOREVER, NULL, 0, &result) == 0 || vm.sp != 0 || vm.frame_count != 0 ||
+        cp_profile_depth != 0) {
+        printf("Unbounded recursion not caught\n");
+        return -1;
+    }
+    /* Still usable after an error. */
+    if (expect_int(&vm, GLOBALS, NULL, 0, 4) != 0 || cp_profile_depth != 0) {
+        return -1;
+    }
+    CPVM_Destroy(&vm);
+    CPString_Reset();
+    CPModule_Close(&module);
+    remove(IMAGE);
+    return 0;
+}
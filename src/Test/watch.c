@@ -0,0 +1,135 @@
+/*
+ * Test/watch.c - test recompilation on change.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include <watch.h>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <string.h>
+
+#define DIR "test_watch_dir"
+
+static int
+write_file(const char *path, const char *text)
+{
+    FILE *file = fopen(path, "wb");
+    if (file == NULL) {
+        return -1;
+    }
+    size_t n = fwrite(text, 1, strlen(text), file);
+    return fclose(file) != 0 || n != strlen(text) ? -1 : 0;
+}
+
+static int
+expect(CPWatcher *watcher, int changed, uint32_t compiled, uint32_t failed)
+{
+    int rv = CPWatcher_Poll(watcher, 5000);
+    if (rv != changed || watcher->stats.compiled != compiled || watcher->stats.failed != failed) {
+        printf("Poll returned %d with %u compiled and %u failed\n", rv, watcher->stats.compiled,
+               watcher->stats.failed);
+        return -1;
+    }
+    return 0;
+}
+
+int
+main()
+{
+#ifdef __linux__
+    CPWatcher watcher;
+    mkdir(DIR, 0777);
+    if (write_file(DIR "/main.cp", "import lib;\nfunc main() { return lib.twice(21); }\n") != 0 ||
+        write_file(DIR "/lib.cp", "func twice(x) { return x * 2; }\n") != 0 ||
+        write_file(DIR "/notes.txt", "not a source\n") != 0) {
+        printf("Cannot write the sources\n");
+        return -1;
+    }
+    if (CPWatcher_Open(&watcher, DIR) != 0) {
+        printf("Cannot watch\n");
+        return -1;
+    }
+    if (watcher.modules.size != 2 || watcher.stats.compiled != 2 || watcher.stats.failed != 0) {
+        printf("Wrong initial compilation\n");
+        return -1;
+    }
+    /* Only the changed file is compiled. */
+    if (write_file(DIR "/lib.cp", "func twice(x) { return x + x; }\n") != 0 || expect(&watcher, 1, 3, 0) != 0) {
+        return -1;
+    }
+    /* Other files are ignored. */
+    if (write_file(DIR "/notes.txt", "still not a source\n") != 0 || CPWatcher_Poll(&watcher, 100) != 0) {
+        printf("Reacted to a file that is not a source\n");
+        return -1;
+    }
+    /* A broken file is reported and stays broken until fixed. */
+    if (write_file(DIR "/lib.cp", "func twice(x) { return x + ; }\n") != 0 || expect(&watcher, 1, 3, 1) != 0 ||
+        write_file(DIR "/lib.cp", "func twice(x) { return x * 2; }\n") != 0 || expect(&watcher, 1, 4, 1) != 0) {
+        return -1;
+    }
+    /* Renaming the function breaks main without recompiling it. */
+    if (write_file(DIR "/lib.cp", "func double(x) { return x * 2; }\n") != 0 || expect(&watcher, 1, 5, 2) != 0) {
+        return -1;
+    }
+    /* So does changing the number of its parameters. */
+    if (write_file(DIR "/lib.cp", "func twice(x, y) { return x * y; }\n") != 0 || expect(&watcher, 1, 6, 3) != 0) {
+        return -1;
+    }
+    /* Deleting it is a change too. */
+    remove(DIR "/lib.cp");
+    if (expect(&watcher, 1, 7, 4) != 0 || watcher.modules.size != 1) {
+        return -1;
+    }
+    /*
+     * A file whose event the kernel dropped is found by listing the
+     * directory, and main, which imports it, is compiled again.
+     */
+    long events = 16384;
+    FILE *limit = fopen("/proc/sys/fs/inotify/max_queued_events", "r");
+    if (limit != NULL) {
+        if (fscanf(limit, "%ld", &events) != 1) {
+            events = 16384;
+        }
+        fclose(limit);
+    }
+    /* Alternate the files, since the kernel merges repeated events. */
+    for (long i = 0; i <= events / 2; i++) {
+        if (write_file(DIR "/notes.txt", "") != 0 || write_file(DIR "/notes2.txt", "") != 0) {
+            printf("Cannot write the notes\n");
+            return -1;
+        }
+    }
+    if (write_file(DIR "/lib.cp", "func twice(x) { return x * 2; }\n") != 0 || expect(&watcher, 2, 9, 4) != 0 ||
+        watcher.modules.size != 2) {
+        return -1;
+    }
+    CPWatcher_Close(&watcher);
+    CPString_Reset();
+    remove(DIR "/.cpbuild/main.cpm");
+    remove(DIR "/.cpbuild/lib.cpm");
+    remove(DIR "/lib.cp");
+    remove(DIR "/notes2.txt");
+    rmdir(DIR "/.cpbuild");
+    remove(DIR "/main.cp");
+    remove(DIR "/notes.txt");
+    rmdir(DIR);
+#endif
+    return 0;
+}
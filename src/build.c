@@ -0,0 +1,552 @@
+/*
+ * build.c - incremental builds of multi-module programs.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "build.h"
+#include "bytecode_writer.h"
+#include "compiler.h"
+#include "linker.h"
+#include "path.h"
+#include "report_error.h"
+#include "safe_string.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const CPString *name;
+    uint64_t size;
+    uint64_t mtime;
+    uint64_t source_hash;
+    uint64_t interface_hash;
+    uint64_t deps_hash;
+    /* Indices into build_t.modules once discovery is done. */
+    const CPString **imports;
+    uint32_t *deps;
+    uint32_t import_count;
+    /* Record in the old database, or NULL. */
+    const unsigned char *record;
+    CPCompiler compiler;
+    int open;
+} module_t;
+
+typedef struct
+{
+    const char *source;
+    char dir[CP_MAX_PATH];
+    char build_dir[CP_MAX_PATH];
+    module_t *modules;
+    uint32_t count;
+    uint32_t capacity;
+    /* Module name to index + 1. */
+    CPHashMap index;
+    /* The old database. */
+    CPMemoryMapping mapping;
+    int mapped;
+    const CPString **strings;
+    uint32_t string_count;
+    const unsigned char *records;
+    uint32_t record_count;
+    const unsigned char *imports;
+    uint32_t import_count;
+    /* Module name to record index + 1. */
+    CPHashMap records_index;
+} build_t;
+
+static int
+module_path(char *dst, const char *dir, const CPString *name, const char *suffix)
+{
+    if(CPath_Join(dst, dir, name->data) != 0 || strcat_safe(dst, suffix, CP_MAX_PATH) != 0) {
+        cp_report_error("Path too long for module '%s'.", name->data);
+        return -1;
+    }
+    return 0;
+}
+
+/* Database */
+
+static const unsigned char *
+find_section(const unsigned char *image, size_t size, uint32_t kind, uint32_t record_size, uint32_t *count)
+{
+    uint32_t sections = CPBytecode_GetU32(image + 12);
+    if(sections > (size - CP_BYTECODE_HEADER_SIZE) / CP_BYTECODE_ENTRY_SIZE) {
+        return NULL;
+    }
+    for(uint32_t i = 0; i < sections; i++) {
+        const unsigned char *entry = image + CP_BYTECODE_HEADER_SIZE + (size_t)i * CP_BYTECODE_ENTRY_SIZE;
+        uint64_t offset = CPBytecode_GetU64(entry + 8);
+        uint64_t length = CPBytecode_GetU64(entry + 16);
+        if(CPBytecode_GetU32(entry) != kind) {
+            continue;
+        }
+        if(offset > size || length > size - offset || length < 8) {
+            return NULL;
+        }
+        *count = CPBytecode_GetU32(image + offset);
+        if(record_size != 0 && *count > (length - 8) / record_size) {
+            return NULL;
+        }
+        if(record_size == 0) {
+            *count = (uint32_t)length;
+        }
+        return image + offset;
+    }
+    return NULL;
+}
+
+static int
+check_database(build_t *build)
+{
+    const unsigned char *image = build->mapping.addr;
+    size_t size = build->mapping.size;
+    uint32_t table_size;
+    const unsigned char *table = find_section(image, size, CP_BYTECODE_SECTION_STRINGS, 0, &table_size);
+    const unsigned char *records = find_section(image, size, CP_BUILD_SECTION_MODULES, CP_BUILD_MODULE_SIZE,
+                                                &build->record_count);
+    const unsigned char *imports = find_section(image, size, CP_BUILD_SECTION_IMPORTS, 4, &build->import_count);
+    if(table == NULL || records == NULL || imports == NULL) {
+        return -1;
+    }
+    uint32_t count = CPString_TableCount(table);
+    if(count > table_size / 8) {
+        return -1;
+    }
+    build->strings = malloc((count ? count : 1) * sizeof(CPString *));
+    if(build->strings == NULL || CPString_LoadTable(table, table_size, build->strings, count) != 0) {
+        return -1;
+    }
+    build->string_count = count;
+    build->records = records + 8;
+    build->imports = imports + 8;
+    for(uint32_t i = 0; i < build->record_count; i++) {
+        const unsigned char *record = build->records + (size_t)i * CP_BUILD_MODULE_SIZE;
+        uint32_t name = CPBytecode_GetU32(record);
+        uint32_t first = CPBytecode_GetU32(record + 4);
+        uint32_t n = CPBytecode_GetU32(record + 8);
+        if(name >= count || first > build->import_count || n > build->import_count - first) {
+            return -1;
+        }
+        for(uint32_t j = 0; j < n; j++) {
+            if(CPBytecode_GetU32(build->imports + (size_t)(first + j) * 4) >= count) {
+                return -1;
+            }
+        }
+        int inserted;
+        CPHashMapEntry *entry = CPHashMap_Put(&build->records_index, build->strings[name], 0, &inserted);
+        if(entry == NULL) {
+            return -1;
+        }
+        entry->value = (void *)(uintptr_t)(i + 1);
+    }
+    return 0;
+}
+
+/* A missing or unreadable database just means a full build. */
+static void
+load_database(build_t *build)
+{
+    char path[CP_MAX_PATH];
+    size_t size;
+    if(CPath_Join(path, build->build_dir, CP_BUILD_DATABASE) != 0) {
+        return;
+    }
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        return;
+    }
+    if(CPMemoryMapping_FileSize(file, &size) == 0 && size >= CP_BYTECODE_HEADER_SIZE &&
+       CPMemoryMapping_Create(&build->mapping, file, size, 0, CP_MMAP_PROT_READ, CP_MMAP_FLAG_PRIVATE) == 0) {
+        build->mapped = 1;
+        const unsigned char *header = build->mapping.addr;
+        if(memcmp(header, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE) != 0 ||
+           CPBytecode_GetU32(header + 4) != CP_BYTECODE_VERSION_MAJOR ||
+           CPBytecode_GetU32(header + 8) != CP_BYTECODE_VERSION_MINOR || check_database(build) != 0) {
+            CPHashMap_Clear(&build->records_index);
+            build->record_count = 0;
+        }
+    }
+    fclose(file);
+}
+
+static int
+write_database(const build_t *build)
+{
+    char path[CP_MAX_PATH], temp[CP_MAX_PATH];
+    CPModuleBuilder strings;
+    CPBytecodeWriter writer;
+    if(CPath_Join(path, build->build_dir, CP_BUILD_DATABASE) != 0 ||
+       strcpy_safe(temp, path, CP_MAX_PATH) != 0 || strcat_safe(temp, ".tmp", CP_MAX_PATH) != 0 ||
+       CPModuleBuilder_Init(&strings) != 0) {
+        return -1;
+    }
+    int rv = -1;
+    uint32_t import_count = 0, index;
+    for(uint32_t i = 0; i < build->count; i++) {
+        import_count += build->modules[i].import_count;
+        if(CPModuleBuilder_String(&strings, build->modules[i].name, &index) != 0) {
+            goto end;
+        }
+    }
+    size_t table_size = CPString_TableSize(strings.strings, strings.string_count);
+    size_t modules_size = 8 + (size_t)build->count * CP_BUILD_MODULE_SIZE;
+    size_t imports_size = 8 + (size_t)import_count * 4;
+    if(CPBytecodeWriter_Open(&writer, temp, 3, table_size + modules_size + imports_size) != 0) {
+        goto end;
+    }
+    unsigned char *p = CPBytecodeWriter_AddSection(&writer, CP_BYTECODE_SECTION_STRINGS, table_size);
+    if(p != NULL) {
+        CPString_WriteTable(p, strings.strings, strings.string_count);
+        p = CPBytecodeWriter_AddSection(&writer, CP_BUILD_SECTION_MODULES, modules_size);
+    }
+    if(p != NULL) {
+        CPBytecode_PutU32(p, build->count);
+        uint32_t first = 0;
+        for(uint32_t i = 0; i < build->count; i++) {
+            const module_t *module = &build->modules[i];
+            unsigned char *record = p + 8 + (size_t)i * CP_BUILD_MODULE_SIZE;
+            /* Module names were added first, in order. */
+            CPBytecode_PutU32(record, i);
+            CPBytecode_PutU32(record + 4, first);
+            CPBytecode_PutU32(record + 8, module->import_count);
+            CPBytecode_PutU64(record + 16, module->size);
+            CPBytecode_PutU64(record + 24, module->mtime);
+            CPBytecode_PutU64(record + 32, module->source_hash);
+            CPBytecode_PutU64(record + 40, module->interface_hash);
+            CPBytecode_PutU64(record + 48, module->deps_hash);
+            first += module->import_count;
+        }
+        p = CPBytecodeWriter_AddSection(&writer, CP_BUILD_SECTION_IMPORTS, imports_size);
+    }
+    if(p != NULL) {
+        CPBytecode_PutU32(p, import_count);
+        p += 8;
+        for(uint32_t i = 0; i < build->count; i++) {
+            for(uint32_t j = 0; j < build->modules[i].import_count; j++) {
+                CPBytecode_PutU32(p, build->modules[i].deps[j]);
+                p += 4;
+            }
+        }
+    }
+    if(CPBytecodeWriter_Close(&writer) != 0 || p == NULL) {
+        remove(temp);
+        goto end;
+    }
+    /* Replace the old database in one step, so it is never half written. */
+    if(rename(temp, path) != 0) {
+        remove(temp);
+        goto end;
+    }
+    rv = 0;
+end:
+    CPModuleBuilder_Destroy(&strings);
+    return rv;
+}
+
+/* Discovery */
+
+static int
+add_module(build_t *build, const CPString *name, uint32_t *index)
+{
+    int inserted;
+    CPHashMapEntry *entry = CPHashMap_Put(&build->index, name, 0, &inserted);
+    if(entry == NULL) {
+        return -1;
+    }
+    if(!inserted) {
+        *index = (uint32_t)(uintptr_t)entry->value - 1;
+        return 0;
+    }
+    if(build->count == build->capacity) {
+        uint32_t capacity = build->capacity ? build->capacity * 2 : 16;
+        module_t *modules = realloc(build->modules, capacity * sizeof(module_t));
+        if(modules == NULL) {
+            CPHashMap_Remove(&build->index, name, 0);
+            return -1;
+        }
+        build->modules = modules;
+        build->capacity = capacity;
+    }
+    *index = build->count++;
+    entry->value = (void *)(uintptr_t)(*index + 1);
+    module_t *module = &build->modules[*index];
+    memset(module, 0, sizeof(module_t));
+    module->name = name;
+    return 0;
+}
+
+static int
+set_imports(module_t *module, uint32_t count)
+{
+    module->imports = malloc((count ? count : 1) * sizeof(CPString *));
+    module->deps = malloc((count ? count : 1) * sizeof(uint32_t));
+    if(module->imports == NULL || module->deps == NULL) {
+        return -1;
+    }
+    module->import_count = count;
+    return 0;
+}
+
+/*
+ * Learn a module's imports and interface: from the database if its size
+ * and modification time are as recorded, else by pre-parsing it.
+ */
+static int
+scan(build_t *build, uint32_t index)
+{
+    char path[CP_MAX_PATH];
+    struct stat st;
+    module_t *module = &build->modules[index];
+    if(index == 0) {
+        if(strcpy_safe(path, build->source, CP_MAX_PATH) != 0) {
+            return -1;
+        }
+    } else if(module_path(path, build->dir, module->name, CP_BUILD_SOURCE_SUFFIX) != 0) {
+        return -1;
+    }
+    if(stat(path, &st) != 0) {
+        cp_report_error("Cannot find module '%s' ('%s').", module->name->data, path);
+        return -1;
+    }
+    module->size = (uint64_t)st.st_size;
+#ifdef _WIN32
+    module->mtime = (uint64_t)st.st_mtime * 1000000000u;
+#else
+    module->mtime = (uint64_t)st.st_mtim.tv_sec * 1000000000u + (uint64_t)st.st_mtim.tv_nsec;
+#endif
+    CPHashMapEntry *entry = CPHashMap_Find(&build->records_index, module->name, 0);
+    if(entry != NULL) {
+        module->record = build->records + ((uintptr_t)entry->value - 1) * CP_BUILD_MODULE_SIZE;
+        if(CPBytecode_GetU64(module->record + 16) == module->size &&
+           CPBytecode_GetU64(module->record + 24) == module->mtime) {
+            uint32_t first = CPBytecode_GetU32(module->record + 4);
+            if(set_imports(module, CPBytecode_GetU32(module->record + 8)) != 0) {
+                return -1;
+            }
+            for(uint32_t i = 0; i < module->import_count; i++) {
+                module->imports[i] = build->strings[CPBytecode_GetU32(build->imports + (size_t)(first + i) * 4)];
+            }
+            module->source_hash = CPBytecode_GetU64(module->record + 32);
+            module->interface_hash = CPBytecode_GetU64(module->record + 40);
+            return 0;
+        }
+    }
+    if(CPCompiler_Open(&module->compiler, path) != 0) {
+        return -1;
+    }
+    module->open = 1;
+    if(module->compiler.name != module->name) {
+        cp_report_error("'%s' must be named '%s%s'.", path, module->name->data, CP_BUILD_SOURCE_SUFFIX);
+        return -1;
+    }
+    module->source_hash = CPHash_Bytes(module->compiler.source, module->compiler.size);
+    module->interface_hash = CPCompiler_InterfaceHash(&module->compiler);
+    if(set_imports(module, module->compiler.import_count) != 0) {
+        return -1;
+    }
+    memcpy(module->imports, module->compiler.imports, module->import_count * sizeof(CPString *));
+    return 0;
+}
+
+static int
+discover(build_t *build)
+{
+    uint32_t index;
+    if(add_module(build, CPModule_NameFromPath(build->source), &index) != 0) {
+        return -1;
+    }
+    /* Modules are appended as they are first imported. */
+    for(uint32_t i = 0; i < build->count; i++) {
+        if(scan(build, i) != 0) {
+            return -1;
+        }
+        for(uint32_t j = 0; j < build->modules[i].import_count; j++) {
+            if(add_module(build, build->modules[i].imports[j], &index) != 0) {
+                return -1;
+            }
+            build->modules[i].deps[j] = index;
+        }
+    }
+    return 0;
+}
+
+/* Compilation */
+
+static int
+stale(const module_t *module, const char *image)
+{
+    struct stat st;
+    if(module->record == NULL || stat(image, &st) != 0) {
+        return 1;
+    }
+    return CPBytecode_GetU64(module->record + 32) != module->source_hash ||
+           CPBytecode_GetU64(module->record + 48) != module->deps_hash;
+}
+
+static int
+compile_modules(build_t *build, CPBuildStats *stats)
+{
+    char image[CP_MAX_PATH], source[CP_MAX_PATH];
+    for(uint32_t i = 0; i < build->count; i++) {
+        module_t *module = &build->modules[i];
+        uint64_t hash = 0;
+        for(uint32_t j = 0; j < module->import_count; j++) {
+            const module_t *dep = &build->modules[module->deps[j]];
+            hash = CPHash_Int(hash ^ dep->name->hash ^ dep->interface_hash);
+        }
+        module->deps_hash = hash;
+        if(module_path(image, build->build_dir, module->name, ".cpm") != 0) {
+            return -1;
+        }
+        if(!stale(module, image)) {
+            continue;
+        }
+        if(!module->open) {
+            if(i == 0) {
+                strcpy_safe(source, build->source, CP_MAX_PATH);
+            } else if(module_path(source, build->dir, module->name, CP_BUILD_SOURCE_SUFFIX) != 0) {
+                return -1;
+            }
+            if(CPCompiler_Open(&module->compiler, source) != 0) {
+                return -1;
+            }
+            module->open = 1;
+        }
+        if(CPCompiler_Write(&module->compiler, image) != 0) {
+            return -1;
+        }
+        stats->compiled++;
+    }
+    return 0;
+}
+
+static int
+make_build_dir(const build_t *build)
+{
+#ifdef _WIN32
+    int rv = _mkdir(build->build_dir);
+#else
+    int rv = mkdir(build->build_dir, 0777);
+#endif
+    if(rv != 0 && errno != EEXIST) {
+        cp_report_error("Cannot create '%s'.", build->build_dir);
+        return -1;
+    }
+    return 0;
+}
+
+static int
+link_modules(const build_t *build, const char *output)
+{
+    char *paths = malloc((size_t)build->count * CP_MAX_PATH);
+    const char **inputs = malloc((build->count ? build->count : 1) * sizeof(const char *));
+    int rv = -1;
+    if(paths == NULL || inputs == NULL) {
+        goto end;
+    }
+    for(uint32_t i = 0; i < build->count; i++) {
+        inputs[i] = paths + (size_t)i * CP_MAX_PATH;
+        if(module_path(paths + (size_t)i * CP_MAX_PATH, build->build_dir, build->modules[i].name, ".cpm") != 0) {
+            goto end;
+        }
+    }
+    rv = CPLinker_Link(output, inputs, (int)build->count, NULL);
+end:
+    free(paths);
+    free(inputs);
+    return rv;
+}
+
+static void
+close_modules(build_t *build)
+{
+    for(uint32_t i = 0; i < build->count; i++) {
+        if(build->modules[i].open) {
+            CPCompiler_Close(&build->modules[i].compiler);
+        }
+        free(build->modules[i].imports);
+        free(build->modules[i].deps);
+    }
+    free(build->modules);
+    build->modules = NULL;
+    build->count = 0;
+}
+
+int
+CPBuild_Run(const char *source, const char *output, CPBuildStats *stats)
+{
+    build_t build;
+    CPBuildStats local;
+    struct stat st;
+    memset(&build, 0, sizeof(build));
+    stats = stats != NULL ? stats : &local;
+    memset(stats, 0, sizeof(CPBuildStats));
+    build.source = source;
+    if(CPath_Dirname(build.dir, source) != 0) {
+        return -1;
+    }
+    if(build.dir[0] == '\0') {
+        strcpy(build.dir, ".");
+    }
+    if(CPath_Join(build.build_dir, build.dir, CP_BUILD_DIR) != 0 ||
+       CPHashMap_Init(&build.index, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        return -1;
+    }
+    if(CPHashMap_Init(&build.records_index, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        CPHashMap_Destroy(&build.index);
+        return -1;
+    }
+    int rv = -1;
+    load_database(&build);
+    if(make_build_dir(&build) != 0 || discover(&build) != 0 || compile_modules(&build, stats) != 0) {
+        goto end;
+    }
+    stats->modules = build.count;
+    if(write_database(&build) != 0) {
+        cp_report_error("Cannot write the build database in '%s'.", build.build_dir);
+        goto end;
+    }
+    rv = 0;
+    if(stats->compiled > 0 || stat(output, &st) != 0) {
+        rv = link_modules(&build, output);
+        stats->linked = 1;
+        /*
+         * The database already vouches for the modules, so an old output
+         * left behind would be taken as up to date by the next build.
+         */
+        if(rv != 0) {
+            remove(output);
+        }
+    }
+end:
+    CPString_Reset();
+    close_modules(&build);
+    free(build.strings);
+    CPHashMap_Destroy(&build.index);
+    CPHashMap_Destroy(&build.records_index);
+    if(build.mapped) {
+        CPMemoryMapping_Destroy(&build.mapping);
+    }
+    return rv;
+}
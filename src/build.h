@@ -0,0 +1,76 @@
+/*
+ * build.h - incremental builds of multi-module programs.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_BUILD_H_
+#define _CP_BUILD_H_
+
+#include <stdint.h>
+
+/*
+ * Build state lives in CP_BUILD_DIR next to the main source file: one
+ * .cpm per module and the dependency database CP_BUILD_DATABASE.  The
+ * database is a .cpm-style image (see bytecode.h) with a STRINGS
+ * section and these two:
+ *
+ *     MODULES  count:u32 reserved:u32, then `count' records:
+ *              name:u32 import_first:u32 import_count:u32 reserved:u32
+ *              size:u64 mtime:u64 source_hash:u64
+ *              interface_hash:u64 deps_hash:u64
+ *     IMPORTS  count:u32 reserved:u32, then `count' string indices
+ *
+ * The header carries the bytecode version of the .cpm files it
+ * describes; a database of another version is ignored, so everything is
+ * compiled again.  `size' and `mtime' let an untouched source be
+ * trusted without reading it.  `interface_hash' covers the names and arities of a module's
+ * functions, and `deps_hash' the interface hashes of its imports as of
+ * its last compilation.
+ */
+#define CP_BUILD_DIR ".cpbuild"
+#define CP_BUILD_DATABASE "deps.cpdb"
+#define CP_BUILD_SOURCE_SUFFIX ".cp"
+
+#define CP_BUILD_SECTION_MODULES 0x100
+#define CP_BUILD_SECTION_IMPORTS 0x101
+#define CP_BUILD_MODULE_SIZE 56
+
+typedef struct
+{
+    uint32_t modules;
+    uint32_t compiled;
+    int linked;
+} CPBuildStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Build the program whose main module is the source file `source' into
+ * the image `output'.  Imported modules are looked up as NAME.cp next
+ * to `source'.  Only modules whose source changed, or whose imports'
+ * interfaces changed, are compiled again; the image is relinked only
+ * when a module was compiled or it is missing.  CPString_Reset() is
+ * called before returning.  `stats' may be NULL.
+ */
+int CPBuild_Run(const char *source, const char *output, CPBuildStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_BUILD_H_ */
@@ -0,0 +1,220 @@
+/*
+ * bundle.c - bytecode images appended to the launcher executable.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "bundle.h"
+#include "bytecode.h"
+#include "report_error.h"
+#include "platform/mmapview.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#endif
+
+#include <stdio.h>
+#include <string.h>
+
+/* A launcher is the whole static cpc; copy it a window at a time. */
+#define COPY_WINDOW_SIZE (1024 * 1024)
+
+/*
+ * Read the trailer of a file of `file_size' bytes.  1 with the image
+ * range if there is a valid one, 0 if not, -1 on read errors.
+ */
+static int
+read_trailer(FILE *file, size_t file_size, size_t *offset, size_t *size)
+{
+    unsigned char trailer[CP_BUNDLE_TRAILER_SIZE];
+    if(file_size < CP_BUNDLE_TRAILER_SIZE) {
+        return 0;
+    }
+    if(fseek(file, -CP_BUNDLE_TRAILER_SIZE, SEEK_END) != 0 ||
+       fread(trailer, 1, sizeof(trailer), file) != sizeof(trailer)) {
+        return -1;
+    }
+    if(memcmp(trailer, CP_BUNDLE_MAGIC, CP_BUNDLE_MAGIC_SIZE) != 0) {
+        return 0;
+    }
+    uint64_t o = CPBytecode_GetU64(trailer + 8);
+    uint64_t s = CPBytecode_GetU64(trailer + 16);
+    size_t limit = file_size - CP_BUNDLE_TRAILER_SIZE;
+    if(o > limit || s > limit - o || s < CP_BYTECODE_HEADER_SIZE) {
+        return 0;
+    }
+    *offset = (size_t)o;
+    *size = (size_t)s;
+    return 1;
+}
+
+/* Write the first `count' bytes of `in' to `out'. */
+static int
+copy_bytes(FILE *out, FILE *in, size_t count)
+{
+    CPMemoryView view;
+    if(CPMemoryView_Open(&view, in, COPY_WINDOW_SIZE, CP_MMAP_PROT_READ, CP_MMAP_FLAG_PRIVATE) != 0) {
+        return -1;
+    }
+    size_t max = CPMemoryView_MaxLength(&view);
+    int rv = 0;
+    for(size_t done = 0; rv == 0 && done < count; ) {
+        size_t chunk = count - done < max ? count - done : max;
+        void *data;
+        if(CPMemoryView_Get(&view, done, chunk, &data) != 0 || fwrite(data, 1, chunk, out) != chunk) {
+            rv = -1;
+        }
+        done += chunk;
+    }
+    if(CPMemoryView_Close(&view) != 0) {
+        rv = -1;
+    }
+    return rv;
+}
+
+static int
+write_bundle(FILE *out, FILE *launcher, size_t launcher_size, FILE *image, size_t image_size)
+{
+    size_t granularity = CPMemoryMapping_Granularity();
+    size_t offset = (launcher_size + granularity - 1) / granularity * granularity;
+    unsigned char trailer[CP_BUNDLE_TRAILER_SIZE];
+    if(copy_bytes(out, launcher, launcher_size) != 0) {
+        return -1;
+    }
+    for(size_t i = launcher_size; i < offset; i++) {
+        if(fputc(0, out) == EOF) {
+            return -1;
+        }
+    }
+    if(copy_bytes(out, image, image_size) != 0) {
+        return -1;
+    }
+    memcpy(trailer, CP_BUNDLE_MAGIC, CP_BUNDLE_MAGIC_SIZE);
+    CPBytecode_PutU64(trailer + 8, offset);
+    CPBytecode_PutU64(trailer + 16, image_size);
+    if(fwrite(trailer, 1, sizeof(trailer), out) != sizeof(trailer)) {
+        return -1;
+    }
+    return 0;
+}
+
+int
+CPBundle_Create(const char *output, const char *launcher, const char *image)
+{
+    int rv = -1;
+    FILE *in = fopen(launcher, "rb");
+    FILE *img = fopen(image, "rb");
+    FILE *out = NULL;
+    size_t launcher_size, image_size, offset, size;
+    unsigned char magic[CP_BYTECODE_MAGIC_NUMBER_SIZE];
+    if(in == NULL || CPMemoryMapping_FileSize(in, &launcher_size) != 0) {
+        cp_report_error("Cannot read launcher '%s'.", launcher);
+        goto end;
+    }
+    switch(read_trailer(in, launcher_size, &offset, &size)) {
+        case 1:
+            launcher_size = offset;
+            break;
+        case 0:
+            break;
+        default:
+            cp_report_error("Cannot read launcher '%s'.", launcher);
+            goto end;
+    }
+    if(img == NULL || CPMemoryMapping_FileSize(img, &image_size) != 0 ||
+       fread(magic, 1, sizeof(magic), img) != sizeof(magic)) {
+        cp_report_error("Cannot read image '%s'.", image);
+        goto end;
+    }
+    if(image_size < CP_BYTECODE_HEADER_SIZE ||
+       memcmp(magic, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE) != 0) {
+        cp_report_error("'%s' is not a bytecode image.", image);
+        goto end;
+    }
+    out = fopen(output, "wb");
+    if(out == NULL) {
+        cp_report_error("Cannot open output '%s'.", output);
+        goto end;
+    }
+    rv = write_bundle(out, in, launcher_size, img, image_size);
+    if(fclose(out) != 0) {
+        rv = -1;
+    }
+    if(rv != 0) {
+        cp_report_error("Cannot write output '%s'.", output);
+        remove(output);
+        goto end;
+    }
+#ifndef _WIN32
+    /* Executable wherever the launcher was. */
+    struct stat st;
+    if(stat(launcher, &st) == 0) {
+        chmod(output, st.st_mode & 0777);
+    }
+#endif
+end:
+    if(in != NULL) {
+        fclose(in);
+    }
+    if(img != NULL) {
+        fclose(img);
+    }
+    return rv;
+}
+
+int
+CPBundle_Open(CPBundle *bundle, const char *path)
+{
+    memset(bundle, 0, sizeof(CPBundle));
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        return -1;
+    }
+    size_t file_size, offset, size;
+    int rv = -1;
+    if(CPMemoryMapping_FileSize(file, &file_size) == 0) {
+        rv = read_trailer(file, file_size, &offset, &size);
+    }
+    if(rv == 1) {
+        /* The bundle may have been written where granules are smaller. */
+        size_t skip = offset % CPMemoryMapping_Granularity();
+        if(CPMemoryMapping_Create(&bundle->mapping, file, skip + size, offset - skip,
+                                  CP_MMAP_PROT_READ, CP_MMAP_FLAG_PRIVATE) != 0) {
+            rv = -1;
+        } else {
+            bundle->image = (const unsigned char *)bundle->mapping.addr + skip;
+            bundle->size = size;
+        }
+    }
+    /* The mapping keeps its own reference to the file. */
+    fclose(file);
+    if(rv == 1 && memcmp(bundle->image, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE) != 0) {
+        CPBundle_Close(bundle);
+        rv = -1;
+    }
+    return rv;
+}
+
+int
+CPBundle_Close(CPBundle *bundle)
+{
+    if(bundle->image == NULL) {
+        return 0;
+    }
+    bundle->image = NULL;
+    bundle->size = 0;
+    return CPMemoryMapping_Destroy(&bundle->mapping);
+}
@@ -0,0 +1,66 @@
+/*
+ * bundle.h - bytecode images appended to the launcher executable.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_BUNDLE_H_
+#define _CP_BUNDLE_H_
+
+#include "platform/mmap.h"
+
+#include <stddef.h>
+
+/*
+ * A bundled executable is the launcher, zero padding up to the mapping
+ * granularity, a .cpm image and a trailer at the very end of the file:
+ *
+ *     magic[8] offset:u64 size:u64    (little-endian, like .cpm)
+ *
+ * The image starts on a granule boundary so it maps in place, shared
+ * through the page cache by every process running the file.
+ */
+#define CP_BUNDLE_MAGIC "cpbundle"
+#define CP_BUNDLE_MAGIC_SIZE 8
+#define CP_BUNDLE_TRAILER_SIZE 24
+
+typedef struct
+{
+    CPMemoryMapping mapping;
+    const unsigned char *image;
+    size_t size;
+} CPBundle;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Write `launcher' followed by the .cpm file `image' to `output'.  A
+ * launcher that is itself a bundle has its old image dropped.
+ */
+int CPBundle_Create(const char *output, const char *launcher, const char *image);
+/*
+ * 1 and the image mapped read-only if `path' is a bundle, 0 if not, -1
+ * if its trailer cannot be read.
+ */
+int CPBundle_Open(CPBundle *bundle, const char *path);
+int CPBundle_Close(CPBundle *bundle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_BUNDLE_H_ */
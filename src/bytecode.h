@@ -0,0 +1,152 @@
+/*
+ * bytecode.h - layout of the bytecode container (.cpm files).
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_BYTECODE_H_
+#define _CP_BYTECODE_H_
+
+#include "version.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A .cpm file is a header, a section directory and the sections.
+ * All integers are little-endian and every section starts on an
+ * 8-byte boundary so it can be used in place from a mapping.
+ *
+ *     header     magic[4] major:u32 minor:u32 count:u32 reserved:u32[4]
+ *     directory  count * { kind:u32 reserved:u32 offset:u64 size:u64 }
+ *     sections   ...
+ */
+#define CP_BYTECODE_HEADER_SIZE 32
+#define CP_BYTECODE_ENTRY_SIZE 24
+#define CP_BYTECODE_ALIGNMENT 8
+
+#define CP_BYTECODE_ALIGN(n) \
+    (((n) + CP_BYTECODE_ALIGNMENT - 1) & ~(size_t)(CP_BYTECODE_ALIGNMENT - 1))
+
+/* Section kinds. */
+
+/*
+ * count:u32 reserved:u32, then `count' records laid out like CPString
+ * (see intern.h): hash:u64 length:u32 reserved:u32 bytes NUL, each
+ * padded to the alignment.  Loading uses the records in place.
+ */
+#define CP_BYTECODE_SECTION_STRINGS 1
+
+/*
+ * count:u32 entry:u32, then `count' records of
+ * name:u32 params:u16 locals:u16 code_offset:u32 code_size:u32.
+ * `name' is a string index and the code range lies in the code
+ * section.  `entry' is the function run first, or CP_BYTECODE_NO_ENTRY.
+ */
+#define CP_BYTECODE_SECTION_FUNCTIONS 2
+#define CP_BYTECODE_FUNCTION_SIZE 16
+#define CP_BYTECODE_NO_ENTRY 0xFFFFFFFFu
+
+/* The instructions of all functions, back to back; see opcode.h. */
+#define CP_BYTECODE_SECTION_CODE 3
+
+/*
+ * count:u32 reserved:u32, then `count' records of
+ * kind:u32 reserved:u32 value:u64, where the value is an int64 or the
+ * bits of a double.
+ */
+#define CP_BYTECODE_SECTION_CONSTANTS 4
+#define CP_BYTECODE_CONSTANT_SIZE 16
+#define CP_BYTECODE_CONSTANT_INT 0
+#define CP_BYTECODE_CONSTANT_FLOAT 1
+
+/*
+ * count:u32 reserved:u32, then `count' records of
+ * module:u32 name:u32 params:u32 reserved:u32, the first two string
+ * indices and `params' the number of arguments the calls pass, which
+ * the linker checks against the function.  A function operand with
+ * CP_BYTECODE_IMPORT_BIT set refers to an import rather than a local
+ * function.  A module is named after its file, without directory or
+ * extension.  Linked images have no imports.
+ */
+#define CP_BYTECODE_SECTION_IMPORTS 5
+#define CP_BYTECODE_IMPORT_SIZE 16
+#define CP_BYTECODE_IMPORT_BIT 0x80000000u
+
+/*
+ * count:u32 reserved:u32, then `count' records of
+ * function:u32 start:u32 end:u32 handler:u32, grouped by function in
+ * increasing order.  An exception thrown in [start, end) of a function
+ * is caught at `handler', all three being offsets into its code.  A
+ * function's inner regions come before the regions around them, so the
+ * first match wins.  Entering a region costs nothing: the table is only
+ * read when something is thrown.  Absent if no function has one.
+ */
+#define CP_BYTECODE_SECTION_HANDLERS 6
+#define CP_BYTECODE_HANDLER_SIZE 16
+
+/*
+ * count:u32 reserved:u32, then `count' string indices naming the
+ * global variables the code refers to.  GLOBAL operands index this
+ * table rather than the strings, so the interpreter can give each name
+ * a slot once instead of hashing it on every access.  Globals are
+ * shared by name across modules.  Absent if the code uses none.
+ */
+#define CP_BYTECODE_SECTION_GLOBALS 7
+#define CP_BYTECODE_GLOBAL_SIZE 4
+
+/*
+ * count:u32 reserved:u32, then `count' records of
+ * library:u32 name:u32 signature:u32 reserved:u32, string indices.
+ * A NATIVE operand indexes this table.  The library is a path for the
+ * system loader, or empty for the program itself; the signature is a
+ * string of type codes, see ffi.h.  Absent if the code calls no native
+ * function.
+ */
+#define CP_BYTECODE_SECTION_NATIVES 8
+#define CP_BYTECODE_NATIVE_SIZE 16
+
+static inline void
+CPBytecode_PutU32(void *dst, uint32_t v)
+{
+    unsigned char *p = dst;
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static inline void
+CPBytecode_PutU64(void *dst, uint64_t v)
+{
+    CPBytecode_PutU32(dst, (uint32_t)v);
+    CPBytecode_PutU32((unsigned char *)dst + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t
+CPBytecode_GetU32(const void *src)
+{
+    const unsigned char *p = src;
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static inline uint64_t
+CPBytecode_GetU64(const void *src)
+{
+    return (uint64_t)CPBytecode_GetU32(src) |
+           (uint64_t)CPBytecode_GetU32((const unsigned char *)src + 4) << 32;
+}
+
+#endif /* _CP_BYTECODE_H_ */
@@ -0,0 +1,185 @@
+/*
+ * bytecode_writer.c - write .cpm files in place through a mapping.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "bytecode_writer.h"
+#include "trace.h"
+
+#include <string.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static int
+resize_file(FILE *file, size_t size)
+{
+#ifdef _WIN32
+    return _chsize_s(_fileno(file), (__int64)size) == 0 ? 0 : -1;
+#else
+    return ftruncate(fileno(file), (off_t)size) == 0 ? 0 : -1;
+#endif
+}
+
+/*
+ * Allocate the blocks of a file that is written through a shared
+ * mapping, so that a full disk fails here instead of raising SIGBUS.
+ */
+static int
+reserve_file(FILE *file, size_t size)
+{
+#ifdef HAVE_POSIX_FALLOCATE
+    int error = posix_fallocate(fileno(file), 0, (off_t)size);
+    if(error != EINVAL && error != EOPNOTSUPP) {
+        return error == 0 ? 0 : -1;
+    }
+#endif
+    return resize_file(file, size);
+}
+
+static int
+map_file(CPBytecodeWriter *writer, size_t capacity)
+{
+    if(reserve_file(writer->file, capacity) != 0) {
+        return -1;
+    }
+    if(CPMemoryMapping_Create(&writer->mapping, writer->file, capacity, 0,
+                              CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE, CP_MMAP_FLAG_SHARED) != 0) {
+        return -1;
+    }
+    writer->capacity = capacity;
+    return 0;
+}
+
+static int
+grow(CPBytecodeWriter *writer, size_t needed)
+{
+    size_t capacity = writer->capacity * 2;
+    if(capacity < needed) {
+        capacity = needed;
+    }
+    CPTrace_Begin("bytecode.grow");
+    int rv = CPMemoryMapping_Destroy(&writer->mapping);
+    if(rv == 0) {
+        rv = map_file(writer, capacity);
+    }
+    CPTrace_End("bytecode.grow");
+    return rv;
+}
+
+static unsigned char *
+entry(CPBytecodeWriter *writer, uint32_t index)
+{
+    return (unsigned char *)writer->mapping.addr + CP_BYTECODE_HEADER_SIZE +
+           (size_t)index * CP_BYTECODE_ENTRY_SIZE;
+}
+
+/*
+ * Create `path' and map room for the header, `max_sections' directory
+ * entries and `size_hint' bytes of section data.
+ */
+int
+CPBytecodeWriter_Open(CPBytecodeWriter *writer, const char *path, uint32_t max_sections, size_t size_hint)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->file = fopen(path, "wb+");
+    if(writer->file == NULL) {
+        return -1;
+    }
+    writer->max_sections = max_sections;
+    writer->size = CP_BYTECODE_ALIGN(CP_BYTECODE_HEADER_SIZE + (size_t)max_sections * CP_BYTECODE_ENTRY_SIZE);
+    /* Section sizes are rounded up one by one; allow for that too. */
+    size_t capacity = writer->size + size_hint + (size_t)max_sections * (CP_BYTECODE_ALIGNMENT - 1);
+    if(map_file(writer, capacity) != 0) {
+        fclose(writer->file);
+        writer->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Append a section of `size' bytes and return where to emit it.  The
+ * memory is zeroed, being fresh file space.
+ */
+void *
+CPBytecodeWriter_AddSection(CPBytecodeWriter *writer, uint32_t kind, size_t size)
+{
+    if(writer->section_count == writer->max_sections) {
+        return NULL;
+    }
+    size_t offset = writer->size;
+    size_t end = offset + CP_BYTECODE_ALIGN(size);
+    if(end > writer->capacity && grow(writer, end) != 0) {
+        return NULL;
+    }
+    unsigned char *e = entry(writer, writer->section_count++);
+    CPBytecode_PutU32(e, kind);
+    CPBytecode_PutU32(e + 4, 0);
+    CPBytecode_PutU64(e + 8, offset);
+    CPBytecode_PutU64(e + 16, size);
+    writer->size = end;
+    return (unsigned char *)writer->mapping.addr + offset;
+}
+
+/*
+ * Get section `index' again, e.g. after a later section moved the
+ * mapping.
+ */
+void *
+CPBytecodeWriter_Section(CPBytecodeWriter *writer, uint32_t index)
+{
+    if(index >= writer->section_count) {
+        return NULL;
+    }
+    return (unsigned char *)writer->mapping.addr + CPBytecode_GetU64(entry(writer, index) + 8);
+}
+
+/*
+ * Write the header, unmap and cut the file to the bytes actually used.
+ * The directory keeps all `max_sections' slots; the header count says
+ * how many of them are live.
+ */
+int
+CPBytecodeWriter_Close(CPBytecodeWriter *writer)
+{
+    int rv = 0;
+    if(writer->file == NULL) {
+        return -1;
+    }
+    unsigned char *header = writer->mapping.addr;
+    memcpy(header, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE);
+    CPBytecode_PutU32(header + 4, CP_BYTECODE_VERSION_MAJOR);
+    CPBytecode_PutU32(header + 8, CP_BYTECODE_VERSION_MINOR);
+    CPBytecode_PutU32(header + 12, writer->section_count);
+    if(CPMemoryMapping_Destroy(&writer->mapping) != 0) {
+        rv = -1;
+    }
+    if(resize_file(writer->file, writer->size) != 0) {
+        rv = -1;
+    }
+    if(fclose(writer->file) != 0) {
+        rv = -1;
+    }
+    writer->file = NULL;
+    return rv;
+}
@@ -0,0 +1,60 @@
+/*
+ * bytecode_writer.h - write .cpm files in place through a mapping.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_BYTECODE_WRITER_H_
+#define _CP_BYTECODE_WRITER_H_
+
+#include "bytecode.h"
+#include "platform/mmap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * The output file is sized up front and mapped shared and writable;
+ * sections are emitted straight into the mapping, so the image is never
+ * staged in a heap buffer.  Callers that compute the section sizes
+ * first and pass their sum as `size_hint' get exactly one mapping.
+ * Otherwise the file grows by remapping, which moves the mapping:
+ * pointers from CPBytecodeWriter_AddSection() stay valid only until
+ * the next call.
+ */
+typedef struct
+{
+    FILE *file;
+    CPMemoryMapping mapping;
+    size_t capacity;
+    size_t size;
+    uint32_t max_sections;
+    uint32_t section_count;
+} CPBytecodeWriter;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int CPBytecodeWriter_Open(CPBytecodeWriter *writer, const char *path, uint32_t max_sections, size_t size_hint);
+void *CPBytecodeWriter_AddSection(CPBytecodeWriter *writer, uint32_t kind, size_t size);
+void *CPBytecodeWriter_Section(CPBytecodeWriter *writer, uint32_t index);
+int CPBytecodeWriter_Close(CPBytecodeWriter *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_BYTECODE_WRITER_H_ */
@@ -42,9 +42,12 @@ CPCommandLine_GetExecutablePath(char *dst)
         return -1;
     }
 #elif defined(__linux__) || defined(__APPLE__)
-    if(readlink("/proc/self/exe", dst, CP_MAX_PATH) == -1) {
+    /* readlink() does not terminate the string. */
+    ssize_t len = readlink("/proc/self/exe", dst, CP_MAX_PATH - 1);
+    if(len == -1) {
         return -1;
     }
+    dst[len] = '\0';
 #else
     Dl_info info;
     if(dladdr((void *)CP_Main, &info)) {
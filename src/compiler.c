@@ -0,0 +1,1186 @@
+/*
+ * compiler.c - compile CP source to bytecode, one function at a time.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "compiler.h"
+#include "ffi.h"
+#include "lexer.h"
+#include "numconv.h"
+#include "opcode.h"
+#include "report_error.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MAX_NESTING 256
+#define MAX_LOCALS 256
+
+static int
+syntax_error(const CPCompiler *compiler, const CPToken *token, const char *message)
+{
+    if(token->kind == CP_TOKEN_ERROR) {
+        message = "Invalid token.";
+    }
+    cp_report_error("%s:%u: %s", compiler->path, (unsigned)token->line, message);
+    return -1;
+}
+
+/* Pre-parser */
+
+static int
+add_function(CPCompiler *compiler, const CPToken *name, const CPSourceFunction *source)
+{
+    const CPString *string = CPString_Intern(name->start, name->length);
+    if(string == NULL) {
+        return -1;
+    }
+    if(CPHashMap_Find(&compiler->native_index, string, 0) != NULL) {
+        return syntax_error(compiler, name, "Function is already defined.");
+    }
+    int inserted;
+    CPHashMapEntry *entry = CPHashMap_Put(&compiler->function_index, string, 0, &inserted);
+    if(entry == NULL) {
+        return -1;
+    }
+    if(!inserted) {
+        return syntax_error(compiler, name, "Function is already defined.");
+    }
+    if(compiler->function_count == compiler->function_capacity) {
+        uint32_t capacity = compiler->function_capacity ? compiler->function_capacity * 2 : 16;
+        CPSourceFunction *sources = realloc(compiler->sources, capacity * sizeof(CPSourceFunction));
+        if(sources != NULL) {
+            compiler->sources = sources;
+        }
+        CPModuleFunction *functions = realloc(compiler->functions, capacity * sizeof(CPModuleFunction));
+        if(functions != NULL) {
+            compiler->functions = functions;
+        }
+        if(sources == NULL || functions == NULL) {
+            CPHashMap_Remove(&compiler->function_index, string, 0);
+            return -1;
+        }
+        compiler->function_capacity = capacity;
+    }
+    uint32_t index = compiler->function_count++;
+    entry->value = (void *)(uintptr_t)(index + 1);
+    compiler->sources[index] = *source;
+    memset(&compiler->functions[index], 0, sizeof(CPModuleFunction));
+    compiler->functions[index].name = string;
+    return 0;
+}
+
+static int
+add_import(CPCompiler *compiler, const CPToken *name)
+{
+    const CPString *string = CPString_Intern(name->start, name->length);
+    if(string == NULL) {
+        return -1;
+    }
+    for(uint32_t i = 0; i < compiler->import_count; i++) {
+        if(compiler->imports[i] == string) {
+            return 0;
+        }
+    }
+    const CPString **imports = realloc(compiler->imports, (compiler->import_count + 1) * sizeof(CPString *));
+    if(imports == NULL) {
+        return -1;
+    }
+    compiler->imports = imports;
+    compiler->imports[compiler->import_count++] = string;
+    return 0;
+}
+
+/* Skip a body, checking only that its brackets pair up. */
+static int
+skim_body(CPCompiler *compiler, CPLexer *lexer)
+{
+    char stack[MAX_NESTING];
+    int depth = 0;
+    CPToken token;
+    do {
+        switch(CPLexer_Next(lexer, &token)) {
+            case CP_TOKEN_LBRACE:
+            case CP_TOKEN_LPAREN:
+                if(depth == MAX_NESTING) {
+                    return syntax_error(compiler, &token, "Brackets nested too deeply.");
+                }
+                stack[depth++] = *token.start;
+                break;
+            case CP_TOKEN_RBRACE:
+                if(depth == 0 || stack[--depth] != '{') {
+                    return syntax_error(compiler, &token, "Unbalanced '}'.");
+                }
+                break;
+            case CP_TOKEN_RPAREN:
+                if(depth == 0 || stack[--depth] != '(') {
+                    return syntax_error(compiler, &token, "Unbalanced ')'.");
+                }
+                break;
+            case CP_TOKEN_EOF:
+                return syntax_error(compiler, &token, "Unterminated function body.");
+            case CP_TOKEN_ERROR:
+                return syntax_error(compiler, &token, "");
+            default:
+                break;
+        }
+    } while(depth > 0);
+    return 0;
+}
+
+static int
+preparse_function(CPCompiler *compiler, CPLexer *lexer)
+{
+    CPToken name, token;
+    CPSourceFunction source;
+    if(CPLexer_Next(lexer, &name) != CP_TOKEN_IDENT) {
+        return syntax_error(compiler, &name, "Expected a function name.");
+    }
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_LPAREN) {
+        return syntax_error(compiler, &token, "Expected '('.");
+    }
+    source.start = (size_t)(token.start - compiler->source);
+    source.line = token.line;
+    uint32_t params = 0;
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_RPAREN) {
+        for(;;) {
+            if(token.kind != CP_TOKEN_IDENT) {
+                return syntax_error(compiler, &token, "Expected a parameter name.");
+            }
+            params++;
+            if(CPLexer_Next(lexer, &token) == CP_TOKEN_RPAREN) {
+                break;
+            }
+            if(token.kind != CP_TOKEN_COMMA || CPLexer_Next(lexer, &token) == CP_TOKEN_RPAREN) {
+                return syntax_error(compiler, &token, "Expected ',' or ')'.");
+            }
+        }
+    }
+    if(params > MAX_LOCALS) {
+        return syntax_error(compiler, &name, "Too many parameters.");
+    }
+    /* Peek at the '{' and let skim_body() take it. */
+    CPLexer body = *lexer;
+    if(CPLexer_Next(&body, &token) != CP_TOKEN_LBRACE) {
+        return syntax_error(compiler, &token, "Expected '{'.");
+    }
+    if(skim_body(compiler, lexer) != 0) {
+        return -1;
+    }
+    source.end = (size_t)(lexer->cur - compiler->source);
+    if(add_function(compiler, &name, &source) != 0) {
+        return -1;
+    }
+    compiler->functions[compiler->function_count - 1].params = (uint16_t)params;
+    return 0;
+}
+
+/* native "LIBRARY" func NAME(TYPE, ...) TYPE; after the 'native'. */
+static int
+preparse_native(CPCompiler *compiler, CPLexer *lexer)
+{
+    CPToken library, name, token;
+    char signature[CP_FFI_MAX_PARAMS + 2];
+    size_t length = 1;
+    if(CPLexer_Next(lexer, &library) != CP_TOKEN_STRING) {
+        return syntax_error(compiler, &library, "Expected a library name.");
+    }
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_FUNC) {
+        return syntax_error(compiler, &token, "Expected 'func'.");
+    }
+    if(CPLexer_Next(lexer, &name) != CP_TOKEN_IDENT) {
+        return syntax_error(compiler, &name, "Expected a function name.");
+    }
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_LPAREN) {
+        return syntax_error(compiler, &token, "Expected '('.");
+    }
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_RPAREN) {
+        for(;;) {
+            if(length == CP_FFI_MAX_PARAMS + 1) {
+                return syntax_error(compiler, &token, "Too many parameters.");
+            }
+            if(token.kind != CP_TOKEN_IDENT ||
+               (signature[length++] = CPFFI_TypeCode(token.start, token.length, 0)) == 0) {
+                return syntax_error(compiler, &token, "Expected a parameter type.");
+            }
+            if(CPLexer_Next(lexer, &token) == CP_TOKEN_RPAREN) {
+                break;
+            }
+            if(token.kind != CP_TOKEN_COMMA || CPLexer_Next(lexer, &token) == CP_TOKEN_RPAREN) {
+                return syntax_error(compiler, &token, "Expected ',' or ')'.");
+            }
+        }
+    }
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_IDENT ||
+       (signature[0] = CPFFI_TypeCode(token.start, token.length, 1)) == 0) {
+        return syntax_error(compiler, &token, "Expected a return type.");
+    }
+    if(CPLexer_Next(lexer, &token) != CP_TOKEN_SEMICOLON) {
+        return syntax_error(compiler, &token, "Expected ';'.");
+    }
+    /* The library name is taken as written, without escapes. */
+    const CPString *path = CPString_Intern(library.start + 1, library.length - 2);
+    const CPString *string = CPString_Intern(name.start, name.length);
+    const CPString *types = CPString_Intern(signature, length);
+    uint32_t index;
+    if(path == NULL || string == NULL || types == NULL) {
+        return -1;
+    }
+    if(CPHashMap_Find(&compiler->function_index, string, 0) != NULL) {
+        return syntax_error(compiler, &name, "Function is already defined.");
+    }
+    int inserted;
+    CPHashMapEntry *entry = CPHashMap_Put(&compiler->native_index, string, 0, &inserted);
+    if(entry == NULL) {
+        return -1;
+    }
+    if(!inserted) {
+        return syntax_error(compiler, &name, "Function is already defined.");
+    }
+    if(CPModuleBuilder_Native(&compiler->builder, path, string, types, &index) != 0) {
+        return -1;
+    }
+    entry->value = (void *)(uintptr_t)(index + 1);
+    return 0;
+}
+
+static int
+preparse(CPCompiler *compiler)
+{
+    CPLexer lexer;
+    CPToken token;
+    CPLexer_Init(&lexer, compiler->source, compiler->size);
+    for(;;) {
+        switch(CPLexer_Next(&lexer, &token)) {
+            case CP_TOKEN_EOF:
+                compiler->stats.preparsed += compiler->function_count;
+                return 0;
+            case CP_TOKEN_FUNC:
+                if(preparse_function(compiler, &lexer) != 0) {
+                    return -1;
+                }
+                break;
+            case CP_TOKEN_IMPORT:
+                if(CPLexer_Next(&lexer, &token) != CP_TOKEN_IDENT) {
+                    return syntax_error(compiler, &token, "Expected a module name.");
+                }
+                if(add_import(compiler, &token) != 0) {
+                    return -1;
+                }
+                if(CPLexer_Next(&lexer, &token) != CP_TOKEN_SEMICOLON) {
+                    return syntax_error(compiler, &token, "Expected ';'.");
+                }
+                break;
+            case CP_TOKEN_NATIVE:
+                if(preparse_native(compiler, &lexer) != 0) {
+                    return -1;
+                }
+                break;
+            default:
+                return syntax_error(compiler, &token, "Expected 'func', 'import' or 'native'.");
+        }
+    }
+}
+
+/* Parser and code generator */
+
+typedef struct
+{
+    CPCompiler *compiler;
+    CPLexer lexer;
+    CPToken current;
+    CPToken previous;
+    unsigned char *code;
+    size_t size;
+    size_t capacity;
+    /* Offset of the last instruction emitted, for tail calls. */
+    size_t last;
+    /* How many try blocks enclose the current statement. */
+    uint32_t try_depth;
+    /* How many unary operands enclose the current one. */
+    uint32_t depth;
+    const CPString *locals[MAX_LOCALS];
+    uint32_t local_count;
+    /* HANDLERS records, innermost region first. */
+    unsigned char *handlers;
+    uint32_t handler_count;
+    uint32_t handler_capacity;
+} parser_t;
+
+static void
+advance(parser_t *p)
+{
+    p->previous = p->current;
+    CPLexer_Next(&p->lexer, &p->current);
+}
+
+static int
+parse_error(parser_t *p, const char *message)
+{
+    return syntax_error(p->compiler, &p->current, message);
+}
+
+static int
+accept(parser_t *p, int kind)
+{
+    if(p->current.kind != kind) {
+        return 0;
+    }
+    advance(p);
+    return 1;
+}
+
+static int
+expect(parser_t *p, int kind, const char *message)
+{
+    return accept(p, kind) ? 0 : parse_error(p, message);
+}
+
+/* Emit an instruction and return its offset, or -1. */
+static int64_t
+emit(parser_t *p, unsigned char op, uint32_t operand)
+{
+    if(p->capacity - p->size < 5) {
+        size_t capacity = p->capacity ? p->capacity * 2 : 64;
+        unsigned char *code = capacity <= UINT32_MAX ? realloc(p->code, capacity) : NULL;
+        if(code == NULL) {
+            return -1;
+        }
+        p->code = code;
+        p->capacity = capacity;
+    }
+    size_t at = p->size;
+    p->size += CPOpcode_Emit(p->code + at, op, operand);
+    p->last = at;
+    return (int64_t)at;
+}
+
+static void
+patch(parser_t *p, int64_t jump)
+{
+    CPBytecode_PutU32(p->code + jump + 1, (uint32_t)p->size);
+}
+
+static int
+emit_constant(parser_t *p, uint32_t kind, uint64_t value)
+{
+    uint32_t index;
+    if(CPModuleBuilder_Constant(&p->compiler->builder, kind, value, &index) != 0) {
+        return -1;
+    }
+    return emit(p, CP_OP_LOAD_CONST, index) < 0 ? -1 : 0;
+}
+
+static int
+emit_string(parser_t *p, unsigned char op, const CPString *string)
+{
+    uint32_t index;
+    if(string == NULL || CPModuleBuilder_String(&p->compiler->builder, string, &index) != 0) {
+        return -1;
+    }
+    return emit(p, op, index) < 0 ? -1 : 0;
+}
+
+static int
+emit_global(parser_t *p, unsigned char op, const CPString *name)
+{
+    uint32_t index;
+    if(CPModuleBuilder_Global(&p->compiler->builder, name, &index) != 0) {
+        return -1;
+    }
+    return emit(p, op, index) < 0 ? -1 : 0;
+}
+
+static int
+find_local(const parser_t *p, const CPString *name)
+{
+    for(uint32_t i = 0; i < p->local_count; i++) {
+        if(p->locals[i] == name) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+static int
+add_local(parser_t *p, const CPToken *token)
+{
+    const CPString *name = CPString_Intern(token->start, token->length);
+    if(name == NULL) {
+        return -1;
+    }
+    if(find_local(p, name) >= 0) {
+        return syntax_error(p->compiler, token, "Variable is already declared.");
+    }
+    if(p->local_count == MAX_LOCALS) {
+        return syntax_error(p->compiler, token, "Too many local variables.");
+    }
+    p->locals[p->local_count++] = name;
+    return 0;
+}
+
+static int expression(parser_t *p);
+
+static int
+number(parser_t *p, int negate)
+{
+    const CPToken *token = &p->previous;
+    if(token->kind == CP_TOKEN_FLOAT) {
+        double value;
+        uint64_t bits;
+        if(CPNum_ParseDouble(token->start, token->length, &value) != token->length) {
+            return syntax_error(p->compiler, token, "Invalid number.");
+        }
+        value = negate ? -value : value;
+        memcpy(&bits, &value, sizeof(bits));
+        return emit_constant(p, CP_BYTECODE_CONSTANT_FLOAT, bits);
+    }
+    uint64_t value;
+    if(CPNum_ParseU64(token->start, token->length, &value) != token->length ||
+       value > (uint64_t)INT64_MAX + (negate ? 1 : 0)) {
+        return syntax_error(p->compiler, token, "Integer out of range.");
+    }
+    return emit_constant(p, CP_BYTECODE_CONSTANT_INT, negate ? 0 - value : value);
+}
+
+static int
+string(parser_t *p)
+{
+    const CPToken *token = &p->previous;
+    char *buffer = malloc(token->length);
+    if(buffer == NULL) {
+        return -1;
+    }
+    size_t length = 0;
+    for(size_t i = 1; i + 1 < token->length; i++) {
+        char c = token->start[i];
+        if(c == '\\') {
+            switch(token->start[++i]) {
+                case 'n': c = '\n'; break;
+                case 't': c = '\t'; break;
+                case '\\': c = '\\'; break;
+                case '"': c = '"'; break;
+                default:
+                    free(buffer);
+                    return syntax_error(p->compiler, token, "Invalid escape sequence.");
+            }
+        }
+        buffer[length++] = c;
+    }
+    int rv = emit_string(p, CP_OP_LOAD_STRING, CPString_Intern(buffer, length));
+    free(buffer);
+    return rv;
+}
+
+/* Arguments after the '(' up to and including the ')'. */
+static int
+arguments(parser_t *p, uint32_t *count)
+{
+    *count = 0;
+    if(accept(p, CP_TOKEN_RPAREN)) {
+        return 0;
+    }
+    do {
+        if(expression(p) != 0) {
+            return -1;
+        }
+        (*count)++;
+    } while(accept(p, CP_TOKEN_COMMA));
+    return expect(p, CP_TOKEN_RPAREN, "Expected ',' or ')'.");
+}
+
+/* A call of a native function; the arguments are checked when it runs. */
+static int
+native_call(parser_t *p, const CPToken *token, uint32_t index)
+{
+    const CPModule *module = &p->compiler->module;
+    uint32_t count;
+    if(arguments(p, &count) != 0) {
+        return -1;
+    }
+    if(count != CPModule_Native(module, index, 2)->length - 1) {
+        return syntax_error(p->compiler, token, "Wrong number of arguments.");
+    }
+    return emit(p, CP_OP_CALL_NATIVE, index) < 0 ? -1 : 0;
+}
+
+static int
+call(parser_t *p, const CPToken *token, const CPString *name)
+{
+    CPHashMapEntry *entry = CPHashMap_Find(&p->compiler->function_index, name, 0);
+    if(entry == NULL) {
+        entry = CPHashMap_Find(&p->compiler->native_index, name, 0);
+        if(entry != NULL) {
+            return native_call(p, token, (uint32_t)(uintptr_t)entry->value - 1);
+        }
+        return syntax_error(p->compiler, token, "Undefined function.");
+    }
+    uint32_t index = (uint32_t)(uintptr_t)entry->value - 1;
+    uint32_t count;
+    if(arguments(p, &count) != 0) {
+        return -1;
+    }
+    if(count != p->compiler->functions[index].params) {
+        return syntax_error(p->compiler, token, "Wrong number of arguments.");
+    }
+    return emit(p, CP_OP_CALL, index) < 0 ? -1 : 0;
+}
+
+static int
+import_call(parser_t *p, const CPToken *token, const CPString *module)
+{
+    uint32_t i, index, count;
+    for(i = 0; i < p->compiler->import_count && p->compiler->imports[i] != module; i++);
+    if(i == p->compiler->import_count) {
+        return syntax_error(p->compiler, token, "Module is not imported.");
+    }
+    if(expect(p, CP_TOKEN_IDENT, "Expected a function name.") != 0) {
+        return -1;
+    }
+    const CPString *name = CPString_Intern(p->previous.start, p->previous.length);
+    if(name == NULL || expect(p, CP_TOKEN_LPAREN, "Expected '('.") != 0 || arguments(p, &count) != 0) {
+        return -1;
+    }
+    /* The callee is not known yet; the linker checks the count. */
+    if(CPModuleBuilder_Import(&p->compiler->builder, module, name, count, &index) != 0) {
+        return -1;
+    }
+    return emit(p, CP_OP_CALL, index) < 0 ? -1 : 0;
+}
+
+static int
+identifier(parser_t *p)
+{
+    CPToken token = p->previous;
+    const CPString *name = CPString_Intern(token.start, token.length);
+    if(name == NULL) {
+        return -1;
+    }
+    if(accept(p, CP_TOKEN_LPAREN)) {
+        return call(p, &token, name);
+    }
+    if(accept(p, CP_TOKEN_DOT)) {
+        return import_call(p, &token, name);
+    }
+    int local = find_local(p, name);
+    if(local >= 0) {
+        return emit(p, CP_OP_LOAD_LOCAL, (uint32_t)local) < 0 ? -1 : 0;
+    }
+    CPHashMapEntry *entry = CPHashMap_Find(&p->compiler->function_index, name, 0);
+    if(entry != NULL) {
+        return emit(p, CP_OP_LOAD_FUNCTION, (uint32_t)(uintptr_t)entry->value - 1) < 0 ? -1 : 0;
+    }
+    return emit_global(p, CP_OP_LOAD_GLOBAL_SLOT, name);
+}
+
+static int
+primary(parser_t *p)
+{
+    if(accept(p, CP_TOKEN_INT) || accept(p, CP_TOKEN_FLOAT)) {
+        return number(p, 0);
+    }
+    if(accept(p, CP_TOKEN_STRING)) {
+        return string(p);
+    }
+    if(accept(p, CP_TOKEN_IDENT)) {
+        return identifier(p);
+    }
+    if(accept(p, CP_TOKEN_LPAREN)) {
+        if(expression(p) != 0) {
+            return -1;
+        }
+        return expect(p, CP_TOKEN_RPAREN, "Expected ')'.");
+    }
+    return parse_error(p, "Expected an expression.");
+}
+
+static int unary(parser_t *p);
+
+/* After a '-': fold negative literals; otherwise compute 0 - x. */
+static int
+negation(parser_t *p)
+{
+    if(accept(p, CP_TOKEN_INT) || accept(p, CP_TOKEN_FLOAT)) {
+        return number(p, 1);
+    }
+    if(emit_constant(p, CP_BYTECODE_CONSTANT_INT, 0) != 0 || unary(p) != 0) {
+        return -1;
+    }
+    return emit(p, CP_OP_SUB, 0) < 0 ? -1 : 0;
+}
+
+/*
+ * Every nested expression, whether by '-', '(' or a call's arguments,
+ * passes through here, so this bounds the parser's recursion.
+ */
+static int
+unary(parser_t *p)
+{
+    if(p->depth == MAX_NESTING) {
+        return parse_error(p, "Expression nested too deeply.");
+    }
+    p->depth++;
+    int rv = accept(p, CP_TOKEN_MINUS) ? negation(p) : primary(p);
+    p->depth--;
+    return rv;
+}
+
+static int
+factor(parser_t *p)
+{
+    if(unary(p) != 0) {
+        return -1;
+    }
+    for(;;) {
+        unsigned char op;
+        if(accept(p, CP_TOKEN_STAR)) {
+            op = CP_OP_MUL;
+        } else if(accept(p, CP_TOKEN_SLASH)) {
+            op = CP_OP_DIV;
+        } else {
+            return 0;
+        }
+        if(unary(p) != 0 || emit(p, op, 0) < 0) {
+            return -1;
+        }
+    }
+}
+
+static int
+term(parser_t *p)
+{
+    if(factor(p) != 0) {
+        return -1;
+    }
+    for(;;) {
+        unsigned char op;
+        if(accept(p, CP_TOKEN_PLUS)) {
+            op = CP_OP_ADD;
+        } else if(accept(p, CP_TOKEN_MINUS)) {
+            op = CP_OP_SUB;
+        } else {
+            return 0;
+        }
+        if(factor(p) != 0 || emit(p, op, 0) < 0) {
+            return -1;
+        }
+    }
+}
+
+/* a > b is !(a <= b) and a >= b is !(a < b), which keeps the operand order. */
+static int
+comparison(parser_t *p)
+{
+    if(term(p) != 0) {
+        return -1;
+    }
+    for(;;) {
+        unsigned char op;
+        int negate = 0;
+        switch(p->current.kind) {
+            case CP_TOKEN_LESS: op = CP_OP_LESS; break;
+            case CP_TOKEN_LESS_EQUAL: op = CP_OP_LESS_EQUAL; break;
+            case CP_TOKEN_GREATER: op = CP_OP_LESS_EQUAL; negate = 1; break;
+            case CP_TOKEN_GREATER_EQUAL: op = CP_OP_LESS; negate = 1; break;
+            default: return 0;
+        }
+        advance(p);
+        if(term(p) != 0 || emit(p, op, 0) < 0 || (negate && emit(p, CP_OP_NOT, 0) < 0)) {
+            return -1;
+        }
+    }
+}
+
+static int
+expression(parser_t *p)
+{
+    if(comparison(p) != 0) {
+        return -1;
+    }
+    for(;;) {
+        int negate;
+        if(accept(p, CP_TOKEN_EQUAL)) {
+            negate = 0;
+        } else if(accept(p, CP_TOKEN_NOT_EQUAL)) {
+            negate = 1;
+        } else {
+            return 0;
+        }
+        if(comparison(p) != 0 || emit(p, CP_OP_EQUAL, 0) < 0 || (negate && emit(p, CP_OP_NOT, 0) < 0)) {
+            return -1;
+        }
+    }
+}
+
+static int statement(parser_t *p);
+
+/* Statements after the '{' up to and including the '}'. */
+static int
+block(parser_t *p)
+{
+    while(!accept(p, CP_TOKEN_RBRACE)) {
+        if(statement(p) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+if_statement(parser_t *p)
+{
+    if(expect(p, CP_TOKEN_LPAREN, "Expected '('.") != 0 || expression(p) != 0 ||
+       expect(p, CP_TOKEN_RPAREN, "Expected ')'.") != 0) {
+        return -1;
+    }
+    int64_t skip_then = emit(p, CP_OP_JUMP_IF_FALSE, 0);
+    if(skip_then < 0 || expect(p, CP_TOKEN_LBRACE, "Expected '{'.") != 0 || block(p) != 0) {
+        return -1;
+    }
+    if(!accept(p, CP_TOKEN_ELSE)) {
+        patch(p, skip_then);
+        return 0;
+    }
+    int64_t skip_else = emit(p, CP_OP_JUMP, 0);
+    if(skip_else < 0) {
+        return -1;
+    }
+    patch(p, skip_then);
+    if(accept(p, CP_TOKEN_IF)) {
+        if(if_statement(p) != 0) {
+            return -1;
+        }
+    } else if(expect(p, CP_TOKEN_LBRACE, "Expected '{'.") != 0 || block(p) != 0) {
+        return -1;
+    }
+    patch(p, skip_else);
+    return 0;
+}
+
+static int
+while_statement(parser_t *p)
+{
+    uint32_t top = (uint32_t)p->size;
+    if(expect(p, CP_TOKEN_LPAREN, "Expected '('.") != 0 || expression(p) != 0 ||
+       expect(p, CP_TOKEN_RPAREN, "Expected ')'.") != 0) {
+        return -1;
+    }
+    int64_t exit = emit(p, CP_OP_JUMP_IF_FALSE, 0);
+    if(exit < 0 || expect(p, CP_TOKEN_LBRACE, "Expected '{'.") != 0 || block(p) != 0 ||
+       emit(p, CP_OP_JUMP, top) < 0) {
+        return -1;
+    }
+    patch(p, exit);
+    return 0;
+}
+
+static int
+add_handler(parser_t *p, uint32_t start, uint32_t end, uint32_t handler)
+{
+    if(p->handler_count == p->handler_capacity) {
+        uint32_t capacity = p->handler_capacity ? p->handler_capacity * 2 : 4;
+        unsigned char *handlers = realloc(p->handlers, (size_t)capacity * CP_BYTECODE_HANDLER_SIZE);
+        if(handlers == NULL) {
+            return -1;
+        }
+        p->handlers = handlers;
+        p->handler_capacity = capacity;
+    }
+    unsigned char *record = p->handlers + (size_t)p->handler_count++ * CP_BYTECODE_HANDLER_SIZE;
+    CPBytecode_PutU32(record, 0);
+    CPBytecode_PutU32(record + 4, start);
+    CPBytecode_PutU32(record + 8, end);
+    CPBytecode_PutU32(record + 12, handler);
+    return 0;
+}
+
+/*
+ * try { A } catch (e) { B } emits A, a jump over B, then B, which
+ * starts by storing the exception in e.  Nothing runs on the way into
+ * A; the region is only recorded, after any regions inside it.
+ */
+static int
+try_statement(parser_t *p)
+{
+    uint32_t start = (uint32_t)p->size;
+    p->try_depth++;
+    if(expect(p, CP_TOKEN_LBRACE, "Expected '{'.") != 0 || block(p) != 0) {
+        return -1;
+    }
+    p->try_depth--;
+    uint32_t end = (uint32_t)p->size;
+    int64_t skip = emit(p, CP_OP_JUMP, 0);
+    if(skip < 0 || expect(p, CP_TOKEN_CATCH, "Expected 'catch'.") != 0 ||
+       expect(p, CP_TOKEN_LPAREN, "Expected '('.") != 0 ||
+       expect(p, CP_TOKEN_IDENT, "Expected a variable name.") != 0) {
+        return -1;
+    }
+    /* Catch variables may share a name; each catch overwrites it. */
+    CPToken token = p->previous;
+    const CPString *name = CPString_Intern(token.start, token.length);
+    if(name == NULL || expect(p, CP_TOKEN_RPAREN, "Expected ')'.") != 0) {
+        return -1;
+    }
+    int local = find_local(p, name);
+    if(local < 0) {
+        if(add_local(p, &token) != 0) {
+            return -1;
+        }
+        local = (int)p->local_count - 1;
+    }
+    if(add_handler(p, start, end, (uint32_t)p->size) != 0 || emit(p, CP_OP_STORE_LOCAL, (uint32_t)local) < 0 ||
+       expect(p, CP_TOKEN_LBRACE, "Expected '{'.") != 0 || block(p) != 0) {
+        return -1;
+    }
+    patch(p, skip);
+    return 0;
+}
+
+static int
+assignment(parser_t *p, const CPToken *token)
+{
+    const CPString *name = CPString_Intern(token->start, token->length);
+    if(name == NULL || expression(p) != 0) {
+        return -1;
+    }
+    int local = find_local(p, name);
+    if(local >= 0) {
+        return emit(p, CP_OP_STORE_LOCAL, (uint32_t)local) < 0 ? -1 : 0;
+    }
+    return emit_global(p, CP_OP_STORE_GLOBAL_SLOT, name);
+}
+
+static int
+statement(parser_t *p)
+{
+    if(accept(p, CP_TOKEN_VAR)) {
+        if(expect(p, CP_TOKEN_IDENT, "Expected a variable name.") != 0) {
+            return -1;
+        }
+        CPToken name = p->previous;
+        /* The variable is not in scope in its own initializer. */
+        if(accept(p, CP_TOKEN_ASSIGN)) {
+            if(expression(p) != 0 || add_local(p, &name) != 0 ||
+               emit(p, CP_OP_STORE_LOCAL, p->local_count - 1) < 0) {
+                return -1;
+            }
+        } else if(add_local(p, &name) != 0) {
+            return -1;
+        }
+        return expect(p, CP_TOKEN_SEMICOLON, "Expected ';'.");
+    }
+    if(accept(p, CP_TOKEN_IF)) {
+        return if_statement(p);
+    }
+    if(accept(p, CP_TOKEN_WHILE)) {
+        return while_statement(p);
+    }
+    if(accept(p, CP_TOKEN_LBRACE)) {
+        return block(p);
+    }
+    if(accept(p, CP_TOKEN_TRY)) {
+        return try_statement(p);
+    }
+    if(accept(p, CP_TOKEN_THROW)) {
+        if(expression(p) != 0 || emit(p, CP_OP_THROW, 0) < 0) {
+            return -1;
+        }
+        return expect(p, CP_TOKEN_SEMICOLON, "Expected ';'.");
+    }
+    if(accept(p, CP_TOKEN_RETURN)) {
+        size_t start = p->size;
+        if(p->current.kind == CP_TOKEN_SEMICOLON) {
+            if(emit_constant(p, CP_BYTECODE_CONSTANT_INT, 0) != 0) {
+                return -1;
+            }
+        } else if(expression(p) != 0) {
+            return -1;
+        }
+        /*
+         * A call in tail position reuses the frame.  Not inside a try,
+         * whose handler must still see the callee's exceptions.
+         */
+        if(p->size > start && p->code[p->last] == CP_OP_CALL && p->try_depth == 0) {
+            p->code[p->last] = CP_OP_TAIL_CALL;
+        } else if(emit(p, CP_OP_RETURN, 0) < 0) {
+            return -1;
+        }
+        return expect(p, CP_TOKEN_SEMICOLON, "Expected ';'.");
+    }
+    if(accept(p, CP_TOKEN_PRINT)) {
+        if(expression(p) != 0 || emit(p, CP_OP_PRINT, 0) < 0) {
+            return -1;
+        }
+        return expect(p, CP_TOKEN_SEMICOLON, "Expected ';'.");
+    }
+    if(p->current.kind == CP_TOKEN_IDENT) {
+        CPLexer lookahead = p->lexer;
+        CPToken next;
+        if(CPLexer_Next(&lookahead, &next) == CP_TOKEN_ASSIGN) {
+            CPToken name = p->current;
+            advance(p);
+            advance(p);
+            if(assignment(p, &name) != 0) {
+                return -1;
+            }
+            return expect(p, CP_TOKEN_SEMICOLON, "Expected ';'.");
+        }
+    }
+    if(expression(p) != 0 || emit(p, CP_OP_POP, 0) < 0) {
+        return -1;
+    }
+    return expect(p, CP_TOKEN_SEMICOLON, "Expected ';'.");
+}
+
+static void
+refresh(CPCompiler *compiler)
+{
+    CPModule *module = &compiler->module;
+    module->strings = compiler->builder.strings;
+    module->string_count = compiler->builder.string_count;
+    module->functions = compiler->functions;
+    module->function_count = compiler->function_count;
+    module->constants = compiler->builder.constants;
+    module->constant_count = compiler->builder.constant_count;
+    module->imports = compiler->builder.imports;
+    module->import_count = compiler->builder.import_count;
+    module->globals = compiler->builder.globals;
+    module->global_count = compiler->builder.global_count;
+    module->natives = compiler->builder.natives;
+    module->native_count = compiler->builder.native_count;
+    int64_t entry = CPCompiler_Find(compiler, "main");
+    module->entry = entry < 0 ? CP_BYTECODE_NO_ENTRY : (uint32_t)entry;
+}
+
+static int
+compile(CPCompiler *compiler, uint32_t index)
+{
+    const CPSourceFunction *source = &compiler->sources[index];
+    CPModuleFunction *function = &compiler->functions[index];
+    parser_t p;
+    /* Lexing, parsing and emitting are one pass, traced as one span. */
+    CPTrace_Begin("compiler.compile");
+    memset(&p, 0, sizeof(p));
+    p.compiler = compiler;
+    CPLexer_Init(&p.lexer, compiler->source, source->end);
+    CPLexer_Seek(&p.lexer, source->start + 1, source->line);
+    advance(&p);
+    int rv = -1;
+    /* The pre-parser has checked the parameter list's shape. */
+    while(accept(&p, CP_TOKEN_IDENT)) {
+        if(add_local(&p, &p.previous) != 0) {
+            goto end;
+        }
+        accept(&p, CP_TOKEN_COMMA);
+    }
+    if(expect(&p, CP_TOKEN_RPAREN, "Expected ')'.") != 0 || expect(&p, CP_TOKEN_LBRACE, "Expected '{'.") != 0 ||
+       block(&p) != 0) {
+        goto end;
+    }
+    /* Falling off the end returns 0. */
+    if(emit_constant(&p, CP_BYTECODE_CONSTANT_INT, 0) != 0 || emit(&p, CP_OP_RETURN, 0) < 0) {
+        goto end;
+    }
+    function->locals = (uint16_t)p.local_count;
+    function->code_size = (uint32_t)p.size;
+    function->code = p.code;
+    function->handler_count = p.handler_count;
+    function->handlers = p.handlers;
+    p.code = NULL;
+    p.handlers = NULL;
+    refresh(compiler);
+    rv = 0;
+end:
+    free(p.code);
+    free(p.handlers);
+    CPTrace_End("compiler.compile");
+    return rv;
+}
+
+int
+CPCompiler_Compile(CPCompiler *compiler, uint32_t index)
+{
+    if(compiler->functions[index].code != NULL) {
+        return 0;
+    }
+    if(compile(compiler, index) != 0) {
+        return -1;
+    }
+    compiler->stats.lazy++;
+    return 0;
+}
+
+int
+CPCompiler_CompileLazily(void *compiler, uint32_t index)
+{
+    return CPCompiler_Compile(compiler, index);
+}
+
+int
+CPCompiler_CompileAll(CPCompiler *compiler)
+{
+    for(uint32_t i = 0; i < compiler->function_count; i++) {
+        if(compiler->functions[i].code == NULL) {
+            if(compile(compiler, i) != 0) {
+                return -1;
+            }
+            compiler->stats.eager++;
+        }
+    }
+    return 0;
+}
+
+int64_t
+CPCompiler_Find(const CPCompiler *compiler, const char *name)
+{
+    const CPString *string = CPString_Lookup(name, strlen(name));
+    if(string == NULL) {
+        return -1;
+    }
+    CPHashMapEntry *entry = CPHashMap_Find(&compiler->function_index, string, 0);
+    return entry == NULL ? -1 : (int64_t)(uintptr_t)entry->value - 1;
+}
+
+static int
+init(CPCompiler *compiler, const char *path)
+{
+    compiler->path = path;
+    if(CPModuleBuilder_Init(&compiler->builder) != 0) {
+        return -1;
+    }
+    if(CPHashMap_Init(&compiler->function_index, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        CPModuleBuilder_Destroy(&compiler->builder);
+        return -1;
+    }
+    if(CPHashMap_Init(&compiler->native_index, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        CPHashMap_Destroy(&compiler->function_index);
+        CPModuleBuilder_Destroy(&compiler->builder);
+        return -1;
+    }
+    CPTrace_Begin("compiler.preparse");
+    int rv = compiler->name == NULL ? -1 : preparse(compiler);
+    CPTrace_End("compiler.preparse");
+    if(rv != 0) {
+        CPCompiler_Close(compiler);
+        return -1;
+    }
+    refresh(compiler);
+    return 0;
+}
+
+int
+CPCompiler_Load(CPCompiler *compiler, const char *name, const char *source, size_t size)
+{
+    memset(compiler, 0, sizeof(CPCompiler));
+    compiler->source = source;
+    compiler->size = size;
+    compiler->name = CPString_InternCString(name);
+    return init(compiler, name);
+}
+
+int
+CPCompiler_Open(CPCompiler *compiler, const char *path)
+{
+    memset(compiler, 0, sizeof(CPCompiler));
+    FILE *file = fopen(path, "rb");
+    size_t size;
+    if(file == NULL || CPMemoryMapping_FileSize(file, &size) != 0) {
+        if(file != NULL) {
+            fclose(file);
+        }
+        cp_report_error("Cannot read '%s'.", path);
+        return -1;
+    }
+    compiler->source = "";
+    if(size > 0) {
+        if(CPMemoryMapping_Create(&compiler->mapping, file, size, 0, CP_MMAP_PROT_READ,
+                                  CP_MMAP_FLAG_PRIVATE) != 0) {
+            fclose(file);
+            cp_report_error("Cannot read '%s'.", path);
+            return -1;
+        }
+        compiler->mapped = 1;
+        compiler->source = compiler->mapping.addr;
+        compiler->size = size;
+    }
+    fclose(file);
+    compiler->name = CPModule_NameFromPath(path);
+    return init(compiler, path);
+}
+
+void
+CPCompiler_Close(CPCompiler *compiler)
+{
+    for(uint32_t i = 0; i < compiler->function_count; i++) {
+        free((void *)compiler->functions[i].code);
+        free((void *)compiler->functions[i].handlers);
+    }
+    free(compiler->sources);
+    free(compiler->functions);
+    free(compiler->imports);
+    CPHashMap_Destroy(&compiler->function_index);
+    CPHashMap_Destroy(&compiler->native_index);
+    CPModuleBuilder_Destroy(&compiler->builder);
+    if(compiler->mapped) {
+        CPMemoryMapping_Destroy(&compiler->mapping);
+    }
+    memset(compiler, 0, sizeof(CPCompiler));
+}
+
+int
+CPCompiler_Write(CPCompiler *compiler, const char *path)
+{
+    if(CPCompiler_CompileAll(compiler) != 0) {
+        return -1;
+    }
+    CPModuleBuilder *builder = &compiler->builder;
+    int rv = 0;
+    CPTrace_Begin("compiler.write");
+    for(uint32_t i = 0; i < compiler->function_count && rv == 0; i++) {
+        const CPModuleFunction *function = &compiler->functions[i];
+        uint32_t index;
+        rv = CPModuleBuilder_Function(builder, function->name, function->params, function->locals,
+                                      function->code, function->code_size, &index);
+        if(rv == 0) {
+            rv = CPModuleBuilder_Handlers(builder, index, function->handlers, function->handler_count);
+        }
+    }
+    builder->entry = compiler->module.entry;
+    if(rv == 0 && CPModuleBuilder_Write(builder, path) != 0) {
+        cp_report_error("Cannot write '%s'.", path);
+        rv = -1;
+    }
+    /* The builder holds functions only while writing. */
+    builder->function_count = 0;
+    builder->code_size = 0;
+    builder->handler_count = 0;
+    refresh(compiler);
+    CPTrace_End("compiler.write");
+    return rv;
+}
+
+uint64_t
+CPCompiler_InterfaceHash(const CPCompiler *compiler)
+{
+    uint64_t hash = 0;
+    for(uint32_t i = 0; i < compiler->function_count; i++) {
+        const CPModuleFunction *function = &compiler->functions[i];
+        hash = CPHash_Int(hash ^ function->name->hash ^ ((uint64_t)function->params << 48));
+    }
+    return hash;
+}
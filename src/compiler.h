@@ -0,0 +1,109 @@
+/*
+ * compiler.h - compile CP source to bytecode, one function at a time.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_COMPILER_H_
+#define _CP_COMPILER_H_
+
+#include "hashmap.h"
+#include "intern.h"
+#include "module.h"
+#include "platform/mmap.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A source file is a sequence of declarations:
+ *
+ *     import NAME;
+ *     native "LIBRARY" func NAME(TYPE, ...) TYPE;
+ *     func NAME(PARAM, ...) { STATEMENT... }
+ *
+ * Opening a file only pre-parses it: function bodies are skimmed for
+ * balanced brackets and their source ranges recorded.  A body is
+ * parsed and compiled when CPCompiler_Compile() asks for it, which the
+ * interpreter does on the function's first call.
+ */
+typedef struct
+{
+    /* Offset and line of the parameter list's '('. */
+    size_t start;
+    uint32_t line;
+    /* Offset just past the body's closing '}'. */
+    size_t end;
+} CPSourceFunction;
+
+typedef struct
+{
+    uint32_t preparsed;
+    uint32_t lazy;
+    uint32_t eager;
+} CPCompileStats;
+
+typedef struct
+{
+    CPMemoryMapping mapping;
+    int mapped;
+    const char *path;
+    const char *source;
+    size_t size;
+    const CPString *name;
+    /* Strings, constants, imports and globals, shared by all functions. */
+    CPModuleBuilder builder;
+    CPSourceFunction *sources;
+    CPModuleFunction *functions;
+    uint32_t function_count;
+    uint32_t function_capacity;
+    /* Function name to index + 1. */
+    CPHashMap function_index;
+    /* Native function name to NATIVES index + 1. */
+    CPHashMap native_index;
+    const CPString **imports;
+    uint32_t import_count;
+    /* The functions and the builder's tables, as the interpreter sees them. */
+    CPModule module;
+    CPCompileStats stats;
+} CPCompiler;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Map and pre-parse `path'; the module is named after the file. */
+int CPCompiler_Open(CPCompiler *compiler, const char *path);
+/* Pre-parse `source', which must outlive the compiler. */
+int CPCompiler_Load(CPCompiler *compiler, const char *name, const char *source, size_t size);
+void CPCompiler_Close(CPCompiler *compiler);
+/* Index of the function `name', or -1. */
+int64_t CPCompiler_Find(const CPCompiler *compiler, const char *name);
+/* Compile function `index' if it is not yet; counted as lazy. */
+int CPCompiler_Compile(CPCompiler *compiler, uint32_t index);
+/* Compile every function not yet compiled; counted as eager. */
+int CPCompiler_CompileAll(CPCompiler *compiler);
+/* CPCompiler_Compile() as a CPVMCompileFunc. */
+int CPCompiler_CompileLazily(void *compiler, uint32_t index);
+/* Compile everything and write a module whose entry is `main'. */
+int CPCompiler_Write(CPCompiler *compiler, const char *path);
+/* Hash of the function names and arities, known once pre-parsed. */
+uint64_t CPCompiler_InterfaceHash(const CPCompiler *compiler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_COMPILER_H_ */
@@ -22,11 +22,28 @@
 #include <path.h>
 #include <report_error.h>
 #include <commandline.h>
+#include <build.h>
+#include <bundle.h>
+#include <bytecode.h>
+#include <compiler.h>
+#include <intern.h>
+#include <linker.h>
+#include <module.h>
+#include <numconv.h>
+#include <trace.h>
+#include <profile.h>
+#include <server.h>
+#include <opstats.h>
+#include <vm.h>
+#include <watch.h>
+#include <platform/perfcounter.h>
 #include <stdio.h>
 
 #include "main.h"
 
 #include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
 
 static int main_running = 0;
 
@@ -35,39 +52,458 @@ static char *home = NULL;
 static char buf1[CP_MAX_PATH];
 static char buf2[CP_MAX_PATH];
 
+#define STATS_OPCODES 0x1
+#define STATS_PERF 0x2
+#define STATS_COMPILE 0x4
+
+static int stats = 0;
+static CPPerfCounter perf;
+/* The exit status main() asked for, if it returned an int. */
+static int program_status = 0;
+static CPCompileStats compile_stats;
+static CPBuildStats build_stats;
+
 static int init_program_path(void)
 {
-    if(CPCommandLine_GetExecutablePath(buf1) == 0) {
+    int rv = -1;
+    CPTrace_Begin("init_program_path");
+    /* A server resolves it once for all requests. */
+    if(exe == NULL) {
+        if(CPCommandLine_GetExecutablePath(buf1) != 0) {
+            cp_report_error("Cannot get executable path.");
+            goto end;
+        }
         exe = buf1;
-    } else {
-        cp_report_error("Cannot get executable path.");
-        return -1;
     }
     if(CPCommandLine_GetHomeDirectory(buf2, exe) == 0) {
         home = buf2;
     } else {
         cp_report_error("Cannot get home directory.");
-        return -1;
+        goto end;
     }
     if(CPath_Filename(cp_exename, exe) < 0) {
         cp_report_error("Cannot get executable name.");
+        goto end;
+    }
+    rv = 0;
+end:
+    CPTrace_End("init_program_path");
+    return rv;
+}
+
+static int start_profile(const char *path, const char *rate)
+{
+    uint64_t hz = CP_PROFILE_DEFAULT_RATE;
+    if(rate != NULL) {
+        size_t length = strlen(rate);
+        if(length == 0 || CPNum_ParseU64(rate, length, &hz) != length ||
+           hz == 0 || hz > 100000) {
+            cp_report_error("Invalid profile rate '%s'.", rate);
+            return -1;
+        }
+    }
+    if(CPProfile_Start(path, (unsigned int)hz) < 0) {
+        cp_report_error("Cannot start profiling to '%s'.", path);
         return -1;
     }
     return 0;
 }
 
+static int parse_stats(const char *list)
+{
+    while(*list != '\0') {
+        size_t len = strcspn(list, ",");
+        if(len == 7 && strncmp(list, "opcodes", len) == 0) {
+#ifndef CP_OPCODE_STATS
+            cp_report_error("Opcode statistics are not available: rebuild with --enable-opcode-stats.");
+            return -1;
+#endif
+            stats |= STATS_OPCODES;
+        } else if(len == 4 && strncmp(list, "perf", len) == 0) {
+            stats |= STATS_PERF;
+        } else if(len == 7 && strncmp(list, "compile", len) == 0) {
+            stats |= STATS_COMPILE;
+        } else {
+            cp_report_error("Unknown statistics '%.*s'.", (int)len, list);
+            return -1;
+        }
+        list += len;
+        if(*list == ',') {
+            list++;
+        }
+    }
+    return 0;
+}
+
+static int run_main(const CPModule *module, CPVMCompileFunc compile, void *context)
+{
+    CPVM vm;
+    CPValue result;
+    if(module->entry == CP_BYTECODE_NO_ENTRY) {
+        cp_report_error("No 'main' function to run.");
+        return -1;
+    }
+    if(CPVM_Init(&vm, module) < 0) {
+        return -1;
+    }
+    vm.compile = compile;
+    vm.context = context;
+    CPTrace_Begin("run");
+    int rv = CPVM_Call(&vm, module->entry, NULL, 0, &result);
+    CPTrace_End("run");
+    CPVM_Destroy(&vm);
+    if(rv == 0 && result.type == CP_VALUE_INT) {
+        program_status = (int)(result.as.i & 0xff);
+    }
+    /* The profile names frames by the module's strings; write it while they exist. */
+    if(CPProfile_Stop() < 0) {
+        rv = -1;
+    }
+    return rv;
+}
+
+/* Loaded images are checked once up front; the interpreter trusts them. */
+static int run_image(const CPModule *module)
+{
+    CPTrace_Begin("verify");
+    for(uint32_t i = 0; i < module->function_count; i++) {
+        if(CPModule_Verify(module, i) < 0) {
+            CPTrace_End("verify");
+            cp_report_error("Invalid code in function '%s'.", module->functions[i].name->data);
+            return -1;
+        }
+    }
+    CPTrace_End("verify");
+    return run_main(module, NULL, NULL);
+}
+
+/*
+ * A bundled executable runs its image instead of taking commands.  The
+ * image is used in place from the mapping.
+ */
+static int run_bundle(const CPBundle *bundle)
+{
+    CPModule module;
+    CPTrace_Begin("load_bundle");
+    int rv = CPModule_Load(&module, bundle->image, bundle->size);
+    CPTrace_End("load_bundle");
+    if(rv < 0) {
+        cp_report_error("Unsupported or corrupt bundled image.");
+        return -1;
+    }
+    rv = run_image(&module);
+    CPString_Reset();
+    CPModule_Close(&module);
+    return rv;
+}
+
+static int is_image(const char *path)
+{
+    size_t length = strlen(path);
+    return length >= 4 && strcmp(path + length - 4, ".cpm") == 0;
+}
+
+/*
+ * Source functions are compiled on their first call unless --eager is
+ * given; the pre-parse has only checked their brackets.
+ */
+static int run_command(void)
+{
+    int eager = CP_ParseFlag("--eager");
+    const char *path = CP_ParseOneArg();
+    if(path == NULL) {
+        cp_report_error("Usage: cpc run [--eager] FILE");
+        return -1;
+    }
+    int rv = -1;
+    if(is_image(path)) {
+        CPModule module;
+        if(CPModule_Open(&module, path) < 0) {
+            cp_report_error("Cannot load '%s'.", path);
+            return -1;
+        }
+        rv = run_image(&module);
+        CPString_Reset();
+        CPModule_Close(&module);
+        return rv;
+    }
+    CPCompiler compiler;
+    CPTrace_Begin("preparse");
+    rv = CPCompiler_Open(&compiler, path);
+    CPTrace_End("preparse");
+    if(rv < 0) {
+        return -1;
+    }
+    if(eager) {
+        CPTrace_Begin("compile");
+        rv = CPCompiler_CompileAll(&compiler);
+        CPTrace_End("compile");
+    }
+    if(rv == 0) {
+        rv = run_main(&compiler.module, CPCompiler_CompileLazily, &compiler);
+    }
+    compile_stats.preparsed += compiler.stats.preparsed;
+    compile_stats.lazy += compiler.stats.lazy;
+    compile_stats.eager += compiler.stats.eager;
+    CPCompiler_Close(&compiler);
+    return rv;
+}
+
+static int compile_command(void)
+{
+    const char *output = CP_ParseOption("-o");
+    const char *path = CP_ParseOneArg();
+    if(output == NULL || path == NULL) {
+        cp_report_error("Usage: cpc compile FILE -o OUTPUT");
+        return -1;
+    }
+    CPCompiler compiler;
+    if(CPCompiler_Open(&compiler, path) < 0) {
+        return -1;
+    }
+    CPTrace_Begin("compile");
+    int rv = CPCompiler_Write(&compiler, output);
+    CPTrace_End("compile");
+    compile_stats.preparsed += compiler.stats.preparsed;
+    compile_stats.eager += compiler.stats.eager;
+    CPCompiler_Close(&compiler);
+    return rv;
+}
+
+static int build_command(void)
+{
+    const char *output = CP_ParseOption("-o");
+    const char *source = CP_ParseOneArg();
+    if(output == NULL || source == NULL) {
+        cp_report_error("Usage: cpc build MAIN -o OUTPUT");
+        return -1;
+    }
+    CPTrace_Begin("build");
+    int rv = CPBuild_Run(source, output, &build_stats);
+    CPTrace_End("build");
+    return rv;
+}
+
+/*
+ * A source FILE is built first, as by `cpc build', into OUTPUT.cpm; the
+ * temporary image is removed once it is bundled.
+ */
+static int bundle_command(void)
+{
+    const char *output = CP_ParseOption("-o");
+    const char *input = CP_ParseOneArg();
+    if(output == NULL || input == NULL) {
+        cp_report_error("Usage: cpc bundle FILE -o OUTPUT");
+        return -1;
+    }
+    if(is_image(input)) {
+        CPTrace_Begin("bundle");
+        int rv = CPBundle_Create(output, exe, input);
+        CPTrace_End("bundle");
+        return rv;
+    }
+    size_t length = strlen(output);
+    char *image = malloc(length + 5);
+    if(image == NULL) {
+        return -1;
+    }
+    memcpy(image, output, length);
+    memcpy(image + length, ".cpm", 5);
+    CPTrace_Begin("build");
+    int rv = CPBuild_Run(input, image, &build_stats);
+    CPTrace_End("build");
+    if(rv == 0) {
+        CPTrace_Begin("bundle");
+        rv = CPBundle_Create(output, exe, image);
+        CPTrace_End("bundle");
+    }
+    remove(image);
+    free(image);
+    return rv;
+}
+
+static int link_command(void)
+{
+    const char *output = CP_ParseOption("-o");
+    if(output == NULL || cp_argc == 0) {
+        cp_report_error("Usage: cpc link MODULE... -o OUTPUT");
+        return -1;
+    }
+    /* Every remaining argument is an input module. */
+    const char **inputs = malloc((size_t)cp_argc * sizeof(const char *));
+    if(inputs == NULL) {
+        return -1;
+    }
+    int count = 0;
+    const char *input;
+    while((input = CP_ParseOneArg()) != NULL) {
+        inputs[count++] = input;
+    }
+    CPTrace_Begin("link");
+    int rv = CPLinker_Link(output, inputs, count, NULL);
+    CPTrace_End("link");
+    free(inputs);
+    return rv;
+}
+
+static int watch_command(void)
+{
+    const char *dir = CP_ParseOneArg();
+    if(dir == NULL) {
+        cp_report_error("Usage: cpc --watch DIR");
+        return -1;
+    }
+    CPWatcher watcher;
+    if(CPWatcher_Open(&watcher, dir) < 0) {
+        return -1;
+    }
+    fprintf(stderr, "Watching '%s': %u modules, %u failed.\n", dir,
+            (unsigned)watcher.modules.size, (unsigned)watcher.stats.failed);
+    int rv;
+    while((rv = CPWatcher_Poll(&watcher, -1)) >= 0) {
+        if(rv == 0) {
+            continue;
+        }
+        uint32_t failed = watcher.stats.failed;
+        fprintf(stderr, "Recompiled %d modules in %.1f ms%s\n", rv,
+                (double)watcher.stats.last_batch_ns / 1e6, failed != 0 ? ", with errors." : ".");
+        watcher.stats.failed = 0;
+    }
+    cp_report_error("Cannot watch '%s'.", dir);
+    CPWatcher_Close(&watcher);
+    return -1;
+}
+
+static void start_stats(void)
+{
+    if(stats & STATS_PERF) {
+        CPPerfCounter_Open(&perf);
+        CPPerfCounter_Start(&perf);
+    }
+}
+
+static void dump_perf(FILE *out)
+{
+    CPPerfCounter_Stop(&perf);
+    fprintf(out, "# counter\tvalue\n");
+    fprintf(out, "elapsed-ns\t%llu\n", (unsigned long long)perf.elapsed_ns);
+    for(int i = 0; i < CP_PERF_EVENTS; i++) {
+        if(perf.available & (1 << i)) {
+            fprintf(out, "%s\t%llu\n", CPPerfCounter_Name(i), (unsigned long long)perf.values[i]);
+        }
+    }
+    int ipc = (1 << CP_PERF_CYCLES) | (1 << CP_PERF_INSTRUCTIONS);
+    if((perf.available & ipc) == ipc && perf.values[CP_PERF_CYCLES] != 0) {
+        fprintf(out, "ipc\t%.2f\n",
+                (double)perf.values[CP_PERF_INSTRUCTIONS] / (double)perf.values[CP_PERF_CYCLES]);
+    }
+    CPPerfCounter_Close(&perf);
+}
+
+static void dump_compile(FILE *out)
+{
+    fprintf(out, "# functions\tcount\n");
+    fprintf(out, "preparsed\t%u\n", (unsigned)compile_stats.preparsed);
+    fprintf(out, "lazy\t%u\n", (unsigned)compile_stats.lazy);
+    fprintf(out, "eager\t%u\n", (unsigned)compile_stats.eager);
+    fprintf(out, "never\t%u\n",
+            (unsigned)(compile_stats.preparsed - compile_stats.lazy - compile_stats.eager));
+    if(build_stats.modules != 0) {
+        fprintf(out, "# modules\tcount\n");
+        fprintf(out, "total\t%u\n", (unsigned)build_stats.modules);
+        fprintf(out, "compiled\t%u\n", (unsigned)build_stats.compiled);
+        fprintf(out, "linked\t%d\n", build_stats.linked);
+    }
+}
+
+static int dump_stats(void)
+{
+    int rv = 0;
+    if(stats & STATS_PERF) {
+        dump_perf(stderr);
+    }
+    if(stats & STATS_COMPILE) {
+        dump_compile(stderr);
+    }
+    if((stats & STATS_OPCODES) && CPOpStats_Dump(stderr) < 0) {
+        rv = -1;
+    }
+    stats = 0;
+    return rv;
+}
+
 static void print_help(void)
 {
     printf("Usage: cpc --version\n");
     printf("           or: cpc --copyright\n");
     printf("           or: cpc --license\n");
     printf("           or: cpc --help\n");
+    printf("           or: cpc bundle FILE -o OUTPUT\n");
+    printf("           or: cpc link MODULE... -o OUTPUT\n");
+    printf("           or: cpc run [--eager] FILE\n");
+    printf("           or: cpc compile FILE -o OUTPUT\n");
+    printf("           or: cpc build MAIN -o OUTPUT\n");
+    printf("           or: cpc --watch DIR\n");
+    printf("           or: cpc --server=SOCKET\n");
     printf("\n");
     printf("            --version       Show version information\n");
     printf("            --copyright     Show copyright information\n");
     printf("            --license       Show license information\n");
     printf("            --help          Show this help information\n");
+    printf("            bundle          Write a copy of cpc that runs a .cpm image, or\n");
+    printf("                            the program built from a source FILE\n");
+    printf("            link            Merge .cpm modules into OUTPUT, keeping what the\n");
+    printf("                            first module's entry point reaches\n");
+    printf("            run             Run main() of a source FILE or a .cpm image; source\n");
+    printf("                            functions compile on first call unless --eager;\n");
+    printf("                            an int main() returns is the exit status\n");
+    printf("            compile         Compile a source FILE to the .cpm module OUTPUT\n");
+    printf("            build           Compile MAIN and the modules it imports, reusing\n");
+    printf("                            what is up to date in .cpbuild/, and link OUTPUT\n");
+    printf("            --watch         Compile every source in DIR into DIR/.cpbuild/ and\n");
+    printf("                            recompile the ones that change, until killed\n");
+    printf("            --server        Serve the commands of other cpc processes on the\n");
+    printf("                            UNIX socket SOCKET, until killed; each command\n");
+    printf("                            runs in a fork and parses its sources afresh\n");
+    printf("\n");
+    printf("Options:\n");
+    printf("            --trace-out=FILE  Write a Chrome trace of the phases to FILE\n");
+    printf("            --profile=FILE    Write sampled CP stacks to FILE in folded format\n");
+    printf("            --profile-rate=HZ Sample HZ times per second of CPU time (default %d)\n",
+           CP_PROFILE_DEFAULT_RATE);
+    printf("            --stats=LIST      Print statistics at exit; LIST is a comma-separated\n");
+    printf("                              list of 'opcodes', 'perf' and 'compile'; a bare\n");
+    printf("                              --stats means --stats=compile\n");
     printf("\n");
+    printf("Environment:\n");
+    printf("            CPC_SERVER        Have the server on this socket run the command, if\n");
+    printf("                              one is listening\n");
+    printf("            CPC_NO_PERF_EVENTS\n");
+    printf("                              If not empty, --stats=perf measures only time\n");
+    printf("                              and page faults\n");
+    printf("\n");
+}
+
+static int run_cpc(void);
+
+/* Runs in a child of the server with the client's argv. */
+static int serve(int argc, char **argv)
+{
+    cp_argc = argc;
+    cp_argv = argv;
+    return run_cpc();
+}
+
+static int server_command(const char *path)
+{
+    if(CP_ParseAssertNoMoreArgs() < 0) {
+        print_help();
+        return 1;
+    }
+    if(init_program_path() < 0) {
+        return 1;
+    }
+    return CPServer_Run(path, serve) < 0 ? 1 : 0;
 }
 
 CP_API_FUNC(int)
@@ -78,21 +514,108 @@ CPMainProgramEntryPoint_CPC(int argc, char **argv)
         return -1;
     }
     main_running = 1;
-    int rv = 1;
     /* Initialize the argument parser. */
     cp_argc = argc - 1;
     cp_argv = argv + 1;
+    int rv;
+    CPBundle bundle;
+    /*
+     * A bundled program is not cpc: it is recognized before any option
+     * is parsed and never forwarded, since a server's executable is
+     * plain cpc and would take the program's arguments for a command.
+     */
     if(init_program_path() < 0) {
+        rv = 1;
+        goto done;
+    }
+    /* An executable we cannot read, e.g. mode 0711, is plain cpc. */
+    if(CPBundle_Open(&bundle, exe) == 1) {
+        rv = run_bundle(&bundle) == 0 ? program_status : 1;
+        CPString_Reset();
+        CPBundle_Close(&bundle);
+        goto done;
+    }
+    const char *server = CP_ParseOption("--server");
+    const char *forward_to = getenv("CPC_SERVER");
+    if(server != NULL) {
+        rv = server_command(server);
+    } else if(forward_to == NULL || forward_to[0] == '\0' ||
+              CPServer_Forward(forward_to, cp_argc, cp_argv, &rv) < 0) {
+        rv = run_cpc();
+    }
+done:
+    main_running = 0;
+    return rv;
+}
+
+/* Run the command in cp_argv; returns the exit status. */
+static int run_cpc(void)
+{
+    int rv = 1;
+    const char *trace_out = CP_ParseOption("--trace-out");
+    if(trace_out != NULL && CPTrace_Start(trace_out) < 0) {
+        cp_report_error("Cannot start tracing to '%s'.", trace_out);
         goto error;
     }
-    if(CP_ParseFlag("--copyright") == 1) {
-        CPCommandLine_PrintCopyright();goto end;
+    /* CP_ParseOption() matches prefixes, so take the longer name first. */
+    const char *profile_rate = CP_ParseOption("--profile-rate");
+    const char *profile_out = CP_ParseOption("--profile");
+    if(profile_out != NULL && start_profile(profile_out, profile_rate) < 0) {
+        goto error;
     }
-    if(CP_ParseFlag("--version") == 1) {
-        CPCommandLine_PrintVersion();goto end;
+    /* A bare --stats must not take the next argument as its list. */
+    const char *stats_list = CP_ParseFlag("--stats") ? "compile" : CP_ParseOption("--stats");
+    if(stats_list != NULL && parse_stats(stats_list) < 0) {
+        goto error;
     }
-    if(CP_ParseFlag("--help") == 1) {
-        print_help();goto end;
+    start_stats();
+    if(init_program_path() < 0) {
+        goto error;
+    }
+    CPTrace_Begin("parse_args");
+    static const char * const commands[] = {"--copyright", "--version", "--help", "bundle", "link", "run", "compile",
+                                            "build", "--watch"};
+    int command = CP_ParseFlagEx(9, commands);
+    CPTrace_End("parse_args");
+    switch(command) {
+        case 0:
+            CPCommandLine_PrintCopyright();goto end;
+        case 1:
+            CPCommandLine_PrintVersion();goto end;
+        case 2:
+            print_help();goto end;
+        case 3:
+            if(bundle_command() < 0) {
+                goto error;
+            }
+            goto end;
+        case 4:
+            if(link_command() < 0) {
+                goto error;
+            }
+            goto end;
+        case 5:
+            if(run_command() < 0) {
+                goto error;
+            }
+            goto end;
+        case 6:
+            if(compile_command() < 0) {
+                goto error;
+            }
+            goto end;
+        case 7:
+            if(build_command() < 0) {
+                goto error;
+            }
+            goto end;
+        case 8:
+            if(watch_command() < 0) {
+                goto error;
+            }
+            goto end;
+        default:
+            break;
     }
     print_help();
     goto error;
@@ -101,8 +624,16 @@ end:
         print_help();
         goto error;
     }
-    rv = 0;
+    rv = program_status;
 error:
-    main_running = 0;
+    if(dump_stats() < 0) {
+        rv = 1;
+    }
+    if(CPProfile_Stop() < 0) {
+        rv = 1;
+    }
+    if(CPTrace_Stop() < 0) {
+        rv = 1;
+    }
     return rv;
 }
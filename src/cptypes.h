@@ -42,6 +42,22 @@ typedef SSIZE_T ssize_t;
 
 #define CP_UNUSED(x) (void)(x)
 
+#ifdef __GNUC__
+#define CP_LIKELY(x) __builtin_expect(!!(x), 1)
+#define CP_UNLIKELY(x) __builtin_expect(!!(x), 0)
+#else
+#define CP_LIKELY(x) (x)
+#define CP_UNLIKELY(x) (x)
+#endif
+
+#if defined(__GNUC__)
+#define CP_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define CP_THREAD_LOCAL __declspec(thread)
+#else
+#define CP_THREAD_LOCAL _Thread_local
+#endif
+
 #ifdef __GNUC__
 #define CP_UNREACHABLE() __builtin_unreachable()
 #else
@@ -0,0 +1,194 @@
+/*
+ * ffi.c - calls into shared libraries.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "ffi.h"
+#include "cptypes.h"
+#include "intern.h"
+#include "report_error.h"
+
+#include <string.h>
+
+/*
+ * Per type code: its C type, whether a CPValue can be passed as one,
+ * the conversion, and how a result is stored.
+ */
+#define C_v void
+#define C_i int
+#define C_l long
+#define C_d double
+#define C_s const char *
+
+#define CHECK_i(a) ((a).type == CP_VALUE_INT)
+#define CHECK_l(a) ((a).type == CP_VALUE_INT)
+#define CHECK_d(a) ((a).type == CP_VALUE_INT || (a).type == CP_VALUE_FLOAT)
+#define CHECK_s(a) ((a).type == CP_VALUE_STRING)
+
+#define ARG_i(a) ((int)(a).as.i)
+#define ARG_l(a) ((long)(a).as.i)
+#define ARG_d(a) ((a).type == CP_VALUE_INT ? (double)(a).as.i : (a).as.f)
+#define ARG_s(a) ((a).as.s->data)
+
+#define RETURN_v(call) \
+    call; \
+    result->type = CP_VALUE_INT; \
+    result->as.i = 0; \
+    return 0
+#define RETURN_i(call) \
+    result->type = CP_VALUE_INT; \
+    result->as.i = call; \
+    return 0
+#define RETURN_l RETURN_i
+#define RETURN_d(call) \
+    result->type = CP_VALUE_FLOAT; \
+    result->as.f = call; \
+    return 0
+#define RETURN_s(call) \
+    const char *s = call; \
+    result->type = CP_VALUE_STRING; \
+    result->as.s = CPString_New(s != NULL ? s : "", s != NULL ? strlen(s) : 0); \
+    return result->as.s != NULL ? 0 : -1
+
+#define TRAMPOLINE0(r) \
+    static int call_##r(CPDynLibFunc function, const CPValue *args, CPValue *result) \
+    { \
+        CP_UNUSED(args); \
+        RETURN_##r(((C_##r (*)(void))function)()); \
+    }
+#define TRAMPOLINE1(r, a) \
+    static int call_##r##a(CPDynLibFunc function, const CPValue *args, CPValue *result) \
+    { \
+        if(!CHECK_##a(args[0])) { \
+            return -1; \
+        } \
+        RETURN_##r(((C_##r (*)(C_##a))function)(ARG_##a(args[0]))); \
+    }
+#define TRAMPOLINE2(r, a, b) \
+    static int call_##r##a##b(CPDynLibFunc function, const CPValue *args, CPValue *result) \
+    { \
+        if(!CHECK_##a(args[0]) || !CHECK_##b(args[1])) { \
+            return -1; \
+        } \
+        RETURN_##r(((C_##r (*)(C_##a, C_##b))function)(ARG_##a(args[0]), ARG_##b(args[1]))); \
+    }
+#define TRAMPOLINE3(r, a, b, c) \
+    static int call_##r##a##b##c(CPDynLibFunc function, const CPValue *args, CPValue *result) \
+    { \
+        if(!CHECK_##a(args[0]) || !CHECK_##b(args[1]) || !CHECK_##c(args[2])) { \
+            return -1; \
+        } \
+        RETURN_##r(((C_##r (*)(C_##a, C_##b, C_##c))function)(ARG_##a(args[0]), ARG_##b(args[1]), \
+                                                               ARG_##c(args[2]))); \
+    }
+
+/* Apply M to every signature: each return type with up to three parameters. */
+#define PARAMS1(M, r) M(r, i) M(r, l) M(r, d) M(r, s)
+#define PARAMS2(M, r) PARAMS2_(M, r, i) PARAMS2_(M, r, l) PARAMS2_(M, r, d) PARAMS2_(M, r, s)
+#define PARAMS2_(M, r, a) M(r, a, i) M(r, a, l) M(r, a, d) M(r, a, s)
+#define PARAMS3(M, r) PARAMS3_(M, r, i) PARAMS3_(M, r, l) PARAMS3_(M, r, d) PARAMS3_(M, r, s)
+#define PARAMS3_(M, r, a) PARAMS3__(M, r, a, i) PARAMS3__(M, r, a, l) PARAMS3__(M, r, a, d) PARAMS3__(M, r, a, s)
+#define PARAMS3__(M, r, a, b) M(r, a, b, i) M(r, a, b, l) M(r, a, b, d) M(r, a, b, s)
+#define SIGNATURES(r, M0, M1, M2, M3) M0(r) PARAMS1(M1, r) PARAMS2(M2, r) PARAMS3(M3, r)
+#define EACH_RETURN(M) M(v) M(i) M(l) M(d) M(s)
+
+#define DEFINE(r) SIGNATURES(r, TRAMPOLINE0, TRAMPOLINE1, TRAMPOLINE2, TRAMPOLINE3)
+EACH_RETURN(DEFINE)
+#undef DEFINE
+
+typedef struct
+{
+    const char *signature;
+    CPFFITrampoline call;
+} trampoline_t;
+
+#define ENTRY0(r) {#r, call_##r},
+#define ENTRY1(r, a) {#r #a, call_##r##a},
+#define ENTRY2(r, a, b) {#r #a #b, call_##r##a##b},
+#define ENTRY3(r, a, b, c) {#r #a #b #c, call_##r##a##b##c},
+#define DEFINE(r) SIGNATURES(r, ENTRY0, ENTRY1, ENTRY2, ENTRY3)
+static const trampoline_t trampolines[] = {EACH_RETURN(DEFINE)};
+#undef DEFINE
+
+char
+CPFFI_TypeCode(const char *name, size_t length, int is_return)
+{
+    static const struct
+    {
+        const char *name;
+        char code;
+    } types[] = {
+        {"int", CP_FFI_INT},
+        {"long", CP_FFI_LONG},
+        {"double", CP_FFI_DOUBLE},
+        {"string", CP_FFI_STRING},
+        {"void", CP_FFI_VOID},
+    };
+    for(size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        if(strlen(types[i].name) == length && memcmp(types[i].name, name, length) == 0) {
+            return types[i].code == CP_FFI_VOID && !is_return ? 0 : types[i].code;
+        }
+    }
+    return 0;
+}
+
+/* Searched only when a slot is bound, so a scan is enough. */
+CPFFITrampoline
+CPFFI_Trampoline(const char *signature)
+{
+    for(size_t i = 0; i < sizeof(trampolines) / sizeof(trampolines[0]); i++) {
+        if(strcmp(trampolines[i].signature, signature) == 0) {
+            return trampolines[i].call;
+        }
+    }
+    return NULL;
+}
+
+int
+CPFFI_Bind(CPNativeSlot *slot, const char *library, const char *symbol, const char *signature)
+{
+    CPFFITrampoline call = CPFFI_Trampoline(signature);
+    if(call == NULL) {
+        cp_report_error("Unsupported signature '%s' of native function '%s'.", signature, symbol);
+        return -1;
+    }
+    void *handle = CPDynLib_Open(library);
+    if(handle == NULL) {
+        cp_report_error("Cannot load library '%s'.", library);
+        return -1;
+    }
+    CPDynLibFunc function = CPDynLib_Symbol(handle, symbol);
+    if(function == NULL) {
+        CPDynLib_Close(handle);
+        cp_report_error("Undefined native function '%s' in library '%s'.", symbol, library);
+        return -1;
+    }
+    slot->function = function;
+    slot->call = call;
+    slot->params = (uint32_t)strlen(signature) - 1;
+    slot->library = handle;
+    return 0;
+}
+
+void
+CPFFI_Unbind(CPNativeSlot *slot)
+{
+    if(slot->library != NULL) {
+        CPDynLib_Close(slot->library);
+    }
+    memset(slot, 0, sizeof(CPNativeSlot));
+}
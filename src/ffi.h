@@ -0,0 +1,79 @@
+/*
+ * ffi.h - calls into shared libraries.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_FFI_H_
+#define _CP_FFI_H_
+
+#include "platform/dynlib.h"
+#include "vm.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * A signature is a string of type codes: the return type, then one per
+ * parameter.  Every signature has its own trampoline, compiled in, that
+ * checks the arguments and makes the call with the C types spelled
+ * out; nothing is interpreted per call.
+ */
+#define CP_FFI_VOID 'v'
+#define CP_FFI_INT 'i'
+#define CP_FFI_LONG 'l'
+#define CP_FFI_DOUBLE 'd'
+#define CP_FFI_STRING 's'
+#define CP_FFI_MAX_PARAMS 3
+
+/*
+ * Returns -1 if an argument has the wrong type.  A string result is
+ * made by CPString_New() and belongs to the caller.
+ */
+typedef int (*CPFFITrampoline)(CPDynLibFunc function, const CPValue *args, CPValue *result);
+
+/* A NATIVES entry as the interpreter binds it on its first call. */
+struct CPNativeSlot
+{
+    CPDynLibFunc function;
+    CPFFITrampoline call;
+    uint32_t params;
+    void *library;
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The type code of the type named by the `length' bytes at `name':
+ * int, long, double, string, or void if `is_return' is set.  0 if none.
+ */
+char CPFFI_TypeCode(const char *name, size_t length, int is_return);
+/* The trampoline of `signature', or NULL if it is not a valid one. */
+CPFFITrampoline CPFFI_Trampoline(const char *signature);
+/*
+ * Load `library', look up `symbol' and pick the trampoline for
+ * `signature'.  Errors are reported.
+ */
+int CPFFI_Bind(CPNativeSlot *slot, const char *library, const char *symbol, const char *signature);
+/* Drop the library reference of a bound slot. */
+void CPFFI_Unbind(CPNativeSlot *slot);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_FFI_H_ */
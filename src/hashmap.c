@@ -0,0 +1,480 @@
+/*
+ * hashmap.c - open-addressing hash map with SIMD control-byte probing.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "hashmap.h"
+#include "cptypes.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHMAP_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#define CTRL_EMPTY 0x80
+#define CTRL_DELETED 0xFE
+#define MIN_CAPACITY 16
+
+/*
+ * Group operations.  Each returns a bit mask over the group; walk it
+ * with mask_index() and `mask &= mask - 1'.
+ */
+#ifdef HASHMAP_SSE2
+
+#define GROUP_SIZE 16
+
+typedef __m128i group_t;
+typedef uint32_t mask_t;
+
+static inline group_t
+group_load(const uint8_t *ctrl)
+{
+    return _mm_loadu_si128((const __m128i *)ctrl);
+}
+
+static inline mask_t
+group_match(group_t group, uint8_t h2)
+{
+    return (mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)h2)));
+}
+
+static inline mask_t
+group_empty(group_t group)
+{
+    return (mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(group, _mm_set1_epi8((char)CTRL_EMPTY)));
+}
+
+static inline mask_t
+group_free(group_t group)
+{
+    /* Empty and deleted are the only control bytes with the top bit set. */
+    return (mask_t)_mm_movemask_epi8(group);
+}
+
+#define MASK_SHIFT 0
+#define MASK_BIT(i) ((mask_t)1 << (i))
+
+#else /* !HASHMAP_SSE2 */
+
+/* Portable version: eight control bytes in a word, one flag bit per byte. */
+#define GROUP_SIZE 8
+
+typedef uint64_t group_t;
+typedef uint64_t mask_t;
+
+#define LSBS 0x0101010101010101ULL
+#define MSBS 0x8080808080808080ULL
+
+static inline group_t
+group_load(const uint8_t *ctrl)
+{
+    uint64_t group;
+    memcpy(&group, ctrl, sizeof(group));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    group = __builtin_bswap64(group);
+#endif
+    return group;
+}
+
+static inline mask_t
+group_match(group_t group, uint8_t h2)
+{
+    /* May report a false match next to a real one; keys are compared anyway. */
+    uint64_t x = group ^ (LSBS * h2);
+    return (x - LSBS) & ~x & MSBS;
+}
+
+static inline mask_t
+group_empty(group_t group)
+{
+    return group & ~(group << 6) & MSBS;
+}
+
+static inline mask_t
+group_free(group_t group)
+{
+    return group & MSBS;
+}
+
+#define MASK_SHIFT 3
+#define MASK_BIT(i) ((mask_t)0x80 << ((i) * 8))
+
+#endif /* HASHMAP_SSE2 */
+
+static inline size_t
+mask_index(mask_t mask)
+{
+#if defined(__GNUC__)
+    return (size_t)(sizeof(mask) == 8 ? __builtin_ctzll(mask) : __builtin_ctz((unsigned)mask)) >> MASK_SHIFT;
+#elif defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, (unsigned __int64)mask);
+    return (size_t)index >> MASK_SHIFT;
+#else
+    size_t index = 0;
+    while(!(mask & 1)) {
+        mask >>= 1;
+        index++;
+    }
+    return index >> MASK_SHIFT;
+#endif
+}
+
+/*
+ * Hashing: 64x64->128 multiply-and-fold, in the style of wyhash.
+ * Not cryptographic; good avalanche for short keys at a few cycles.
+ */
+#define K0 0xa0761d6478bd642fULL
+#define K1 0xe7037ed1a0b428dbULL
+#define K2 0x8ebc6af09c88c6e3ULL
+
+static inline uint64_t
+mix(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (uint64_t)r ^ (uint64_t)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+    uint64_t hi;
+    uint64_t lo = _umul128(a, b, &hi);
+    return lo ^ hi;
+#else
+    uint64_t ha = a >> 32, la = (uint32_t)a, hb = b >> 32, lb = (uint32_t)b;
+    uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    uint64_t t = rl + (rm0 << 32);
+    uint64_t c = t < rl;
+    uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+static inline uint64_t
+read64(const uint8_t *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t
+read32(const uint8_t *p)
+{
+    uint32_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint64_t
+CPHash_Bytes(const void *data, size_t length)
+{
+    const uint8_t *p = data;
+    uint64_t seed = K0 ^ length;
+    uint64_t a, b;
+    if(CP_LIKELY(length <= 16)) {
+        if(length >= 4) {
+            /* Two overlapping reads cover 4..16 bytes. */
+            size_t half = (length >> 3) << 2;
+            a = read32(p) << 32 | read32(p + half);
+            b = read32(p + length - 4) << 32 | read32(p + length - 4 - half);
+        } else if(length > 0) {
+            a = (uint64_t)p[0] << 16 | (uint64_t)p[length >> 1] << 8 | p[length - 1];
+            b = 0;
+        } else {
+            a = b = 0;
+        }
+    } else {
+        size_t i = length;
+        while(i > 16) {
+            seed = mix(read64(p) ^ K1, read64(p + 8) ^ seed);
+            p += 16;
+            i -= 16;
+        }
+        a = read64(p + i - 16);
+        b = read64(p + i - 8);
+    }
+    return mix(K1 ^ length, mix(a ^ K1, b ^ seed));
+}
+
+uint64_t
+CPHash_Int(uint64_t value)
+{
+    return mix(value ^ K0, K2);
+}
+
+static inline uint64_t
+hash_key(const CPHashMap *map, const void *key, size_t length)
+{
+    if(map->key_type == CP_HASHMAP_KEY_INTEGER) {
+        return CPHash_Int((uint64_t)(uintptr_t)key);
+    }
+    return CPHash_Bytes(key, length);
+}
+
+static inline int
+key_equal(const CPHashMap *map, const CPHashMapEntry *entry, const void *key, size_t length)
+{
+    if(map->key_type == CP_HASHMAP_KEY_INTEGER) {
+        return entry->key == key;
+    }
+    return entry->length == length && memcmp(entry->key, key, length) == 0;
+}
+
+/* The top 57 bits pick the first group; the low 7 go in the control byte. */
+#define H1(hash) ((size_t)((hash) >> 7))
+#define H2(hash) ((uint8_t)((hash) & 0x7F))
+
+static inline void
+set_ctrl(CPHashMap *map, size_t index, uint8_t value)
+{
+    map->ctrl[index] = value;
+    /* The first group is mirrored past the end so any group load is in bounds. */
+    if(index < GROUP_SIZE) {
+        map->ctrl[map->capacity + index] = value;
+    }
+}
+
+static inline size_t
+max_load(size_t capacity)
+{
+    return capacity - capacity / 8;
+}
+
+static int
+allocate(CPHashMap *map, size_t capacity)
+{
+    size_t entries_size = capacity * sizeof(CPHashMapEntry);
+    uint8_t *block = malloc(entries_size + capacity + GROUP_SIZE);
+    if(block == NULL) {
+        return -1;
+    }
+    map->entries = (CPHashMapEntry *)block;
+    map->ctrl = block + entries_size;
+    memset(map->ctrl, CTRL_EMPTY, capacity + GROUP_SIZE);
+    map->capacity = capacity;
+    map->size = 0;
+    map->growth_left = max_load(capacity);
+    return 0;
+}
+
+/* First empty or deleted slot on the probe sequence of `hash'. */
+static size_t
+find_free(const CPHashMap *map, uint64_t hash)
+{
+    size_t mask = map->capacity - 1;
+    size_t pos = H1(hash) & mask;
+    for(size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+        mask_t free_slots = group_free(group_load(map->ctrl + pos));
+        if(free_slots) {
+            return (pos + mask_index(free_slots)) & mask;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+static int
+resize(CPHashMap *map, size_t capacity)
+{
+    CPHashMap old = *map;
+    if(allocate(map, capacity) != 0) {
+        *map = old;
+        return -1;
+    }
+    for(size_t i = 0; i < old.capacity; i++) {
+        if(old.ctrl[i] & 0x80) {
+            continue;
+        }
+        const CPHashMapEntry *entry = &old.entries[i];
+        uint64_t hash = hash_key(map, entry->key, entry->length);
+        size_t index = find_free(map, hash);
+        set_ctrl(map, index, H2(hash));
+        map->entries[index] = *entry;
+    }
+    map->size = old.size;
+    map->growth_left -= old.size;
+    free(old.entries);
+    return 0;
+}
+
+/*
+ * Room for `expected' entries without growing.
+ */
+int
+CPHashMap_Init(CPHashMap *map, int key_type, size_t expected)
+{
+    size_t capacity = MIN_CAPACITY;
+    while(max_load(capacity) < expected) {
+        capacity *= 2;
+    }
+    map->key_type = key_type;
+    return allocate(map, capacity);
+}
+
+void
+CPHashMap_Destroy(CPHashMap *map)
+{
+    free(map->entries);
+    map->entries = NULL;
+    map->ctrl = NULL;
+    map->capacity = map->size = map->growth_left = 0;
+}
+
+void
+CPHashMap_Clear(CPHashMap *map)
+{
+    memset(map->ctrl, CTRL_EMPTY, map->capacity + GROUP_SIZE);
+    map->size = 0;
+    map->growth_left = max_load(map->capacity);
+}
+
+static inline CPHashMapEntry *
+find(const CPHashMap *map, const void *key, size_t length, uint64_t hash)
+{
+    size_t mask = map->capacity - 1;
+    size_t pos = H1(hash) & mask;
+    for(size_t step = GROUP_SIZE;; step += GROUP_SIZE) {
+        group_t group = group_load(map->ctrl + pos);
+        for(mask_t m = group_match(group, H2(hash)); m; m &= m - 1) {
+            CPHashMapEntry *entry = &map->entries[(pos + mask_index(m)) & mask];
+            if(CP_LIKELY(key_equal(map, entry, key, length))) {
+                return entry;
+            }
+        }
+        if(CP_LIKELY(group_empty(group))) {
+            return NULL;
+        }
+        pos = (pos + step) & mask;
+    }
+}
+
+CPHashMapEntry *
+CPHashMap_Find(const CPHashMap *map, const void *key, size_t length)
+{
+    return find(map, key, length, hash_key(map, key, length));
+}
+
+/*
+ * For callers that keep the hash next to the key.  `hash' must be what
+ * the map would compute: CPHash_Bytes() or CPHash_Int() of the key.
+ */
+CPHashMapEntry *
+CPHashMap_FindHashed(const CPHashMap *map, const void *key, size_t length, uint64_t hash)
+{
+    return find(map, key, length, hash);
+}
+
+/*
+ * Find the entry for `key', adding it with a NULL value if it is not
+ * there.  `*inserted' tells which happened.  NULL if out of memory.
+ */
+CPHashMapEntry *
+CPHashMap_Put(CPHashMap *map, const void *key, size_t length, int *inserted)
+{
+    return CPHashMap_PutHashed(map, key, length, hash_key(map, key, length), inserted);
+}
+
+CPHashMapEntry *
+CPHashMap_PutHashed(CPHashMap *map, const void *key, size_t length, uint64_t hash, int *inserted)
+{
+    CPHashMapEntry *entry = find(map, key, length, hash);
+    if(entry != NULL) {
+        if(inserted != NULL) {
+            *inserted = 0;
+        }
+        return entry;
+    }
+    size_t index = find_free(map, hash);
+    if(CP_UNLIKELY(map->growth_left == 0 && map->ctrl[index] == CTRL_EMPTY)) {
+        /* Out of empty slots: rehash, dropping tombstones, and grow if mostly live. */
+        size_t capacity = map->size > max_load(map->capacity) / 2 ? map->capacity * 2 : map->capacity;
+        if(resize(map, capacity) != 0) {
+            return NULL;
+        }
+        index = find_free(map, hash);
+    }
+    if(map->ctrl[index] == CTRL_EMPTY) {
+        map->growth_left--;
+    }
+    set_ctrl(map, index, H2(hash));
+    map->size++;
+    entry = &map->entries[index];
+    entry->key = key;
+    entry->length = length;
+    entry->value = NULL;
+    if(inserted != NULL) {
+        *inserted = 1;
+    }
+    return entry;
+}
+
+int
+CPHashMap_Remove(CPHashMap *map, const void *key, size_t length)
+{
+    CPHashMapEntry *entry = CPHashMap_Find(map, key, length);
+    if(entry == NULL) {
+        return -1;
+    }
+    size_t index = (size_t)(entry - map->entries);
+    /*
+     * A slot can go back to empty only if no probe sequence ever ran
+     * through it while the group was full, i.e. when the groups before
+     * and after it together still have an empty slot within reach.
+     */
+    size_t mask = map->capacity - 1;
+    mask_t before = group_empty(group_load(map->ctrl + ((index - GROUP_SIZE) & mask)));
+    mask_t after = group_empty(group_load(map->ctrl + index));
+    if(before && after) {
+        size_t trailing = mask_index(after);
+        size_t leading = 0;
+        for(size_t i = GROUP_SIZE; i-- > 0 && !(before & MASK_BIT(i));) {
+            leading++;
+        }
+        if(leading + trailing < GROUP_SIZE) {
+            set_ctrl(map, index, CTRL_EMPTY);
+            map->growth_left++;
+            map->size--;
+            return 0;
+        }
+    }
+    set_ctrl(map, index, CTRL_DELETED);
+    map->size--;
+    return 0;
+}
+
+/*
+ * Iterate with `size_t it = 0; while((e = CPHashMap_Next(map, &it)))'.
+ */
+CPHashMapEntry *
+CPHashMap_Next(const CPHashMap *map, size_t *iterator)
+{
+    for(size_t i = *iterator; i < map->capacity; i++) {
+        if(!(map->ctrl[i] & 0x80)) {
+            *iterator = i + 1;
+            return &map->entries[i];
+        }
+    }
+    *iterator = map->capacity;
+    return NULL;
+}
@@ -0,0 +1,78 @@
+/*
+ * hashmap.h - open-addressing hash map with SIMD control-byte probing.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_HASHMAP_H_
+#define _CP_HASHMAP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Keys are `length' bytes at `key', compared with memcmp(). */
+#define CP_HASHMAP_KEY_BYTES 0
+/* Keys are integers passed as (const void *)(uintptr_t)n; `length' is ignored. */
+#define CP_HASHMAP_KEY_INTEGER 1
+
+typedef struct
+{
+    const void *key;
+    size_t length;
+    void *value;
+} CPHashMapEntry;
+
+/*
+ * Every slot has a control byte: empty, deleted, or the low 7 bits of
+ * the key's hash.  A lookup loads a group of control bytes at once (16
+ * with SSE2, 8 otherwise), compares them all against those 7 bits and
+ * only touches the entries that match, so most probes never look at a
+ * key.  The map does not copy keys; they must outlive their entries.
+ */
+typedef struct
+{
+    uint8_t *ctrl;
+    CPHashMapEntry *entries;
+    size_t capacity;
+    size_t size;
+    size_t growth_left;
+    int key_type;
+} CPHashMap;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint64_t CPHash_Bytes(const void *data, size_t length);
+uint64_t CPHash_Int(uint64_t value);
+
+int CPHashMap_Init(CPHashMap *map, int key_type, size_t expected);
+void CPHashMap_Destroy(CPHashMap *map);
+void CPHashMap_Clear(CPHashMap *map);
+/*
+ * Pointers into the map stay valid until the next insertion.
+ */
+CPHashMapEntry *CPHashMap_Find(const CPHashMap *map, const void *key, size_t length);
+CPHashMapEntry *CPHashMap_FindHashed(const CPHashMap *map, const void *key, size_t length, uint64_t hash);
+CPHashMapEntry *CPHashMap_Put(CPHashMap *map, const void *key, size_t length, int *inserted);
+CPHashMapEntry *CPHashMap_PutHashed(CPHashMap *map, const void *key, size_t length, uint64_t hash, int *inserted);
+int CPHashMap_Remove(CPHashMap *map, const void *key, size_t length);
+CPHashMapEntry *CPHashMap_Next(const CPHashMap *map, size_t *iterator);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_HASHMAP_H_ */
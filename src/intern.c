@@ -0,0 +1,290 @@
+/*
+ * intern.c - process-wide string interning.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "intern.h"
+#include "bytecode.h"
+#include "hashmap.h"
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define INTERN_BIG_ENDIAN 1
+#endif
+
+/* Strings are bump-allocated from chunks and live until CPString_Reset(). */
+#define CHUNK_SIZE (64 * 1024)
+
+typedef union chunk
+{
+    union chunk *next;
+    uint64_t align;
+} chunk_t;
+
+#define RECORD_SIZE(length) CP_BYTECODE_ALIGN(offsetof(CPString, data) + (size_t)(length) + 1)
+
+static CPHashMap interned;
+static int initialized = 0;
+static chunk_t *chunks = NULL;
+static char *cursor = NULL;
+static size_t left = 0;
+
+static CPString *
+allocate(size_t length)
+{
+    size_t size = RECORD_SIZE(length);
+    if(size > left) {
+        /* Big strings get a chunk of their own and keep the current one. */
+        int own = size > CHUNK_SIZE / 4;
+        size_t chunk_size = sizeof(chunk_t) + (own ? size : CHUNK_SIZE);
+        chunk_t *chunk = malloc(chunk_size);
+        if(chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = chunks;
+        chunks = chunk;
+        if(own) {
+            return (CPString *)(chunk + 1);
+        }
+        cursor = (char *)(chunk + 1);
+        left = CHUNK_SIZE;
+    }
+    CPString *string = (CPString *)cursor;
+    cursor += size;
+    left -= size;
+    return string;
+}
+
+static int
+initialize(void)
+{
+    if(!initialized) {
+        if(CPHashMap_Init(&interned, CP_HASHMAP_KEY_BYTES, 1024) != 0) {
+            return -1;
+        }
+        initialized = 1;
+    }
+    return 0;
+}
+
+static const CPString *
+intern(const char *str, size_t length, uint64_t hash)
+{
+    int inserted;
+    CPHashMapEntry *entry = CPHashMap_PutHashed(&interned, str, length, hash, &inserted);
+    if(entry == NULL) {
+        return NULL;
+    }
+    if(!inserted) {
+        return entry->value;
+    }
+    CPString *string = allocate(length);
+    if(string == NULL) {
+        CPHashMap_Remove(&interned, str, length);
+        return NULL;
+    }
+    string->hash = hash;
+    string->length = (uint32_t)length;
+    string->flags = 0;
+    memcpy(string->data, str, length);
+    string->data[length] = '\0';
+    /* The key now points at the copy, not at the caller's buffer. */
+    entry->key = string->data;
+    entry->value = string;
+    return string;
+}
+
+/*
+ * Get the unique string equal to `length' bytes at `str'.  NULL if out
+ * of memory or longer than 4 GB.
+ */
+const CPString *
+CPString_Intern(const char *str, size_t length)
+{
+    if(length > UINT32_MAX || initialize() != 0) {
+        return NULL;
+    }
+    return intern(str, length, CPHash_Bytes(str, length));
+}
+
+const CPString *
+CPString_InternCString(const char *str)
+{
+    return CPString_Intern(str, strlen(str));
+}
+
+/*
+ * Get the interned string equal to `str' without adding it, e.g. to
+ * match keywords: a NULL result means `str' is none of them.
+ */
+const CPString *
+CPString_Lookup(const char *str, size_t length)
+{
+    if(!initialized) {
+        return NULL;
+    }
+    CPHashMapEntry *entry = CPHashMap_FindHashed(&interned, str, length, CPHash_Bytes(str, length));
+    return entry != NULL ? entry->value : NULL;
+}
+
+/*
+ * Forget every string.  Strings from loaded tables stay with their
+ * owners; everything else is freed.
+ */
+void
+CPString_Reset(void)
+{
+    while(chunks != NULL) {
+        chunk_t *next = chunks->next;
+        free(chunks);
+        chunks = next;
+    }
+    cursor = NULL;
+    left = 0;
+    if(initialized) {
+        CPHashMap_Destroy(&interned);
+        initialized = 0;
+    }
+}
+
+CPString *
+CPString_New(const char *str, size_t length)
+{
+    if(length > UINT32_MAX) {
+        return NULL;
+    }
+    CPString *string = CPSlab_Alloc(offsetof(CPString, data) + length + 1);
+    if(string == NULL) {
+        return NULL;
+    }
+    string->hash = CPHash_Bytes(str, length);
+    string->length = (uint32_t)length;
+    string->flags = CP_STRING_UNPOOLED;
+    memcpy(string->data, str, length);
+    string->data[length] = '\0';
+    return string;
+}
+
+void
+CPString_Free(CPString *string)
+{
+    CPSlab_Free(string, offsetof(CPString, data) + string->length + 1);
+}
+
+size_t
+CPString_TableSize(const CPString *const *strings, uint32_t count)
+{
+    size_t size = 8;
+    for(uint32_t i = 0; i < count; i++) {
+        size += RECORD_SIZE(strings[i]->length);
+    }
+    return size;
+}
+
+/* Write a string table; `dst' needs CPString_TableSize() bytes. */
+void
+CPString_WriteTable(void *dst, const CPString *const *strings, uint32_t count)
+{
+    unsigned char *p = dst;
+    CPBytecode_PutU32(p, count);
+    CPBytecode_PutU32(p + 4, 0);
+    p += 8;
+    for(uint32_t i = 0; i < count; i++) {
+        const CPString *string = strings[i];
+        size_t size = RECORD_SIZE(string->length);
+        CPBytecode_PutU64(p, string->hash);
+        CPBytecode_PutU32(p + 8, string->length);
+        CPBytecode_PutU32(p + 12, 0);
+        memcpy(p + offsetof(CPString, data), string->data, string->length);
+        memset(p + offsetof(CPString, data) + string->length, 0,
+               size - offsetof(CPString, data) - string->length);
+        p += size;
+    }
+}
+
+uint32_t
+CPString_TableCount(const void *table)
+{
+    return CPBytecode_GetU32(table);
+}
+
+/*
+ * Intern the strings of a table of `size' bytes, typically a section
+ * of a mapped .cpm file, and store the unique string for record i in
+ * `strings[i]'.  Records not seen before become the unique strings
+ * themselves: nothing is copied, so the table must stay mapped until
+ * CPString_Reset().  A stored hash is checked only when its string is
+ * new, since a hit on it has already proved it.
+ * A misaligned table, or any table on a big-endian host, is copied.
+ */
+int
+CPString_LoadTable(const void *table, size_t size, const CPString **strings, uint32_t max_strings)
+{
+    const unsigned char *p = table;
+    const unsigned char *end = p + size;
+    if(size < 8 || initialize() != 0) {
+        return -1;
+    }
+#ifdef INTERN_BIG_ENDIAN
+    /* Records are little-endian, so they cannot be used in place here. */
+    int in_place = 0;
+#else
+    int in_place = (uintptr_t)table % CP_BYTECODE_ALIGNMENT == 0;
+#endif
+    uint32_t count = CPBytecode_GetU32(p);
+    if(count > max_strings) {
+        return -1;
+    }
+    p += 8;
+    for(uint32_t i = 0; i < count; i++) {
+        if((size_t)(end - p) < offsetof(CPString, data)) {
+            return -1;
+        }
+        uint64_t hash = CPBytecode_GetU64(p);
+        uint32_t length = CPBytecode_GetU32(p + 8);
+        size_t record = RECORD_SIZE(length);
+        if((size_t)(end - p) < record || p[offsetof(CPString, data) + length] != '\0') {
+            return -1;
+        }
+        const char *data = (const char *)p + offsetof(CPString, data);
+        CPHashMapEntry *entry = CPHashMap_FindHashed(&interned, data, length, hash);
+        if(entry != NULL) {
+            strings[i] = entry->value;
+        } else if(CPHash_Bytes(data, length) != hash) {
+            /* Under a wrong hash the string would be interned twice. */
+            return -1;
+        } else if(in_place) {
+            int inserted;
+            entry = CPHashMap_PutHashed(&interned, data, length, hash, &inserted);
+            if(entry == NULL) {
+                return -1;
+            }
+            entry->value = (void *)p;
+            strings[i] = entry->value;
+        } else {
+            strings[i] = intern(data, length, hash);
+            if(strings[i] == NULL) {
+                return -1;
+            }
+        }
+        p += record;
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+/*
+ * intern.h - process-wide string interning.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_INTERN_H_
+#define _CP_INTERN_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * An interned string.  There is exactly one CPString per distinct byte
+ * sequence, so interned strings are equal iff their pointers are.
+ * `hash' is CPHash_Bytes() of the data, which is NUL-terminated.  The
+ * layout doubles as the record format of the bytecode string table.
+ */
+typedef struct
+{
+    uint64_t hash;
+    uint32_t length;
+    /* 0 in the pool and in string tables. */
+    uint32_t flags;
+    char data[];
+} CPString;
+
+/* Made by CPString_New(): outside the pool, so it may repeat a pooled string. */
+#define CP_STRING_UNPOOLED 0x1
+
+static inline int
+CPString_Equal(const CPString *a, const CPString *b)
+{
+    if(a == b) {
+        return 1;
+    }
+    return ((a->flags | b->flags) & CP_STRING_UNPOOLED) && a->hash == b->hash && a->length == b->length &&
+           memcmp(a->data, b->data, a->length) == 0;
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const CPString *CPString_Intern(const char *str, size_t length);
+const CPString *CPString_InternCString(const char *str);
+const CPString *CPString_Lookup(const char *str, size_t length);
+void CPString_Reset(void);
+/*
+ * A string outside the pool, for values made at run time that should not
+ * live until CPString_Reset().  Free it with CPString_Free().
+ */
+CPString *CPString_New(const char *str, size_t length);
+void CPString_Free(CPString *string);
+
+size_t CPString_TableSize(const CPString *const *strings, uint32_t count);
+void CPString_WriteTable(void *dst, const CPString *const *strings, uint32_t count);
+int CPString_LoadTable(const void *table, size_t size, const CPString **strings, uint32_t max_strings);
+uint32_t CPString_TableCount(const void *table);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_INTERN_H_ */
@@ -0,0 +1,212 @@
+/*
+ * lexer.c - tokenize CP source.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "lexer.h"
+
+#include <string.h>
+
+void
+CPLexer_Init(CPLexer *lexer, const char *source, size_t size)
+{
+    lexer->source = source;
+    lexer->cur = source;
+    lexer->end = source + size;
+    lexer->line = 1;
+}
+
+void
+CPLexer_Seek(CPLexer *lexer, size_t offset, uint32_t line)
+{
+    lexer->cur = lexer->source + offset;
+    lexer->line = line;
+}
+
+static inline int
+is_digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static inline int
+is_ident(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || is_digit(c);
+}
+
+static int
+keyword(const char *s, size_t length)
+{
+    static const struct
+    {
+        const char *name;
+        int kind;
+    } keywords[] = {
+        {"catch", CP_TOKEN_CATCH},
+        {"else", CP_TOKEN_ELSE},
+        {"func", CP_TOKEN_FUNC},
+        {"if", CP_TOKEN_IF},
+        {"import", CP_TOKEN_IMPORT},
+        {"native", CP_TOKEN_NATIVE},
+        {"print", CP_TOKEN_PRINT},
+        {"return", CP_TOKEN_RETURN},
+        {"throw", CP_TOKEN_THROW},
+        {"try", CP_TOKEN_TRY},
+        {"var", CP_TOKEN_VAR},
+        {"while", CP_TOKEN_WHILE},
+    };
+    for(size_t i = 0; i < sizeof(keywords) / sizeof(keywords[0]); i++) {
+        if(strlen(keywords[i].name) == length && memcmp(keywords[i].name, s, length) == 0) {
+            return keywords[i].kind;
+        }
+    }
+    return CP_TOKEN_IDENT;
+}
+
+static void
+skip_space(CPLexer *lexer)
+{
+    while(lexer->cur < lexer->end) {
+        char c = *lexer->cur;
+        if(c == '\n') {
+            lexer->line++;
+        } else if(c == '/' && lexer->cur + 1 < lexer->end && lexer->cur[1] == '/') {
+            while(lexer->cur < lexer->end && *lexer->cur != '\n') {
+                lexer->cur++;
+            }
+            continue;
+        } else if(c != ' ' && c != '\t' && c != '\r') {
+            return;
+        }
+        lexer->cur++;
+    }
+}
+
+static int
+number(CPLexer *lexer)
+{
+    const char *p = lexer->cur;
+    int kind = CP_TOKEN_INT;
+    while(p < lexer->end && is_digit(*p)) {
+        p++;
+    }
+    if(p + 1 < lexer->end && *p == '.' && is_digit(p[1])) {
+        kind = CP_TOKEN_FLOAT;
+        for(p++; p < lexer->end && is_digit(*p); p++);
+    }
+    if(p < lexer->end && (*p == 'e' || *p == 'E')) {
+        const char *q = p + 1;
+        if(q < lexer->end && (*q == '+' || *q == '-')) {
+            q++;
+        }
+        if(q < lexer->end && is_digit(*q)) {
+            kind = CP_TOKEN_FLOAT;
+            for(p = q; p < lexer->end && is_digit(*p); p++);
+        }
+    }
+    lexer->cur = p;
+    return kind;
+}
+
+static int
+string(CPLexer *lexer)
+{
+    const char *p = lexer->cur + 1;
+    while(p < lexer->end && *p != '"' && *p != '\n') {
+        if(*p == '\\' && p + 1 < lexer->end) {
+            p++;
+        }
+        p++;
+    }
+    if(p == lexer->end || *p != '"') {
+        lexer->cur = p;
+        return CP_TOKEN_ERROR;
+    }
+    lexer->cur = p + 1;
+    return CP_TOKEN_STRING;
+}
+
+/* A one-character token, or `two' if followed by '='. */
+static int
+operator(CPLexer *lexer, int one, int two)
+{
+    if(lexer->cur + 1 < lexer->end && lexer->cur[1] == '=') {
+        lexer->cur += 2;
+        return two;
+    }
+    lexer->cur++;
+    return one;
+}
+
+int
+CPLexer_Next(CPLexer *lexer, CPToken *token)
+{
+    skip_space(lexer);
+    token->start = lexer->cur;
+    token->line = lexer->line;
+    if(lexer->cur == lexer->end) {
+        token->length = 0;
+        return token->kind = CP_TOKEN_EOF;
+    }
+    char c = *lexer->cur;
+    int kind;
+    if(is_digit(c)) {
+        kind = number(lexer);
+    } else if(is_ident(c)) {
+        while(lexer->cur < lexer->end && is_ident(*lexer->cur)) {
+            lexer->cur++;
+        }
+        kind = keyword(token->start, (size_t)(lexer->cur - token->start));
+    } else if(c == '"') {
+        kind = string(lexer);
+    } else {
+        switch(c) {
+            case '<':
+                kind = operator(lexer, CP_TOKEN_LESS, CP_TOKEN_LESS_EQUAL);
+                break;
+            case '>':
+                kind = operator(lexer, CP_TOKEN_GREATER, CP_TOKEN_GREATER_EQUAL);
+                break;
+            case '=':
+                kind = operator(lexer, CP_TOKEN_ASSIGN, CP_TOKEN_EQUAL);
+                break;
+            case '!':
+                kind = operator(lexer, CP_TOKEN_ERROR, CP_TOKEN_NOT_EQUAL);
+                break;
+            default:
+                lexer->cur++;
+                switch(c) {
+                    case '(': kind = CP_TOKEN_LPAREN; break;
+                    case ')': kind = CP_TOKEN_RPAREN; break;
+                    case '{': kind = CP_TOKEN_LBRACE; break;
+                    case '}': kind = CP_TOKEN_RBRACE; break;
+                    case ',': kind = CP_TOKEN_COMMA; break;
+                    case '.': kind = CP_TOKEN_DOT; break;
+                    case ';': kind = CP_TOKEN_SEMICOLON; break;
+                    case '+': kind = CP_TOKEN_PLUS; break;
+                    case '-': kind = CP_TOKEN_MINUS; break;
+                    case '*': kind = CP_TOKEN_STAR; break;
+                    case '/': kind = CP_TOKEN_SLASH; break;
+                    default: kind = CP_TOKEN_ERROR; break;
+                }
+                break;
+        }
+    }
+    token->length = (size_t)(lexer->cur - token->start);
+    return token->kind = kind;
+}
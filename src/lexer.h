@@ -0,0 +1,98 @@
+/*
+ * lexer.h - tokenize CP source.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_LEXER_H_
+#define _CP_LEXER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum
+{
+    CP_TOKEN_EOF,
+    /* A character no token starts with, or an unterminated string. */
+    CP_TOKEN_ERROR,
+    CP_TOKEN_IDENT,
+    CP_TOKEN_INT,
+    CP_TOKEN_FLOAT,
+    CP_TOKEN_STRING,
+    /* Keywords */
+    CP_TOKEN_CATCH,
+    CP_TOKEN_ELSE,
+    CP_TOKEN_FUNC,
+    CP_TOKEN_IF,
+    CP_TOKEN_IMPORT,
+    CP_TOKEN_NATIVE,
+    CP_TOKEN_PRINT,
+    CP_TOKEN_RETURN,
+    CP_TOKEN_THROW,
+    CP_TOKEN_TRY,
+    CP_TOKEN_VAR,
+    CP_TOKEN_WHILE,
+    /* Punctuation */
+    CP_TOKEN_LPAREN,
+    CP_TOKEN_RPAREN,
+    CP_TOKEN_LBRACE,
+    CP_TOKEN_RBRACE,
+    CP_TOKEN_COMMA,
+    CP_TOKEN_DOT,
+    CP_TOKEN_SEMICOLON,
+    CP_TOKEN_ASSIGN,
+    CP_TOKEN_PLUS,
+    CP_TOKEN_MINUS,
+    CP_TOKEN_STAR,
+    CP_TOKEN_SLASH,
+    CP_TOKEN_LESS,
+    CP_TOKEN_LESS_EQUAL,
+    CP_TOKEN_GREATER,
+    CP_TOKEN_GREATER_EQUAL,
+    CP_TOKEN_EQUAL,
+    CP_TOKEN_NOT_EQUAL,
+};
+
+/* `start' points into the source; string tokens include their quotes. */
+typedef struct
+{
+    int kind;
+    uint32_t line;
+    const char *start;
+    size_t length;
+} CPToken;
+
+typedef struct
+{
+    const char *source;
+    const char *cur;
+    const char *end;
+    uint32_t line;
+} CPLexer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void CPLexer_Init(CPLexer *lexer, const char *source, size_t size);
+/* Continue from byte `offset' of the source, which is on line `line'. */
+void CPLexer_Seek(CPLexer *lexer, size_t offset, uint32_t line);
+int CPLexer_Next(CPLexer *lexer, CPToken *token);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_LEXER_H_ */
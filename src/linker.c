@@ -0,0 +1,317 @@
+/*
+ * linker.c - merge .cpm modules into one image.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "linker.h"
+#include "module.h"
+#include "opcode.h"
+#include "report_error.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define UNREACHED 0xFFFFFFFFu
+
+/*
+ * Functions are numbered globally, module by module: function i of
+ * module m is base[m] + i.  `order' lists the reached ones in the order
+ * they are first reached, which is their index in the output.
+ */
+typedef struct
+{
+    int count;
+    CPModule *modules;
+    const CPString **names;
+    /* Function name to index + 1, one map per module. */
+    CPHashMap *exports;
+    uint32_t *base;
+    uint32_t total;
+    uint32_t *owner;
+    uint32_t *new_index;
+    uint32_t *order;
+    uint32_t reached;
+} linker_t;
+
+static int
+open_modules(linker_t *linker, const char * const *inputs)
+{
+    for(int m = 0; m < linker->count; m++) {
+        CPModule *module = &linker->modules[m];
+        if(CPModule_Open(module, inputs[m]) != 0) {
+            cp_report_error("Cannot load module '%s'.", inputs[m]);
+            return -1;
+        }
+        linker->names[m] = CPModule_NameFromPath(inputs[m]);
+        if(linker->names[m] == NULL) {
+            return -1;
+        }
+        for(int i = 0; i < m; i++) {
+            if(linker->names[i] == linker->names[m]) {
+                cp_report_error("Modules '%s' and '%s' have the same name.", inputs[i], inputs[m]);
+                return -1;
+            }
+        }
+        if(CPHashMap_Init(&linker->exports[m], CP_HASHMAP_KEY_INTEGER, module->function_count) != 0) {
+            return -1;
+        }
+        /* The first function of a name is the one imports refer to. */
+        for(uint32_t i = 0; i < module->function_count; i++) {
+            int inserted;
+            CPHashMapEntry *entry = CPHashMap_Put(&linker->exports[m], module->functions[i].name, 0, &inserted);
+            if(entry == NULL) {
+                return -1;
+            }
+            if(inserted) {
+                entry->value = (void *)(uintptr_t)(i + 1);
+            }
+        }
+        if(module->function_count > UINT32_MAX - linker->total) {
+            return -1;
+        }
+        linker->base[m] = linker->total;
+        linker->total += module->function_count;
+    }
+    return 0;
+}
+
+/* The global number of the function a FUNCTION operand of module `m' refers to. */
+static int
+resolve(const linker_t *linker, uint32_t m, uint32_t operand, uint32_t *function)
+{
+    const CPModule *module = &linker->modules[m];
+    if(!(operand & CP_BYTECODE_IMPORT_BIT)) {
+        *function = linker->base[m] + operand;
+        return 0;
+    }
+    uint32_t i = operand & ~CP_BYTECODE_IMPORT_BIT;
+    const CPString *target = CPModule_ImportModule(module, i);
+    const CPString *name = CPModule_ImportName(module, i);
+    for(int t = 0; t < linker->count; t++) {
+        if(linker->names[t] != target) {
+            continue;
+        }
+        CPHashMapEntry *entry = CPHashMap_Find(&linker->exports[t], name, 0);
+        if(entry == NULL) {
+            break;
+        }
+        *function = linker->base[t] + (uint32_t)(uintptr_t)entry->value - 1;
+        uint32_t params = linker->modules[t].functions[*function - linker->base[t]].params;
+        if(CPModule_ImportParams(module, i) != params) {
+            cp_report_error("Function '%s.%s' takes %u arguments, not %u as called from module '%s'.",
+                            target->data, name->data, params, CPModule_ImportParams(module, i),
+                            linker->names[m]->data);
+            return -1;
+        }
+        return 0;
+    }
+    cp_report_error("Undefined function '%s.%s' referenced from module '%s'.",
+                    target->data, name->data, linker->names[m]->data);
+    return -1;
+}
+
+static void
+reach(linker_t *linker, uint32_t function)
+{
+    if(linker->new_index[function] == UNREACHED) {
+        linker->new_index[function] = linker->reached;
+        linker->order[linker->reached++] = function;
+    }
+}
+
+/* Walk the call graph breadth-first from the entry point. */
+static int
+mark(linker_t *linker)
+{
+    const CPModule *first = &linker->modules[0];
+    if(first->entry == CP_BYTECODE_NO_ENTRY) {
+        cp_report_error("Module '%s' has no entry point.", linker->names[0]->data);
+        return -1;
+    }
+    for(uint32_t g = 0; g < linker->total; g++) {
+        linker->new_index[g] = UNREACHED;
+    }
+    for(int m = 0; m < linker->count; m++) {
+        for(uint32_t i = 0; i < linker->modules[m].function_count; i++) {
+            linker->owner[linker->base[m] + i] = (uint32_t)m;
+        }
+    }
+    reach(linker, linker->base[0] + first->entry);
+    for(uint32_t next = 0; next < linker->reached; next++) {
+        uint32_t g = linker->order[next];
+        uint32_t m = linker->owner[g];
+        const CPModule *module = &linker->modules[m];
+        if(CPModule_Verify(module, g - linker->base[m]) != 0) {
+            cp_report_error("Invalid code in function '%s' of module '%s'.",
+                            module->functions[g - linker->base[m]].name->data, linker->names[m]->data);
+            return -1;
+        }
+        const CPModuleFunction *function = &module->functions[g - linker->base[m]];
+        for(size_t pc = 0; pc < function->code_size; pc += CPOpcode_Length(function->code[pc])) {
+            unsigned char op = function->code[pc];
+            if(cp_opcodes[op].operand == CP_OPERAND_FUNCTION) {
+                uint32_t target;
+                if(resolve(linker, m, CPBytecode_GetU32(function->code + pc + 1), &target) != 0) {
+                    return -1;
+                }
+                reach(linker, target);
+            }
+        }
+    }
+    return 0;
+}
+
+/* Rewrite the operands of a copy of the code against the builder's tables. */
+static int
+relocate(const linker_t *linker, CPModuleBuilder *builder, uint32_t m, unsigned char *code, size_t size)
+{
+    const CPModule *module = &linker->modules[m];
+    for(size_t pc = 0; pc < size; pc += CPOpcode_Length(code[pc])) {
+        unsigned char op = code[pc];
+        unsigned char *operand = code + pc + 1;
+        uint32_t value, index;
+        switch(cp_opcodes[op].operand) {
+            case CP_OPERAND_STRING:
+                value = CPBytecode_GetU32(operand);
+                if(CPModuleBuilder_String(builder, module->strings[value], &index) != 0) {
+                    return -1;
+                }
+                break;
+            case CP_OPERAND_CONST:
+                value = CPBytecode_GetU32(operand);
+                if(CPModuleBuilder_Constant(builder, CPModule_ConstantKind(module, value),
+                                            CPModule_ConstantValue(module, value), &index) != 0) {
+                    return -1;
+                }
+                break;
+            case CP_OPERAND_GLOBAL:
+                value = CPBytecode_GetU32(operand);
+                if(CPModuleBuilder_Global(builder, CPModule_GlobalName(module, value), &index) != 0) {
+                    return -1;
+                }
+                break;
+            case CP_OPERAND_NATIVE:
+                value = CPBytecode_GetU32(operand);
+                if(CPModuleBuilder_Native(builder, CPModule_Native(module, value, 0), CPModule_Native(module, value, 1),
+                                          CPModule_Native(module, value, 2), &index) != 0) {
+                    return -1;
+                }
+                break;
+            case CP_OPERAND_FUNCTION:
+                if(resolve(linker, m, CPBytecode_GetU32(operand), &value) != 0) {
+                    return -1;
+                }
+                index = linker->new_index[value];
+                break;
+            default:
+                continue;
+        }
+        CPBytecode_PutU32(operand, index);
+    }
+    return 0;
+}
+
+static int
+emit(const linker_t *linker, const char *output, CPLinkerStats *stats)
+{
+    CPModuleBuilder builder;
+    if(CPModuleBuilder_Init(&builder) != 0) {
+        return -1;
+    }
+    int rv = -1;
+    unsigned char *code = NULL;
+    for(uint32_t next = 0; next < linker->reached; next++) {
+        uint32_t g = linker->order[next];
+        uint32_t m = linker->owner[g];
+        const CPModuleFunction *function = &linker->modules[m].functions[g - linker->base[m]];
+        unsigned char *p = realloc(code, function->code_size ? function->code_size : 1);
+        if(p == NULL) {
+            goto end;
+        }
+        code = p;
+        memcpy(code, function->code, function->code_size);
+        uint32_t index;
+        if(relocate(linker, &builder, m, code, function->code_size) != 0 ||
+           CPModuleBuilder_Function(&builder, function->name, function->params, function->locals,
+                                    code, function->code_size, &index) != 0 ||
+           CPModuleBuilder_Handlers(&builder, index, function->handlers, function->handler_count) != 0) {
+            goto end;
+        }
+    }
+    builder.entry = 0;
+    if(CPModuleBuilder_Write(&builder, output) != 0) {
+        cp_report_error("Cannot write output '%s'.", output);
+        goto end;
+    }
+    if(stats != NULL) {
+        stats->functions_in = linker->total;
+        stats->functions_out = builder.function_count;
+        stats->strings_out = builder.string_count;
+        stats->constants_out = builder.constant_count;
+    }
+    rv = 0;
+end:
+    free(code);
+    CPModuleBuilder_Destroy(&builder);
+    return rv;
+}
+
+int
+CPLinker_Link(const char *output, const char * const *inputs, int count, CPLinkerStats *stats)
+{
+    linker_t linker;
+    memset(&linker, 0, sizeof(linker));
+    if(count <= 0) {
+        return -1;
+    }
+    int rv = -1;
+    linker.count = count;
+    linker.modules = calloc((size_t)count, sizeof(CPModule));
+    linker.names = calloc((size_t)count, sizeof(CPString *));
+    linker.exports = calloc((size_t)count, sizeof(CPHashMap));
+    linker.base = calloc((size_t)count, sizeof(uint32_t));
+    if(linker.modules == NULL || linker.names == NULL || linker.exports == NULL || linker.base == NULL ||
+       open_modules(&linker, inputs) != 0) {
+        goto end;
+    }
+    size_t total = linker.total ? linker.total : 1;
+    linker.owner = malloc(total * sizeof(uint32_t));
+    linker.new_index = malloc(total * sizeof(uint32_t));
+    linker.order = malloc(total * sizeof(uint32_t));
+    if(linker.owner == NULL || linker.new_index == NULL || linker.order == NULL ||
+       mark(&linker) != 0 || emit(&linker, output, stats) != 0) {
+        goto end;
+    }
+    rv = 0;
+end:
+    /* The interned strings point into the mappings; drop them first. */
+    CPString_Reset();
+    for(int m = 0; linker.modules != NULL && m < count; m++) {
+        CPModule_Close(&linker.modules[m]);
+        if(linker.exports != NULL) {
+            CPHashMap_Destroy(&linker.exports[m]);
+        }
+    }
+    free(linker.modules);
+    free(linker.names);
+    free(linker.exports);
+    free(linker.base);
+    free(linker.owner);
+    free(linker.new_index);
+    free(linker.order);
+    return rv;
+}
@@ -0,0 +1,53 @@
+/*
+ * linker.h - merge .cpm modules into one image.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_LINKER_H_
+#define _CP_LINKER_H_
+
+#include <stdint.h>
+
+typedef struct
+{
+    uint32_t functions_in;
+    uint32_t functions_out;
+    uint32_t strings_out;
+    uint32_t constants_out;
+} CPLinkerStats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Link the modules `inputs' into the image `output'.  The entry point
+ * of inputs[0] is the entry point of the image, and only functions it
+ * reaches are kept.  Imports name a module by its file name without
+ * directory or extension; they become direct function indices, so the
+ * output has no IMPORTS section.  Strings and constants are merged
+ * into one table each.
+ *
+ * The inputs' strings are interned for the duration of the call, and
+ * CPString_Reset() is called before returning.  `stats' may be NULL.
+ */
+int CPLinker_Link(const char *output, const char * const *inputs, int count, CPLinkerStats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_LINKER_H_ */
@@ -0,0 +1,849 @@
+/*
+ * module.c - reading and building .cpm modules.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "module.h"
+#include "opcode.h"
+#include "bytecode_writer.h"
+#include "path.h"
+#include "trace.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    const unsigned char *data;
+    size_t size;
+} section_t;
+
+/* A table section: count:u32 x:u32, then `count' records of `record' bytes. */
+static int
+table(const section_t *section, size_t record, uint32_t *count)
+{
+    if(section->size < 8) {
+        return -1;
+    }
+    *count = CPBytecode_GetU32(section->data);
+    if(*count > (section->size - 8) / record) {
+        return -1;
+    }
+    return 0;
+}
+
+static int
+load_sections(CPModule *module, section_t *sections)
+{
+    const unsigned char *image = module->image;
+    if(module->size < CP_BYTECODE_HEADER_SIZE ||
+       memcmp(image, CP_BYTECODE_MAGIC_NUMBER, CP_BYTECODE_MAGIC_NUMBER_SIZE) != 0 ||
+       CPBytecode_GetU32(image + 4) != CP_BYTECODE_VERSION_MAJOR) {
+        return -1;
+    }
+    uint32_t count = CPBytecode_GetU32(image + 12);
+    if(count > (module->size - CP_BYTECODE_HEADER_SIZE) / CP_BYTECODE_ENTRY_SIZE) {
+        return -1;
+    }
+    for(uint32_t i = 0; i < count; i++) {
+        const unsigned char *entry = image + CP_BYTECODE_HEADER_SIZE + (size_t)i * CP_BYTECODE_ENTRY_SIZE;
+        uint32_t kind = CPBytecode_GetU32(entry);
+        uint64_t offset = CPBytecode_GetU64(entry + 8);
+        uint64_t size = CPBytecode_GetU64(entry + 16);
+        if(offset > module->size || size > module->size - offset) {
+            return -1;
+        }
+        /* Unknown kinds are skipped, for images from newer minor versions. */
+        if(kind <= CP_BYTECODE_SECTION_NATIVES) {
+            sections[kind].data = image + offset;
+            sections[kind].size = (size_t)size;
+        }
+    }
+    return 0;
+}
+
+static int
+load_functions(CPModule *module, const section_t *section, const section_t *code)
+{
+    uint32_t count;
+    if(section->data == NULL) {
+        return 0;
+    }
+    if(table(section, CP_BYTECODE_FUNCTION_SIZE, &count) != 0) {
+        return -1;
+    }
+    module->entry = CPBytecode_GetU32(section->data + 4);
+    if(module->entry != CP_BYTECODE_NO_ENTRY && module->entry >= count) {
+        return -1;
+    }
+    module->functions = malloc((count ? count : 1) * sizeof(CPModuleFunction));
+    if(module->functions == NULL) {
+        return -1;
+    }
+    module->function_count = count;
+    for(uint32_t i = 0; i < count; i++) {
+        const unsigned char *record = section->data + 8 + (size_t)i * CP_BYTECODE_FUNCTION_SIZE;
+        uint32_t name = CPBytecode_GetU32(record);
+        uint32_t params_locals = CPBytecode_GetU32(record + 4);
+        uint32_t offset = CPBytecode_GetU32(record + 8);
+        uint32_t size = CPBytecode_GetU32(record + 12);
+        if(name >= module->string_count || offset > code->size || size > code->size - offset) {
+            return -1;
+        }
+        CPModuleFunction *function = &module->functions[i];
+        function->name = module->strings[name];
+        function->params = (uint16_t)params_locals;
+        function->locals = (uint16_t)(params_locals >> 16);
+        function->code = code->data + offset;
+        function->code_size = size;
+        function->handler_count = 0;
+        function->handlers = NULL;
+        if(function->params > function->locals) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static int
+load_handlers(CPModule *module, const section_t *section)
+{
+    uint32_t count;
+    if(section->data == NULL) {
+        return 0;
+    }
+    if(table(section, CP_BYTECODE_HANDLER_SIZE, &count) != 0) {
+        return -1;
+    }
+    const unsigned char *records = section->data + 8;
+    uint32_t last = 0;
+    for(uint32_t i = 0; i < count; i++) {
+        const unsigned char *record = records + (size_t)i * CP_BYTECODE_HANDLER_SIZE;
+        uint32_t index = CPBytecode_GetU32(record);
+        uint32_t start = CPBytecode_GetU32(record + 4);
+        uint32_t end = CPBytecode_GetU32(record + 8);
+        uint32_t handler = CPBytecode_GetU32(record + 12);
+        if(index >= module->function_count || index < last) {
+            return -1;
+        }
+        CPModuleFunction *function = &module->functions[index];
+        if(start > end || end > function->code_size || handler >= function->code_size) {
+            return -1;
+        }
+        if(function->handlers == NULL) {
+            function->handlers = record;
+        }
+        function->handler_count++;
+        last = index;
+    }
+    return 0;
+}
+
+/*
+ * Sections are checked as they are indexed; instructions are left to
+ * CPModule_Verify().
+ */
+int
+CPModule_Load(CPModule *module, const void *image, size_t size)
+{
+    section_t sections[CP_BYTECODE_SECTION_NATIVES + 1];
+    CPTrace_Begin("module.load");
+    memset(module, 0, sizeof(CPModule));
+    memset(sections, 0, sizeof(sections));
+    module->image = image;
+    module->size = size;
+    module->entry = CP_BYTECODE_NO_ENTRY;
+    if(load_sections(module, sections) != 0) {
+        goto error;
+    }
+
+    const section_t *strings = &sections[CP_BYTECODE_SECTION_STRINGS];
+    if(strings->data != NULL) {
+        if(strings->size < 8) {
+            goto error;
+        }
+        uint32_t count = CPString_TableCount(strings->data);
+        if(count > strings->size / 8) {
+            goto error;
+        }
+        module->strings = malloc((count ? count : 1) * sizeof(CPString *));
+        if(module->strings == NULL ||
+           CPString_LoadTable(strings->data, strings->size, module->strings, count) != 0) {
+            goto error;
+        }
+        module->string_count = count;
+    }
+
+    const section_t *constants = &sections[CP_BYTECODE_SECTION_CONSTANTS];
+    if(constants->data != NULL) {
+        if(table(constants, CP_BYTECODE_CONSTANT_SIZE, &module->constant_count) != 0) {
+            goto error;
+        }
+        module->constants = constants->data + 8;
+    }
+
+    const section_t *imports = &sections[CP_BYTECODE_SECTION_IMPORTS];
+    if(imports->data != NULL) {
+        if(table(imports, CP_BYTECODE_IMPORT_SIZE, &module->import_count) != 0) {
+            goto error;
+        }
+        module->imports = imports->data + 8;
+        for(uint32_t i = 0; i < module->import_count; i++) {
+            const unsigned char *record = module->imports + (size_t)i * CP_BYTECODE_IMPORT_SIZE;
+            if(CPBytecode_GetU32(record) >= module->string_count ||
+               CPBytecode_GetU32(record + 4) >= module->string_count) {
+                goto error;
+            }
+        }
+    }
+
+    const section_t *globals = &sections[CP_BYTECODE_SECTION_GLOBALS];
+    if(globals->data != NULL) {
+        if(table(globals, CP_BYTECODE_GLOBAL_SIZE, &module->global_count) != 0) {
+            goto error;
+        }
+        module->globals = globals->data + 8;
+        for(uint32_t i = 0; i < module->global_count; i++) {
+            if(CPBytecode_GetU32(module->globals + (size_t)i * CP_BYTECODE_GLOBAL_SIZE) >= module->string_count) {
+                goto error;
+            }
+        }
+    }
+
+    const section_t *natives = &sections[CP_BYTECODE_SECTION_NATIVES];
+    if(natives->data != NULL) {
+        if(table(natives, CP_BYTECODE_NATIVE_SIZE, &module->native_count) != 0) {
+            goto error;
+        }
+        module->natives = natives->data + 8;
+        for(uint32_t i = 0; i < module->native_count; i++) {
+            const unsigned char *record = module->natives + (size_t)i * CP_BYTECODE_NATIVE_SIZE;
+            if(CPBytecode_GetU32(record) >= module->string_count ||
+               CPBytecode_GetU32(record + 4) >= module->string_count ||
+               CPBytecode_GetU32(record + 8) >= module->string_count) {
+                goto error;
+            }
+        }
+    }
+
+    if(load_functions(module, &sections[CP_BYTECODE_SECTION_FUNCTIONS],
+                      &sections[CP_BYTECODE_SECTION_CODE]) != 0 ||
+       load_handlers(module, &sections[CP_BYTECODE_SECTION_HANDLERS]) != 0) {
+        goto error;
+    }
+    CPTrace_End("module.load");
+    return 0;
+error:
+    CPModule_Close(module);
+    CPTrace_End("module.load");
+    return -1;
+}
+
+int
+CPModule_Open(CPModule *module, const char *path)
+{
+    CPMemoryMapping mapping;
+    size_t size;
+    FILE *file = fopen(path, "rb");
+    if(file == NULL) {
+        memset(module, 0, sizeof(CPModule));
+        return -1;
+    }
+    int rv = -1;
+    if(CPMemoryMapping_FileSize(file, &size) == 0 && size >= CP_BYTECODE_HEADER_SIZE &&
+       CPMemoryMapping_Create(&mapping, file, size, 0, CP_MMAP_PROT_READ, CP_MMAP_FLAG_PRIVATE) == 0) {
+        rv = CPModule_Load(module, mapping.addr, size);
+        if(rv == 0) {
+            module->mapping = mapping;
+            module->mapped = 1;
+        } else {
+            CPMemoryMapping_Destroy(&mapping);
+        }
+    } else {
+        memset(module, 0, sizeof(CPModule));
+    }
+    fclose(file);
+    return rv;
+}
+
+void
+CPModule_Close(CPModule *module)
+{
+    free(module->strings);
+    free(module->functions);
+    if(module->mapped) {
+        CPMemoryMapping_Destroy(&module->mapping);
+    }
+    memset(module, 0, sizeof(CPModule));
+}
+
+#define UNVISITED UINT32_MAX
+
+typedef struct
+{
+    size_t size;
+    unsigned char *starts;  /* one bit per byte of code, set where an instruction starts */
+    uint32_t *depth;        /* operand stack depth before each instruction */
+    uint32_t *work;
+    uint32_t work_count;
+} verify_t;
+
+/* Control reaches `target' with `depth' operands on the stack. */
+static int
+flow_to(verify_t *v, size_t target, uint32_t depth)
+{
+    if(target >= v->size || !(v->starts[target / 8] & (1u << (target % 8)))) {
+        return -1;
+    }
+    if(v->depth[target] == UNVISITED) {
+        v->depth[target] = depth;
+        v->work[v->work_count++] = (uint32_t)target;
+        return 0;
+    }
+    /* Paths that meet must agree, or a later pop could reach the locals. */
+    return v->depth[target] == depth ? 0 : -1;
+}
+
+static uint32_t
+callee_params(const CPModule *module, uint32_t operand)
+{
+    if(operand & CP_BYTECODE_IMPORT_BIT) {
+        return CPModule_ImportParams(module, operand & ~CP_BYTECODE_IMPORT_BIT);
+    }
+    return module->functions[operand].params;
+}
+
+/* Follow every path from the entry and the handlers, tracking the stack depth. */
+static int
+check_flow(const CPModule *module, const CPModuleFunction *function, verify_t *v)
+{
+    const unsigned char *code = function->code;
+    if(flow_to(v, 0, 0) != 0) {
+        return -1;
+    }
+    for(uint32_t i = 0; i < function->handler_count; i++) {
+        /* A handler starts with only the exception above the locals. */
+        const unsigned char *record = function->handlers + (size_t)i * CP_BYTECODE_HANDLER_SIZE;
+        if(flow_to(v, CPBytecode_GetU32(record + 12), 1) != 0) {
+            return -1;
+        }
+    }
+    while(v->work_count > 0) {
+        uint32_t pc = v->work[--v->work_count];
+        unsigned char op = code[pc];
+        uint32_t operand = cp_opcodes[op].operand != CP_OPERAND_NONE ? CPBytecode_GetU32(code + pc + 1) : 0;
+        uint32_t depth = v->depth[pc], pops = 0, pushes = 0;
+        int falls_through = 1;
+        switch(op) {
+            case CP_OP_LOAD_CONST:
+            case CP_OP_LOAD_STRING:
+            case CP_OP_LOAD_LOCAL:
+            case CP_OP_LOAD_GLOBAL:
+            case CP_OP_LOAD_GLOBAL_SLOT:
+            case CP_OP_LOAD_FUNCTION:
+                pushes = 1;
+                break;
+            case CP_OP_STORE_LOCAL:
+            case CP_OP_STORE_GLOBAL:
+            case CP_OP_STORE_GLOBAL_SLOT:
+            case CP_OP_POP:
+            case CP_OP_PRINT:
+            case CP_OP_JUMP_IF_FALSE:
+                pops = 1;
+                break;
+            case CP_OP_ADD:
+            case CP_OP_SUB:
+            case CP_OP_MUL:
+            case CP_OP_DIV:
+            case CP_OP_LESS:
+            case CP_OP_LESS_EQUAL:
+            case CP_OP_EQUAL:
+                pops = 2;
+                pushes = 1;
+                break;
+            case CP_OP_NOT:
+                pops = 1;
+                pushes = 1;
+                break;
+            case CP_OP_CALL:
+                pops = callee_params(module, operand);
+                pushes = 1;
+                break;
+            case CP_OP_TAIL_CALL:
+                pops = callee_params(module, operand);
+                falls_through = 0;
+                break;
+            case CP_OP_CALL_NATIVE: {
+                /* The signature is the result type and then one type per parameter. */
+                uint32_t length = CPModule_Native(module, operand, 2)->length;
+                if(length == 0) {
+                    return -1;
+                }
+                pops = length - 1;
+                pushes = 1;
+                break;
+            }
+            case CP_OP_RETURN:
+            case CP_OP_THROW:
+                pops = 1;
+                falls_through = 0;
+                break;
+            case CP_OP_JUMP:
+                falls_through = 0;
+                break;
+            default:
+                break;
+        }
+        if(depth < pops) {
+            return -1;
+        }
+        depth = depth - pops + pushes;
+        if((op == CP_OP_JUMP || op == CP_OP_JUMP_IF_FALSE) && flow_to(v, operand, depth) != 0) {
+            return -1;
+        }
+        /* Running past the last instruction fails here too. */
+        if(falls_through && flow_to(v, pc + CPOpcode_Length(op), depth) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int
+CPModule_Verify(const CPModule *module, uint32_t index)
+{
+    const CPModuleFunction *function = &module->functions[index];
+    const unsigned char *code = function->code;
+    size_t size = function->code_size;
+    verify_t v;
+    v.size = size;
+    v.work_count = 0;
+    v.starts = calloc(size / 8 + 1, 1);
+    v.depth = malloc((size ? size : 1) * sizeof(uint32_t));
+    v.work = malloc((size ? size : 1) * sizeof(uint32_t));
+    int rv = -1;
+    if(v.starts == NULL || v.depth == NULL || v.work == NULL) {
+        goto end;
+    }
+    for(size_t pc = 0; pc < size; ) {
+        unsigned char op = code[pc];
+        if(op >= CP_OP_COUNT || CPOpcode_Length(op) > size - pc) {
+            goto end;
+        }
+        uint32_t operand = 0;
+        if(cp_opcodes[op].operand != CP_OPERAND_NONE) {
+            operand = CPBytecode_GetU32(code + pc + 1);
+        }
+        int valid = 1;
+        switch(cp_opcodes[op].operand) {
+            case CP_OPERAND_INDEX:
+                valid = operand < function->locals;
+                break;
+            case CP_OPERAND_JUMP:
+                valid = operand < size;
+                break;
+            case CP_OPERAND_CONST:
+                valid = operand < module->constant_count;
+                break;
+            case CP_OPERAND_STRING:
+                valid = operand < module->string_count;
+                break;
+            case CP_OPERAND_GLOBAL:
+                valid = operand < module->global_count;
+                break;
+            case CP_OPERAND_NATIVE:
+                valid = operand < module->native_count;
+                break;
+            case CP_OPERAND_FUNCTION:
+                if(operand & CP_BYTECODE_IMPORT_BIT) {
+                    valid = (operand & ~CP_BYTECODE_IMPORT_BIT) < module->import_count;
+                } else {
+                    valid = operand < module->function_count;
+                }
+                break;
+            default:
+                break;
+        }
+        if(!valid) {
+            goto end;
+        }
+        v.starts[pc / 8] |= (unsigned char)(1u << (pc % 8));
+        v.depth[pc] = UNVISITED;
+        pc += CPOpcode_Length(op);
+    }
+    rv = check_flow(module, function, &v);
+end:
+    free(v.starts);
+    free(v.depth);
+    free(v.work);
+    return rv;
+}
+
+const CPString *
+CPModule_NameFromPath(const char *path)
+{
+    const char *start = path;
+    for(const char *p = path; *p != '\0'; p++) {
+        if(CP_IS_PATH_SEP(*p)) {
+            start = p + 1;
+        }
+    }
+    const char *dot = strrchr(start, '.');
+    size_t length = dot != NULL && dot != start ? (size_t)(dot - start) : strlen(start);
+    return CPString_Intern(start, length);
+}
+
+/* Builder */
+
+static int
+reserve(void *buffer, size_t *capacity, size_t needed)
+{
+    if(needed <= *capacity) {
+        return 0;
+    }
+    size_t new_capacity = *capacity ? *capacity * 2 : 256;
+    while(new_capacity < needed) {
+        new_capacity *= 2;
+    }
+    void *p = realloc(*(void **)buffer, new_capacity);
+    if(p == NULL) {
+        return -1;
+    }
+    *(void **)buffer = p;
+    *capacity = new_capacity;
+    return 0;
+}
+
+int
+CPModuleBuilder_Init(CPModuleBuilder *builder)
+{
+    memset(builder, 0, sizeof(CPModuleBuilder));
+    builder->entry = CP_BYTECODE_NO_ENTRY;
+    if(CPHashMap_Init(&builder->string_index, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        return -1;
+    }
+    if(CPHashMap_Init(&builder->constant_index, CP_HASHMAP_KEY_BYTES, 0) != 0) {
+        CPHashMap_Destroy(&builder->string_index);
+        return -1;
+    }
+    if(CPHashMap_Init(&builder->global_index, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        CPHashMap_Destroy(&builder->string_index);
+        CPHashMap_Destroy(&builder->constant_index);
+        return -1;
+    }
+    return 0;
+}
+
+void
+CPModuleBuilder_Destroy(CPModuleBuilder *builder)
+{
+    CPHashMap_Destroy(&builder->string_index);
+    CPHashMap_Destroy(&builder->constant_index);
+    CPHashMap_Destroy(&builder->global_index);
+    free(builder->strings);
+    free(builder->constants);
+    free(builder->imports);
+    free(builder->functions);
+    free(builder->code);
+    free(builder->handlers);
+    free(builder->globals);
+    free(builder->natives);
+    memset(builder, 0, sizeof(CPModuleBuilder));
+}
+
+int
+CPModuleBuilder_String(CPModuleBuilder *builder, const CPString *string, uint32_t *index)
+{
+    CPHashMapEntry *entry = CPHashMap_Find(&builder->string_index, (const void *)string, 0);
+    if(entry != NULL) {
+        *index = (uint32_t)(uintptr_t)entry->value;
+        return 0;
+    }
+    if(reserve(&builder->strings, &builder->string_capacity,
+               (builder->string_count + 1) * sizeof(CPString *)) != 0) {
+        return -1;
+    }
+    int inserted;
+    entry = CPHashMap_Put(&builder->string_index, (const void *)string, 0, &inserted);
+    if(entry == NULL) {
+        return -1;
+    }
+    *index = builder->string_count;
+    entry->value = (void *)(uintptr_t)*index;
+    builder->strings[builder->string_count++] = string;
+    return 0;
+}
+
+int
+CPModuleBuilder_Constant(CPModuleBuilder *builder, uint32_t kind, uint64_t value, uint32_t *index)
+{
+    unsigned char record[CP_BYTECODE_CONSTANT_SIZE] = {0};
+    CPBytecode_PutU32(record, kind);
+    CPBytecode_PutU64(record + 8, value);
+    CPHashMapEntry *entry = CPHashMap_Find(&builder->constant_index, record, sizeof(record));
+    if(entry != NULL) {
+        *index = (uint32_t)(uintptr_t)entry->value;
+        return 0;
+    }
+    unsigned char *old = builder->constants;
+    if(reserve(&builder->constants, &builder->constant_capacity,
+               (builder->constant_count + 1) * (size_t)CP_BYTECODE_CONSTANT_SIZE) != 0) {
+        return -1;
+    }
+    if(builder->constants != old) {
+        /* The map's keys point into the records; point them at the new copy. */
+        CPHashMap_Clear(&builder->constant_index);
+        for(uint32_t i = 0; i < builder->constant_count; i++) {
+            int inserted;
+            entry = CPHashMap_Put(&builder->constant_index,
+                                  builder->constants + (size_t)i * CP_BYTECODE_CONSTANT_SIZE,
+                                  CP_BYTECODE_CONSTANT_SIZE, &inserted);
+            if(entry == NULL) {
+                return -1;
+            }
+            entry->value = (void *)(uintptr_t)i;
+        }
+    }
+    unsigned char *slot = builder->constants + (size_t)builder->constant_count * CP_BYTECODE_CONSTANT_SIZE;
+    memcpy(slot, record, sizeof(record));
+    int inserted;
+    entry = CPHashMap_Put(&builder->constant_index, slot, CP_BYTECODE_CONSTANT_SIZE, &inserted);
+    if(entry == NULL) {
+        return -1;
+    }
+    *index = builder->constant_count++;
+    entry->value = (void *)(uintptr_t)*index;
+    return 0;
+}
+
+int
+CPModuleBuilder_Import(CPModuleBuilder *builder, const CPString *module, const CPString *name, uint32_t params,
+                       uint32_t *index)
+{
+    uint32_t m, n;
+    if(CPModuleBuilder_String(builder, module, &m) != 0 ||
+       CPModuleBuilder_String(builder, name, &n) != 0) {
+        return -1;
+    }
+    /* Modules import few names; a scan is enough. */
+    for(uint32_t i = 0; i < builder->import_count; i++) {
+        const unsigned char *record = builder->imports + (size_t)i * CP_BYTECODE_IMPORT_SIZE;
+        if(CPBytecode_GetU32(record) == m && CPBytecode_GetU32(record + 4) == n &&
+           CPBytecode_GetU32(record + 8) == params) {
+            *index = i | CP_BYTECODE_IMPORT_BIT;
+            return 0;
+        }
+    }
+    if(reserve(&builder->imports, &builder->import_capacity,
+               (builder->import_count + 1) * (size_t)CP_BYTECODE_IMPORT_SIZE) != 0) {
+        return -1;
+    }
+    unsigned char *record = builder->imports + (size_t)builder->import_count * CP_BYTECODE_IMPORT_SIZE;
+    CPBytecode_PutU32(record, m);
+    CPBytecode_PutU32(record + 4, n);
+    CPBytecode_PutU32(record + 8, params);
+    CPBytecode_PutU32(record + 12, 0);
+    *index = builder->import_count++ | CP_BYTECODE_IMPORT_BIT;
+    return 0;
+}
+
+int
+CPModuleBuilder_Global(CPModuleBuilder *builder, const CPString *name, uint32_t *index)
+{
+    CPHashMapEntry *entry = CPHashMap_Find(&builder->global_index, (const void *)name, 0);
+    if(entry != NULL) {
+        *index = (uint32_t)(uintptr_t)entry->value;
+        return 0;
+    }
+    uint32_t n;
+    if(CPModuleBuilder_String(builder, name, &n) != 0 ||
+       reserve(&builder->globals, &builder->global_capacity,
+               (builder->global_count + 1) * (size_t)CP_BYTECODE_GLOBAL_SIZE) != 0) {
+        return -1;
+    }
+    int inserted;
+    entry = CPHashMap_Put(&builder->global_index, (const void *)name, 0, &inserted);
+    if(entry == NULL) {
+        return -1;
+    }
+    CPBytecode_PutU32(builder->globals + (size_t)builder->global_count * CP_BYTECODE_GLOBAL_SIZE, n);
+    *index = builder->global_count++;
+    entry->value = (void *)(uintptr_t)*index;
+    return 0;
+}
+
+int
+CPModuleBuilder_Native(CPModuleBuilder *builder, const CPString *library, const CPString *name,
+                       const CPString *signature, uint32_t *index)
+{
+    uint32_t l, n, s;
+    if(CPModuleBuilder_String(builder, library, &l) != 0 || CPModuleBuilder_String(builder, name, &n) != 0 ||
+       CPModuleBuilder_String(builder, signature, &s) != 0) {
+        return -1;
+    }
+    /* Like imports, few per module. */
+    for(uint32_t i = 0; i < builder->native_count; i++) {
+        const unsigned char *record = builder->natives + (size_t)i * CP_BYTECODE_NATIVE_SIZE;
+        if(CPBytecode_GetU32(record) == l && CPBytecode_GetU32(record + 4) == n &&
+           CPBytecode_GetU32(record + 8) == s) {
+            *index = i;
+            return 0;
+        }
+    }
+    if(reserve(&builder->natives, &builder->native_capacity,
+               (builder->native_count + 1) * (size_t)CP_BYTECODE_NATIVE_SIZE) != 0) {
+        return -1;
+    }
+    unsigned char *record = builder->natives + (size_t)builder->native_count * CP_BYTECODE_NATIVE_SIZE;
+    CPBytecode_PutU32(record, l);
+    CPBytecode_PutU32(record + 4, n);
+    CPBytecode_PutU32(record + 8, s);
+    CPBytecode_PutU32(record + 12, 0);
+    *index = builder->native_count++;
+    return 0;
+}
+
+int
+CPModuleBuilder_Function(CPModuleBuilder *builder, const CPString *name, uint16_t params, uint16_t locals,
+                         const unsigned char *code, size_t code_size, uint32_t *index)
+{
+    uint32_t n;
+    if(builder->code_size + code_size > UINT32_MAX ||
+       CPModuleBuilder_String(builder, name, &n) != 0 ||
+       reserve(&builder->code, &builder->code_capacity, builder->code_size + code_size) != 0 ||
+       reserve(&builder->functions, &builder->function_capacity,
+               (builder->function_count + 1) * (size_t)CP_BYTECODE_FUNCTION_SIZE) != 0) {
+        return -1;
+    }
+    unsigned char *record = builder->functions + (size_t)builder->function_count * CP_BYTECODE_FUNCTION_SIZE;
+    CPBytecode_PutU32(record, n);
+    CPBytecode_PutU32(record + 4, (uint32_t)params | (uint32_t)locals << 16);
+    CPBytecode_PutU32(record + 8, (uint32_t)builder->code_size);
+    CPBytecode_PutU32(record + 12, (uint32_t)code_size);
+    if(code_size > 0) {
+        memcpy(builder->code + builder->code_size, code, code_size);
+    }
+    builder->code_size += code_size;
+    *index = builder->function_count++;
+    return 0;
+}
+
+int
+CPModuleBuilder_Handlers(CPModuleBuilder *builder, uint32_t function, const unsigned char *handlers,
+                         uint32_t count)
+{
+    if(count == 0) {
+        return 0;
+    }
+    if(reserve(&builder->handlers, &builder->handler_capacity,
+               (builder->handler_count + (size_t)count) * CP_BYTECODE_HANDLER_SIZE) != 0) {
+        return -1;
+    }
+    unsigned char *p = builder->handlers + (size_t)builder->handler_count * CP_BYTECODE_HANDLER_SIZE;
+    memcpy(p, handlers, (size_t)count * CP_BYTECODE_HANDLER_SIZE);
+    for(uint32_t i = 0; i < count; i++) {
+        CPBytecode_PutU32(p + (size_t)i * CP_BYTECODE_HANDLER_SIZE, function);
+    }
+    builder->handler_count += count;
+    return 0;
+}
+
+static unsigned char *
+add_table(CPBytecodeWriter *writer, uint32_t kind, uint32_t count, uint32_t x,
+          const void *records, size_t record_size)
+{
+    unsigned char *p = CPBytecodeWriter_AddSection(writer, kind, 8 + count * record_size);
+    if(p != NULL) {
+        CPBytecode_PutU32(p, count);
+        CPBytecode_PutU32(p + 4, x);
+        if(count > 0) {
+            memcpy(p + 8, records, count * record_size);
+        }
+    }
+    return p;
+}
+
+int
+CPModuleBuilder_Write(CPModuleBuilder *builder, const char *path)
+{
+    CPBytecodeWriter writer;
+    size_t strings_size = CPString_TableSize(builder->strings, builder->string_count);
+    size_t functions_size = 8 + (size_t)builder->function_count * CP_BYTECODE_FUNCTION_SIZE;
+    size_t constants_size = 8 + (size_t)builder->constant_count * CP_BYTECODE_CONSTANT_SIZE;
+    size_t imports_size = builder->import_count ? 8 + (size_t)builder->import_count * CP_BYTECODE_IMPORT_SIZE : 0;
+    size_t handlers_size = builder->handler_count ? 8 + (size_t)builder->handler_count * CP_BYTECODE_HANDLER_SIZE : 0;
+    size_t globals_size = builder->global_count ? 8 + (size_t)builder->global_count * CP_BYTECODE_GLOBAL_SIZE : 0;
+    size_t natives_size = builder->native_count ? 8 + (size_t)builder->native_count * CP_BYTECODE_NATIVE_SIZE : 0;
+    size_t hint = strings_size + functions_size + builder->code_size + constants_size + imports_size +
+                  handlers_size + globals_size + natives_size;
+    uint32_t sections = 4 + (builder->import_count > 0) + (builder->handler_count > 0) + (builder->global_count > 0) +
+                        (builder->native_count > 0);
+    if(CPBytecodeWriter_Open(&writer, path, sections, hint) != 0) {
+        return -1;
+    }
+    /* Fill each section before adding the next; adding may move the mapping. */
+    int rv = 0;
+    void *p = CPBytecodeWriter_AddSection(&writer, CP_BYTECODE_SECTION_STRINGS, strings_size);
+    if(p == NULL) {
+        rv = -1;
+    } else {
+        CPString_WriteTable(p, builder->strings, builder->string_count);
+    }
+    if(rv == 0 && add_table(&writer, CP_BYTECODE_SECTION_FUNCTIONS, builder->function_count, builder->entry,
+                            builder->functions, CP_BYTECODE_FUNCTION_SIZE) == NULL) {
+        rv = -1;
+    }
+    if(rv == 0) {
+        p = CPBytecodeWriter_AddSection(&writer, CP_BYTECODE_SECTION_CODE, builder->code_size);
+        if(p == NULL) {
+            rv = -1;
+        } else if(builder->code_size > 0) {
+            memcpy(p, builder->code, builder->code_size);
+        }
+    }
+    if(rv == 0 && add_table(&writer, CP_BYTECODE_SECTION_CONSTANTS, builder->constant_count, 0,
+                            builder->constants, CP_BYTECODE_CONSTANT_SIZE) == NULL) {
+        rv = -1;
+    }
+    if(rv == 0 && builder->import_count > 0 &&
+       add_table(&writer, CP_BYTECODE_SECTION_IMPORTS, builder->import_count, 0,
+                 builder->imports, CP_BYTECODE_IMPORT_SIZE) == NULL) {
+        rv = -1;
+    }
+    if(rv == 0 && builder->handler_count > 0 &&
+       add_table(&writer, CP_BYTECODE_SECTION_HANDLERS, builder->handler_count, 0,
+                 builder->handlers, CP_BYTECODE_HANDLER_SIZE) == NULL) {
+        rv = -1;
+    }
+    if(rv == 0 && builder->global_count > 0 &&
+       add_table(&writer, CP_BYTECODE_SECTION_GLOBALS, builder->global_count, 0,
+                 builder->globals, CP_BYTECODE_GLOBAL_SIZE) == NULL) {
+        rv = -1;
+    }
+    if(rv == 0 && builder->native_count > 0 &&
+       add_table(&writer, CP_BYTECODE_SECTION_NATIVES, builder->native_count, 0,
+                 builder->natives, CP_BYTECODE_NATIVE_SIZE) == NULL) {
+        rv = -1;
+    }
+    if(CPBytecodeWriter_Close(&writer) != 0) {
+        rv = -1;
+    }
+    if(rv != 0) {
+        remove(path);
+    }
+    return rv;
+}
@@ -0,0 +1,199 @@
+/*
+ * module.h - reading and building .cpm modules.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_MODULE_H_
+#define _CP_MODULE_H_
+
+#include "bytecode.h"
+#include "hashmap.h"
+#include "intern.h"
+#include "platform/mmap.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct
+{
+    const CPString *name;
+    uint16_t params;
+    uint16_t locals;
+    uint32_t code_size;
+    const unsigned char *code;
+    /* This function's HANDLERS records; see bytecode.h. */
+    uint32_t handler_count;
+    const unsigned char *handlers;
+} CPModuleFunction;
+
+/*
+ * A loaded module points into its image, which stays mapped until
+ * CPModule_Close().  Its strings are interned from the image in place,
+ * so the image must also outlive them: close modules only after
+ * CPString_Reset(), or once nothing looks their strings up again.
+ */
+typedef struct
+{
+    CPMemoryMapping mapping;
+    int mapped;
+    const unsigned char *image;
+    size_t size;
+    const CPString **strings;
+    uint32_t string_count;
+    CPModuleFunction *functions;
+    uint32_t function_count;
+    uint32_t entry;
+    const unsigned char *constants;
+    uint32_t constant_count;
+    const unsigned char *imports;
+    uint32_t import_count;
+    const unsigned char *globals;
+    uint32_t global_count;
+    const unsigned char *natives;
+    uint32_t native_count;
+} CPModule;
+
+/*
+ * Collects strings, constants, imports and functions, numbering each
+ * distinct one once, and writes them out as a .cpm image.
+ */
+typedef struct
+{
+    CPHashMap string_index;
+    const CPString **strings;
+    uint32_t string_count;
+    /* Keyed by the whole record, so kind and value both count. */
+    CPHashMap constant_index;
+    unsigned char *constants;
+    uint32_t constant_count;
+    unsigned char *imports;
+    uint32_t import_count;
+    unsigned char *functions;
+    uint32_t function_count;
+    uint32_t entry;
+    unsigned char *code;
+    size_t code_size;
+    unsigned char *handlers;
+    uint32_t handler_count;
+    /* Global name to index. */
+    CPHashMap global_index;
+    unsigned char *globals;
+    uint32_t global_count;
+    unsigned char *natives;
+    uint32_t native_count;
+    /* Allocated bytes of the arrays above. */
+    size_t string_capacity;
+    size_t constant_capacity;
+    size_t import_capacity;
+    size_t function_capacity;
+    size_t code_capacity;
+    size_t handler_capacity;
+    size_t global_capacity;
+    size_t native_capacity;
+} CPModuleBuilder;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int CPModule_Open(CPModule *module, const char *path);
+int CPModule_Load(CPModule *module, const void *image, size_t size);
+void CPModule_Close(CPModule *module);
+/*
+ * Check every instruction of function `index' against the module, and
+ * its control flow: jumps and handlers land on instruction boundaries,
+ * no path pops below the locals or meets another at a different stack
+ * depth, and none runs off the end of the code.
+ */
+int CPModule_Verify(const CPModule *module, uint32_t index);
+
+/* The name imports use for the module in `path': its file name without extension. */
+const CPString *CPModule_NameFromPath(const char *path);
+
+int CPModuleBuilder_Init(CPModuleBuilder *builder);
+void CPModuleBuilder_Destroy(CPModuleBuilder *builder);
+int CPModuleBuilder_String(CPModuleBuilder *builder, const CPString *string, uint32_t *index);
+int CPModuleBuilder_Constant(CPModuleBuilder *builder, uint32_t kind, uint64_t value, uint32_t *index);
+/*
+ * `*index' is the function operand, CP_BYTECODE_IMPORT_BIT included, for
+ * calls passing `params' arguments.
+ */
+int CPModuleBuilder_Import(CPModuleBuilder *builder, const CPString *module, const CPString *name, uint32_t params,
+                           uint32_t *index);
+/* `*index' is the GLOBAL operand for the variable `name'. */
+int CPModuleBuilder_Global(CPModuleBuilder *builder, const CPString *name, uint32_t *index);
+/* `*index' is the NATIVE operand for `name' of `library'. */
+int CPModuleBuilder_Native(CPModuleBuilder *builder, const CPString *library, const CPString *name,
+                           const CPString *signature, uint32_t *index);
+int CPModuleBuilder_Function(CPModuleBuilder *builder, const CPString *name, uint16_t params, uint16_t locals,
+                             const unsigned char *code, size_t code_size, uint32_t *index);
+/*
+ * Give the function just added the `count' HANDLERS records at
+ * `handlers'; their function fields are ignored.
+ */
+int CPModuleBuilder_Handlers(CPModuleBuilder *builder, uint32_t function, const unsigned char *handlers,
+                             uint32_t count);
+int CPModuleBuilder_Write(CPModuleBuilder *builder, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline uint32_t
+CPModule_ConstantKind(const CPModule *module, uint32_t index)
+{
+    return CPBytecode_GetU32(module->constants + (size_t)index * CP_BYTECODE_CONSTANT_SIZE);
+}
+
+static inline uint64_t
+CPModule_ConstantValue(const CPModule *module, uint32_t index)
+{
+    return CPBytecode_GetU64(module->constants + (size_t)index * CP_BYTECODE_CONSTANT_SIZE + 8);
+}
+
+static inline const CPString *
+CPModule_ImportModule(const CPModule *module, uint32_t index)
+{
+    return module->strings[CPBytecode_GetU32(module->imports + (size_t)index * CP_BYTECODE_IMPORT_SIZE)];
+}
+
+static inline const CPString *
+CPModule_ImportName(const CPModule *module, uint32_t index)
+{
+    return module->strings[CPBytecode_GetU32(module->imports + (size_t)index * CP_BYTECODE_IMPORT_SIZE + 4)];
+}
+
+static inline uint32_t
+CPModule_ImportParams(const CPModule *module, uint32_t index)
+{
+    return CPBytecode_GetU32(module->imports + (size_t)index * CP_BYTECODE_IMPORT_SIZE + 8);
+}
+
+static inline const CPString *
+CPModule_GlobalName(const CPModule *module, uint32_t index)
+{
+    return module->strings[CPBytecode_GetU32(module->globals + (size_t)index * CP_BYTECODE_GLOBAL_SIZE)];
+}
+
+/* Field 0, 1 or 2 of NATIVES record `index': the library, name or signature. */
+static inline const CPString *
+CPModule_Native(const CPModule *module, uint32_t index, int field)
+{
+    return module->strings[CPBytecode_GetU32(module->natives + (size_t)index * CP_BYTECODE_NATIVE_SIZE +
+                                             (size_t)field * 4)];
+}
+
+#endif /* _CP_MODULE_H_ */
@@ -0,0 +1,783 @@
+/*
+ * numconv.c - locale-independent number parsing and formatting.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "numconv.h"
+
+#include <string.h>
+
+/*
+ * Parsing is Eisel-Lemire: the decimal significand is multiplied by a
+ * 128-bit approximation of the power of ten, which settles the rounding
+ * in all but pathological cases.  Inputs of more than 19 digits that
+ * their first 19 do not settle are compared with the halfway point in
+ * big integers.  Formatting is Ryu.  Both only read
+ * the tables in numconv_table.c.
+ */
+
+#define MANTISSA_BITS 52
+#define EXPONENT_BIAS 1023
+#define INFINITE_POWER 0x7FF
+#define SMALLEST_POWER10 (-342)
+#define LARGEST_POWER10 308
+#define MAX_DIGITS 19
+
+/* Ryu works with 125 bits of 5^i and of 2^k / 5^i. */
+#define POW5_BITCOUNT 125
+#define POW5_INV_BITCOUNT 125
+
+extern const uint64_t cp_numconv_pow5_128[651][2];
+extern const uint64_t cp_numconv_pow5_split[326][2];
+extern const uint64_t cp_numconv_pow5_inv_split[342][2];
+
+static const char digit_pairs[200] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* Exactly representable powers of ten, for the fast path. */
+static const double exact_powers[23] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+static inline uint64_t
+mul64(uint64_t a, uint64_t b, uint64_t *high)
+{
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *high = (uint64_t)(r >> 64);
+    return (uint64_t)r;
+#else
+    uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+    uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+    uint64_t p0 = a_lo * b_lo, p1 = a_lo * b_hi;
+    uint64_t p2 = a_hi * b_lo, p3 = a_hi * b_hi;
+    uint64_t mid = (p0 >> 32) + (uint32_t)p1 + (uint32_t)p2;
+    *high = p3 + (p1 >> 32) + (p2 >> 32) + (mid >> 32);
+    return (mid << 32) | (uint32_t)p0;
+#endif
+}
+
+static inline int
+leading_zeros(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_clzll(x);
+#else
+    int n = 0;
+    while((x & (1ULL << 63)) == 0) {
+        x <<= 1;
+        n++;
+    }
+    return n;
+#endif
+}
+
+static inline int
+decimal_length(uint64_t v)
+{
+    int n = 1;
+    for(;;) {
+        if(v < 10) {
+            return n;
+        }
+        if(v < 100) {
+            return n + 1;
+        }
+        if(v < 1000) {
+            return n + 2;
+        }
+        if(v < 10000) {
+            return n + 3;
+        }
+        v /= 10000;
+        n += 4;
+    }
+}
+
+/* Writes the low `length` digits of v ending just before dst + length. */
+static inline void
+write_digits(uint64_t v, char *dst, int length)
+{
+    char *p = dst + length;
+    while(v >= 100) {
+        unsigned int pair = (unsigned int)(v % 100) * 2;
+        v /= 100;
+        p -= 2;
+        p[0] = digit_pairs[pair];
+        p[1] = digit_pairs[pair + 1];
+    }
+    if(v >= 10) {
+        p -= 2;
+        p[0] = digit_pairs[v * 2];
+        p[1] = digit_pairs[v * 2 + 1];
+    } else {
+        *--p = (char)('0' + v);
+    }
+}
+
+size_t
+CPNum_FormatU64(uint64_t value, char *dst)
+{
+    int length = decimal_length(value);
+    write_digits(value, dst, length);
+    dst[length] = '\0';
+    return (size_t)length;
+}
+
+size_t
+CPNum_FormatI64(int64_t value, char *dst)
+{
+    if(value >= 0) {
+        return CPNum_FormatU64((uint64_t)value, dst);
+    }
+    *dst = '-';
+    return 1 + CPNum_FormatU64(-(uint64_t)value, dst + 1);
+}
+
+/* Ryu */
+
+static inline int32_t
+pow5bits(int32_t e)
+{
+    /* ceil(log2(5^e)) for 0 <= e <= 3528. */
+    return ((e * 1217359) >> 19) + 1;
+}
+
+static inline int32_t
+log10_pow2(int32_t e)
+{
+    return (e * 78913) >> 18;
+}
+
+static inline int32_t
+log10_pow5(int32_t e)
+{
+    return (e * 732923) >> 20;
+}
+
+static inline int
+multiple_of_pow5(uint64_t value, int32_t p)
+{
+    int32_t count = 0;
+    while(value % 5 == 0) {
+        value /= 5;
+        count++;
+    }
+    return count >= p;
+}
+
+static inline int
+multiple_of_pow2(uint64_t value, int32_t p)
+{
+    return (value & ((1ULL << p) - 1)) == 0;
+}
+
+/* (m * mul) >> j, where mul is 128 bits and 64 < j < 128. */
+static inline uint64_t
+mul_shift(uint64_t m, const uint64_t *mul, int32_t j)
+{
+    uint64_t high0, high1;
+    mul64(m, mul[0], &high0);
+    uint64_t low1 = mul64(m, mul[1], &high1);
+    uint64_t sum = high0 + low1;
+    high1 += sum < high0;
+    return (high1 << (128 - j)) | (sum >> (j - 64));
+}
+
+/* Shortest digits and power of ten for a finite, non-zero double. */
+static uint64_t
+shortest(uint64_t mantissa, uint32_t exponent, int32_t *e10_out)
+{
+    int32_t e2;
+    uint64_t m2;
+    if(exponent == 0) {
+        e2 = 1 - EXPONENT_BIAS - MANTISSA_BITS - 2;
+        m2 = mantissa;
+    } else {
+        e2 = (int32_t)exponent - EXPONENT_BIAS - MANTISSA_BITS - 2;
+        m2 = (1ULL << MANTISSA_BITS) | mantissa;
+    }
+    int accept_bounds = (m2 & 1) == 0;
+
+    /* The halfway points to the neighbours are mv + 2 and mv - 1 - mm_shift. */
+    uint64_t mv = 4 * m2;
+    uint32_t mm_shift = mantissa != 0 || exponent <= 1;
+    uint64_t vr, vp, vm;
+    int32_t e10;
+    int vm_trailing_zeros = 0;
+    int vr_trailing_zeros = 0;
+    if(e2 >= 0) {
+        int32_t q = log10_pow2(e2) - (e2 > 3);
+        e10 = q;
+        int32_t k = POW5_INV_BITCOUNT + pow5bits(q) - 1;
+        int32_t i = -e2 + q + k;
+        const uint64_t *mul = cp_numconv_pow5_inv_split[q];
+        vr = mul_shift(4 * m2, mul, i);
+        vp = mul_shift(4 * m2 + 2, mul, i);
+        vm = mul_shift(4 * m2 - 1 - mm_shift, mul, i);
+        if(q <= 21) {
+            /* At most one of mp, mv and mm is a multiple of 5. */
+            if(mv % 5 == 0) {
+                vr_trailing_zeros = multiple_of_pow5(mv, q);
+            } else if(accept_bounds) {
+                vm_trailing_zeros = multiple_of_pow5(mv - 1 - mm_shift, q);
+            } else {
+                vp -= multiple_of_pow5(mv + 2, q);
+            }
+        }
+    } else {
+        int32_t q = log10_pow5(-e2) - (-e2 > 1);
+        e10 = q + e2;
+        int32_t i = -e2 - q;
+        int32_t k = pow5bits(i) - POW5_BITCOUNT;
+        int32_t j = q - k;
+        const uint64_t *mul = cp_numconv_pow5_split[i];
+        vr = mul_shift(4 * m2, mul, j);
+        vp = mul_shift(4 * m2 + 2, mul, j);
+        vm = mul_shift(4 * m2 - 1 - mm_shift, mul, j);
+        if(q <= 1) {
+            /* mv has at least two trailing zero bits; mp at least one. */
+            vr_trailing_zeros = 1;
+            if(accept_bounds) {
+                vm_trailing_zeros = mm_shift == 1;
+            } else {
+                vp--;
+            }
+        } else if(q < 63) {
+            vr_trailing_zeros = multiple_of_pow2(mv, q);
+        }
+    }
+
+    int32_t removed = 0;
+    uint64_t output;
+    if(vm_trailing_zeros || vr_trailing_zeros) {
+        /* Rare: the exact value may sit on a digit boundary. */
+        unsigned int last_removed = 0;
+        while(vp / 10 > vm / 10) {
+            vm_trailing_zeros &= vm % 10 == 0;
+            vr_trailing_zeros &= last_removed == 0;
+            last_removed = (unsigned int)(vr % 10);
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        if(vm_trailing_zeros) {
+            while(vm % 10 == 0) {
+                vr_trailing_zeros &= last_removed == 0;
+                last_removed = (unsigned int)(vr % 10);
+                vr /= 10;
+                vp /= 10;
+                vm /= 10;
+                removed++;
+            }
+        }
+        if(vr_trailing_zeros && last_removed == 5 && vr % 2 == 0) {
+            /* Exactly halfway; round to even. */
+            last_removed = 4;
+        }
+        output = vr + ((vr == vm && (!accept_bounds || !vm_trailing_zeros)) || last_removed >= 5);
+    } else {
+        int round_up = 0;
+        if(vp / 100 > vm / 100) {
+            round_up = vr % 100 >= 50;
+            vr /= 100;
+            vp /= 100;
+            vm /= 100;
+            removed += 2;
+        }
+        while(vp / 10 > vm / 10) {
+            round_up = vr % 10 >= 5;
+            vr /= 10;
+            vp /= 10;
+            vm /= 10;
+            removed++;
+        }
+        output = vr + (vr == vm || round_up);
+    }
+    *e10_out = e10 + removed;
+    return output;
+}
+
+/* Integers below 2^53 need no search; only their trailing zeros go. */
+static int
+small_integer(uint64_t mantissa, uint32_t exponent, uint64_t *output, int32_t *e10)
+{
+    int32_t e2 = (int32_t)exponent - EXPONENT_BIAS - MANTISSA_BITS;
+    if(e2 > 0 || e2 < -MANTISSA_BITS) {
+        return 0;
+    }
+    uint64_t m2 = (1ULL << MANTISSA_BITS) | mantissa;
+    if((m2 & ((1ULL << -e2) - 1)) != 0) {
+        return 0;
+    }
+    uint64_t v = m2 >> -e2;
+    int32_t zeros = 0;
+    while(v % 10 == 0) {
+        v /= 10;
+        zeros++;
+    }
+    *output = v;
+    *e10 = zeros;
+    return 1;
+}
+
+size_t
+CPNum_FormatDouble(double value, char *dst)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint64_t mantissa = bits & ((1ULL << MANTISSA_BITS) - 1);
+    uint32_t exponent = (uint32_t)(bits >> MANTISSA_BITS) & INFINITE_POWER;
+    char *p = dst;
+    if(exponent == INFINITE_POWER && mantissa != 0) {
+        memcpy(dst, "nan", 4);
+        return 3;
+    }
+    if(bits >> 63) {
+        *p++ = '-';
+    }
+    if(exponent == INFINITE_POWER) {
+        memcpy(p, "inf", 4);
+        return (size_t)(p - dst) + 3;
+    }
+    if(exponent == 0 && mantissa == 0) {
+        memcpy(p, "0", 2);
+        return (size_t)(p - dst) + 1;
+    }
+
+    uint64_t output;
+    int32_t e10;
+    if(!small_integer(mantissa, exponent, &output, &e10)) {
+        output = shortest(mantissa, exponent, &e10);
+    }
+    int length = decimal_length(output);
+    int32_t scientific = e10 + length - 1;
+    if(scientific >= -5 && scientific < 17) {
+        if(e10 >= 0) {
+            write_digits(output, p, length);
+            p += length;
+            memset(p, '0', (size_t)e10);
+            p += e10;
+        } else if(scientific >= 0) {
+            /* Write the digits one place right, then pull the integer part back. */
+            write_digits(output, p + 1, length);
+            memmove(p, p + 1, (size_t)scientific + 1);
+            p[scientific + 1] = '.';
+            p += length + 1;
+        } else {
+            *p++ = '0';
+            *p++ = '.';
+            memset(p, '0', (size_t)(-scientific - 1));
+            p += -scientific - 1;
+            write_digits(output, p, length);
+            p += length;
+        }
+    } else {
+        write_digits(output, p + 1, length);
+        p[0] = p[1];
+        if(length > 1) {
+            p[1] = '.';
+            p += length + 1;
+        } else {
+            p++;
+        }
+        *p++ = 'e';
+        *p++ = scientific < 0 ? '-' : '+';
+        uint32_t e = (uint32_t)(scientific < 0 ? -scientific : scientific);
+        int e_length = decimal_length(e);
+        write_digits(e, p, e_length);
+        p += e_length;
+    }
+    *p = '\0';
+    return (size_t)(p - dst);
+}
+
+/* Parsing */
+
+static inline int
+is_digit(char c)
+{
+    return (unsigned char)(c - '0') < 10;
+}
+
+size_t
+CPNum_ParseU64(const char *s, size_t length, uint64_t *out)
+{
+    uint64_t value = 0;
+    size_t i = 0;
+    for(; i < length && is_digit(s[i]); i++) {
+        uint64_t digit = (uint64_t)(s[i] - '0');
+        if(value > (UINT64_MAX - digit) / 10) {
+            return 0;
+        }
+        value = value * 10 + digit;
+    }
+    if(i == 0) {
+        return 0;
+    }
+    *out = value;
+    return i;
+}
+
+size_t
+CPNum_ParseI64(const char *s, size_t length, int64_t *out)
+{
+    int negative = length > 0 && s[0] == '-';
+    uint64_t value;
+    size_t used = CPNum_ParseU64(s + negative, length - (size_t)negative, &value);
+    if(used == 0 || value > (uint64_t)INT64_MAX + (uint64_t)negative) {
+        return 0;
+    }
+    *out = negative ? (int64_t)(0 - value) : (int64_t)value;
+    return used + (size_t)negative;
+}
+
+/* w * 10^q as IEEE exponent and mantissa fields; w must be non-zero. */
+static void
+compute_float(int64_t q, uint64_t w, uint64_t *mantissa_out, int32_t *power2_out)
+{
+    uint64_t mantissa;
+    int32_t power2;
+    if(q < SMALLEST_POWER10) {
+        *mantissa_out = 0;
+        *power2_out = 0;
+        return;
+    }
+    if(q > LARGEST_POWER10) {
+        *mantissa_out = 0;
+        *power2_out = INFINITE_POWER;
+        return;
+    }
+    int lz = leading_zeros(w);
+    w <<= lz;
+
+    /* The top 55 bits of the product; refine when they might carry. */
+    const uint64_t *power = cp_numconv_pow5_128[q - SMALLEST_POWER10];
+    uint64_t high;
+    uint64_t low = mul64(w, power[1], &high);
+    if((high & 0x1FF) == 0x1FF) {
+        uint64_t high2;
+        mul64(w, power[0], &high2);
+        low += high2;
+        high += low < high2;
+    }
+
+    int upperbit = (int)(high >> 63);
+    int shift = upperbit + 64 - MANTISSA_BITS - 3;
+    mantissa = high >> shift;
+    power2 = (int32_t)((((152170 + 65536) * q) >> 16) + 63) + upperbit - lz + EXPONENT_BIAS;
+    if(power2 <= 0) {
+        /* Subnormal, or zero. */
+        if(-power2 + 1 >= 64) {
+            *mantissa_out = 0;
+            *power2_out = 0;
+            return;
+        }
+        mantissa >>= -power2 + 1;
+        mantissa += mantissa & 1;
+        mantissa >>= 1;
+        *mantissa_out = mantissa;
+        *power2_out = mantissa < (1ULL << MANTISSA_BITS) ? 0 : 1;
+        return;
+    }
+    /* The product is exact here, so a halfway case really is one: round to even. */
+    if(low <= 1 && q >= -4 && q <= 23 && (mantissa & 3) == 1 && (mantissa << shift) == high) {
+        mantissa &= ~(uint64_t)1;
+    }
+    mantissa += mantissa & 1;
+    mantissa >>= 1;
+    if(mantissa >= (2ULL << MANTISSA_BITS)) {
+        mantissa = 1ULL << MANTISSA_BITS;
+        power2++;
+    }
+    mantissa &= ~(1ULL << MANTISSA_BITS);
+    if(power2 >= INFINITE_POWER) {
+        power2 = INFINITE_POWER;
+        mantissa = 0;
+    }
+    *mantissa_out = mantissa;
+    *power2_out = power2;
+}
+
+static uint64_t
+to_bits(int64_t q, uint64_t w)
+{
+    uint64_t mantissa;
+    int32_t power2;
+    compute_float(q, w, &mantissa, &power2);
+    return mantissa | ((uint64_t)power2 << MANTISSA_BITS);
+}
+
+/*
+ * Enough 32-bit limbs for either side of the comparison in parse_long():
+ * 768 digits, or 5^1112 times a 54-bit halfway point, are under 2700
+ * bits.
+ */
+#define BIG_LIMBS 96
+#define BIG_DIGITS 768
+
+typedef struct
+{
+    uint32_t count;
+    uint32_t limbs[BIG_LIMBS];
+} big_t;
+
+static void
+big_mul_add(big_t *big, uint32_t factor, uint32_t addend)
+{
+    uint64_t carry = addend;
+    for(uint32_t i = 0; i < big->count; i++) {
+        uint64_t product = (uint64_t)big->limbs[i] * factor + carry;
+        big->limbs[i] = (uint32_t)product;
+        carry = product >> 32;
+    }
+    if(carry != 0 && big->count < BIG_LIMBS) {
+        big->limbs[big->count++] = (uint32_t)carry;
+    }
+}
+
+static void
+big_mul_pow5(big_t *big, uint64_t n)
+{
+    static const uint32_t pow5[14] = {
+        1, 5, 25, 125, 625, 3125, 15625, 78125, 390625, 1953125, 9765625,
+        48828125, 244140625, 1220703125,
+    };
+    for(; n >= 13; n -= 13) {
+        big_mul_add(big, pow5[13], 0);
+    }
+    big_mul_add(big, pow5[n], 0);
+}
+
+static void
+big_shift_left(big_t *big, uint64_t bits)
+{
+    uint32_t words = (uint32_t)(bits / 32);
+    uint32_t shift = (uint32_t)(bits % 32);
+    if(big->count == 0 || big->count + words >= BIG_LIMBS) {
+        return;
+    }
+    memmove(big->limbs + words, big->limbs, big->count * sizeof(uint32_t));
+    memset(big->limbs, 0, words * sizeof(uint32_t));
+    big->count += words;
+    uint32_t carry = 0;
+    for(uint32_t i = words; shift != 0 && i < big->count; i++) {
+        uint32_t limb = big->limbs[i];
+        big->limbs[i] = limb << shift | carry;
+        carry = limb >> (32 - shift);
+    }
+    if(carry != 0) {
+        big->limbs[big->count++] = carry;
+    }
+}
+
+static int
+big_compare(const big_t *a, const big_t *b)
+{
+    if(a->count != b->count) {
+        return a->count < b->count ? -1 : 1;
+    }
+    for(uint32_t i = a->count; i-- > 0;) {
+        if(a->limbs[i] != b->limbs[i]) {
+            return a->limbs[i] < b->limbs[i] ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * The `count' significant digits in [p, end) times 10^exponent, for
+ * more than 19 digits.  The first 19 place the value between w and w + 1
+ * units of the last of them; if both round alike, that is the answer.
+ * Otherwise the digits are compared exactly with the halfway point
+ * between the two candidates.  Past BIG_DIGITS digits, only whether one
+ * is non-zero can matter, and only to break a tie.
+ */
+static double
+parse_long(const char *p, const char *end, int64_t exponent, size_t count)
+{
+    while(*p == '0' || *p == '.') {
+        p++;
+    }
+    uint64_t w = 0;
+    for(const char *d = p; w < 1000000000000000000ULL; d++) {
+        if(*d != '.') {
+            w = w * 10 + (uint64_t)(*d - '0');
+        }
+    }
+    int64_t q = exponent + (int64_t)(count - MAX_DIGITS);
+    uint64_t low = to_bits(q, w);
+    uint64_t high = to_bits(q, w + 1);
+    double value;
+    if(low == high) {
+        memcpy(&value, &low, sizeof(value));
+        return value;
+    }
+
+    big_t decimal;
+    size_t used = 0;
+    uint32_t chunk = 0, scale = 1;
+    int sticky = 0;
+    decimal.count = 0;
+    for(; p < end; p++) {
+        if(*p == '.') {
+            continue;
+        }
+        if(used == BIG_DIGITS) {
+            if(*p != '0') {
+                sticky = 1;
+                break;
+            }
+            continue;
+        }
+        chunk = chunk * 10 + (uint32_t)(*p - '0');
+        scale *= 10;
+        used++;
+        if(scale == 1000000000) {
+            big_mul_add(&decimal, scale, chunk);
+            chunk = 0;
+            scale = 1;
+        }
+    }
+    if(scale > 1) {
+        big_mul_add(&decimal, scale, chunk);
+    }
+    int64_t e10 = exponent + (int64_t)(count - used);
+
+    /* low is m * 2^e2, so the halfway point is (2m + 1) * 2^(e2 - 1). */
+    uint64_t m = low & ((1ULL << MANTISSA_BITS) - 1);
+    int64_t e2 = (int64_t)(low >> MANTISSA_BITS);
+    if(e2 == 0) {
+        e2 = 1 - EXPONENT_BIAS - MANTISSA_BITS;
+    } else {
+        m |= 1ULL << MANTISSA_BITS;
+        e2 -= EXPONENT_BIAS + MANTISSA_BITS;
+    }
+    big_t halfway;
+    m = 2 * m + 1;
+    halfway.limbs[0] = (uint32_t)m;
+    halfway.limbs[1] = (uint32_t)(m >> 32);
+    halfway.count = halfway.limbs[1] != 0 ? 2 : 1;
+
+    /* Clear the powers of five and two down to integers on both sides. */
+    if(e10 >= 0) {
+        big_mul_pow5(&decimal, (uint64_t)e10);
+    } else {
+        big_mul_pow5(&halfway, (uint64_t)-e10);
+    }
+    int64_t shift = e10 - (e2 - 1);
+    if(shift >= 0) {
+        big_shift_left(&decimal, (uint64_t)shift);
+    } else {
+        big_shift_left(&halfway, (uint64_t)-shift);
+    }
+    int order = big_compare(&decimal, &halfway);
+    if(order == 0) {
+        order = sticky || (low & 1) ? 1 : -1;
+    }
+    uint64_t bits = order > 0 ? high : low;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+size_t
+CPNum_ParseDouble(const char *s, size_t length, double *out)
+{
+    const char *p = s;
+    const char *end = s + length;
+    int negative = 0;
+    if(p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        p++;
+    }
+
+    /* Digits past the 19th wrap around; such numbers go the slow way. */
+    const char *first = p;
+    uint64_t w = 0;
+    for(; p < end && is_digit(*p); p++) {
+        w = w * 10 + (uint64_t)(*p - '0');
+    }
+    size_t count = (size_t)(p - first);
+    int64_t exponent = 0;
+    if(p < end && *p == '.') {
+        const char *fraction = ++p;
+        for(; p < end && is_digit(*p); p++) {
+            w = w * 10 + (uint64_t)(*p - '0');
+        }
+        exponent = -(int64_t)(p - fraction);
+        count += (size_t)(p - fraction);
+    }
+    if(count == 0) {
+        return 0;
+    }
+    const char *digits_end = p;
+    if(p < end && (*p == 'e' || *p == 'E')) {
+        const char *e = p + 1;
+        int e_negative = 0;
+        if(e < end && (*e == '-' || *e == '+')) {
+            e_negative = *e == '-';
+            e++;
+        }
+        if(e < end && is_digit(*e)) {
+            int64_t value = 0;
+            for(; e < end && is_digit(*e); e++) {
+                if(value < 0x10000) {
+                    value = value * 10 + (*e - '0');
+                }
+            }
+            exponent += e_negative ? -value : value;
+            p = e;
+        }
+    }
+    size_t used = (size_t)(p - s);
+
+    if(count > MAX_DIGITS) {
+        for(const char *z = first; z < p && (*z == '0' || *z == '.'); z++) {
+            count -= *z == '0';
+        }
+    }
+
+    double value;
+    if(count > MAX_DIGITS) {
+        value = parse_long(first, digits_end, exponent, count);
+    } else if(exponent >= -22 && exponent <= 22 && w <= (1ULL << 53)) {
+        /* Both operands are exact, so one rounding gives the right answer. */
+        value = (double)w;
+        value = exponent < 0 ? value / exact_powers[-exponent] : value * exact_powers[exponent];
+    } else if(w == 0) {
+        value = 0.0;
+    } else {
+        uint64_t mantissa;
+        int32_t power2;
+        compute_float(exponent, w, &mantissa, &power2);
+        uint64_t bits = mantissa | ((uint64_t)power2 << MANTISSA_BITS);
+        memcpy(&value, &bits, sizeof(value));
+    }
+    *out = negative ? -value : value;
+    return used;
+}
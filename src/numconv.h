@@ -0,0 +1,54 @@
+/*
+ * numconv.h - locale-independent number parsing and formatting.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_NUMCONV_H_
+#define _CP_NUMCONV_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Enough for any number formatted below, including the NUL. */
+#define CP_NUM_BUFFER_SIZE 32
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Formatting writes a NUL-terminated string to dst and returns its
+ * length.  Doubles use the shortest digits that read back to the same
+ * value, positional between 1e-5 and 1e17 and "1.5e+20" style outside.
+ */
+size_t CPNum_FormatU64(uint64_t value, char *dst);
+size_t CPNum_FormatI64(int64_t value, char *dst);
+size_t CPNum_FormatDouble(double value, char *dst);
+
+/*
+ * Parsing reads a prefix of s and returns the number of bytes used, or
+ * 0 if there is no number there or an integer does not fit.  Doubles
+ * take [+-]digits[.digits][(e|E)[+-]digits], rounded to nearest even.
+ */
+size_t CPNum_ParseU64(const char *s, size_t length, uint64_t *out);
+size_t CPNum_ParseI64(const char *s, size_t length, int64_t *out);
+size_t CPNum_ParseDouble(const char *s, size_t length, double *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_NUMCONV_H_ */
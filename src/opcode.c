@@ -0,0 +1,50 @@
+/*
+ * opcode.c - the bytecode instruction set.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "opcode.h"
+
+const CPOpcodeInfo cp_opcodes[CP_OP_COUNT] = {
+    [CP_OP_NOP] = {"NOP", CP_OPERAND_NONE},
+    [CP_OP_LOAD_CONST] = {"LOAD_CONST", CP_OPERAND_CONST},
+    [CP_OP_LOAD_STRING] = {"LOAD_STRING", CP_OPERAND_STRING},
+    [CP_OP_LOAD_LOCAL] = {"LOAD_LOCAL", CP_OPERAND_INDEX},
+    [CP_OP_STORE_LOCAL] = {"STORE_LOCAL", CP_OPERAND_INDEX},
+    [CP_OP_LOAD_GLOBAL] = {"LOAD_GLOBAL", CP_OPERAND_STRING},
+    [CP_OP_STORE_GLOBAL] = {"STORE_GLOBAL", CP_OPERAND_STRING},
+    [CP_OP_LOAD_FUNCTION] = {"LOAD_FUNCTION", CP_OPERAND_FUNCTION},
+    [CP_OP_CALL] = {"CALL", CP_OPERAND_FUNCTION},
+    [CP_OP_RETURN] = {"RETURN", CP_OPERAND_NONE},
+    [CP_OP_POP] = {"POP", CP_OPERAND_NONE},
+    [CP_OP_PRINT] = {"PRINT", CP_OPERAND_NONE},
+    [CP_OP_ADD] = {"ADD", CP_OPERAND_NONE},
+    [CP_OP_SUB] = {"SUB", CP_OPERAND_NONE},
+    [CP_OP_MUL] = {"MUL", CP_OPERAND_NONE},
+    [CP_OP_DIV] = {"DIV", CP_OPERAND_NONE},
+    [CP_OP_LESS] = {"LESS", CP_OPERAND_NONE},
+    [CP_OP_LESS_EQUAL] = {"LESS_EQUAL", CP_OPERAND_NONE},
+    [CP_OP_EQUAL] = {"EQUAL", CP_OPERAND_NONE},
+    [CP_OP_NOT] = {"NOT", CP_OPERAND_NONE},
+    [CP_OP_JUMP] = {"JUMP", CP_OPERAND_JUMP},
+    [CP_OP_JUMP_IF_FALSE] = {"JUMP_IF_FALSE", CP_OPERAND_JUMP},
+    [CP_OP_THROW] = {"THROW", CP_OPERAND_NONE},
+    [CP_OP_TAIL_CALL] = {"TAIL_CALL", CP_OPERAND_FUNCTION},
+    [CP_OP_LOAD_GLOBAL_SLOT] = {"LOAD_GLOBAL_SLOT", CP_OPERAND_GLOBAL},
+    [CP_OP_STORE_GLOBAL_SLOT] = {"STORE_GLOBAL_SLOT", CP_OPERAND_GLOBAL},
+    [CP_OP_CALL_NATIVE] = {"CALL_NATIVE", CP_OPERAND_NATIVE},
+};
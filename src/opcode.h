@@ -0,0 +1,109 @@
+/*
+ * opcode.h - the bytecode instruction set.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_OPCODE_H_
+#define _CP_OPCODE_H_
+
+#include "bytecode.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * An instruction is an opcode byte, followed by a little-endian u32
+ * operand unless the opcode's operand kind is CP_OPERAND_NONE.  Jump
+ * targets are offsets from the start of the function.
+ */
+enum
+{
+    CP_OP_NOP,
+    CP_OP_LOAD_CONST,
+    CP_OP_LOAD_STRING,
+    CP_OP_LOAD_LOCAL,
+    CP_OP_STORE_LOCAL,
+    CP_OP_LOAD_GLOBAL,
+    CP_OP_STORE_GLOBAL,
+    CP_OP_LOAD_FUNCTION,
+    CP_OP_CALL,
+    CP_OP_RETURN,
+    CP_OP_POP,
+    CP_OP_PRINT,
+    CP_OP_ADD,
+    CP_OP_SUB,
+    CP_OP_MUL,
+    CP_OP_DIV,
+    CP_OP_LESS,
+    CP_OP_LESS_EQUAL,
+    CP_OP_EQUAL,
+    CP_OP_NOT,
+    CP_OP_JUMP,
+    CP_OP_JUMP_IF_FALSE,
+    /* Added since; new opcodes go last so existing numbers never change. */
+    CP_OP_THROW,
+    CP_OP_TAIL_CALL,
+    CP_OP_LOAD_GLOBAL_SLOT,
+    CP_OP_STORE_GLOBAL_SLOT,
+    CP_OP_CALL_NATIVE,
+    CP_OP_COUNT
+};
+
+/* What an operand refers to, and so what a linker must rewrite. */
+#define CP_OPERAND_NONE 0
+#define CP_OPERAND_INDEX 1
+#define CP_OPERAND_JUMP 2
+#define CP_OPERAND_CONST 3
+#define CP_OPERAND_STRING 4
+#define CP_OPERAND_FUNCTION 5
+#define CP_OPERAND_GLOBAL 6
+#define CP_OPERAND_NATIVE 7
+
+typedef struct
+{
+    const char *name;
+    uint8_t operand;
+} CPOpcodeInfo;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const CPOpcodeInfo cp_opcodes[CP_OP_COUNT];
+
+#ifdef __cplusplus
+}
+#endif
+
+static inline size_t
+CPOpcode_Length(unsigned char op)
+{
+    return cp_opcodes[op].operand == CP_OPERAND_NONE ? 1 : 5;
+}
+
+/* Append an instruction at `dst' and return its length. */
+static inline size_t
+CPOpcode_Emit(unsigned char *dst, unsigned char op, uint32_t operand)
+{
+    dst[0] = op;
+    if(cp_opcodes[op].operand == CP_OPERAND_NONE) {
+        return 1;
+    }
+    CPBytecode_PutU32(dst + 1, operand);
+    return 5;
+}
+
+#endif /* _CP_OPCODE_H_ */
@@ -0,0 +1,129 @@
+/*
+ * opstats.c - per-opcode execution counters for the dispatch loop.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "opstats.h"
+#include "cptypes.h"
+#include "opcode.h"
+#include "report_error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef CP_OPCODE_STATS
+
+CPOpStats cp_opstats = { .last_op = -1 };
+
+typedef struct
+{
+    uint64_t count;
+    int first;
+    int second;
+} stat_row_t;
+
+/* Opcodes past the table can only come from a bad image; print those as numbers. */
+static void
+print_opcode(FILE *out, int op)
+{
+    if(op < CP_OP_COUNT) {
+        fputs(cp_opcodes[op].name, out);
+    } else {
+        fprintf(out, "%d", op);
+    }
+}
+
+static int
+compare_rows(const void *a, const void *b)
+{
+    uint64_t x = ((const stat_row_t *)a)->count;
+    uint64_t y = ((const stat_row_t *)b)->count;
+    return (x < y) - (x > y); /* descending */
+}
+
+/*
+ * Print tab-separated tables with '#' header lines so the output can be
+ * fed straight to sort(1), awk or a spreadsheet.
+ */
+int
+CPOpStats_Dump(FILE *out)
+{
+    CPOpStats_Leave();
+    stat_row_t *rows = malloc(CP_OPSTATS_OPCODES * CP_OPSTATS_OPCODES * sizeof(stat_row_t));
+    if(rows == NULL) {
+        return -1;
+    }
+    uint64_t total = 0;
+    size_t n = 0;
+    for(int op = 0; op < CP_OPSTATS_OPCODES; op++) {
+        total += cp_opstats.counts[op];
+        if(cp_opstats.counts[op] != 0) {
+            rows[n].count = cp_opstats.counts[op];
+            rows[n].first = op;
+            rows[n].second = -1;
+            n++;
+        }
+    }
+    qsort(rows, n, sizeof(stat_row_t), compare_rows);
+    fprintf(out, "# opcode\tcount\tpercent\tticks\tticks/op\n");
+    for(size_t i = 0; i < n; i++) {
+        int op = rows[i].first;
+        print_opcode(out, op);
+        fprintf(out, "\t%llu\t%.2f\t%llu\t%.1f\n",
+                (unsigned long long)rows[i].count,
+                100.0 * (double)rows[i].count / (double)total,
+                (unsigned long long)cp_opstats.ticks[op],
+                (double)cp_opstats.ticks[op] / (double)rows[i].count);
+    }
+    n = 0;
+    uint64_t pair_total = 0;
+    for(int a = 0; a < CP_OPSTATS_OPCODES; a++) {
+        for(int b = 0; b < CP_OPSTATS_OPCODES; b++) {
+            if(cp_opstats.pairs[a][b] != 0) {
+                pair_total += cp_opstats.pairs[a][b];
+                rows[n].count = cp_opstats.pairs[a][b];
+                rows[n].first = a;
+                rows[n].second = b;
+                n++;
+            }
+        }
+    }
+    qsort(rows, n, sizeof(stat_row_t), compare_rows);
+    fprintf(out, "\n# first\tsecond\tcount\tpercent\n");
+    for(size_t i = 0; i < n; i++) {
+        print_opcode(out, rows[i].first);
+        fputc('\t', out);
+        print_opcode(out, rows[i].second);
+        fprintf(out, "\t%llu\t%.2f\n",
+                (unsigned long long)rows[i].count,
+                100.0 * (double)rows[i].count / (double)pair_total);
+    }
+    free(rows);
+    return 0;
+}
+
+#else /* CP_OPCODE_STATS */
+
+int
+CPOpStats_Dump(FILE *out)
+{
+    CP_UNUSED(out);
+    cp_report_error("Opcode statistics are not available: rebuild with --enable-opcode-stats.");
+    return -1;
+}
+
+#endif /* CP_OPCODE_STATS */
@@ -0,0 +1,102 @@
+/*
+ * opstats.h - per-opcode execution counters for the dispatch loop.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_OPSTATS_H_
+#define _CP_OPSTATS_H_
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define CP_OPSTATS_OPCODES 256
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Configure with --enable-opcode-stats to define CP_OPCODE_STATS.
+ * Otherwise the macros below expand to nothing and the dispatch loop
+ * carries no instrumentation at all.
+ */
+#ifdef CP_OPCODE_STATS
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define CP_OPSTATS_TICKS() __rdtsc()
+#else
+#include "platform/clock.h"
+#define CP_OPSTATS_TICKS() CPClock_Monotonic()
+#endif
+
+typedef struct
+{
+    uint64_t counts[CP_OPSTATS_OPCODES];
+    uint64_t ticks[CP_OPSTATS_OPCODES];
+    uint64_t pairs[CP_OPSTATS_OPCODES][CP_OPSTATS_OPCODES];
+    uint64_t last_ticks;
+    int last_op;
+} CPOpStats;
+
+extern CPOpStats cp_opstats;
+
+/*
+ * Called at the top of every dispatch: the time since the previous
+ * dispatch is charged to the previous opcode.
+ */
+static inline void
+CPOpStats_Dispatch(unsigned char op)
+{
+    uint64_t now = CP_OPSTATS_TICKS();
+    int last = cp_opstats.last_op;
+    if(last >= 0) {
+        cp_opstats.ticks[last] += now - cp_opstats.last_ticks;
+        cp_opstats.pairs[last][op]++;
+    }
+    cp_opstats.counts[op]++;
+    cp_opstats.last_op = op;
+    cp_opstats.last_ticks = now;
+}
+
+/* Called when the dispatch loop exits so the last opcode is charged. */
+static inline void
+CPOpStats_Leave(void)
+{
+    int last = cp_opstats.last_op;
+    if(last >= 0) {
+        cp_opstats.ticks[last] += CP_OPSTATS_TICKS() - cp_opstats.last_ticks;
+        cp_opstats.last_op = -1;
+    }
+}
+
+#define CP_OPSTATS_DISPATCH(op) CPOpStats_Dispatch((unsigned char)(op))
+#define CP_OPSTATS_LEAVE() CPOpStats_Leave()
+
+#else /* CP_OPCODE_STATS */
+
+#define CP_OPSTATS_DISPATCH(op) ((void)0)
+#define CP_OPSTATS_LEAVE() ((void)0)
+
+#endif /* CP_OPCODE_STATS */
+
+int CPOpStats_Dump(FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_OPSTATS_H_ */
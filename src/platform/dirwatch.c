@@ -0,0 +1,149 @@
+/*
+ * dirwatch.c - directory change notification.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "dirwatch.h"
+
+#include <stddef.h>
+
+#ifndef _WIN32
+#include <dirent.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+
+/*
+ * IN_CLOSE_WRITE rather than IN_MODIFY: an editor's save is one event
+ * and the file is complete when it arrives.
+ */
+#define WATCH_EVENTS (IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO)
+#endif
+
+int
+CPDirWatch_Open(CPDirWatch *watch, const char *dir)
+{
+#ifdef __linux__
+    watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if(watch->fd < 0) {
+        return -1;
+    }
+    watch->wd = inotify_add_watch(watch->fd, dir, WATCH_EVENTS | IN_ONLYDIR);
+    if(watch->wd < 0) {
+        close(watch->fd);
+        return -1;
+    }
+    watch->dir = dir;
+    return 0;
+#else
+    (void)dir;
+    watch->fd = -1;
+    watch->wd = -1;
+    watch->dir = NULL;
+    return -1;
+#endif
+}
+
+int
+CPDirWatch_List(const char *dir, CPDirWatchFunc changed, void *context)
+{
+#ifndef _WIN32
+    DIR *d = opendir(dir);
+    if(d == NULL) {
+        return -1;
+    }
+    int rv = 0;
+    struct dirent *entry;
+    while(rv == 0 && (entry = readdir(d)) != NULL) {
+        if(entry->d_name[0] != '.') {
+            rv = changed(context, entry->d_name);
+        }
+    }
+    closedir(d);
+    return rv;
+#else
+    (void)dir;
+    (void)changed;
+    (void)context;
+    return -1;
+#endif
+}
+
+int
+CPDirWatch_Wait(CPDirWatch *watch, int timeout_ms, CPDirWatchFunc changed, void *context)
+{
+#ifdef __linux__
+    struct pollfd pfd;
+    pfd.fd = watch->fd;
+    pfd.events = POLLIN;
+    int n = poll(&pfd, 1, timeout_ms);
+    if(n <= 0) {
+        return n < 0 && errno != EINTR ? -1 : 0;
+    }
+    /* Aligned for struct inotify_event; holds several events at once. */
+    union
+    {
+        struct inotify_event event;
+        char bytes[16 * 1024];
+    } buffer;
+    int rv = 0;
+    for(;;) {
+        ssize_t length = read(watch->fd, buffer.bytes, sizeof(buffer.bytes));
+        if(length < 0) {
+            return errno == EAGAIN || errno == EINTR ? rv : -1;
+        }
+        for(char *p = buffer.bytes; p < buffer.bytes + length;) {
+            const struct inotify_event *event = (const struct inotify_event *)(void *)p;
+            if(event->mask & IN_Q_OVERFLOW) {
+                if(CPDirWatch_List(watch->dir, changed, context) != 0) {
+                    return -1;
+                }
+                rv = 1;
+            } else if(event->len > 0 && !(event->mask & IN_ISDIR)) {
+                if(changed(context, event->name) != 0) {
+                    return -1;
+                }
+                rv = 1;
+            }
+            p += sizeof(struct inotify_event) + event->len;
+        }
+    }
+#else
+    (void)watch;
+    (void)timeout_ms;
+    (void)changed;
+    (void)context;
+    return -1;
+#endif
+}
+
+void
+CPDirWatch_Close(CPDirWatch *watch)
+{
+#ifdef __linux__
+    if(watch->fd >= 0) {
+        close(watch->fd);
+        watch->fd = -1;
+    }
+#else
+    (void)watch;
+#endif
+}
@@ -0,0 +1,59 @@
+/*
+ * dirwatch.h - directory change notification.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_DIRWATCH_H_
+#define _CP_DIRWATCH_H_
+
+/*
+ * Reports files of one directory that were written and closed, created,
+ * moved in or out, or deleted.  Only Linux (inotify) is supported; other
+ * systems fail to open.
+ */
+typedef struct
+{
+    int fd;
+    int wd;
+    /* Listed again when the kernel drops events; must outlive the watch. */
+    const char *dir;
+} CPDirWatch;
+
+/* Called with the name, relative to the directory, of a changed file. */
+typedef int (*CPDirWatchFunc)(void *context, const char *name);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int CPDirWatch_Open(CPDirWatch *watch, const char *dir);
+/* Report every file now in `dir' to `changed', as if just created. */
+int CPDirWatch_List(const char *dir, CPDirWatchFunc changed, void *context);
+/*
+ * Wait up to `timeout_ms' milliseconds, or forever if negative, for
+ * changes and report them all to `changed'.  If the kernel's queue
+ * overflowed, every file in the directory is reported instead; a file
+ * deleted meanwhile is not.  Returns 1 if there were changes, 0 on
+ * timeout and -1 on error or if `changed' fails.
+ */
+int CPDirWatch_Wait(CPDirWatch *watch, int timeout_ms, CPDirWatchFunc changed, void *context);
+void CPDirWatch_Close(CPDirWatch *watch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_DIRWATCH_H_ */
@@ -0,0 +1,65 @@
+/*
+ * dynlib.c - shared library loading.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "dynlib.h"
+
+#include <stddef.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+void *
+CPDynLib_Open(const char *path)
+{
+#ifdef _WIN32
+    if(*path == '\0') {
+        return GetModuleHandleA(NULL);
+    }
+    return LoadLibraryA(path);
+#else
+    /* RTLD_NOW, so that a missing dependency fails here and not mid-call. */
+    return dlopen(*path == '\0' ? NULL : path, RTLD_NOW | RTLD_LOCAL);
+#endif
+}
+
+CPDynLibFunc
+CPDynLib_Symbol(void *library, const char *name)
+{
+#ifdef _WIN32
+    return (CPDynLibFunc)GetProcAddress(library, name);
+#else
+    return (CPDynLibFunc)dlsym(library, name);
+#endif
+}
+
+void
+CPDynLib_Close(void *library)
+{
+#ifdef _WIN32
+    /* The program's own handle is not counted. */
+    if(library != GetModuleHandleA(NULL)) {
+        FreeLibrary(library);
+    }
+#else
+    dlclose(library);
+#endif
+}
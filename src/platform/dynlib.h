@@ -0,0 +1,43 @@
+/*
+ * dynlib.h - shared library loading.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_DYNLIB_H_
+#define _CP_DYNLIB_H_
+
+/* A function of a library, to be cast to its real type before calling. */
+typedef void (*CPDynLibFunc)(void);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Load the library `path', or return the running program itself if
+ * `path' is empty.  Loading a library again only counts a reference.
+ * Returns NULL on error.
+ */
+void *CPDynLib_Open(const char *path);
+/* The function `name' of `library', or NULL. */
+CPDynLibFunc CPDynLib_Symbol(void *library, const char *name);
+void CPDynLib_Close(void *library);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_DYNLIB_H_ */
@@ -18,6 +18,7 @@
 
 #include "config.h"
 #include "mmap.h"
+#include "trace.h"
 
 #include <stdio.h>
 #include <assert.h>
@@ -154,52 +155,158 @@ convert_flags(file_t file, prot_t p, int flags)
     if(file == -1){
         mmap_flags |= MAP_ANONYMOUS;
     }
+#ifdef MAP_POPULATE
+    if(flags & CP_MMAP_FLAG_POPULATE) {
+        mmap_flags |= MAP_POPULATE;
+    }
+#endif
     return mmap_flags;
 #endif
 }
 
-int 
-CPMemoryMapping_Create(CPMemoryMapping *mapping, FILE *file, size_t size, size_t offset, int prot, int flags)
+#ifndef _WIN32
+static void
+populate(void *addr, size_t size, int prot, int flags)
 {
-    file_t handle = convert_file_to_handle_or_fd(file);
-    size = convert_size(handle, size);
-    if(size == (size_t)-1) {
-        return -1;
+    /* Write faults on a shared file mapping would dirty every page. */
+    int writable = (prot & CP_MMAP_PROT_WRITE) && !(flags & CP_MMAP_FLAG_SHARED);
+#ifdef MADV_POPULATE_WRITE
+    if(madvise(addr, size, writable ? MADV_POPULATE_WRITE : MADV_POPULATE_READ) == 0) {
+        return;
+    }
+#endif
+    /* Writing back what is already there faults a private page in for writing. */
+    size_t page = CPMemoryMapping_PageSize();
+    for(size_t off = 0; off < size; off += page) {
+        volatile char *p = (volatile char *)addr + off;
+        if(writable) {
+            *p = *p;
+        } else {
+            (void)*p;
+        }
     }
+}
+
+static int
+map_huge_anonymous(CPMemoryMapping *mapping, size_t size, prot_t p, flags_t f)
+{
+    size_t huge = CP_MMAP_HUGEPAGE_SIZE;
+    size = (size + huge - 1) & ~(huge - 1);
     mapping->size = size;
-    if(offset > size) {
+#ifdef MAP_HUGETLB
+    /* Reserved huge pages (vm.nr_hugepages) are the only guaranteed kind. */
+    mapping->addr = mmap(NULL, size, p, f | MAP_HUGETLB, -1, 0);
+    if(mapping->addr != MAP_FAILED) {
+        return 0;
+    }
+#endif
+#ifdef MAP_POPULATE
+    f &= ~MAP_POPULATE;
+#endif
+    /*
+     * Fall back to transparent huge pages, which the kernel only uses for
+     * 2 MB aligned ranges: over-map by one huge page and trim both ends.
+     */
+    char *raw = mmap(NULL, size + huge, p, f, -1, 0);
+    if(raw == MAP_FAILED) {
         return -1;
     }
+    char *aligned = (char *)(((uintptr_t)raw + huge - 1) & ~(uintptr_t)(huge - 1));
+    if(aligned != raw) {
+        munmap(raw, (size_t)(aligned - raw));
+    }
+    if(aligned + size != raw + size + huge) {
+        munmap(aligned + size, (size_t)(raw + size + huge - (aligned + size)));
+    }
+    mapping->addr = aligned;
+#ifdef MADV_HUGEPAGE
+    madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+    return 0;
+}
+#endif /* _WIN32 */
+
+static int
+create_mapping(CPMemoryMapping *mapping, void *addr, FILE *file, size_t size, size_t offset, int prot, int flags)
+{
+    file_t handle = convert_file_to_handle_or_fd(file);
+    if(size == (size_t)-1) {
+        /* Map from `offset' to the end of the file. */
+        size_t file_size = convert_size(handle, size);
+        if(file_size == (size_t)-1 || offset > file_size) {
+            return -1;
+        }
+        size = file_size - offset;
+    }
+    mapping->size = size;
     prot_t p = convert_prot(prot, flags);
     flags_t f = convert_flags(handle, p, flags);
 #ifdef _WIN32
-  #ifdef _WIN64
-    mapping->hMapping = CreateFileMappingA(handle, NULL, p, size >> 32, (DWORD)size, NULL);
-  #else /* _WIN64 */
-    mapping->hMapping = CreateFileMappingA(handle, NULL, p, 0, (DWORD)size, NULL);
-  #endif /* _WIN64 */
+    /* The mapping object has to reach the end of the view. */
+    unsigned long long end = (unsigned long long)size;
+    if(handle != INVALID_HANDLE_VALUE) {
+        end += offset;
+    }
+    mapping->hMapping = CreateFileMappingA(handle, NULL, p, (DWORD)(end >> 32), (DWORD)end, NULL);
     if(mapping->hMapping == NULL || mapping->hMapping == INVALID_HANDLE_VALUE) {
         return -1;
     }
-  #ifdef _WIN64
-    mapping->addr = MapViewOfFile(mapping->hMapping, f, offset >> 32, (DWORD)offset, size);
-  #else /* _WIN64 */
-    mapping->addr = MapViewOfFile(mapping->hMapping, f, 0, offset, size);
-  #endif /* _WIN64 */
+    mapping->addr = MapViewOfFileEx(mapping->hMapping, f, (DWORD)((unsigned long long)offset >> 32),
+                                    (DWORD)offset, size, addr);
     if(mapping->addr == NULL) {
         CloseHandle(mapping->hMapping);
         return -1;
     }
     return 0;
 #else /* _WIN32 */
-    mapping->addr = mmap(NULL, size, p, f, handle, offset);
+    if(addr != NULL) {
+        f |= MAP_FIXED;
+    } else if((flags & CP_MMAP_FLAG_HUGEPAGE) && handle == -1) {
+        if(map_huge_anonymous(mapping, size, p, f) != 0) {
+            return -1;
+        }
+        if(flags & CP_MMAP_FLAG_POPULATE) {
+            populate(mapping->addr, mapping->size, prot, flags);
+        }
+        return 0;
+    }
+    mapping->addr = mmap(addr, size, p, f, handle, offset);
     if(mapping->addr == MAP_FAILED) {
         return -1;
     }
+#ifdef MADV_HUGEPAGE
+    if(flags & CP_MMAP_FLAG_HUGEPAGE) {
+        /* Only shmem and some filesystems honour this for files. */
+        madvise(mapping->addr, size, MADV_HUGEPAGE);
+    }
+#endif
+#ifndef MAP_POPULATE
+    if(flags & CP_MMAP_FLAG_POPULATE) {
+        populate(mapping->addr, size, prot, flags);
+    }
+#endif
     return 0;
 #endif
 }
 
+int 
+CPMemoryMapping_Create(CPMemoryMapping *mapping, FILE *file, size_t size, size_t offset, int prot, int flags)
+{
+    CPTrace_Begin("CPMemoryMapping_Create");
+    int rv = create_mapping(mapping, NULL, file, size, offset, prot, flags);
+    CPTrace_End("CPMemoryMapping_Create");
+    return rv;
+}
+
+int
+CPMemoryMapping_CreateAt(CPMemoryMapping *mapping, void *addr, FILE *file, size_t size, size_t offset, int prot, int flags)
+{
+    CPTrace_Begin("CPMemoryMapping_Create");
+    int rv = create_mapping(mapping, addr, file, size, offset, prot, flags);
+    CPTrace_End("CPMemoryMapping_Create");
+    return rv;
+}
+
 int CPMemoryMapping_Protect(CPMemoryMapping *mapping, size_t offset, size_t size, int prot)
 {
     if(size == (size_t)-1) {
@@ -218,6 +325,104 @@ int CPMemoryMapping_Protect(CPMemoryMapping *mapping, size_t offset, size_t size
     return 0;
 }
 
+int CPMemoryMapping_Advise(CPMemoryMapping *mapping, size_t offset, size_t size, int advice)
+{
+    if(offset > mapping->size) {
+        return -1;
+    }
+    if(size == (size_t)-1) {
+        size = mapping->size - offset;
+    }
+    if(size > mapping->size - offset) {
+        return -1;
+    }
+    /* The kernel wants a page-aligned start. */
+    size_t start = offset & ~(CPMemoryMapping_PageSize() - 1);
+    size += offset - start;
+#ifdef _WIN32
+    /*
+     * Windows has no cheap equivalent for these on file views, and
+     * every advice but DONTNEED is only a hint anyway.  DONTNEED leaves
+     * the contents undefined, so keeping them is allowed.
+     */
+    (void)start; // unused
+    if(advice < CP_MMAP_ADVICE_NORMAL || advice > CP_MMAP_ADVICE_HUGEPAGE) {
+        return -1;
+    }
+    return 0;
+#else
+    int a;
+    switch(advice) {
+        case CP_MMAP_ADVICE_NORMAL:
+            a = MADV_NORMAL;
+            break;
+        case CP_MMAP_ADVICE_SEQUENTIAL:
+            a = MADV_SEQUENTIAL;
+            break;
+        case CP_MMAP_ADVICE_RANDOM:
+            a = MADV_RANDOM;
+            break;
+        case CP_MMAP_ADVICE_WILLNEED:
+            a = MADV_WILLNEED;
+            break;
+        case CP_MMAP_ADVICE_DONTNEED:
+            a = MADV_DONTNEED;
+            break;
+        case CP_MMAP_ADVICE_HUGEPAGE:
+#ifdef MADV_HUGEPAGE
+            a = MADV_HUGEPAGE;
+            break;
+#else
+            return 0;
+#endif
+        default:
+            return -1;
+    }
+    if(madvise((char *)mapping->addr + start, size, a) != 0) {
+        return -1;
+    }
+    return 0;
+#endif
+}
+
+int CPMemoryMapping_FileSize(FILE *file, size_t *size)
+{
+    file_t handle = convert_file_to_handle_or_fd(file);
+    *size = convert_size(handle, (size_t)-1);
+    return *size == (size_t)-1 ? -1 : 0;
+}
+
+size_t CPMemoryMapping_Granularity(void)
+{
+#ifdef _WIN32
+    static size_t granularity = 0;
+    if(granularity == 0) {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        granularity = (size_t)info.dwAllocationGranularity;
+    }
+    return granularity;
+#else
+    return CPMemoryMapping_PageSize();
+#endif
+}
+
+size_t CPMemoryMapping_PageSize(void)
+{
+    static size_t page_size = 0;
+    if(page_size == 0) {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        page_size = (size_t)info.dwPageSize;
+#else
+        long r = sysconf(_SC_PAGESIZE);
+        page_size = r > 0 ? (size_t)r : 4096;
+#endif
+    }
+    return page_size;
+}
+
 int CPMemoryMapping_Destroy(CPMemoryMapping *mapping)
 {
 #ifdef _WIN32
@@ -45,9 +45,42 @@ typedef struct
 
 #define CP_MMAP_FLAG_SHARED 0b01
 #define CP_MMAP_FLAG_PRIVATE 0b10
+/* Fault every page in before returning (a hint where unsupported). */
+#define CP_MMAP_FLAG_POPULATE 0b100
+/*
+ * Back the mapping with 2 MB pages.  Anonymous mappings first try
+ * reserved huge pages, then fall back to transparent huge pages;
+ * their size is rounded up to CP_MMAP_HUGEPAGE_SIZE.
+ */
+#define CP_MMAP_FLAG_HUGEPAGE 0b1000
+
+#define CP_MMAP_HUGEPAGE_SIZE (2 * 1024 * 1024)
+
+/* Advice for CPMemoryMapping_Advise(); all but DONTNEED are hints. */
+#define CP_MMAP_ADVICE_NORMAL 0
+#define CP_MMAP_ADVICE_SEQUENTIAL 1
+#define CP_MMAP_ADVICE_RANDOM 2
+#define CP_MMAP_ADVICE_WILLNEED 3
+/* Release the pages; their contents are undefined afterwards. */
+#define CP_MMAP_ADVICE_DONTNEED 4
+#define CP_MMAP_ADVICE_HUGEPAGE 5
 
+/*
+ * `offset' must be a multiple of CPMemoryMapping_Granularity().
+ * A `size' of (size_t)-1 maps from `offset' to the end of the file.
+ */
 int CPMemoryMapping_Create(CPMemoryMapping *mapping, FILE *file, size_t size, size_t offset, int prot, int flags);
+/*
+ * Like CPMemoryMapping_Create() but at exactly `addr'.  On POSIX systems
+ * this replaces whatever was mapped there; on Windows the range must be
+ * free.  `addr' must be aligned to CPMemoryMapping_Granularity().
+ */
+int CPMemoryMapping_CreateAt(CPMemoryMapping *mapping, void *addr, FILE *file, size_t size, size_t offset, int prot, int flags);
 int CPMemoryMapping_Protect(CPMemoryMapping *mapping, size_t offset, size_t size, int prot);
+int CPMemoryMapping_Advise(CPMemoryMapping *mapping, size_t offset, size_t size, int advice);
 int CPMemoryMapping_Destroy(CPMemoryMapping *mapping);
+int CPMemoryMapping_FileSize(FILE *file, size_t *size);
+size_t CPMemoryMapping_Granularity(void);
+size_t CPMemoryMapping_PageSize(void);
 
 #endif /* _CP_MMAP_H_ */
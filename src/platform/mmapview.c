@@ -0,0 +1,122 @@
+/*
+ * mmapview.c - bounded sliding-window views of large files.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "mmapview.h"
+
+#include <string.h>
+
+int
+CPMemoryView_Open(CPMemoryView *view, FILE *file, size_t window_size, int prot, int flags)
+{
+    memset(view, 0, sizeof(CPMemoryView));
+    if(file == NULL) {
+        return -1;
+    }
+    if(CPMemoryMapping_FileSize(file, &view->file_size) != 0) {
+        return -1;
+    }
+    /* Round up, and leave room for at least one granule of data. */
+    size_t granularity = CPMemoryMapping_Granularity();
+    window_size = (window_size + granularity - 1) / granularity * granularity;
+    if(window_size < 2 * granularity) {
+        window_size = 2 * granularity;
+    }
+    view->file = file;
+    view->window_size = window_size;
+    view->prot = prot;
+    view->flags = flags;
+    return 0;
+}
+
+/*
+ * The longest range CPMemoryView_Get() accepts: a range may start
+ * anywhere inside the first granule of a window.
+ */
+size_t
+CPMemoryView_MaxLength(const CPMemoryView *view)
+{
+    return view->window_size - CPMemoryMapping_Granularity() + 1;
+}
+
+int
+CPMemoryView_Get(CPMemoryView *view, size_t offset, size_t length, void **ptr)
+{
+    if(offset > view->file_size || length > view->file_size - offset) {
+        return -1;
+    }
+    if(length > CPMemoryView_MaxLength(view)) {
+        return -1;
+    }
+    view->clock++;
+    CPMemoryViewWindow *victim = &view->windows[0];
+    for(int i = 0; i < CP_MMAP_VIEW_WINDOWS; i++) {
+        CPMemoryViewWindow *window = &view->windows[i];
+        if(window->mapped && offset >= window->offset &&
+           offset + length <= window->offset + window->mapping.size) {
+            window->last_use = view->clock;
+            *ptr = (char *)window->mapping.addr + (offset - window->offset);
+            return 0;
+        }
+        if(!window->mapped) {
+            if(victim->mapped) {
+                victim = window;
+            }
+        } else if(victim->mapped && window->last_use < victim->last_use) {
+            victim = window;
+        }
+    }
+    size_t granularity = CPMemoryMapping_Granularity();
+    size_t start = offset / granularity * granularity;
+    size_t size = view->window_size;
+    if(size > view->file_size - start) {
+        size = view->file_size - start;
+    }
+    if(size == 0) {
+        /* An empty range at the end of the file: nothing to map or evict. */
+        *ptr = NULL;
+        return 0;
+    }
+    if(victim->mapped) {
+        CPMemoryMapping_Destroy(&victim->mapping);
+        victim->mapped = 0;
+    }
+    if(CPMemoryMapping_Create(&victim->mapping, view->file, size, start, view->prot, view->flags) != 0) {
+        return -1;
+    }
+    victim->offset = start;
+    victim->last_use = view->clock;
+    victim->mapped = 1;
+    *ptr = (char *)victim->mapping.addr + (offset - start);
+    return 0;
+}
+
+int
+CPMemoryView_Close(CPMemoryView *view)
+{
+    int rv = 0;
+    for(int i = 0; i < CP_MMAP_VIEW_WINDOWS; i++) {
+        if(view->windows[i].mapped) {
+            if(CPMemoryMapping_Destroy(&view->windows[i].mapping) != 0) {
+                rv = -1;
+            }
+            view->windows[i].mapped = 0;
+        }
+    }
+    return rv;
+}
@@ -0,0 +1,69 @@
+/*
+ * mmapview.h - bounded sliding-window views of large files.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_MMAPVIEW_H_
+#define _CP_MMAPVIEW_H_
+
+#include "mmap.h"
+
+#include <stdint.h>
+#include <stdio.h>
+
+/* Number of windows kept mapped at once. */
+#define CP_MMAP_VIEW_WINDOWS 4
+
+typedef struct
+{
+    CPMemoryMapping mapping;
+    size_t offset;
+    uint64_t last_use;
+    int mapped;
+} CPMemoryViewWindow;
+
+/*
+ * A view maps at most CP_MMAP_VIEW_WINDOWS windows of `window_size'
+ * bytes of a file at a time, so address space and RSS stay bounded no
+ * matter how large the file is.  Windows start at the granularity
+ * boundary below the requested offset and the least recently used one
+ * is remapped on a miss, which suits readers that mostly move forward.
+ */
+typedef struct
+{
+    FILE *file;
+    size_t file_size;
+    size_t window_size;
+    int prot;
+    int flags;
+    uint64_t clock;
+    CPMemoryViewWindow windows[CP_MMAP_VIEW_WINDOWS];
+} CPMemoryView;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int CPMemoryView_Open(CPMemoryView *view, FILE *file, size_t window_size, int prot, int flags);
+size_t CPMemoryView_MaxLength(const CPMemoryView *view);
+int CPMemoryView_Get(CPMemoryView *view, size_t offset, size_t length, void **ptr);
+int CPMemoryView_Close(CPMemoryView *view);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_MMAPVIEW_H_ */
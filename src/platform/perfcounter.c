@@ -0,0 +1,216 @@
+/*
+ * perfcounter.c - cross-platform hardware performance counters.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "perfcounter.h"
+#include "clock.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+/*
+ * Only Linux exposes the hardware counters to user space without a
+ * driver.  Everywhere else, and whenever the kernel refuses (for example
+ * kernel.perf_event_paranoid or a container seccomp profile), only the
+ * wall time in elapsed_ns is filled in and `available' stays 0.
+ * Page faults fall back to getrusage(), which counts the whole process.
+ * Setting CP_PERF_DISABLE_ENV forces that fallback, so it can be tested
+ * on hosts that do allow the counters.
+ */
+
+const char *
+CPPerfCounter_Name(int event)
+{
+    switch(event) {
+        case CP_PERF_CYCLES:
+            return "cycles";
+        case CP_PERF_INSTRUCTIONS:
+            return "instructions";
+        case CP_PERF_CACHE_MISSES:
+            return "cache-misses";
+        case CP_PERF_BRANCH_MISSES:
+            return "branch-misses";
+        case CP_PERF_DTLB_MISSES:
+            return "dtlb-misses";
+        case CP_PERF_PAGE_FAULTS:
+            return "page-faults";
+        default:
+            return "unknown";
+    }
+}
+
+#ifdef __linux__
+static const uint32_t event_types[CP_PERF_EVENTS] = {
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE,
+    PERF_TYPE_SOFTWARE,
+};
+
+static const uint64_t event_configs[CP_PERF_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES,
+    PERF_COUNT_HW_BRANCH_MISSES,
+    PERF_COUNT_HW_CACHE_DTLB |
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_SW_PAGE_FAULTS,
+};
+
+static inline int
+open_event(uint32_t type, uint64_t config)
+{
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+int
+CPPerfCounter_Open(CPPerfCounter *counter)
+{
+    memset(counter, 0, sizeof(CPPerfCounter));
+#ifdef __linux__
+    const char *disable = getenv(CP_PERF_DISABLE_ENV);
+    int fallback = disable != NULL && *disable != '\0';
+    for(int i = 0; i < CP_PERF_EVENTS; i++) {
+        counter->fds[i] = fallback ? -1 : open_event(event_types[i], event_configs[i]);
+        if(counter->fds[i] >= 0) {
+            counter->available |= 1 << i;
+        }
+    }
+#elif !defined(_WIN32)
+    for(int i = 0; i < CP_PERF_EVENTS; i++) {
+        counter->fds[i] = -1;
+    }
+#endif
+#ifndef _WIN32
+    counter->available |= 1 << CP_PERF_PAGE_FAULTS;
+#endif
+    return 0;
+}
+
+#ifndef _WIN32
+static uint64_t
+rusage_faults(void)
+{
+    struct rusage usage;
+    if(getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return (uint64_t)usage.ru_minflt + (uint64_t)usage.ru_majflt;
+}
+
+static inline int
+use_rusage_faults(CPPerfCounter *counter)
+{
+#ifdef __linux__
+    return counter->fds[CP_PERF_PAGE_FAULTS] < 0;
+#else
+    (void)counter; // unused
+    return 1;
+#endif
+}
+#endif
+
+int
+CPPerfCounter_Start(CPPerfCounter *counter)
+{
+#ifdef __linux__
+    for(int i = 0; i < CP_PERF_EVENTS; i++) {
+        if(counter->fds[i] >= 0) {
+            ioctl(counter->fds[i], PERF_EVENT_IOC_RESET, 0);
+            ioctl(counter->fds[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+#ifndef _WIN32
+    if(use_rusage_faults(counter)) {
+        counter->start_faults = rusage_faults();
+    }
+#endif
+    counter->start_ns = CPClock_Monotonic();
+    return 0;
+}
+
+int
+CPPerfCounter_Stop(CPPerfCounter *counter)
+{
+    counter->elapsed_ns = CPClock_Monotonic() - counter->start_ns;
+#ifndef _WIN32
+    if(use_rusage_faults(counter)) {
+        counter->values[CP_PERF_PAGE_FAULTS] = rusage_faults() - counter->start_faults;
+    }
+#endif
+#ifdef __linux__
+    for(int i = 0; i < CP_PERF_EVENTS; i++) {
+        if(counter->fds[i] < 0) {
+            continue;
+        }
+        ioctl(counter->fds[i], PERF_EVENT_IOC_DISABLE, 0);
+        uint64_t data[3]; /* value, time enabled, time running */
+        /* A counter the kernel never scheduled counted nothing, not zero. */
+        if(read(counter->fds[i], data, sizeof(data)) != (ssize_t)sizeof(data) || data[2] == 0) {
+            counter->available &= ~(1 << i);
+            continue;
+        }
+        /* Scale up if the kernel multiplexed the counter. */
+        if(data[2] < data[1]) {
+            data[0] = (uint64_t)((double)data[0] * (double)data[1] / (double)data[2]);
+        }
+        counter->values[i] = data[0];
+    }
+#endif
+    return 0;
+}
+
+int
+CPPerfCounter_Close(CPPerfCounter *counter)
+{
+#ifdef __linux__
+    for(int i = 0; i < CP_PERF_EVENTS; i++) {
+        if(counter->fds[i] >= 0) {
+            close(counter->fds[i]);
+            counter->fds[i] = -1;
+        }
+    }
+#endif
+    counter->available = 0;
+    return 0;
+}
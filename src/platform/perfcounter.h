@@ -0,0 +1,62 @@
+/*
+ * perfcounter.h - cross-platform hardware performance counters.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_PERFCOUNTER_H_
+#define _CP_PERFCOUNTER_H_
+
+#include <stdint.h>
+
+#define CP_PERF_CYCLES 0
+#define CP_PERF_INSTRUCTIONS 1
+#define CP_PERF_CACHE_MISSES 2
+#define CP_PERF_BRANCH_MISSES 3
+#define CP_PERF_DTLB_MISSES 4
+#define CP_PERF_PAGE_FAULTS 5
+#define CP_PERF_EVENTS 6
+
+/* If set and not empty, CPPerfCounter_Open() skips the hardware counters. */
+#define CP_PERF_DISABLE_ENV "CPC_NO_PERF_EVENTS"
+
+typedef struct
+{
+    /* Bit n is set when values[n] was measured. */
+    int available;
+    uint64_t values[CP_PERF_EVENTS];
+    uint64_t elapsed_ns;
+    uint64_t start_ns;
+    uint64_t start_faults;
+#ifndef _WIN32
+    int fds[CP_PERF_EVENTS];
+#endif
+} CPPerfCounter;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+const char *CPPerfCounter_Name(int event);
+int CPPerfCounter_Open(CPPerfCounter *counter);
+int CPPerfCounter_Start(CPPerfCounter *counter);
+int CPPerfCounter_Stop(CPPerfCounter *counter);
+int CPPerfCounter_Close(CPPerfCounter *counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_PERFCOUNTER_H_ */
@@ -0,0 +1,174 @@
+/*
+ * ringbuffer.c - double-mapped virtual ring buffer.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "ringbuffer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#define RESERVE_ATTEMPTS 16
+
+/*
+ * Get a file with no name to back both views: a memfd on Linux and an
+ * unlinked temporary file elsewhere.  Its pages live in the page cache
+ * and are never written back while the buffer is alive.
+ */
+static FILE *
+open_backing_file(size_t size)
+{
+    FILE *file = NULL;
+#if defined(__linux__) && defined(SYS_memfd_create)
+    int fd = (int)syscall(SYS_memfd_create, "cp-ringbuffer", 0);
+    if(fd >= 0) {
+        file = fdopen(fd, "w+");
+        if(file == NULL) {
+            close(fd);
+        }
+    }
+#endif
+    if(file == NULL) {
+        file = tmpfile();
+    }
+    if(file == NULL) {
+        return NULL;
+    }
+#ifndef _WIN32
+    /* Windows grows the file when the mapping object is created. */
+    if(ftruncate(fileno(file), (off_t)size) != 0) {
+        fclose(file);
+        return NULL;
+    }
+#else
+    (void)size; // unused
+#endif
+    return file;
+}
+
+static int
+map_twice(CPRingBuffer *ring)
+{
+    int prot = CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE;
+    size_t size = ring->size;
+    for(int attempt = 0; attempt < RESERVE_ATTEMPTS; attempt++) {
+        /*
+         * Find 2 * size bytes of free address space.  Read-only, since
+         * Windows rejects no-access sections; nothing is committed anyway.
+         */
+        CPMemoryMapping reserve;
+        if(CPMemoryMapping_Create(&reserve, NULL, 2 * size, 0, CP_MMAP_PROT_READ, CP_MMAP_FLAG_PRIVATE) != 0) {
+            return -1;
+        }
+        char *base = reserve.addr;
+#ifdef _WIN32
+        /*
+         * Views cannot replace a reservation here, so release it first
+         * and retry if another thread grabs the range in between.
+         */
+        CPMemoryMapping_Destroy(&reserve);
+#endif
+        /* On POSIX systems the two views replace the reservation. */
+        if(CPMemoryMapping_CreateAt(&ring->first, base, ring->file, size, 0, prot, CP_MMAP_FLAG_SHARED) != 0) {
+#ifndef _WIN32
+            CPMemoryMapping_Destroy(&reserve);
+#endif
+            continue;
+        }
+        if(CPMemoryMapping_CreateAt(&ring->second, base + size, ring->file, size, 0, prot, CP_MMAP_FLAG_SHARED) != 0) {
+            CPMemoryMapping_Destroy(&ring->first);
+#ifndef _WIN32
+            reserve.addr = base + size;
+            reserve.size = size;
+            CPMemoryMapping_Destroy(&reserve);
+#endif
+            continue;
+        }
+        ring->base = base;
+        return 0;
+    }
+    return -1;
+}
+
+int
+CPRingBuffer_Create(CPRingBuffer *ring, size_t min_size)
+{
+    memset(ring, 0, sizeof(CPRingBuffer));
+    size_t granularity = CPMemoryMapping_Granularity();
+    if(min_size == 0) {
+        min_size = 1;
+    }
+    ring->size = (min_size + granularity - 1) / granularity * granularity;
+    ring->file = open_backing_file(ring->size);
+    if(ring->file == NULL) {
+        return -1;
+    }
+    if(map_twice(ring) != 0) {
+        fclose(ring->file);
+        ring->file = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int
+CPRingBuffer_Destroy(CPRingBuffer *ring)
+{
+    if(ring->file == NULL) {
+        return 0;
+    }
+    CPMemoryMapping_Destroy(&ring->second);
+    CPMemoryMapping_Destroy(&ring->first);
+    fclose(ring->file);
+    ring->file = NULL;
+    ring->base = NULL;
+    return 0;
+}
+
+size_t
+CPRingBuffer_Write(CPRingBuffer *ring, const void *data, size_t size)
+{
+    size_t avail;
+    void *dst = CPRingBuffer_WritePtr(ring, &avail);
+    if(size > avail) {
+        size = avail;
+    }
+    memcpy(dst, data, size);
+    CPRingBuffer_Produce(ring, size);
+    return size;
+}
+
+size_t
+CPRingBuffer_Read(CPRingBuffer *ring, void *data, size_t size)
+{
+    size_t avail;
+    void *src = CPRingBuffer_ReadPtr(ring, &avail);
+    if(size > avail) {
+        size = avail;
+    }
+    memcpy(data, src, size);
+    CPRingBuffer_Consume(ring, size);
+    return size;
+}
@@ -0,0 +1,94 @@
+/*
+ * ringbuffer.h - double-mapped virtual ring buffer.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_RINGBUFFER_H_
+#define _CP_RINGBUFFER_H_
+
+#include "mmap.h"
+
+#include <stddef.h>
+#include <stdio.h>
+
+/*
+ * The same `size' bytes of memory are mapped twice, back to back, so
+ * the byte after the last one is the first one again.  Every readable
+ * or writable region is therefore one contiguous span, even when it
+ * wraps around the end, and callers never split a copy in two.
+ *
+ * `head' is where reading resumes and `tail' where writing resumes;
+ * 0 <= head <= tail <= head + size.
+ */
+typedef struct
+{
+    CPMemoryMapping first;
+    CPMemoryMapping second;
+    FILE *file;
+    char *base;
+    size_t size;
+    size_t head;
+    size_t tail;
+} CPRingBuffer;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int CPRingBuffer_Create(CPRingBuffer *ring, size_t min_size);
+int CPRingBuffer_Destroy(CPRingBuffer *ring);
+size_t CPRingBuffer_Write(CPRingBuffer *ring, const void *data, size_t size);
+size_t CPRingBuffer_Read(CPRingBuffer *ring, void *data, size_t size);
+
+/* Contiguous span of `*avail' readable bytes. */
+static inline void *
+CPRingBuffer_ReadPtr(CPRingBuffer *ring, size_t *avail)
+{
+    *avail = ring->tail - ring->head;
+    return ring->base + ring->head;
+}
+
+/* Drop `n' bytes from the front after reading them in place. */
+static inline void
+CPRingBuffer_Consume(CPRingBuffer *ring, size_t n)
+{
+    ring->head += n;
+    if(ring->head >= ring->size) {
+        ring->head -= ring->size;
+        ring->tail -= ring->size;
+    }
+}
+
+/* Contiguous span of `*avail' writable bytes. */
+static inline void *
+CPRingBuffer_WritePtr(CPRingBuffer *ring, size_t *avail)
+{
+    *avail = ring->size - (ring->tail - ring->head);
+    return ring->base + ring->tail;
+}
+
+/* Publish `n' bytes written in place at CPRingBuffer_WritePtr(). */
+static inline void
+CPRingBuffer_Produce(CPRingBuffer *ring, size_t n)
+{
+    ring->tail += n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_RINGBUFFER_H_ */
@@ -0,0 +1,324 @@
+/*
+ * profile.c - sampling profiler for CP-level call stacks.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "profile.h"
+#include "cptypes.h"
+#include "numconv.h"
+#include "safe_string.h"
+#include "report_error.h"
+
+#ifndef _WIN32
+#include <signal.h>
+#include <errno.h>
+#include <sys/time.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Samples are aggregated inside the signal handler: identical stacks
+ * share one slot of an open-addressing table and their frames are
+ * stored once in a preallocated pool.  Nothing in the handler allocates.
+ */
+#define PROFILE_SLOTS 16384
+#define PROFILE_POOL_FRAMES (256 * 1024)
+#define PROFILE_MAX_PROBES 64
+
+typedef struct
+{
+    const char *name;
+    uint32_t offset;
+} sample_frame_t;
+
+typedef struct
+{
+    uint64_t hash;
+    uint64_t count;
+    uint32_t start;
+    uint32_t depth;
+    int truncated;
+} sample_slot_t;
+
+CP_THREAD_LOCAL CPProfileFrame cp_profile_frames[CP_PROFILE_MAX_DEPTH];
+CP_THREAD_LOCAL volatile int cp_profile_depth = 0;
+int cp_profile_running = 0;
+
+#ifndef _WIN32
+static char profile_path[CP_MAX_PATH];
+static sample_slot_t *slots = NULL;
+static sample_frame_t *pool = NULL;
+static volatile uint32_t pool_used = 0;
+static volatile uint64_t samples_dropped = 0;
+static struct sigaction old_action;
+static struct itimerval old_timer;
+
+static inline uint64_t
+hash_frame(uint64_t h, const char *name, uint32_t offset)
+{
+    h ^= (uint64_t)(uintptr_t)name;
+    h *= 0x100000001b3ULL;
+    h ^= offset;
+    h *= 0x100000001b3ULL;
+    return h;
+}
+
+static void
+on_sigprof(int sig)
+{
+    CP_UNUSED(sig);
+    int saved_errno = errno;
+    int depth = cp_profile_depth;
+    int truncated = 0;
+    if(depth > CP_PROFILE_MAX_DEPTH) {
+        depth = CP_PROFILE_MAX_DEPTH;
+        truncated = 1;
+    }
+    if(depth < 0) {
+        depth = 0;
+    }
+    uint64_t h = 0xcbf29ce484222325ULL ^ (uint64_t)truncated;
+    for(int i = 0; i < depth; i++) {
+        h = hash_frame(h, cp_profile_frames[i].name, cp_profile_frames[i].offset);
+    }
+    size_t index = (size_t)h & (PROFILE_SLOTS - 1);
+    for(int probe = 0; probe < PROFILE_MAX_PROBES; probe++) {
+        sample_slot_t *slot = &slots[index];
+        if(slot->count == 0) {
+            if(pool_used + (uint32_t)depth > PROFILE_POOL_FRAMES) {
+                break;
+            }
+            slot->start = pool_used;
+            for(int i = 0; i < depth; i++) {
+                pool[slot->start + i].name = cp_profile_frames[i].name;
+                pool[slot->start + i].offset = cp_profile_frames[i].offset;
+            }
+            pool_used += (uint32_t)depth;
+            slot->hash = h;
+            slot->depth = (uint32_t)depth;
+            slot->truncated = truncated;
+            slot->count = 1;
+            errno = saved_errno;
+            return;
+        }
+        if(slot->hash == h && slot->depth == (uint32_t)depth && slot->truncated == truncated) {
+            int same = 1;
+            for(int i = 0; i < depth && same; i++) {
+                same = pool[slot->start + i].name == cp_profile_frames[i].name &&
+                       pool[slot->start + i].offset == cp_profile_frames[i].offset;
+            }
+            if(same) {
+                slot->count++;
+                errno = saved_errno;
+                return;
+            }
+        }
+        index = (index + 1) & (PROFILE_SLOTS - 1);
+    }
+    samples_dropped++;
+    errno = saved_errno;
+}
+#endif /* _WIN32 */
+
+int
+CPProfile_Start(const char *path, unsigned int rate)
+{
+#ifdef _WIN32
+    CP_UNUSED(path);
+    CP_UNUSED(rate);
+    cp_report_error("Profiling is not supported on this platform.");
+    return -1;
+#else
+    if(path == NULL || cp_profile_running || rate == 0 || rate > 1000000) {
+        return -1;
+    }
+    if(strcpy_safe(profile_path, path, CP_MAX_PATH) != 0) {
+        return -1;
+    }
+    slots = calloc(PROFILE_SLOTS, sizeof(sample_slot_t));
+    pool = malloc(PROFILE_POOL_FRAMES * sizeof(sample_frame_t));
+    if(slots == NULL || pool == NULL) {
+        goto error;
+    }
+    pool_used = 0;
+    samples_dropped = 0;
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = on_sigprof;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    if(sigaction(SIGPROF, &action, &old_action) != 0) {
+        goto error;
+    }
+    struct itimerval timer;
+    /* tv_usec must stay below a second, so a rate of 1 Hz is 1 s + 0 us. */
+    timer.it_interval.tv_sec = 1 / rate;
+    timer.it_interval.tv_usec = (1000000 / rate) % 1000000;
+    if(timer.it_interval.tv_sec == 0 && timer.it_interval.tv_usec == 0) {
+        timer.it_interval.tv_usec = 1;
+    }
+    timer.it_value = timer.it_interval;
+    if(setitimer(ITIMER_PROF, &timer, &old_timer) != 0) {
+        sigaction(SIGPROF, &old_action, NULL);
+        goto error;
+    }
+    cp_profile_running = 1;
+    return 0;
+error:
+    free(slots);
+    free(pool);
+    slots = NULL;
+    pool = NULL;
+    return -1;
+#endif
+}
+
+#ifndef _WIN32
+typedef struct
+{
+    char *line;
+    uint64_t count;
+} folded_stack_t;
+
+static int
+compare_stacks(const void *a, const void *b)
+{
+    return strcmp(((const folded_stack_t *)a)->line, ((const folded_stack_t *)b)->line);
+}
+
+static void
+append_frame(char *line, size_t *len, const char *name, uint32_t offset)
+{
+    /* ';' separates frames and ' ' the count, so neither may appear in names. */
+    for(; *name != '\0'; name++) {
+        line[(*len)++] = (*name == ';' || *name == ' ') ? '_' : *name;
+    }
+    *len += (size_t)sprintf(line + *len, "+0x%x", (unsigned int)offset);
+}
+
+static char *
+format_stack(const sample_slot_t *slot)
+{
+    size_t size = 32;
+    for(uint32_t i = 0; i < slot->depth; i++) {
+        const char *name = pool[slot->start + i].name;
+        size += (name != NULL ? strlen(name) : 1) + 16;
+    }
+    char *line = malloc(size);
+    if(line == NULL) {
+        return NULL;
+    }
+    size_t len = 0;
+    if(slot->truncated) {
+        len += (size_t)sprintf(line, "[truncated];");
+    }
+    if(slot->depth == 0) {
+        len += (size_t)sprintf(line + len, "[native]");
+    }
+    for(uint32_t i = 0; i < slot->depth; i++) {
+        if(i > 0) {
+            line[len++] = ';';
+        }
+        sample_frame_t *frame = &pool[slot->start + i];
+        append_frame(line, &len, frame->name != NULL ? frame->name : "?", frame->offset);
+    }
+    line[len] = '\0';
+    return line;
+}
+#endif /* _WIN32 */
+
+/*
+ * Stop sampling and write the aggregated stacks in folded format:
+ * one "outer;inner;leaf count" line per distinct stack.
+ */
+int
+CPProfile_Stop(void)
+{
+#ifdef _WIN32
+    return 0;
+#else
+    if(!cp_profile_running) {
+        return 0;
+    }
+    cp_profile_running = 0;
+    setitimer(ITIMER_PROF, &old_timer, NULL);
+    sigaction(SIGPROF, &old_action, NULL);
+    int rv = 0;
+    size_t count = 0;
+    FILE *out = NULL;
+    folded_stack_t *stacks = malloc(PROFILE_SLOTS * sizeof(folded_stack_t));
+    if(stacks == NULL) {
+        rv = -1;
+        goto end;
+    }
+    for(size_t i = 0; i < PROFILE_SLOTS; i++) {
+        if(slots[i].count == 0) {
+            continue;
+        }
+        stacks[count].line = format_stack(&slots[i]);
+        if(stacks[count].line == NULL) {
+            rv = -1;
+            goto end;
+        }
+        stacks[count].count = slots[i].count;
+        count++;
+    }
+    /* Distinct name pointers may carry the same text: merge by line. */
+    qsort(stacks, count, sizeof(folded_stack_t), compare_stacks);
+    out = fopen(profile_path, "w");
+    if(out == NULL) {
+        cp_report_error("Cannot open profile output '%s'.", profile_path);
+        rv = -1;
+        goto end;
+    }
+    for(size_t i = 0; i < count; ) {
+        uint64_t total = 0;
+        size_t j = i;
+        for(; j < count && strcmp(stacks[j].line, stacks[i].line) == 0; j++) {
+            total += stacks[j].count;
+        }
+        char number[CP_NUM_BUFFER_SIZE];
+        size_t length = CPNum_FormatU64(total, number);
+        number[length] = '\n';
+        fputs(stacks[i].line, out);
+        fputc(' ', out);
+        fwrite(number, 1, length + 1, out);
+        i = j;
+    }
+    if(samples_dropped > 0) {
+        cp_report_error("Profiler dropped %llu samples.",
+                        (unsigned long long)samples_dropped);
+    }
+end:
+    if(out != NULL && fclose(out) != 0) {
+        cp_report_error("Cannot write profile output '%s'.", profile_path);
+        rv = -1;
+    }
+    for(size_t i = 0; i < count; i++) {
+        free(stacks[i].line);
+    }
+    free(stacks);
+    free(slots);
+    free(pool);
+    slots = NULL;
+    pool = NULL;
+    return rv;
+#endif
+}
@@ -0,0 +1,87 @@
+/*
+ * profile.h - sampling profiler for CP-level call stacks.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_PROFILE_H_
+#define _CP_PROFILE_H_
+
+#include "cptypes.h"
+
+#include <stdint.h>
+
+#define CP_PROFILE_DEFAULT_RATE 997
+#define CP_PROFILE_MAX_DEPTH 128
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The interpreter keeps a shadow stack of CP frames per thread; the
+ * SIGPROF handler copies the interrupted thread's on every tick.  Frame
+ * names must outlive the profile.
+ */
+typedef struct
+{
+    const char * volatile name;
+    volatile uint32_t offset;
+} CPProfileFrame;
+
+extern CP_THREAD_LOCAL CPProfileFrame cp_profile_frames[CP_PROFILE_MAX_DEPTH];
+extern CP_THREAD_LOCAL volatile int cp_profile_depth;
+/* Nonzero from CPProfile_Start() to CPProfile_Stop(). */
+extern int cp_profile_running;
+
+int CPProfile_Start(const char *path, unsigned int rate);
+int CPProfile_Stop(void);
+
+static inline void
+CPProfile_PushFrame(const char *name)
+{
+    int depth = cp_profile_depth;
+    if(depth < CP_PROFILE_MAX_DEPTH) {
+        cp_profile_frames[depth].name = name;
+        cp_profile_frames[depth].offset = 0;
+    }
+    /* Publish the frame only after it is filled in. */
+    cp_profile_depth = depth + 1;
+}
+
+static inline void
+CPProfile_PopFrame(void)
+{
+    cp_profile_depth--;
+}
+
+/*
+ * Record the bytecode offset the innermost frame is executing.  The
+ * interpreter calls this only while a profile is running.
+ */
+static inline void
+CPProfile_SetOffset(uint32_t offset)
+{
+    int depth = cp_profile_depth;
+    if(depth > 0 && depth <= CP_PROFILE_MAX_DEPTH) {
+        cp_profile_frames[depth - 1].offset = offset;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_PROFILE_H_ */
@@ -0,0 +1,357 @@
+/*
+ * rope.c - immutable strings with cheap concatenation.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "rope.h"
+#include "cptypes.h"
+#include "hashmap.h"
+#include "slab.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* AVL depth is below 1.45 * log2(n), so 128 covers any length. */
+#define MAX_DEPTH 128
+
+/*
+ * Nodes and short leaves come from the slab allocator.  A leaf's bytes
+ * follow the header unless the leaf was flattened from a node.
+ */
+static inline size_t
+leaf_size(const CPRope *rope)
+{
+    if(rope->flags & CP_ROPE_FLAG_OWNS_DATA) {
+        return sizeof(CPRope);
+    }
+    return sizeof(CPRope) + rope->capacity + 1;
+}
+
+static CPRope *
+new_flat(size_t length, size_t capacity)
+{
+    CPRope *rope = CPSlab_Alloc(sizeof(CPRope) + capacity + 1);
+    if(rope == NULL) {
+        return NULL;
+    }
+    rope->length = length;
+    rope->capacity = capacity;
+    rope->hash = 0;
+    rope->refcount = 1;
+    rope->depth = 0;
+    rope->flags = 0;
+    rope->left = rope->right = NULL;
+    rope->data = (char *)(rope + 1);
+    rope->data[length] = '\0';
+    return rope;
+}
+
+/*
+ * The helpers below take over the references passed to them, and
+ * accept NULL (out of memory) to keep error handling in one place.
+ */
+static CPRope *
+node(CPRope *left, CPRope *right)
+{
+    CPRope *rope = NULL;
+    if(left != NULL && right != NULL) {
+        rope = CPSlab_Alloc(sizeof(CPRope));
+    }
+    if(rope == NULL) {
+        CPRope_Release(left);
+        CPRope_Release(right);
+        return NULL;
+    }
+    rope->length = left->length + right->length;
+    rope->capacity = 0;
+    rope->hash = 0;
+    rope->refcount = 1;
+    rope->depth = (uint8_t)(1 + (left->depth > right->depth ? left->depth : right->depth));
+    rope->flags = 0;
+    rope->left = left;
+    rope->right = right;
+    rope->data = NULL;
+    return rope;
+}
+
+/*
+ * Leaves built here are given room up to CP_ROPE_SHORT_LENGTH, and an
+ * unshared one is appended to in place.
+ */
+static CPRope *
+flat_concat(CPRope *left, CPRope *right)
+{
+    size_t length = left->length + right->length;
+    if(left->refcount == 1 && left->capacity >= length) {
+        memcpy(left->data + left->length, right->data, right->length);
+        left->data[length] = '\0';
+        left->length = length;
+        left->flags &= (uint8_t)~CP_ROPE_FLAG_HASHED;
+        CPRope_Release(right);
+        return left;
+    }
+    CPRope *rope = new_flat(length, CP_ROPE_SHORT_LENGTH);
+    if(rope != NULL) {
+        memcpy(rope->data, left->data, left->length);
+        memcpy(rope->data + left->length, right->data, right->length);
+    }
+    CPRope_Release(left);
+    CPRope_Release(right);
+    return rope;
+}
+
+/*
+ * Give up the reference to `rope' and get references to its children.
+ * When it was the last reference the children are taken over as they
+ * are, which is what makes CPRope_Append() on an unshared rope cheap.
+ */
+static void
+split(CPRope *rope, CPRope **left, CPRope **right)
+{
+    *left = rope->left;
+    *right = rope->right;
+    if(--rope->refcount == 0) {
+        CPSlab_Free(rope, sizeof(CPRope));
+    } else {
+        CPRope_Retain(*left);
+        CPRope_Retain(*right);
+    }
+}
+
+/* node() that restores the AVL invariant when depths differ by two. */
+static CPRope *
+balance(CPRope *left, CPRope *right)
+{
+    if(left == NULL || right == NULL) {
+        return node(left, right);
+    }
+    CPRope *a, *b, *c, *d;
+    if(right->depth > left->depth + 1) {
+        split(right, &b, &c);
+        if(b->depth > c->depth) {
+            split(b, &a, &b);
+            return node(node(left, a), node(b, c));
+        }
+        return node(node(left, b), c);
+    }
+    if(left->depth > right->depth + 1) {
+        split(left, &a, &b);
+        if(b->depth > a->depth) {
+            split(b, &c, &d);
+            return node(node(a, c), node(d, right));
+        }
+        return node(a, node(b, right));
+    }
+    return node(left, right);
+}
+
+static CPRope *
+join(CPRope *left, CPRope *right)
+{
+    if(left == NULL || right == NULL) {
+        return node(left, right);
+    }
+    if(left->length == 0) {
+        CPRope_Release(left);
+        return right;
+    }
+    if(right->length == 0) {
+        CPRope_Release(right);
+        return left;
+    }
+    if(left->depth == 0 && right->depth == 0 &&
+       left->length + right->length <= CP_ROPE_SHORT_LENGTH) {
+        return flat_concat(left, right);
+    }
+    if(left->depth > right->depth + 1 ||
+       (right->depth == 0 && left->depth > 0 && left->right->depth == 0 &&
+        left->right->length + right->length <= CP_ROPE_SHORT_LENGTH)) {
+        /*
+         * Descend the right spine.  This also merges a short append
+         * into the last leaf, so appending small pieces one at a time
+         * does not leave one node per piece.
+         */
+        CPRope *l, *r;
+        split(left, &l, &r);
+        return balance(l, join(r, right));
+    }
+    if(right->depth > left->depth + 1 ||
+       (left->depth == 0 && right->depth > 0 && right->left->depth == 0 &&
+        left->length + right->left->length <= CP_ROPE_SHORT_LENGTH)) {
+        CPRope *l, *r;
+        split(right, &l, &r);
+        return balance(join(left, l), r);
+    }
+    return node(left, right);
+}
+
+CPRope *
+CPRope_FromBytes(const char *data, size_t length)
+{
+    CPRope *rope = new_flat(length, length);
+    if(rope != NULL) {
+        memcpy(rope->data, data, length);
+    }
+    return rope;
+}
+
+CPRope *
+CPRope_FromCString(const char *str)
+{
+    return CPRope_FromBytes(str, strlen(str));
+}
+
+CPRope *
+CPRope_Retain(CPRope *rope)
+{
+    rope->refcount++;
+    return rope;
+}
+
+void
+CPRope_Release(CPRope *rope)
+{
+    if(rope == NULL || --rope->refcount != 0) {
+        return;
+    }
+    if(rope->depth != 0) {
+        CPRope_Release(rope->left);
+        CPRope_Release(rope->right);
+        CPSlab_Free(rope, sizeof(CPRope));
+        return;
+    }
+    if(rope->flags & CP_ROPE_FLAG_OWNS_DATA) {
+        free(rope->data);
+    }
+    CPSlab_Free(rope, leaf_size(rope));
+}
+
+/* `left' + `right'; neither operand is copied unless both are short. */
+CPRope *
+CPRope_Concat(CPRope *left, CPRope *right)
+{
+    return join(CPRope_Retain(left), CPRope_Retain(right));
+}
+
+/*
+ * Like CPRope_Concat() but takes over the caller's reference to
+ * `rope', as in `s = s + piece'.  Nodes of `rope' nobody else holds
+ * are reused rather than copied.
+ */
+CPRope *
+CPRope_Append(CPRope *rope, CPRope *piece)
+{
+    return join(rope, CPRope_Retain(piece));
+}
+
+static CPRope *
+join_range(CPRope *separator, CPRope *const *pieces, size_t begin, size_t end)
+{
+    if(end - begin == 1) {
+        if(begin > 0 && separator != NULL) {
+            return join(CPRope_Retain(separator), CPRope_Retain(pieces[begin]));
+        }
+        return CPRope_Retain(pieces[begin]);
+    }
+    size_t middle = begin + (end - begin) / 2;
+    return join(join_range(separator, pieces, begin, middle),
+                join_range(separator, pieces, middle, end));
+}
+
+/*
+ * Concatenate `count' pieces with `separator' (may be NULL) between
+ * them, building a balanced tree directly.
+ */
+CPRope *
+CPRope_Join(CPRope *separator, CPRope *const *pieces, size_t count)
+{
+    if(count == 0) {
+        return CPRope_FromBytes("", 0);
+    }
+    return join_range(separator, pieces, 0, count);
+}
+
+/* Copy the `length' bytes of `rope' to `dst' without flattening it. */
+void
+CPRope_CopyTo(const CPRope *rope, char *dst)
+{
+    const CPRope *stack[MAX_DEPTH];
+    size_t top = 0;
+    stack[top++] = rope;
+    while(top > 0) {
+        rope = stack[--top];
+        if(rope->depth == 0) {
+            memcpy(dst, rope->data, rope->length);
+            dst += rope->length;
+        } else {
+            stack[top++] = rope->right;
+            stack[top++] = rope->left;
+        }
+    }
+}
+
+/*
+ * Turn `rope' into a flat rope in place and return its NUL-terminated
+ * bytes.  The value does not change, so this is safe on shared ropes.
+ */
+const char *
+CPRope_Flatten(CPRope *rope)
+{
+    if(rope->depth == 0) {
+        return rope->data;
+    }
+    char *data = malloc(rope->length + 1);
+    if(data == NULL) {
+        return NULL;
+    }
+    CPRope_CopyTo(rope, data);
+    data[rope->length] = '\0';
+    CPRope_Release(rope->left);
+    CPRope_Release(rope->right);
+    rope->left = rope->right = NULL;
+    rope->depth = 0;
+    rope->capacity = rope->length;
+    rope->data = data;
+    rope->flags |= CP_ROPE_FLAG_OWNS_DATA;
+    return data;
+}
+
+/* The byte at `index', or -1 if out of range or out of memory. */
+int
+CPRope_CharAt(CPRope *rope, size_t index)
+{
+    if(index >= rope->length) {
+        return -1;
+    }
+    const char *data = CPRope_Flatten(rope);
+    return data != NULL ? (unsigned char)data[index] : -1;
+}
+
+/* CPHash_Bytes() of the contents, computed once. */
+uint64_t
+CPRope_Hash(CPRope *rope)
+{
+    if(!(rope->flags & CP_ROPE_FLAG_HASHED)) {
+        const char *data = CPRope_Flatten(rope);
+        if(data == NULL) {
+            return 0;
+        }
+        rope->hash = CPHash_Bytes(data, rope->length);
+        rope->flags |= CP_ROPE_FLAG_HASHED;
+    }
+    return rope->hash;
+}
@@ -0,0 +1,78 @@
+/*
+ * rope.h - immutable strings with cheap concatenation.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_ROPE_H_
+#define _CP_ROPE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Concatenations no longer than this are copied into a flat leaf. */
+#define CP_ROPE_SHORT_LENGTH 64
+
+#define CP_ROPE_FLAG_HASHED 0b01
+#define CP_ROPE_FLAG_OWNS_DATA 0b10
+
+/*
+ * A rope is either flat (`data', depth 0) or the concatenation of two
+ * ropes.  Concatenation shares both operands and keeps the tree
+ * AVL-balanced, so building a string piece by piece costs O(log n)
+ * nodes per piece instead of copying everything built so far.  The
+ * first indexed access or hash flattens the rope in place, once.
+ * Short leaves have spare `capacity' and absorb small appends while
+ * unshared.
+ * Ropes are reference counted; every function returning a rope
+ * returns a new reference.
+ */
+typedef struct CPRope
+{
+    size_t length;
+    size_t capacity;
+    uint64_t hash;
+    uint32_t refcount;
+    uint8_t depth;
+    uint8_t flags;
+    struct CPRope *left;
+    struct CPRope *right;
+    char *data;
+} CPRope;
+
+#define CPRope_Length(rope) ((rope)->length)
+#define CPRope_IsFlat(rope) ((rope)->depth == 0)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+CPRope *CPRope_FromBytes(const char *data, size_t length);
+CPRope *CPRope_FromCString(const char *str);
+CPRope *CPRope_Retain(CPRope *rope);
+void CPRope_Release(CPRope *rope);
+CPRope *CPRope_Concat(CPRope *left, CPRope *right);
+CPRope *CPRope_Append(CPRope *rope, CPRope *piece);
+CPRope *CPRope_Join(CPRope *separator, CPRope *const *pieces, size_t count);
+const char *CPRope_Flatten(CPRope *rope);
+int CPRope_CharAt(CPRope *rope, size_t index);
+uint64_t CPRope_Hash(CPRope *rope);
+void CPRope_CopyTo(const CPRope *rope, char *dst);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_ROPE_H_ */
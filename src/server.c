@@ -0,0 +1,421 @@
+/*
+ * server.c - a compile server on a local socket.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifdef __linux__
+/* struct ucred, for SO_PEERCRED. */
+#define _GNU_SOURCE
+#endif
+
+#include "config.h"
+#include "server.h"
+#include "cptypes.h"
+#include "path.h"
+#include "report_error.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+extern char **environ;
+
+#define HEADER_SIZE 16
+
+static int
+make_address(struct sockaddr_un *address, const char *path)
+{
+    memset(address, 0, sizeof(struct sockaddr_un));
+    address->sun_family = AF_UNIX;
+    if(strlen(path) >= sizeof(address->sun_path)) {
+        cp_report_error("Socket path too long: '%s'.", path);
+        return -1;
+    }
+    strcpy(address->sun_path, path);
+    return 0;
+}
+
+static int
+connect_to(const char *path)
+{
+    struct sockaddr_un address;
+    if(make_address(&address, path) != 0) {
+        return -1;
+    }
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if(fd < 0) {
+        return -1;
+    }
+    if(connect(fd, (struct sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int
+write_all(int fd, const void *data, size_t size)
+{
+    const char *p = data;
+    while(size > 0) {
+        ssize_t n = write(fd, p, size);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+static int
+read_all(int fd, void *data, size_t size)
+{
+    char *p = data;
+    while(size > 0) {
+        ssize_t n = read(fd, p, size);
+        if(n < 0 && errno == EINTR) {
+            continue;
+        }
+        if(n <= 0) {
+            return -1;
+        }
+        p += n;
+        size -= (size_t)n;
+    }
+    return 0;
+}
+
+/* The header travels with the client's standard streams attached. */
+static int
+receive_header(int fd, uint32_t header[4], int fds[3])
+{
+    union
+    {
+        struct cmsghdr align;
+        char bytes[CMSG_SPACE(3 * sizeof(int))];
+    } control;
+    struct iovec iov;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    iov.iov_base = header;
+    iov.iov_len = HEADER_SIZE;
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.bytes;
+    message.msg_controllen = sizeof(control.bytes);
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &message, 0);
+    } while(n < 0 && errno == EINTR);
+    if(n <= 0) {
+        return -1;
+    }
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if(cmsg == NULL || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ||
+       cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int))) {
+        return -1;
+    }
+    memcpy(fds, CMSG_DATA(cmsg), 3 * sizeof(int));
+    if(n != HEADER_SIZE || header[0] != CP_SERVER_MAGIC || header[1] > CP_SERVER_MAX_REQUEST ||
+       header[2] > header[1] || header[3] > header[1]) {
+        close(fds[0]);
+        close(fds[1]);
+        close(fds[2]);
+        return -1;
+    }
+    return 0;
+}
+
+/*
+ * Split the payload into cwd, argv and envp, which point into it.
+ * `strings' must have room for argc + envc + 2 pointers.
+ */
+static int
+parse_request(char *payload, const uint32_t header[4], char **strings)
+{
+    char *p = payload;
+    char *end = payload + header[1];
+    uint32_t count = 1 + header[2] + header[3];
+    for(uint32_t i = 0; i < count; i++) {
+        char *nul = memchr(p, '\0', (size_t)(end - p));
+        if(nul == NULL) {
+            return -1;
+        }
+        strings[i] = p;
+        p = nul + 1;
+    }
+    strings[count] = NULL;
+    return 0;
+}
+
+static int
+exit_status(int status)
+{
+    if(WIFEXITED(status)) {
+        return WEXITSTATUS(status);
+    }
+    return WIFSIGNALED(status) ? 128 + WTERMSIG(status) : 1;
+}
+
+/* Runs in the child: become the client's process and run the request. */
+static void
+run_request(int connection, CPServerFunc handler)
+{
+    uint32_t header[4];
+    int fds[3];
+    if(receive_header(connection, header, fds) != 0) {
+        _exit(1);
+    }
+    char *payload = malloc(header[1] + 1u);
+    char **strings = malloc((2u + header[2] + header[3]) * sizeof(char *));
+    if(payload == NULL || strings == NULL || read_all(connection, payload, header[1]) != 0 ||
+       parse_request(payload, header, strings) != 0) {
+        _exit(1);
+    }
+    /* The request proper gets its own process, so a crash is still answered. */
+    signal(SIGCHLD, SIG_DFL);
+    pid_t pid = fork();
+    if(pid == 0) {
+        close(connection);
+        for(int i = 0; i < 3; i++) {
+            dup2(fds[i], i);
+            close(fds[i]);
+        }
+        environ = strings + 2 + header[2];
+        if(chdir(strings[0]) != 0) {
+            cp_report_error("Cannot change to '%s'.", strings[0]);
+            exit(1);
+        }
+        exit(handler((int)header[2], strings + 1));
+    }
+    int status = 1;
+    if(pid > 0) {
+        pid_t waited;
+        do {
+            waited = waitpid(pid, &status, 0);
+        } while(waited < 0 && errno == EINTR);
+        status = waited == pid ? exit_status(status) : 1;
+    }
+    uint32_t reply = (uint32_t)status;
+    write_all(connection, &reply, sizeof(reply));
+    _exit(0);
+}
+
+/* The uid of the process on the other end of `connection'. */
+static int
+peer_uid(int connection, uid_t *uid)
+{
+#if defined(SO_PEERCRED)
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if(getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0) {
+        return -1;
+    }
+    *uid = credentials.uid;
+    return 0;
+#elif defined(HAVE_GETPEEREID)
+    gid_t gid;
+    return getpeereid(connection, uid, &gid);
+#else
+    CP_UNUSED(connection);
+    CP_UNUSED(uid);
+    return -1;
+#endif
+}
+
+int
+CPServer_Run(const char *path, CPServerFunc handler)
+{
+    struct sockaddr_un address;
+    struct stat st;
+    if(make_address(&address, path) != 0) {
+        return -1;
+    }
+    int fd = connect_to(path);
+    if(fd >= 0) {
+        close(fd);
+        cp_report_error("A server is already listening on '%s'.", path);
+        return -1;
+    }
+    /* Left behind by a server that was killed; never remove anything else. */
+    if(lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) {
+        unlink(path);
+    }
+#if !defined(SO_PEERCRED) && !defined(HAVE_GETPEEREID)
+    cp_report_error("Cannot check who connects to a socket on this platform.");
+    return -1;
+#endif
+    /* Requests run with our rights: only our user may connect. */
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t mask = umask(0177);
+    int bound = listener >= 0 && bind(listener, (struct sockaddr *)&address, sizeof(address)) == 0;
+    umask(mask);
+    if(!bound || listen(listener, SOMAXCONN) != 0) {
+        cp_report_error("Cannot listen on '%s'.", path);
+        if(listener >= 0) {
+            close(listener);
+        }
+        return -1;
+    }
+    /* Nobody waits for the request processes. */
+    signal(SIGCHLD, SIG_IGN);
+    for(;;) {
+        int connection = accept(listener, NULL, NULL);
+        if(connection < 0) {
+            if(errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            cp_report_error("Cannot accept on '%s'.", path);
+            break;
+        }
+        /* Root may connect whatever the socket's mode says. */
+        uid_t uid;
+        if(peer_uid(connection, &uid) != 0 || uid != geteuid()) {
+            close(connection);
+            continue;
+        }
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if(pid == 0) {
+            close(listener);
+            run_request(connection, handler);
+        }
+        close(connection);
+    }
+    close(listener);
+    return -1;
+}
+
+int
+CPServer_Forward(const char *path, int argc, char **argv, int *status)
+{
+    char cwd[CP_MAX_PATH];
+    if(argc < 0 || CPath_Getcwd(cwd) != 0) {
+        return -1;
+    }
+    int fd = connect_to(path);
+    if(fd < 0) {
+        return -1;
+    }
+    uint32_t envc = 0;
+    size_t size = strlen(cwd) + 1;
+    for(int i = 0; i < argc; i++) {
+        size += strlen(argv[i]) + 1;
+    }
+    for(; environ[envc] != NULL; envc++) {
+        size += strlen(environ[envc]) + 1;
+    }
+    char *payload = malloc(HEADER_SIZE + size);
+    if(size > CP_SERVER_MAX_REQUEST || payload == NULL) {
+        free(payload);
+        close(fd);
+        return -1;
+    }
+    uint32_t header[4] = {CP_SERVER_MAGIC, (uint32_t)size, (uint32_t)argc, envc};
+    memcpy(payload, header, HEADER_SIZE);
+    char *p = payload + HEADER_SIZE;
+    size_t n = strlen(cwd) + 1;
+    memcpy(p, cwd, n);
+    p += n;
+    for(int i = 0; i < argc; i++) {
+        n = strlen(argv[i]) + 1;
+        memcpy(p, argv[i], n);
+        p += n;
+    }
+    for(uint32_t i = 0; i < envc; i++) {
+        n = strlen(environ[i]) + 1;
+        memcpy(p, environ[i], n);
+        p += n;
+    }
+
+    /* Whatever we buffered must come out before the server writes. */
+    fflush(stdout);
+    fflush(stderr);
+    int fds[3] = {0, 1, 2};
+    union
+    {
+        struct cmsghdr align;
+        char bytes[CMSG_SPACE(sizeof(fds))];
+    } control;
+    struct iovec iov;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    memset(&control, 0, sizeof(control));
+    iov.iov_base = payload;
+    iov.iov_len = HEADER_SIZE;
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.bytes;
+    message.msg_controllen = sizeof(control.bytes);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    memcpy(CMSG_DATA(cmsg), fds, sizeof(fds));
+    ssize_t sent;
+    do {
+        sent = sendmsg(fd, &message, 0);
+    } while(sent < 0 && errno == EINTR);
+    int rv = sent == HEADER_SIZE && write_all(fd, payload + HEADER_SIZE, size) == 0 ? 0 : -1;
+    free(payload);
+    uint32_t reply;
+    if(rv == 0 && read_all(fd, &reply, sizeof(reply)) != 0) {
+        /* The request was taken; running it again here could repeat it. */
+        cp_report_error("Lost the connection to the server on '%s'.", path);
+        reply = 1;
+    }
+    close(fd);
+    if(rv == 0) {
+        *status = (int)reply;
+    }
+    return rv;
+}
+
+#else
+
+int
+CPServer_Run(const char *path, CPServerFunc handler)
+{
+    (void)handler;
+    cp_report_error("Cannot listen on '%s': not supported on this system.", path);
+    return -1;
+}
+
+int
+CPServer_Forward(const char *path, int argc, char **argv, int *status)
+{
+    (void)path;
+    (void)argc;
+    (void)argv;
+    (void)status;
+    return -1;
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+ * server.h - a compile server on a local socket.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_SERVER_H_
+#define _CP_SERVER_H_
+
+#include <stdint.h>
+
+/*
+ * A client sends one request over a UNIX stream socket, with its stdin,
+ * stdout and stderr attached as SCM_RIGHTS, so whatever the server does
+ * for it is written straight to its terminal or pipes:
+ *
+ *     magic:u32 size:u32 argc:u32 envc:u32
+ *     `size' bytes: cwd, then argc arguments, then envc NAME=VALUE
+ *     strings, each NUL-terminated
+ *
+ * The server answers with the exit status as a u32 and closes the
+ * connection.  Integers are in host byte order; both ends are on the
+ * same machine.
+ */
+#define CP_SERVER_MAGIC 0x31535043u
+#define CP_SERVER_MAX_REQUEST (1u << 20)
+
+/* Runs a request as the body of a process; returns its exit status. */
+typedef int (*CPServerFunc)(int argc, char **argv);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Listen on `path' and serve requests until killed.  Each request runs
+ * in a child forked from the server, so it saves the client's exec and
+ * start-up, cannot disturb the server, and runs alongside the others.
+ * This is only a fork server: nothing parsed or compiled for one request
+ * is kept for the next.  The child has the client's working directory,
+ * environment and standard streams.  The socket is created with mode 0600 and connections from
+ * other users are closed unserved.  Returns -1 if the socket cannot be
+ * set up.
+ */
+int CPServer_Run(const char *path, CPServerFunc handler);
+/*
+ * Have the server on `path' run `argv' for us and store its exit
+ * status.  Returns -1 without side effects if no server is listening,
+ * so the caller can do the work itself.
+ */
+int CPServer_Forward(const char *path, int argc, char **argv, int *status);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_SERVER_H_ */
@@ -0,0 +1,263 @@
+/*
+ * slab.c - size-class allocator for small runtime objects.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "slab.h"
+#include "cptypes.h"
+#include "platform/mmap.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#define SLAB_CLASSES 16
+/* Address space mapped at a time for one class; pages fault in as carved. */
+#define SLAB_SPAN_SIZE (1024 * 1024)
+#define CACHE_LINE 64
+
+typedef struct slab_object
+{
+    struct slab_object *next;
+    /* Only in the depot: the first object of a batch links the next batch. */
+    struct slab_object *next_batch;
+} slab_object_t;
+
+typedef struct
+{
+    slab_object_t *head;
+    size_t count;
+} slab_cache_t;
+
+/*
+ * Full batches are exactly class_batch[] objects long, so moving one
+ * is a pointer swap.  Partial lists from CPSlab_FlushThread() are
+ * chained on `loose' and handed out whole.
+ */
+typedef struct
+{
+    long lock;
+    slab_object_t *batches;
+    slab_object_t *loose;
+    size_t loose_count;
+    char *cursor;
+    char *limit;
+} slab_depot_t;
+
+/* One cache line per depot, so threads refilling different classes do not collide. */
+typedef union
+{
+    slab_depot_t depot;
+    char line[CACHE_LINE];
+} slab_depot_line_t;
+
+static const uint16_t class_size[SLAB_CLASSES] = {
+    16, 32, 48, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512,
+};
+
+/* About 4 KB per batch, and never fewer than 16 objects. */
+static const uint16_t class_batch[SLAB_CLASSES] = {
+    256, 128, 85, 64, 51, 42, 36, 32, 25, 21, 18, 16, 16, 16, 16, 16,
+};
+
+/* Indexed by (size + 15) / 16. */
+static const uint8_t class_index[CP_SLAB_MAX_SIZE / 16 + 1] = {
+    0, 0, 1, 2, 3, 4, 5, 6, 7,
+    8, 8, 9, 9, 10, 10, 11, 11,
+    12, 12, 12, 12, 13, 13, 13, 13,
+    14, 14, 14, 14, 15, 15, 15, 15,
+};
+
+static slab_depot_line_t depots[SLAB_CLASSES];
+static CP_THREAD_LOCAL slab_cache_t local_caches[SLAB_CLASSES];
+
+static inline void
+depot_lock(slab_depot_t *depot)
+{
+#if defined(__GNUC__)
+    while(__atomic_exchange_n(&depot->lock, 1, __ATOMIC_ACQUIRE)) {
+        while(__atomic_load_n(&depot->lock, __ATOMIC_RELAXED)) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        }
+    }
+#elif defined(_WIN32)
+    while(InterlockedExchange(&depot->lock, 1)) {
+        YieldProcessor();
+    }
+#else
+    depot->lock = 1;
+#endif
+}
+
+static inline void
+depot_unlock(slab_depot_t *depot)
+{
+#if defined(__GNUC__)
+    __atomic_store_n(&depot->lock, 0, __ATOMIC_RELEASE);
+#elif defined(_WIN32)
+    InterlockedExchange(&depot->lock, 0);
+#else
+    depot->lock = 0;
+#endif
+}
+
+/* Cut a fresh batch from the class's current span, mapping a new one if needed. */
+static slab_object_t *
+carve(slab_depot_t *depot, size_t index)
+{
+    size_t size = class_size[index];
+    size_t count = class_batch[index];
+    size_t bytes = size * count;
+    if(depot->cursor == NULL || (size_t)(depot->limit - depot->cursor) < bytes) {
+        CPMemoryMapping mapping;
+        if(CPMemoryMapping_Create(&mapping, NULL, SLAB_SPAN_SIZE, 0,
+                                  CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE,
+                                  CP_MMAP_FLAG_PRIVATE) < 0) {
+            return NULL;
+        }
+        depot->cursor = mapping.addr;
+        depot->limit = depot->cursor + SLAB_SPAN_SIZE;
+    }
+    char *start = depot->cursor;
+    depot->cursor += bytes;
+    depot_unlock(depot);
+
+    /* Link the objects outside the lock; nobody else can see them yet. */
+    for(size_t i = 0; i + 1 < count; i++) {
+        ((slab_object_t *)(start + i * size))->next = (slab_object_t *)(start + (i + 1) * size);
+    }
+    ((slab_object_t *)(start + (count - 1) * size))->next = NULL;
+    return (slab_object_t *)start;
+}
+
+static slab_object_t *
+refill(size_t index, slab_cache_t *cache)
+{
+    slab_depot_t *depot = &depots[index].depot;
+    slab_object_t *head;
+    size_t count = class_batch[index];
+    depot_lock(depot);
+    if(depot->batches != NULL) {
+        head = depot->batches;
+        depot->batches = head->next_batch;
+        depot_unlock(depot);
+    } else if(depot->loose != NULL) {
+        head = depot->loose;
+        count = depot->loose_count;
+        depot->loose = NULL;
+        depot->loose_count = 0;
+        depot_unlock(depot);
+    } else {
+        /* carve() unlocks. */
+        head = carve(depot, index);
+        if(head == NULL) {
+            depot_unlock(depot);
+            return NULL;
+        }
+    }
+    cache->head = head;
+    cache->count = count;
+    return head;
+}
+
+/* Move the first class_batch[] objects of the cache to the depot. */
+static void
+flush_batch(size_t index, slab_cache_t *cache)
+{
+    slab_depot_t *depot = &depots[index].depot;
+    size_t count = class_batch[index];
+    slab_object_t *head = cache->head;
+    slab_object_t *last = head;
+    for(size_t i = 1; i < count; i++) {
+        last = last->next;
+    }
+    cache->head = last->next;
+    cache->count -= count;
+    last->next = NULL;
+    depot_lock(depot);
+    head->next_batch = depot->batches;
+    depot->batches = head;
+    depot_unlock(depot);
+}
+
+void *
+CPSlab_Alloc(size_t size)
+{
+    if(size > CP_SLAB_MAX_SIZE) {
+        return malloc(size);
+    }
+    size_t index = class_index[(size + 15) >> 4];
+    slab_cache_t *cache = &local_caches[index];
+    slab_object_t *object = cache->head;
+    if(CP_UNLIKELY(object == NULL)) {
+        object = refill(index, cache);
+        if(object == NULL) {
+            return NULL;
+        }
+    }
+    cache->head = object->next;
+    cache->count--;
+    return object;
+}
+
+void
+CPSlab_Free(void *ptr, size_t size)
+{
+    if(ptr == NULL) {
+        return;
+    }
+    if(size > CP_SLAB_MAX_SIZE) {
+        free(ptr);
+        return;
+    }
+    size_t index = class_index[(size + 15) >> 4];
+    slab_cache_t *cache = &local_caches[index];
+    slab_object_t *object = ptr;
+    object->next = cache->head;
+    cache->head = object;
+    /* Keep up to two batches so alternating alloc and free cannot thrash. */
+    if(CP_UNLIKELY(++cache->count >= 2u * class_batch[index])) {
+        flush_batch(index, cache);
+    }
+}
+
+void
+CPSlab_FlushThread(void)
+{
+    for(size_t index = 0; index < SLAB_CLASSES; index++) {
+        slab_cache_t *cache = &local_caches[index];
+        while(cache->count >= class_batch[index]) {
+            flush_batch(index, cache);
+        }
+        if(cache->head == NULL) {
+            continue;
+        }
+        slab_object_t *last = cache->head;
+        while(last->next != NULL) {
+            last = last->next;
+        }
+        slab_depot_t *depot = &depots[index].depot;
+        depot_lock(depot);
+        last->next = depot->loose;
+        depot->loose = cache->head;
+        depot->loose_count += cache->count;
+        depot_unlock(depot);
+        cache->head = NULL;
+        cache->count = 0;
+    }
+}
@@ -0,0 +1,47 @@
+/*
+ * slab.h - size-class allocator for small runtime objects.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_SLAB_H_
+#define _CP_SLAB_H_
+
+#include <stddef.h>
+
+/* Larger requests are passed on to malloc(). */
+#define CP_SLAB_MAX_SIZE 512
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * Objects are 16-byte aligned and come from anonymous mappings carved
+ * into size classes.  Each thread keeps a free list per class and
+ * trades whole batches with a shared depot, so the common path takes
+ * no lock.  The caller passes the allocation size back on free; an
+ * object may be freed by any thread.  Memory is reused, never unmapped.
+ */
+void *CPSlab_Alloc(size_t size);
+void CPSlab_Free(void *ptr, size_t size);
+/* Hand this thread's cached objects back; call before a thread exits. */
+void CPSlab_FlushThread(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_SLAB_H_ */
@@ -0,0 +1,239 @@
+/*
+ * trace.c - record phase spans in Chrome trace-event format.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "trace.h"
+#include "cptypes.h"
+#include "safe_string.h"
+#include "report_error.h"
+#include "platform/clock.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TRACE_CHUNK_EVENTS 4096
+
+typedef struct
+{
+    const char *name;
+    uint64_t ts;
+    char phase;
+} trace_event_t;
+
+typedef struct trace_chunk
+{
+    struct trace_chunk *next;
+    size_t count;
+    trace_event_t events[TRACE_CHUNK_EVENTS];
+} trace_chunk_t;
+
+/*
+ * Every thread appends to its own buffer, so recording never takes a lock.
+ * Buffers are pushed once onto a global list with a CAS so that
+ * CPTrace_Stop() can find them.
+ */
+typedef struct trace_buffer
+{
+    struct trace_buffer *next;
+    unsigned int tid;
+    trace_chunk_t *head;
+    trace_chunk_t *tail;
+} trace_buffer_t;
+
+int cp_trace_enabled = 0;
+
+static char trace_path[CP_MAX_PATH];
+static FILE *trace_out = NULL;
+static uint64_t trace_origin;
+static trace_buffer_t *trace_buffers = NULL;
+static unsigned int trace_next_tid = 0;
+static unsigned int trace_generation = 0;
+static CP_THREAD_LOCAL trace_buffer_t *local_buffer = NULL;
+static CP_THREAD_LOCAL unsigned int local_generation = 0;
+
+static inline void
+push_buffer(trace_buffer_t *buffer)
+{
+#if defined(__GNUC__)
+    buffer->next = __atomic_load_n(&trace_buffers, __ATOMIC_ACQUIRE);
+    while(!__atomic_compare_exchange_n(&trace_buffers, &buffer->next, buffer, 1,
+                                       __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        /* buffer->next has been reloaded by the failed exchange. */
+    }
+    buffer->tid = __atomic_add_fetch(&trace_next_tid, 1, __ATOMIC_RELAXED);
+#elif defined(_WIN32)
+    PVOID old;
+    do {
+        old = trace_buffers;
+        buffer->next = old;
+    } while(InterlockedCompareExchangePointer((PVOID *)&trace_buffers, buffer, old) != old);
+    buffer->tid = (unsigned int)InterlockedIncrement((LONG *)&trace_next_tid);
+#else
+    buffer->next = trace_buffers;
+    trace_buffers = buffer;
+    buffer->tid = ++trace_next_tid;
+#endif
+}
+
+static trace_buffer_t *
+get_local_buffer(void)
+{
+    if(local_buffer != NULL && local_generation == trace_generation) {
+        return local_buffer;
+    }
+    trace_buffer_t *buffer = calloc(1, sizeof(trace_buffer_t));
+    if(buffer == NULL) {
+        return NULL;
+    }
+    push_buffer(buffer);
+    local_buffer = buffer;
+    local_generation = trace_generation;
+    return buffer;
+}
+
+void
+CPTrace_Record(const char *name, char phase)
+{
+    uint64_t now = CPClock_Monotonic();
+    trace_buffer_t *buffer = get_local_buffer();
+    if(buffer == NULL) {
+        return;
+    }
+    trace_chunk_t *chunk = buffer->tail;
+    if(chunk == NULL || chunk->count == TRACE_CHUNK_EVENTS) {
+        trace_chunk_t *fresh = malloc(sizeof(trace_chunk_t));
+        if(fresh == NULL) {
+            return; /* Drop the event rather than disturb the program. */
+        }
+        fresh->next = NULL;
+        fresh->count = 0;
+        if(chunk == NULL) {
+            buffer->head = fresh;
+        } else {
+            chunk->next = fresh;
+        }
+        buffer->tail = chunk = fresh;
+    }
+    trace_event_t *event = &chunk->events[chunk->count++];
+    event->name = name;
+    event->ts = now - trace_origin;
+    event->phase = phase;
+}
+
+int
+CPTrace_Start(const char *path)
+{
+    if(path == NULL || cp_trace_enabled) {
+        return -1;
+    }
+    if(strcpy_safe(trace_path, path, CP_MAX_PATH) != 0) {
+        return -1;
+    }
+    /* Opened now, so a bad path fails before the work rather than after. */
+    trace_out = fopen(path, "w");
+    if(trace_out == NULL) {
+        return -1;
+    }
+    trace_origin = CPClock_Monotonic();
+    cp_trace_enabled = 1;
+    return 0;
+}
+
+static void
+write_json_string(FILE *out, const char *s)
+{
+    fputc('"', out);
+    for(; *s != '\0'; s++) {
+        unsigned char c = (unsigned char)*s;
+        if(c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if(c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static unsigned long
+get_pid(void)
+{
+#ifdef _WIN32
+    return (unsigned long)GetCurrentProcessId();
+#else
+    return (unsigned long)getpid();
+#endif
+}
+
+/*
+ * Write every recorded event and release the buffers.  Other threads
+ * must have stopped recording by the time this is called.
+ */
+int
+CPTrace_Stop(void)
+{
+    if(!cp_trace_enabled) {
+        return 0;
+    }
+    cp_trace_enabled = 0;
+    int rv = 0;
+    FILE *out = trace_out;
+    trace_out = NULL;
+    unsigned long pid = get_pid();
+    int first = 1;
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    trace_buffer_t *buffer = trace_buffers;
+    while(buffer != NULL) {
+        trace_chunk_t *chunk = buffer->head;
+        while(chunk != NULL) {
+            for(size_t i = 0; i < chunk->count; i++) {
+                trace_event_t *event = &chunk->events[i];
+                fprintf(out, "%s\n{\"name\":", first ? "" : ",");
+                write_json_string(out, event->name);
+                /* Timestamps are microseconds with a nanosecond fraction. */
+                fprintf(out, ",\"ph\":\"%c\",\"ts\":%llu.%03u,\"pid\":%lu,\"tid\":%u}", event->phase,
+                        (unsigned long long)(event->ts / 1000), (unsigned int)(event->ts % 1000), pid, buffer->tid);
+                first = 0;
+            }
+            trace_chunk_t *next = chunk->next;
+            free(chunk);
+            chunk = next;
+        }
+        trace_buffer_t *next = buffer->next;
+        free(buffer);
+        buffer = next;
+    }
+    trace_buffers = NULL;
+    /* Invalidate the thread-local pointers to the buffers freed above. */
+    trace_generation++;
+    fprintf(out, "\n]}\n");
+    if(fclose(out) != 0) {
+        cp_report_error("Cannot write trace output '%s'.", trace_path);
+        rv = -1;
+    }
+    return rv;
+}
@@ -0,0 +1,48 @@
+/*
+ * trace.h - record phase spans in Chrome trace-event format.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_TRACE_H_
+#define _CP_TRACE_H_
+
+#include "cptypes.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int cp_trace_enabled;
+
+int CPTrace_Start(const char *path);
+int CPTrace_Stop(void);
+void CPTrace_Record(const char *name, char phase);
+
+/*
+ * Span names must be string literals (or otherwise outlive the trace):
+ * only the pointer is recorded, the text is read when the file is written.
+ * When tracing is off a span costs a single predictable branch.
+ */
+#define CPTrace_Begin(name) \
+    do { if(CP_UNLIKELY(cp_trace_enabled)) CPTrace_Record((name), 'B'); } while(0)
+#define CPTrace_End(name) \
+    do { if(CP_UNLIKELY(cp_trace_enabled)) CPTrace_Record((name), 'E'); } while(0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_TRACE_H_ */
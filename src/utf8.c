@@ -0,0 +1,603 @@
+/*
+ * utf8.c - UTF-8 validation, counting and transcoding.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "utf8.h"
+
+#include <string.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_X86 1
+#include <immintrin.h>
+#define TARGET_SSE4 __attribute__((target("sse4.2")))
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#endif
+
+#define MSBS 0x8080808080808080ULL
+
+typedef struct
+{
+    size_t (*validate)(const uint8_t *s, size_t n);
+    size_t (*count)(const uint8_t *s, size_t n);
+    size_t (*offset)(const uint8_t *s, size_t n, size_t index);
+    size_t (*to_utf32)(const uint8_t *s, size_t n, uint32_t *dst);
+} utf8_impl_t;
+
+static inline int
+popcount64(uint64_t x)
+{
+#ifdef __GNUC__
+    return __builtin_popcountll(x);
+#else
+    int count = 0;
+    for(; x != 0; x &= x - 1) {
+        count++;
+    }
+    return count;
+#endif
+}
+
+static inline uint64_t
+load64(const uint8_t *s)
+{
+    uint64_t w;
+    memcpy(&w, s, sizeof(w));
+    return w;
+}
+
+/* Scalar versions, also used to finish the tails of the SIMD ones. */
+
+/* Offset of the first byte of the first invalid sequence, or `n'. */
+static size_t
+validate_scalar(const uint8_t *s, size_t n)
+{
+    size_t i = 0;
+    while(i < n) {
+        if(n - i >= 8 && !(load64(s + i) & MSBS)) {
+            i += 8;
+            continue;
+        }
+        uint8_t c = s[i];
+        if(c < 0x80) {
+            i++;
+            continue;
+        }
+        size_t length;
+        uint8_t low = 0x80;
+        uint8_t high = 0xBF;
+        if(c >= 0xC2 && c <= 0xDF) {
+            length = 2;
+        } else if(c >= 0xE0 && c <= 0xEF) {
+            length = 3;
+            if(c == 0xE0) {
+                low = 0xA0; // overlong
+            } else if(c == 0xED) {
+                high = 0x9F; // surrogate
+            }
+        } else if(c >= 0xF0 && c <= 0xF4) {
+            length = 4;
+            if(c == 0xF0) {
+                low = 0x90; // overlong
+            } else if(c == 0xF4) {
+                high = 0x8F; // above U+10FFFF
+            }
+        } else {
+            return i;
+        }
+        if(n - i < length || s[i + 1] < low || s[i + 1] > high) {
+            return i;
+        }
+        for(size_t k = 2; k < length; k++) {
+            if((s[i + k] & 0xC0) != 0x80) {
+                return i;
+            }
+        }
+        i += length;
+    }
+    return n;
+}
+
+/* Code points are the bytes that are not continuation bytes (10xxxxxx). */
+static size_t
+count_scalar(const uint8_t *s, size_t n)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for(; n - i >= 8; i += 8) {
+        uint64_t w = load64(s + i);
+        count += 8 - (size_t)popcount64(w & ~(w << 1) & MSBS);
+    }
+    for(; i < n; i++) {
+        count += (s[i] & 0xC0) != 0x80;
+    }
+    return count;
+}
+
+static size_t
+offset_scalar(const uint8_t *s, size_t n, size_t index)
+{
+    for(size_t i = 0; i < n; i++) {
+        if((s[i] & 0xC0) != 0x80 && index-- == 0) {
+            return i;
+        }
+    }
+    return n;
+}
+
+/* Decode the character at `s' into `*out'; returns its length. */
+static inline size_t
+decode(const uint8_t *s, uint32_t *out)
+{
+    uint8_t c = s[0];
+    if(c < 0x80) {
+        *out = c;
+        return 1;
+    }
+    if(c < 0xE0) {
+        *out = (uint32_t)(c & 0x1F) << 6 | (s[1] & 0x3F);
+        return 2;
+    }
+    if(c < 0xF0) {
+        *out = (uint32_t)(c & 0x0F) << 12 | (uint32_t)(s[1] & 0x3F) << 6 | (s[2] & 0x3F);
+        return 3;
+    }
+    *out = (uint32_t)(c & 0x07) << 18 | (uint32_t)(s[1] & 0x3F) << 12 |
+           (uint32_t)(s[2] & 0x3F) << 6 | (s[3] & 0x3F);
+    return 4;
+}
+
+static size_t
+to_utf32_scalar(const uint8_t *s, size_t n, uint32_t *dst)
+{
+    uint32_t *out = dst;
+    for(size_t i = 0; i < n; out++) {
+        i += decode(s + i, out);
+    }
+    return (size_t)(out - dst);
+}
+
+/*
+ * The SIMD validator classifies every byte by its high nibble, the high
+ * and low nibble of the byte before it, and whether it is the third or
+ * fourth byte after a 3- or 4-byte lead, with three 16-entry table
+ * lookups per block (Keiser and Lemire, "Validating UTF-8 In Less Than
+ * One Instruction Per Byte", 2021).  Each table entry is a set of the
+ * error kinds below; a byte pair is invalid when all three agree.
+ */
+#ifdef UTF8_X86
+
+#define TOO_SHORT (1 << 0)      // 11______ 0_______ / 11______ 11______
+#define TOO_LONG (1 << 1)       // 0_______ 10______
+#define OVERLONG_3 (1 << 2)     // 11100000 100_____
+#define TOO_LARGE (1 << 3)      // 11110100 1001____ and above
+#define SURROGATE (1 << 4)      // 11101101 101_____
+#define OVERLONG_2 (1 << 5)     // 1100000_ 10______
+#define TOO_LARGE_1000 (1 << 6) // 11110101 1000____ and above
+#define OVERLONG_4 (1 << 6)     // 11110000 1000____
+#define TWO_CONTS (1 << 7)      // 10______ 10______
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+#define BYTE_1_HIGH \
+    TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG, \
+    TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS, \
+    TOO_SHORT | OVERLONG_2, \
+    TOO_SHORT, \
+    TOO_SHORT | OVERLONG_3 | SURROGATE, \
+    TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4
+
+#define BYTE_1_LOW \
+    CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4, \
+    CARRY | OVERLONG_2, \
+    CARRY, \
+    CARRY, \
+    CARRY | TOO_LARGE, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000, \
+    CARRY | TOO_LARGE | TOO_LARGE_1000
+
+#define BYTE_2_HIGH \
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE, \
+    TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE, \
+    TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT
+
+/* Bytes at or above these in the last three positions start an unfinished character. */
+#define INCOMPLETE \
+    (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, \
+    (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xEF, (char)0xDF, (char)0xBF
+
+/*
+ * A block failed: everything before it is valid, so rescan from the
+ * start of the last character that began before it.
+ */
+static size_t
+resync(const uint8_t *s, size_t n, size_t block)
+{
+    size_t start = block;
+    if(start > 0) {
+        start--;
+        for(int k = 0; k < 3 && start > 0 && (s[start] & 0xC0) == 0x80; k++) {
+            start--;
+        }
+    }
+    return start + validate_scalar(s + start, n - start);
+}
+
+TARGET_SSE4 static size_t
+validate_sse4(const uint8_t *s, size_t n)
+{
+    const __m128i byte_1_high = _mm_setr_epi8(BYTE_1_HIGH);
+    const __m128i byte_1_low = _mm_setr_epi8(BYTE_1_LOW);
+    const __m128i byte_2_high = _mm_setr_epi8(BYTE_2_HIGH);
+    const __m128i incomplete = _mm_setr_epi8(INCOMPLETE);
+    const __m128i nibble = _mm_set1_epi8(0x0F);
+    __m128i prev = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    uint8_t tail[16];
+    for(size_t i = 0; i < n; i += 16) {
+        __m128i in;
+        if(n - i >= 16) {
+            in = _mm_loadu_si128((const __m128i *)(s + i));
+        } else {
+            /* Zero padding is ASCII, so it flags a character cut short. */
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s + i, n - i);
+            in = _mm_loadu_si128((const __m128i *)tail);
+        }
+        __m128i error = prev_incomplete;
+        if(_mm_movemask_epi8(in) != 0) {
+            __m128i prev1 = _mm_alignr_epi8(in, prev, 15);
+            __m128i special = _mm_and_si128(
+                _mm_and_si128(_mm_shuffle_epi8(byte_1_high, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble)),
+                              _mm_shuffle_epi8(byte_1_low, _mm_and_si128(prev1, nibble))),
+                _mm_shuffle_epi8(byte_2_high, _mm_and_si128(_mm_srli_epi16(in, 4), nibble)));
+            __m128i third = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 14), _mm_set1_epi8((char)(0xE0 - 0x80)));
+            __m128i fourth = _mm_subs_epu8(_mm_alignr_epi8(in, prev, 13), _mm_set1_epi8((char)(0xF0 - 0x80)));
+            __m128i must23 = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8((char)0x80));
+            error = _mm_xor_si128(must23, special);
+            prev_incomplete = _mm_subs_epu8(in, incomplete);
+        }
+        if(!_mm_testz_si128(error, error)) {
+            return resync(s, n, i);
+        }
+        prev = in;
+    }
+    if(!_mm_testz_si128(prev_incomplete, prev_incomplete)) {
+        return resync(s, n, n - n % 16);
+    }
+    return n;
+}
+
+#define PREV256(in, prev, k) \
+    _mm256_alignr_epi8(in, _mm256_permute2x128_si256(prev, in, 0x21), 16 - (k))
+
+TARGET_AVX2 static size_t
+validate_avx2(const uint8_t *s, size_t n)
+{
+    const __m256i byte_1_high = _mm256_setr_epi8(BYTE_1_HIGH, BYTE_1_HIGH);
+    const __m256i byte_1_low = _mm256_setr_epi8(BYTE_1_LOW, BYTE_1_LOW);
+    const __m256i byte_2_high = _mm256_setr_epi8(BYTE_2_HIGH, BYTE_2_HIGH);
+    const __m256i incomplete = _mm256_setr_epi8(
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+        (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF, (char)0xFF,
+        INCOMPLETE);
+    const __m256i nibble = _mm256_set1_epi8(0x0F);
+    __m256i prev = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    uint8_t tail[32];
+    for(size_t i = 0; i < n; i += 32) {
+        __m256i in;
+        if(n - i >= 32) {
+            in = _mm256_loadu_si256((const __m256i *)(s + i));
+        } else {
+            memset(tail, 0, sizeof(tail));
+            memcpy(tail, s + i, n - i);
+            in = _mm256_loadu_si256((const __m256i *)tail);
+        }
+        __m256i error = prev_incomplete;
+        if(_mm256_movemask_epi8(in) != 0) {
+            __m256i prev1 = PREV256(in, prev, 1);
+            __m256i special = _mm256_and_si256(
+                _mm256_and_si256(
+                    _mm256_shuffle_epi8(byte_1_high, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble)),
+                    _mm256_shuffle_epi8(byte_1_low, _mm256_and_si256(prev1, nibble))),
+                _mm256_shuffle_epi8(byte_2_high, _mm256_and_si256(_mm256_srli_epi16(in, 4), nibble)));
+            __m256i third = _mm256_subs_epu8(PREV256(in, prev, 2), _mm256_set1_epi8((char)(0xE0 - 0x80)));
+            __m256i fourth = _mm256_subs_epu8(PREV256(in, prev, 3), _mm256_set1_epi8((char)(0xF0 - 0x80)));
+            __m256i must23 = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8((char)0x80));
+            error = _mm256_xor_si256(must23, special);
+            prev_incomplete = _mm256_subs_epu8(in, incomplete);
+        }
+        if(!_mm256_testz_si256(error, error)) {
+            return resync(s, n, i);
+        }
+        prev = in;
+    }
+    if(!_mm256_testz_si256(prev_incomplete, prev_incomplete)) {
+        return resync(s, n, n - n % 32);
+    }
+    return n;
+}
+
+/* Bit i set when byte i starts a code point: signed byte > -65. */
+TARGET_SSE4 static inline uint32_t
+starts_sse4(const uint8_t *s)
+{
+    __m128i in = _mm_loadu_si128((const __m128i *)s);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(in, _mm_set1_epi8(-65)));
+}
+
+TARGET_AVX2 static inline uint32_t
+starts_avx2(const uint8_t *s)
+{
+    __m256i in = _mm256_loadu_si256((const __m256i *)s);
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi8(in, _mm256_set1_epi8(-65)));
+}
+
+TARGET_SSE4 static size_t
+count_sse4(const uint8_t *s, size_t n)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for(; n - i >= 16; i += 16) {
+        count += (size_t)__builtin_popcount(starts_sse4(s + i));
+    }
+    return count + count_scalar(s + i, n - i);
+}
+
+TARGET_AVX2 static size_t
+count_avx2(const uint8_t *s, size_t n)
+{
+    size_t count = 0;
+    size_t i = 0;
+    for(; n - i >= 32; i += 32) {
+        count += (size_t)__builtin_popcount(starts_avx2(s + i));
+    }
+    return count + count_scalar(s + i, n - i);
+}
+
+static inline size_t
+nth_bit(uint32_t mask, size_t n)
+{
+    for(; n > 0; n--) {
+        mask &= mask - 1;
+    }
+    return (size_t)__builtin_ctz(mask);
+}
+
+TARGET_SSE4 static size_t
+offset_sse4(const uint8_t *s, size_t n, size_t index)
+{
+    size_t i = 0;
+    for(; n - i >= 16; i += 16) {
+        uint32_t mask = starts_sse4(s + i);
+        size_t count = (size_t)__builtin_popcount(mask);
+        if(index < count) {
+            return i + nth_bit(mask, index);
+        }
+        index -= count;
+    }
+    return i + offset_scalar(s + i, n - i, index);
+}
+
+TARGET_AVX2 static size_t
+offset_avx2(const uint8_t *s, size_t n, size_t index)
+{
+    size_t i = 0;
+    for(; n - i >= 32; i += 32) {
+        uint32_t mask = starts_avx2(s + i);
+        size_t count = (size_t)__builtin_popcount(mask);
+        if(index < count) {
+            return i + nth_bit(mask, index);
+        }
+        index -= count;
+    }
+    return i + offset_scalar(s + i, n - i, index);
+}
+
+/* Widen all-ASCII blocks at once; decode the others a character at a time. */
+TARGET_SSE4 static size_t
+to_utf32_sse4(const uint8_t *s, size_t n, uint32_t *dst)
+{
+    uint32_t *out = dst;
+    size_t i = 0;
+    while(n - i >= 16) {
+        __m128i in = _mm_loadu_si128((const __m128i *)(s + i));
+        if(_mm_movemask_epi8(in) == 0) {
+            _mm_storeu_si128((__m128i *)out, _mm_cvtepu8_epi32(in));
+            _mm_storeu_si128((__m128i *)(out + 4), _mm_cvtepu8_epi32(_mm_srli_si128(in, 4)));
+            _mm_storeu_si128((__m128i *)(out + 8), _mm_cvtepu8_epi32(_mm_srli_si128(in, 8)));
+            _mm_storeu_si128((__m128i *)(out + 12), _mm_cvtepu8_epi32(_mm_srli_si128(in, 12)));
+            out += 16;
+            i += 16;
+            continue;
+        }
+        /* Not all ASCII: decode up to the block end, or just past it. */
+        size_t end = i + 16;
+        while(i < end) {
+            i += decode(s + i, out++);
+        }
+    }
+    return (size_t)(out - dst) + to_utf32_scalar(s + i, n - i, out);
+}
+
+TARGET_AVX2 static size_t
+to_utf32_avx2(const uint8_t *s, size_t n, uint32_t *dst)
+{
+    uint32_t *out = dst;
+    size_t i = 0;
+    while(n - i >= 32) {
+        __m256i in = _mm256_loadu_si256((const __m256i *)(s + i));
+        if(_mm256_movemask_epi8(in) == 0) {
+            __m128i low = _mm256_castsi256_si128(in);
+            __m128i high = _mm256_extracti128_si256(in, 1);
+            _mm256_storeu_si256((__m256i *)out, _mm256_cvtepu8_epi32(low));
+            _mm256_storeu_si256((__m256i *)(out + 8), _mm256_cvtepu8_epi32(_mm_srli_si128(low, 8)));
+            _mm256_storeu_si256((__m256i *)(out + 16), _mm256_cvtepu8_epi32(high));
+            _mm256_storeu_si256((__m256i *)(out + 24), _mm256_cvtepu8_epi32(_mm_srli_si128(high, 8)));
+            out += 32;
+            i += 32;
+            continue;
+        }
+        /* Not all ASCII: decode up to the block end, or just past it. */
+        size_t end = i + 32;
+        while(i < end) {
+            i += decode(s + i, out++);
+        }
+    }
+    return (size_t)(out - dst) + to_utf32_scalar(s + i, n - i, out);
+}
+
+#endif /* UTF8_X86 */
+
+static const utf8_impl_t impls[] = {
+    {validate_scalar, count_scalar, offset_scalar, to_utf32_scalar},
+#ifdef UTF8_X86
+    {validate_sse4, count_sse4, offset_sse4, to_utf32_sse4},
+    {validate_avx2, count_avx2, offset_avx2, to_utf32_avx2},
+#endif
+};
+
+static const utf8_impl_t *impl = NULL;
+static int impl_level = CP_UTF8_SCALAR;
+
+static int
+supported(int level)
+{
+    switch(level) {
+    case CP_UTF8_SCALAR:
+        return 1;
+#ifdef UTF8_X86
+    case CP_UTF8_SSE4:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse4.2");
+    case CP_UTF8_AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("popcnt");
+#endif
+    default:
+        return 0;
+    }
+}
+
+static inline const utf8_impl_t *
+get_impl(void)
+{
+    if(impl == NULL) {
+        int level = CP_UTF8_AVX2;
+        while(!supported(level)) {
+            level--;
+        }
+        impl_level = level;
+        impl = &impls[level];
+    }
+    return impl;
+}
+
+/*
+ * 0 if `length' bytes at `data' are valid UTF-8.  Otherwise -1, with
+ * the offset of the first invalid sequence in `*error_offset' if given.
+ */
+int
+CPUtf8_Validate(const void *data, size_t length, size_t *error_offset)
+{
+    size_t offset = get_impl()->validate(data, length);
+    if(offset == length) {
+        return 0;
+    }
+    if(error_offset != NULL) {
+        *error_offset = offset;
+    }
+    return -1;
+}
+
+/* Number of code points. */
+size_t
+CPUtf8_Count(const void *data, size_t length)
+{
+    return get_impl()->count(data, length);
+}
+
+/* Byte offset of code point `index', or `length' past the end. */
+size_t
+CPUtf8_Offset(const void *data, size_t length, size_t index)
+{
+    return get_impl()->offset(data, length, index);
+}
+
+/* Decode into `dst', which needs room for `length' code points; returns the count. */
+size_t
+CPUtf8_ToUtf32(const void *data, size_t length, uint32_t *dst)
+{
+    return get_impl()->to_utf32(data, length, dst);
+}
+
+/* Encode into `dst', which needs room for 4 * `count' bytes; returns the bytes written. */
+size_t
+CPUtf8_FromUtf32(const uint32_t *src, size_t count, void *dst)
+{
+    uint8_t *out = dst;
+    for(size_t i = 0; i < count; i++) {
+        uint32_t c = src[i];
+        if(c < 0x80) {
+            *out++ = (uint8_t)c;
+        } else if(c < 0x800) {
+            *out++ = (uint8_t)(0xC0 | c >> 6);
+            *out++ = (uint8_t)(0x80 | (c & 0x3F));
+        } else if(c < 0x10000) {
+            *out++ = (uint8_t)(0xE0 | c >> 12);
+            *out++ = (uint8_t)(0x80 | (c >> 6 & 0x3F));
+            *out++ = (uint8_t)(0x80 | (c & 0x3F));
+        } else {
+            *out++ = (uint8_t)(0xF0 | c >> 18);
+            *out++ = (uint8_t)(0x80 | (c >> 12 & 0x3F));
+            *out++ = (uint8_t)(0x80 | (c >> 6 & 0x3F));
+            *out++ = (uint8_t)(0x80 | (c & 0x3F));
+        }
+    }
+    return (size_t)(out - (uint8_t *)dst);
+}
+
+int
+CPUtf8_Level(void)
+{
+    get_impl();
+    return impl_level;
+}
+
+/* Force an implementation, for tests and benchmarks.  -1 if the CPU lacks it. */
+int
+CPUtf8_SetLevel(int level)
+{
+    if(level < CP_UTF8_SCALAR || level > CP_UTF8_AVX2 || !supported(level)) {
+        return -1;
+    }
+    impl_level = level;
+    impl = &impls[level];
+    return 0;
+}
@@ -0,0 +1,52 @@
+/*
+ * utf8.h - UTF-8 validation, counting and transcoding.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_UTF8_H_
+#define _CP_UTF8_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Implementations, in order of preference. */
+#define CP_UTF8_SCALAR 0
+#define CP_UTF8_SSE4 1
+#define CP_UTF8_AVX2 2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The best implementation the CPU supports is picked on first use.
+ * Validation follows RFC 3629: no overlong forms, no surrogates,
+ * nothing above U+10FFFF.  The other functions expect valid input.
+ */
+int CPUtf8_Validate(const void *data, size_t length, size_t *error_offset);
+size_t CPUtf8_Count(const void *data, size_t length);
+size_t CPUtf8_Offset(const void *data, size_t length, size_t index);
+size_t CPUtf8_ToUtf32(const void *data, size_t length, uint32_t *dst);
+size_t CPUtf8_FromUtf32(const uint32_t *src, size_t count, void *dst);
+
+int CPUtf8_Level(void);
+int CPUtf8_SetLevel(int level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_UTF8_H_ */
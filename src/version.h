@@ -37,7 +37,7 @@
 
 #define CP_BYTECODE_MAGIC_NUMBER_SIZE 4
 #define CP_BYTECODE_MAGIC_NUMBER "\x63\x70\x6d\x80"
-#define CP_BYTECODE_VERSION_MAJOR 0x00000000L
+#define CP_BYTECODE_VERSION_MAJOR 0x00000001L
 #define CP_BYTECODE_VERSION_MINOR 0x00000000L
 
 #ifdef __cplusplus
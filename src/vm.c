@@ -0,0 +1,791 @@
+/*
+ * vm.c - the bytecode interpreter.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "vm.h"
+#include "cptypes.h"
+#include "ffi.h"
+#include "numconv.h"
+#include "opcode.h"
+#include "opstats.h"
+#include "profile.h"
+#include "report_error.h"
+#include "slab.h"
+
+#ifndef _WIN32
+#include <setjmp.h>
+#include <signal.h>
+#endif
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Where a fault in a guard page can be caught (POSIX signals), the
+ * interpreter does not check for stack overflow on every push.
+ * Elsewhere the guard pages only stop runaway writes and the checks
+ * stay.
+ */
+#ifdef _WIN32
+#define CHECK_STACK 1
+#else
+#define CHECK_STACK 0
+#endif
+
+#define ROUND_UP(n, page) (((n) + (page) - 1) / (page) * (page))
+
+#if !CHECK_STACK
+static CP_THREAD_LOCAL CPVM *current_vm = NULL;
+static struct sigaction old_segv;
+static struct sigaction old_bus;
+static int fault_handler_installed = 0;
+
+static int
+in_guard(const CPVM *vm, const char *addr)
+{
+    size_t page = CPMemoryMapping_PageSize();
+    const char *values_end = (const char *)(vm->stack + CP_VM_STACK_SIZE);
+    const char *frames_end = (const char *)(vm->frames + CP_VM_FRAMES_SIZE);
+    return (addr >= values_end && addr < values_end + page) || (addr >= frames_end && addr < frames_end + page);
+}
+
+static void
+on_fault(int sig, siginfo_t *info, void *context)
+{
+    CPVM *vm = current_vm;
+    CP_UNUSED(context);
+    if(vm != NULL && vm->overflow != NULL && in_guard(vm, info->si_addr)) {
+        siglongjmp(*(sigjmp_buf *)vm->overflow, 1);
+    }
+    /* Not ours: put the old handler back and let the access fault again. */
+    sigaction(sig, sig == SIGSEGV ? &old_segv : &old_bus, NULL);
+}
+
+static int
+install_fault_handler(void)
+{
+    if(fault_handler_installed) {
+        return 0;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_sigaction = on_fault;
+    /* NODEFER, so that jumping out of the handler leaves the signal unblocked. */
+    action.sa_flags = SA_SIGINFO | SA_NODEFER;
+    sigemptyset(&action.sa_mask);
+    if(sigaction(SIGSEGV, &action, &old_segv) != 0) {
+        return -1;
+    }
+    if(sigaction(SIGBUS, &action, &old_bus) != 0) {
+        sigaction(SIGSEGV, &old_segv, NULL);
+        return -1;
+    }
+    fault_handler_installed = 1;
+    return 0;
+}
+#endif
+
+/* Give every entry of the module's GLOBALS and NATIVES tables a slot. */
+static int
+grow_slots(CPVM *vm)
+{
+    uint32_t count = vm->module->global_count;
+    if(count > vm->slot_count) {
+        CPGlobalSlot *slots = realloc(vm->slots, count * sizeof(CPGlobalSlot));
+        if(slots == NULL) {
+            return -1;
+        }
+        memset(slots + vm->slot_count, 0, (count - vm->slot_count) * sizeof(CPGlobalSlot));
+        vm->slots = slots;
+        vm->slot_count = count;
+    }
+    count = vm->module->native_count;
+    if(count > vm->native_count) {
+        CPNativeSlot *natives = realloc(vm->natives, count * sizeof(CPNativeSlot));
+        if(natives == NULL) {
+            return -1;
+        }
+        memset(natives + vm->native_count, 0, (count - vm->native_count) * sizeof(CPNativeSlot));
+        vm->natives = natives;
+        vm->native_count = count;
+    }
+    return 0;
+}
+
+/*
+ * The mapping is laid out as values, guard, frames, guard, with each
+ * stack placed to end exactly where its guard page starts.
+ */
+int
+CPVM_Init(CPVM *vm, const CPModule *module)
+{
+    memset(vm, 0, sizeof(CPVM));
+    vm->module = module;
+    vm->out = stdout;
+    size_t page = CPMemoryMapping_PageSize();
+    size_t values = ROUND_UP(CP_VM_STACK_SIZE * sizeof(CPValue), page);
+    size_t frames = ROUND_UP(CP_VM_FRAMES_SIZE * sizeof(CPFrame), page);
+    if(CPMemoryMapping_Create(&vm->stacks, NULL, values + page + frames + page, 0,
+                              CP_MMAP_PROT_READ | CP_MMAP_PROT_WRITE, CP_MMAP_FLAG_PRIVATE) != 0) {
+        return -1;
+    }
+    char *base = vm->stacks.addr;
+    if(CPMemoryMapping_Protect(&vm->stacks, values, page, CP_MMAP_PROT_NONE) != 0 ||
+       CPMemoryMapping_Protect(&vm->stacks, values + page + frames, page, CP_MMAP_PROT_NONE) != 0 ||
+#if !CHECK_STACK
+       install_fault_handler() != 0 ||
+#endif
+       CPHashMap_Init(&vm->globals, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        CPMemoryMapping_Destroy(&vm->stacks);
+        return -1;
+    }
+    /* Every slot starts out stale. */
+    vm->globals_version = 1;
+    if(grow_slots(vm) != 0) {
+        free(vm->slots);
+        CPHashMap_Destroy(&vm->globals);
+        CPMemoryMapping_Destroy(&vm->stacks);
+        return -1;
+    }
+    vm->stack = (CPValue *)(void *)(base + values) - CP_VM_STACK_SIZE;
+    vm->frames = (CPFrame *)(void *)(base + values + page + frames) - CP_VM_FRAMES_SIZE;
+    return 0;
+}
+
+void
+CPVM_Destroy(CPVM *vm)
+{
+    size_t iterator = 0;
+    CPHashMapEntry *entry;
+    while((entry = CPHashMap_Next(&vm->globals, &iterator)) != NULL) {
+        CPSlab_Free(entry->value, sizeof(CPValue));
+    }
+    CPHashMap_Destroy(&vm->globals);
+    free(vm->slots);
+    for(uint32_t i = 0; i < vm->native_count; i++) {
+        CPFFI_Unbind(&vm->natives[i]);
+    }
+    free(vm->natives);
+    for(size_t i = 0; i < vm->string_count; i++) {
+        CPString_Free(vm->strings[i]);
+    }
+    free(vm->strings);
+    CPMemoryMapping_Destroy(&vm->stacks);
+    memset(vm, 0, sizeof(CPVM));
+}
+
+void
+CPVM_Print(FILE *out, const CPModule *module, const CPValue *value)
+{
+    char buffer[CP_NUM_BUFFER_SIZE];
+    switch(value->type) {
+        case CP_VALUE_INT:
+            fwrite(buffer, 1, CPNum_FormatI64(value->as.i, buffer), out);
+            break;
+        case CP_VALUE_FLOAT:
+            fwrite(buffer, 1, CPNum_FormatDouble(value->as.f, buffer), out);
+            break;
+        case CP_VALUE_STRING:
+            fwrite(value->as.s->data, 1, value->as.s->length, out);
+            break;
+        default:
+            fprintf(out, "<function %s>", module->functions[value->as.function].name->data);
+            break;
+    }
+}
+
+/* Take ownership of a string a native function returned. */
+static int
+keep_string(CPVM *vm, CPString *string)
+{
+    if(vm->string_count == vm->string_capacity) {
+        size_t capacity = vm->string_capacity ? vm->string_capacity * 2 : 16;
+        CPString **strings = realloc(vm->strings, capacity * sizeof(CPString *));
+        if(strings == NULL) {
+            CPString_Free(string);
+            return -1;
+        }
+        vm->strings = strings;
+        vm->string_capacity = capacity;
+    }
+    vm->strings[vm->string_count++] = string;
+    return 0;
+}
+
+static int
+runtime_error(CPVM *vm, const char *fmt, ...)
+{
+    char message[256];
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(message, sizeof(message), fmt, args);
+    va_end(args);
+    const char *where = "?";
+    if(vm->frame_count > 0) {
+        where = vm->module->functions[vm->frames[vm->frame_count - 1].function].name->data;
+    }
+    cp_report_error("Runtime error in function '%s': %s", where, message);
+    return -1;
+}
+
+static int
+truthy(const CPValue *value)
+{
+    switch(value->type) {
+        case CP_VALUE_INT:
+            return value->as.i != 0;
+        case CP_VALUE_FLOAT:
+            return value->as.f != 0.0;
+        case CP_VALUE_STRING:
+            return value->as.s->length != 0;
+        default:
+            return 1;
+    }
+}
+
+static inline double
+as_float(const CPValue *value)
+{
+    return value->type == CP_VALUE_INT ? (double)value->as.i : value->as.f;
+}
+
+static inline int
+is_number(const CPValue *value)
+{
+    return value->type == CP_VALUE_INT || value->type == CP_VALUE_FLOAT;
+}
+
+/* Integers wrap around rather than overflow. */
+static int
+arithmetic(CPVM *vm, unsigned char op, CPValue *a, const CPValue *b)
+{
+    if(!is_number(a) || !is_number(b)) {
+        return runtime_error(vm, "Unsupported operand types for %s.", cp_opcodes[op].name);
+    }
+    if(a->type == CP_VALUE_INT && b->type == CP_VALUE_INT) {
+        uint64_t x = (uint64_t)a->as.i, y = (uint64_t)b->as.i;
+        switch(op) {
+            case CP_OP_ADD: x += y; break;
+            case CP_OP_SUB: x -= y; break;
+            case CP_OP_MUL: x *= y; break;
+            default:
+                if(y == 0) {
+                    return runtime_error(vm, "Division by zero.");
+                }
+                /* INT64_MIN / -1 is the one quotient that overflows. */
+                x = b->as.i == -1 ? 0 - x : (uint64_t)(a->as.i / b->as.i);
+                break;
+        }
+        a->as.i = (int64_t)x;
+        return 0;
+    }
+    double x = as_float(a), y = as_float(b);
+    switch(op) {
+        case CP_OP_ADD: x += y; break;
+        case CP_OP_SUB: x -= y; break;
+        case CP_OP_MUL: x *= y; break;
+        default: x /= y; break;
+    }
+    a->type = CP_VALUE_FLOAT;
+    a->as.f = x;
+    return 0;
+}
+
+static int
+compare(CPVM *vm, unsigned char op, CPValue *a, const CPValue *b)
+{
+    int result;
+    if(op == CP_OP_EQUAL) {
+        if(is_number(a) && is_number(b)) {
+            result = a->type == CP_VALUE_INT && b->type == CP_VALUE_INT ?
+                     a->as.i == b->as.i : as_float(a) == as_float(b);
+        } else if(a->type != b->type) {
+            result = 0;
+        } else if(a->type == CP_VALUE_STRING) {
+            result = CPString_Equal(a->as.s, b->as.s);
+        } else {
+            result = a->as.function == b->as.function;
+        }
+    } else {
+        if(!is_number(a) || !is_number(b)) {
+            return runtime_error(vm, "Unsupported operand types for %s.", cp_opcodes[op].name);
+        }
+        if(a->type == CP_VALUE_INT && b->type == CP_VALUE_INT) {
+            result = op == CP_OP_LESS ? a->as.i < b->as.i : a->as.i <= b->as.i;
+        } else {
+            result = op == CP_OP_LESS ? as_float(a) < as_float(b) : as_float(a) <= as_float(b);
+        }
+    }
+    a->type = CP_VALUE_INT;
+    a->as.i = result;
+    return 0;
+}
+
+/* Make sure `function' can be called: local, and compiled. */
+static int
+resolve(CPVM *vm, uint32_t function)
+{
+    const CPModule *module = vm->module;
+    if(function & CP_BYTECODE_IMPORT_BIT) {
+        uint32_t i = function & ~CP_BYTECODE_IMPORT_BIT;
+        return runtime_error(vm, "Unresolved import '%s.%s'; link the program first.",
+                             CPModule_ImportModule(module, i)->data, CPModule_ImportName(module, i)->data);
+    }
+    if(module->functions[function].code == NULL &&
+       (vm->compile == NULL || vm->compile(vm->context, function) != 0 || grow_slots(vm) != 0)) {
+        return -1;
+    }
+    return 0;
+}
+
+/* The value of the global `name', created as 0 if `define' is set; NULL if none. */
+static CPValue *
+find_global(CPVM *vm, const CPString *name, int define)
+{
+    if(!define) {
+        CPHashMapEntry *entry = CPHashMap_Find(&vm->globals, name, 0);
+        return entry != NULL ? entry->value : NULL;
+    }
+    int inserted;
+    CPHashMapEntry *entry = CPHashMap_Put(&vm->globals, name, 0, &inserted);
+    if(entry == NULL) {
+        return NULL;
+    }
+    if(inserted) {
+        CPValue *value = CPSlab_Alloc(sizeof(CPValue));
+        if(value == NULL) {
+            CPHashMap_Remove(&vm->globals, name, 0);
+            return NULL;
+        }
+        value->type = CP_VALUE_INT;
+        value->as.i = 0;
+        entry->value = value;
+        vm->globals_version++;
+    }
+    return entry->value;
+}
+
+/*
+ * Resolve NATIVES entry `index' once; later calls go straight through
+ * its slot.
+ */
+static int
+bind_native(CPVM *vm, uint32_t index)
+{
+    const CPModule *module = vm->module;
+    return CPFFI_Bind(&vm->natives[index], CPModule_Native(module, index, 0)->data,
+                      CPModule_Native(module, index, 1)->data, CPModule_Native(module, index, 2)->data);
+}
+
+/* The slow path of the GLOBAL_SLOT opcodes: look the name up again. */
+static CPValue *
+refill_slot(CPVM *vm, uint32_t index, int define)
+{
+    CPGlobalSlot *slot = &vm->slots[index];
+    slot->value = find_global(vm, CPModule_GlobalName(vm->module, index), define);
+    slot->version = vm->globals_version;
+    return slot->value;
+}
+
+/* Push a frame for `function', whose arguments are on top of the stack. */
+static int
+enter(CPVM *vm, uint32_t function)
+{
+    if(resolve(vm, function) != 0) {
+        return -1;
+    }
+    const CPModuleFunction *callee = &vm->module->functions[function];
+    size_t extra = (size_t)(callee->locals - callee->params);
+    if(CHECK_STACK && (vm->frame_count == CP_VM_FRAMES_SIZE || CP_VM_STACK_SIZE - vm->sp < extra)) {
+        return runtime_error(vm, "Stack overflow.");
+    }
+    CPFrame *frame = &vm->frames[vm->frame_count++];
+    frame->function = function;
+    frame->pc = 0;
+    frame->base = vm->sp - callee->params;
+    CPProfile_PushFrame(callee->name->data);
+    for(size_t i = 0; i < extra; i++) {
+        vm->stack[vm->sp].type = CP_VALUE_INT;
+        vm->stack[vm->sp++].as.i = 0;
+    }
+    return 0;
+}
+
+/*
+ * Reuse the top frame for `function': its arguments move down over the
+ * caller's, so a chain of tail calls runs in constant stack.
+ */
+static int
+enter_tail(CPVM *vm, uint32_t function)
+{
+    if(resolve(vm, function) != 0) {
+        return -1;
+    }
+    const CPModuleFunction *callee = &vm->module->functions[function];
+    size_t extra = (size_t)(callee->locals - callee->params);
+    CPFrame *frame = &vm->frames[vm->frame_count - 1];
+    if(CHECK_STACK && CP_VM_STACK_SIZE - frame->base - callee->params < extra) {
+        return runtime_error(vm, "Stack overflow.");
+    }
+    memmove(vm->stack + frame->base, vm->stack + vm->sp - callee->params, callee->params * sizeof(CPValue));
+    vm->sp = frame->base + callee->params;
+    frame->function = function;
+    frame->pc = 0;
+    CPProfile_PopFrame();
+    CPProfile_PushFrame(callee->name->data);
+    for(size_t i = 0; i < extra; i++) {
+        vm->stack[vm->sp].type = CP_VALUE_INT;
+        vm->stack[vm->sp++].as.i = 0;
+    }
+    return 0;
+}
+
+/*
+ * Resume at the innermost handler around the pc of the top frame, or of
+ * the frames below it down to `floor', with the exception on the stack.
+ * This is the only reader of the HANDLERS tables, so code that never
+ * throws pays nothing for its try regions.
+ */
+static int
+unwind(CPVM *vm, size_t floor, const CPValue *exception)
+{
+    const CPModule *module = vm->module;
+    const CPString *thrower = module->functions[vm->frames[vm->frame_count - 1].function].name;
+    while(vm->frame_count > floor) {
+        CPFrame *frame = &vm->frames[vm->frame_count - 1];
+        const CPModuleFunction *function = &module->functions[frame->function];
+        /* The saved pc is just past the THROW or the CALL. */
+        uint32_t at = frame->pc - 1;
+        for(uint32_t i = 0; i < function->handler_count; i++) {
+            const unsigned char *record = function->handlers + (size_t)i * CP_BYTECODE_HANDLER_SIZE;
+            if(at >= CPBytecode_GetU32(record + 4) && at < CPBytecode_GetU32(record + 8)) {
+                vm->sp = frame->base + function->locals;
+                vm->stack[vm->sp++] = *exception;
+                frame->pc = CPBytecode_GetU32(record + 12);
+                return 0;
+            }
+        }
+        vm->sp = frame->base;
+        vm->frame_count--;
+        CPProfile_PopFrame();
+    }
+    char buffer[CP_NUM_BUFFER_SIZE];
+    const char *text = buffer;
+    switch(exception->type) {
+        case CP_VALUE_INT:
+            CPNum_FormatI64(exception->as.i, buffer);
+            break;
+        case CP_VALUE_FLOAT:
+            CPNum_FormatDouble(exception->as.f, buffer);
+            break;
+        case CP_VALUE_STRING:
+            text = exception->as.s->data;
+            break;
+        default:
+            text = module->functions[exception->as.function].name->data;
+            break;
+    }
+    cp_report_error("Uncaught exception thrown in function '%s': %s", thrower->data, text);
+    return -1;
+}
+
+#define PUSH(v) \
+    do { \
+        if(CHECK_STACK && CP_UNLIKELY(vm->sp == CP_VM_STACK_SIZE)) { \
+            rv = runtime_error(vm, "Stack overflow."); \
+            goto end; \
+        } \
+        vm->stack[vm->sp++] = (v); \
+    } while(0)
+
+#define POP() (vm->stack[--vm->sp])
+#define TOP() (vm->stack[vm->sp - 1])
+
+static int
+run(CPVM *vm, size_t floor, CPValue *result)
+{
+    const CPModule *module = vm->module;
+    int rv = 0;
+    CPFrame *frame;
+    const unsigned char *code;
+    CPValue *locals;
+    uint32_t pc;
+    CPValue value;
+    /* Profiles start and stop outside of runs, so test this once. */
+    const int profiling = cp_profile_running;
+
+#define LOAD_FRAME() \
+    do { \
+        frame = &vm->frames[vm->frame_count - 1]; \
+        code = module->functions[frame->function].code; \
+        locals = vm->stack + frame->base; \
+        pc = frame->pc; \
+    } while(0)
+
+    LOAD_FRAME();
+    for(;;) {
+        unsigned char op = code[pc];
+        uint32_t operand = 0;
+        CP_OPSTATS_DISPATCH(op);
+        if(CP_UNLIKELY(profiling)) {
+            CPProfile_SetOffset(pc);
+        }
+        if(cp_opcodes[op].operand != CP_OPERAND_NONE) {
+            operand = CPBytecode_GetU32(code + pc + 1);
+            pc += 5;
+        } else {
+            pc++;
+        }
+        switch(op) {
+            case CP_OP_NOP:
+                break;
+            case CP_OP_LOAD_CONST:
+                if(CPModule_ConstantKind(module, operand) == CP_BYTECODE_CONSTANT_INT) {
+                    value.type = CP_VALUE_INT;
+                    value.as.i = (int64_t)CPModule_ConstantValue(module, operand);
+                } else {
+                    uint64_t bits = CPModule_ConstantValue(module, operand);
+                    value.type = CP_VALUE_FLOAT;
+                    memcpy(&value.as.f, &bits, sizeof(double));
+                }
+                PUSH(value);
+                break;
+            case CP_OP_LOAD_STRING:
+                value.type = CP_VALUE_STRING;
+                value.as.s = module->strings[operand];
+                PUSH(value);
+                break;
+            case CP_OP_LOAD_LOCAL:
+                PUSH(locals[operand]);
+                break;
+            case CP_OP_STORE_LOCAL:
+                locals[operand] = POP();
+                break;
+            case CP_OP_LOAD_GLOBAL: {
+                CPValue *global = find_global(vm, module->strings[operand], 0);
+                if(global == NULL) {
+                    frame->pc = pc;
+                    rv = runtime_error(vm, "Undefined global '%s'.", module->strings[operand]->data);
+                    goto end;
+                }
+                PUSH(*global);
+                break;
+            }
+            case CP_OP_STORE_GLOBAL: {
+                CPValue *global = find_global(vm, module->strings[operand], 1);
+                if(global == NULL) {
+                    rv = runtime_error(vm, "Out of memory.");
+                    goto end;
+                }
+                *global = POP();
+                break;
+            }
+            case CP_OP_LOAD_GLOBAL_SLOT: {
+                CPValue *global = vm->slots[operand].value;
+                if(CP_UNLIKELY(vm->slots[operand].version != vm->globals_version)) {
+                    global = refill_slot(vm, operand, 0);
+                }
+                if(CP_UNLIKELY(global == NULL)) {
+                    frame->pc = pc;
+                    rv = runtime_error(vm, "Undefined global '%s'.", CPModule_GlobalName(module, operand)->data);
+                    goto end;
+                }
+                PUSH(*global);
+                break;
+            }
+            case CP_OP_STORE_GLOBAL_SLOT: {
+                CPValue *global = vm->slots[operand].value;
+                if(CP_UNLIKELY(global == NULL || vm->slots[operand].version != vm->globals_version)) {
+                    global = refill_slot(vm, operand, 1);
+                    if(global == NULL) {
+                        rv = runtime_error(vm, "Out of memory.");
+                        goto end;
+                    }
+                }
+                *global = POP();
+                break;
+            }
+            case CP_OP_LOAD_FUNCTION:
+                value.type = CP_VALUE_FUNCTION;
+                value.as.function = operand;
+                PUSH(value);
+                break;
+            case CP_OP_CALL:
+                frame->pc = pc;
+                if(enter(vm, operand) != 0) {
+                    rv = -1;
+                    goto end;
+                }
+                LOAD_FRAME();
+                break;
+            case CP_OP_TAIL_CALL:
+                frame->pc = pc;
+                if(enter_tail(vm, operand) != 0) {
+                    rv = -1;
+                    goto end;
+                }
+                LOAD_FRAME();
+                break;
+            case CP_OP_CALL_NATIVE: {
+                CPNativeSlot *native = &vm->natives[operand];
+                frame->pc = pc;
+                if(CP_UNLIKELY(native->call == NULL) && bind_native(vm, operand) != 0) {
+                    rv = -1;
+                    goto end;
+                }
+                vm->sp -= native->params;
+                if(native->call(native->function, vm->stack + vm->sp, &value) != 0) {
+                    rv = runtime_error(vm, "Wrong argument types for native function '%s'.",
+                                       CPModule_Native(module, operand, 1)->data);
+                    goto end;
+                }
+                if(value.type == CP_VALUE_STRING && keep_string(vm, (CPString *)value.as.s) != 0) {
+                    rv = runtime_error(vm, "Out of memory.");
+                    goto end;
+                }
+                PUSH(value);
+                break;
+            }
+            case CP_OP_RETURN:
+                value = POP();
+                vm->sp = frame->base;
+                CPProfile_PopFrame();
+                if(--vm->frame_count == floor) {
+                    *result = value;
+                    goto end;
+                }
+                PUSH(value);
+                LOAD_FRAME();
+                break;
+            case CP_OP_THROW:
+                value = POP();
+                frame->pc = pc;
+                if(unwind(vm, floor, &value) != 0) {
+                    rv = -1;
+                    goto end;
+                }
+                LOAD_FRAME();
+                break;
+            case CP_OP_POP:
+                vm->sp--;
+                break;
+            case CP_OP_PRINT:
+                value = POP();
+                CPVM_Print(vm->out, module, &value);
+                fputc('\n', vm->out);
+                break;
+            case CP_OP_ADD:
+            case CP_OP_SUB:
+            case CP_OP_MUL:
+            case CP_OP_DIV:
+                value = POP();
+                if(arithmetic(vm, op, &TOP(), &value) != 0) {
+                    rv = -1;
+                    goto end;
+                }
+                break;
+            case CP_OP_LESS:
+            case CP_OP_LESS_EQUAL:
+            case CP_OP_EQUAL:
+                value = POP();
+                if(compare(vm, op, &TOP(), &value) != 0) {
+                    rv = -1;
+                    goto end;
+                }
+                break;
+            case CP_OP_NOT:
+                value.type = CP_VALUE_INT;
+                value.as.i = !truthy(&TOP());
+                TOP() = value;
+                break;
+            case CP_OP_JUMP:
+                pc = operand;
+                break;
+            case CP_OP_JUMP_IF_FALSE:
+                value = POP();
+                if(!truthy(&value)) {
+                    pc = operand;
+                }
+                break;
+            default:
+                CP_UNREACHABLE();
+                break;
+        }
+    }
+end:
+    CP_OPSTATS_LEAVE();
+    return rv;
+#undef LOAD_FRAME
+}
+
+int
+CPVM_Call(CPVM *vm, uint32_t function, const CPValue *args, uint32_t argc, CPValue *result)
+{
+    const CPModule *module = vm->module;
+    if(function >= module->function_count) {
+        return -1;
+    }
+    if(argc != module->functions[function].params) {
+        cp_report_error("Function '%s' takes %u arguments, not %u.",
+                        module->functions[function].name->data, (unsigned)module->functions[function].params,
+                        (unsigned)argc);
+        return -1;
+    }
+    size_t sp = vm->sp, floor = vm->frame_count;
+    int profile_depth = cp_profile_depth;
+    if(CP_VM_STACK_SIZE - vm->sp < argc) {
+        return runtime_error(vm, "Stack overflow.");
+    }
+    int rv = 0;
+#if !CHECK_STACK
+    sigjmp_buf overflow;
+    CPVM *outer_vm = current_vm;
+    void *outer_overflow = vm->overflow;
+    current_vm = vm;
+    vm->overflow = &overflow;
+    if(sigsetjmp(overflow, 0) != 0) {
+        /* A push ran into a guard page, maybe half way through a frame. */
+        if(vm->frame_count > CP_VM_FRAMES_SIZE) {
+            vm->frame_count = CP_VM_FRAMES_SIZE;
+        }
+        runtime_error(vm, "Stack overflow.");
+        rv = -1;
+        goto done;
+    }
+#endif
+    for(uint32_t i = 0; i < argc; i++) {
+        vm->stack[vm->sp++] = args[i];
+    }
+    if(enter(vm, function) != 0 || run(vm, floor, result) != 0) {
+        rv = -1;
+        goto done;
+    }
+done:
+    if(rv != 0) {
+        /* Unwind whatever the error left behind. */
+        vm->sp = sp;
+        vm->frame_count = floor;
+        cp_profile_depth = profile_depth;
+    }
+#if !CHECK_STACK
+    current_vm = outer_vm;
+    vm->overflow = outer_overflow;
+#endif
+    return rv;
+}
@@ -0,0 +1,129 @@
+/*
+ * vm.h - the bytecode interpreter.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_VM_H_
+#define _CP_VM_H_
+
+#include "hashmap.h"
+#include "intern.h"
+#include "module.h"
+#include "platform/mmap.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define CP_VALUE_INT 0
+#define CP_VALUE_FLOAT 1
+#define CP_VALUE_STRING 2
+#define CP_VALUE_FUNCTION 3
+
+typedef struct
+{
+    uint32_t type;
+    union
+    {
+        int64_t i;
+        double f;
+        const CPString *s;
+        uint32_t function;
+    } as;
+} CPValue;
+
+typedef struct
+{
+    uint32_t function;
+    uint32_t pc;
+    /* Index of the first local in the value stack. */
+    size_t base;
+} CPFrame;
+
+/*
+ * The dictionary entry a GLOBAL operand named, as of `version'.  The
+ * entry, or its absence, holds while the VM's globals_version does.
+ */
+typedef struct
+{
+    CPValue *value;
+    uint64_t version;
+} CPGlobalSlot;
+
+/* Defined in ffi.h. */
+typedef struct CPNativeSlot CPNativeSlot;
+
+#define CP_VM_STACK_SIZE (64 * 1024)
+#define CP_VM_FRAMES_SIZE (8 * 1024)
+
+/*
+ * Called before the first call of a function whose code is NULL; it
+ * must fill in the code or return -1.  The module's tables may move.
+ */
+typedef int (*CPVMCompileFunc)(void *context, uint32_t function);
+
+typedef struct
+{
+    const CPModule *module;
+    CPVMCompileFunc compile;
+    void *context;
+    FILE *out;
+    /*
+     * One mapping holds both stacks, each followed by a PROT_NONE guard
+     * page, so pushing past either end faults rather than being checked.
+     */
+    CPMemoryMapping stacks;
+    CPValue *stack;
+    size_t sp;
+    CPFrame *frames;
+    size_t frame_count;
+    /* Where a fault in a guard page resumes, while CPVM_Call() runs. */
+    void *overflow;
+    /* Interned name to a CPValue from the slab allocator. */
+    CPHashMap globals;
+    /* Bumped whenever a name is added to `globals'. */
+    uint64_t globals_version;
+    /* One per entry of the module's GLOBALS table. */
+    CPGlobalSlot *slots;
+    uint32_t slot_count;
+    /* One per entry of the module's NATIVES table, bound on first call. */
+    CPNativeSlot *natives;
+    uint32_t native_count;
+    /* Strings native functions returned; they live until CPVM_Destroy(). */
+    CPString **strings;
+    size_t string_count;
+    size_t string_capacity;
+} CPVM;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The module's code must pass CPModule_Verify(); the interpreter does
+ * not check operands again.  PRINT writes to `vm->out', stdout unless
+ * changed after CPVM_Init().
+ */
+int CPVM_Init(CPVM *vm, const CPModule *module);
+void CPVM_Destroy(CPVM *vm);
+int CPVM_Call(CPVM *vm, uint32_t function, const CPValue *args, uint32_t argc, CPValue *result);
+void CPVM_Print(FILE *out, const CPModule *module, const CPValue *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_VM_H_ */
@@ -0,0 +1,271 @@
+/*
+ * watch.c - recompile sources as they change.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+#include "watch.h"
+#include "build.h"
+#include "report_error.h"
+#include "safe_string.h"
+#include "platform/clock.h"
+
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int
+changed(void *context, const char *name)
+{
+    CPWatcher *watcher = context;
+    size_t length = strlen(name);
+    size_t suffix = sizeof(CP_BUILD_SOURCE_SUFFIX) - 1;
+    if(length <= suffix || strcmp(name + length - suffix, CP_BUILD_SOURCE_SUFFIX) != 0) {
+        return 0;
+    }
+    const CPString *module = CPString_Intern(name, length - suffix);
+    int inserted;
+    if(module == NULL || CPHashMap_Put(&watcher->pending, module, 0, &inserted) == NULL) {
+        return -1;
+    }
+    return 0;
+}
+
+static void
+close_module(CPWatchedModule *module)
+{
+    if(module->open) {
+        CPCompiler_Close(&module->compiler);
+        module->open = 0;
+    }
+    module->ok = 0;
+}
+
+static CPWatchedModule *
+get_module(CPWatcher *watcher, const CPString *name)
+{
+    int inserted;
+    CPHashMapEntry *entry = CPHashMap_Put(&watcher->modules, name, 0, &inserted);
+    if(entry == NULL || !inserted) {
+        return entry != NULL ? entry->value : NULL;
+    }
+    CPWatchedModule *module = calloc(1, sizeof(CPWatchedModule));
+    if(module == NULL) {
+        CPHashMap_Remove(&watcher->modules, name, 0);
+        return NULL;
+    }
+    module->name = name;
+    /* Resolved once, for as long as the file exists. */
+    if(CPath_Join(module->path, watcher->dir, name->data) != 0 ||
+       strcat_safe(module->path, CP_BUILD_SOURCE_SUFFIX, CP_MAX_PATH) != 0 ||
+       CPath_Join(module->image, watcher->build_dir, name->data) != 0 ||
+       strcat_safe(module->image, ".cpm", CP_MAX_PATH) != 0) {
+        CPHashMap_Remove(&watcher->modules, name, 0);
+        free(module);
+        return NULL;
+    }
+    entry->value = module;
+    return module;
+}
+
+/* Returns 1 if the module's interface changed. */
+static int
+recompile(CPWatcher *watcher, const CPString *name)
+{
+    struct stat st;
+    CPHashMapEntry *entry = CPHashMap_Find(&watcher->modules, name, 0);
+    CPWatchedModule *module = entry != NULL ? entry->value : NULL;
+    char path[CP_MAX_PATH];
+    if(module != NULL) {
+        strcpy(path, module->path);
+    } else if(CPath_Join(path, watcher->dir, name->data) != 0 ||
+              strcat_safe(path, CP_BUILD_SOURCE_SUFFIX, CP_MAX_PATH) != 0) {
+        return 0;
+    }
+    if(stat(path, &st) != 0) {
+        if(module == NULL) {
+            return 0;
+        }
+        close_module(module);
+        remove(module->image);
+        CPHashMap_Remove(&watcher->modules, name, 0);
+        free(module);
+        watcher->stats.compiled++;
+        return 1;
+    }
+    module = get_module(watcher, name);
+    if(module == NULL) {
+        watcher->stats.failed++;
+        return 0;
+    }
+    close_module(module);
+    uint64_t hash = module->interface_hash;
+    if(CPCompiler_Open(&module->compiler, module->path) == 0) {
+        module->open = 1;
+        module->interface_hash = CPCompiler_InterfaceHash(&module->compiler);
+        module->ok = CPCompiler_Write(&module->compiler, module->image) == 0;
+    }
+    if(module->ok) {
+        watcher->stats.compiled++;
+    } else {
+        watcher->stats.failed++;
+    }
+    return module->interface_hash != hash;
+}
+
+/*
+ * Imports are bound by name at link time; check them and their argument
+ * counts now so a call into a changed interface is reported without
+ * linking.
+ */
+static void
+check_imports(CPWatcher *watcher, CPWatchedModule *module)
+{
+    const CPModule *view = &module->compiler.module;
+    for(uint32_t i = 0; i < view->import_count; i++) {
+        const CPString *name = CPModule_ImportModule(view, i);
+        const CPString *function = CPModule_ImportName(view, i);
+        CPHashMapEntry *entry = CPHashMap_Find(&watcher->modules, name, 0);
+        const CPWatchedModule *target = entry != NULL ? entry->value : NULL;
+        int64_t index = target != NULL && target->open ? CPCompiler_Find(&target->compiler, function->data) : -1;
+        if(index < 0) {
+            cp_report_error("Undefined function '%s.%s' referenced from module '%s'.",
+                            name->data, function->data, module->name->data);
+            watcher->stats.failed++;
+            return;
+        }
+        uint32_t params = target->compiler.functions[index].params;
+        if(CPModule_ImportParams(view, i) != params) {
+            cp_report_error("Function '%s.%s' takes %u arguments, not %u as called from module '%s'.",
+                            name->data, function->data, params, CPModule_ImportParams(view, i),
+                            module->name->data);
+            watcher->stats.failed++;
+            return;
+        }
+    }
+}
+
+static int
+imports_changed(const CPWatcher *watcher, const CPWatchedModule *module)
+{
+    for(uint32_t i = 0; i < module->compiler.import_count; i++) {
+        CPHashMapEntry *entry = CPHashMap_Find(&watcher->pending, module->compiler.imports[i], 0);
+        if(entry != NULL && entry->value != NULL) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int
+rebuild(CPWatcher *watcher)
+{
+    uint64_t start = CPClock_Monotonic();
+    int count = (int)watcher->pending.size;
+    size_t iterator = 0;
+    CPHashMapEntry *entry;
+    while((entry = CPHashMap_Next(&watcher->pending, &iterator)) != NULL) {
+        if(recompile(watcher, entry->key)) {
+            entry->value = (void *)1;
+        }
+    }
+    iterator = 0;
+    while((entry = CPHashMap_Next(&watcher->modules, &iterator)) != NULL) {
+        CPWatchedModule *module = entry->value;
+        if(module->ok && (CPHashMap_Find(&watcher->pending, module->name, 0) != NULL ||
+                          imports_changed(watcher, module))) {
+            check_imports(watcher, module);
+        }
+    }
+    CPHashMap_Clear(&watcher->pending);
+    watcher->stats.batches++;
+    watcher->stats.last_batch_ns = CPClock_Monotonic() - start;
+    return count;
+}
+
+int
+CPWatcher_Open(CPWatcher *watcher, const char *dir)
+{
+    memset(watcher, 0, sizeof(CPWatcher));
+    if(strcpy_safe(watcher->dir, dir, CP_MAX_PATH) != 0 ||
+       CPath_Join(watcher->build_dir, dir, CP_BUILD_DIR) != 0) {
+        cp_report_error("Path too long: '%s'.", dir);
+        return -1;
+    }
+#ifdef _WIN32
+    int made = _mkdir(watcher->build_dir);
+#else
+    int made = mkdir(watcher->build_dir, 0777);
+#endif
+    if(made != 0 && errno != EEXIST) {
+        cp_report_error("Cannot create '%s'.", watcher->build_dir);
+        return -1;
+    }
+    if(CPDirWatch_Open(&watcher->watch, watcher->dir) != 0) {
+        cp_report_error("Cannot watch '%s'.", dir);
+        return -1;
+    }
+    if(CPHashMap_Init(&watcher->modules, CP_HASHMAP_KEY_INTEGER, 0) != 0 ||
+       CPHashMap_Init(&watcher->pending, CP_HASHMAP_KEY_INTEGER, 0) != 0) {
+        CPHashMap_Destroy(&watcher->modules);
+        CPDirWatch_Close(&watcher->watch);
+        return -1;
+    }
+    if(CPDirWatch_List(dir, changed, watcher) != 0) {
+        CPWatcher_Close(watcher);
+        cp_report_error("Cannot read '%s'.", dir);
+        return -1;
+    }
+    rebuild(watcher);
+    return 0;
+}
+
+int
+CPWatcher_Poll(CPWatcher *watcher, int timeout_ms)
+{
+    int rv = CPDirWatch_Wait(&watcher->watch, timeout_ms, changed, watcher);
+    /* Editors save in several steps and checkouts touch many files. */
+    while(rv > 0) {
+        rv = CPDirWatch_Wait(&watcher->watch, CP_WATCH_DEBOUNCE_MS, changed, watcher);
+    }
+    if(rv < 0) {
+        return -1;
+    }
+    if(watcher->pending.size == 0) {
+        return 0;
+    }
+    return rebuild(watcher);
+}
+
+void
+CPWatcher_Close(CPWatcher *watcher)
+{
+    size_t iterator = 0;
+    CPHashMapEntry *entry;
+    while((entry = CPHashMap_Next(&watcher->modules, &iterator)) != NULL) {
+        close_module(entry->value);
+        free(entry->value);
+    }
+    CPHashMap_Destroy(&watcher->modules);
+    CPHashMap_Destroy(&watcher->pending);
+    CPDirWatch_Close(&watcher->watch);
+}
@@ -0,0 +1,92 @@
+/*
+ * watch.h - recompile sources as they change.
+ * Copyright (C) 2026 Huang Jiangyao. All rights reserved.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#ifndef _CP_WATCH_H_
+#define _CP_WATCH_H_
+
+#include "compiler.h"
+#include "hashmap.h"
+#include "intern.h"
+#include "path.h"
+#include "platform/dirwatch.h"
+
+#include <stdint.h>
+
+/* Quiet time that ends a burst of changes. */
+#define CP_WATCH_DEBOUNCE_MS 30
+
+typedef struct
+{
+    const CPString *name;
+    char path[CP_MAX_PATH];
+    char image[CP_MAX_PATH];
+    CPCompiler compiler;
+    int open;
+    /* Compiled without errors. */
+    int ok;
+    uint64_t interface_hash;
+} CPWatchedModule;
+
+typedef struct
+{
+    uint32_t batches;
+    uint32_t compiled;
+    uint32_t failed;
+    uint64_t last_batch_ns;
+} CPWatchStats;
+
+/*
+ * Every NAME.cp in a directory, compiled to .cpbuild/NAME.cpm as in
+ * build.h.  The compilers stay open between changes so that interned
+ * names, paths and the modules nothing touched are reused; a change
+ * recompiles the changed files and re-checks the calls into any module
+ * whose interface changed.  CPString_Reset() must not be called while
+ * a watcher is open.
+ */
+typedef struct
+{
+    char dir[CP_MAX_PATH];
+    char build_dir[CP_MAX_PATH];
+    CPDirWatch watch;
+    /* Module name to CPWatchedModule *. */
+    CPHashMap modules;
+    /* Names changed since the last batch; value 1 once the interface did. */
+    CPHashMap pending;
+    CPWatchStats stats;
+} CPWatcher;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Start watching `dir' and compile what it holds. */
+int CPWatcher_Open(CPWatcher *watcher, const char *dir);
+/*
+ * Wait up to `timeout_ms', or forever if negative, for changes; then
+ * wait for them to settle and recompile.  Returns the number of
+ * changed modules, 0 if no source changed, or -1.  Compilation errors
+ * are reported and counted in the stats, not returned.
+ */
+int CPWatcher_Poll(CPWatcher *watcher, int timeout_ms);
+void CPWatcher_Close(CPWatcher *watcher);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _CP_WATCH_H_ */